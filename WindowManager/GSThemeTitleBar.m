@@ -11,6 +11,7 @@
 #import <cairo/cairo-xcb.h>
 #import <XCBKit/services/ICCCMService.h>
 #import "URSThemeIntegration.h"
+#import "URSPixelOps.h"
 
 @implementation GSThemeTitleBar
 
@@ -204,6 +205,11 @@
 
     cairo_t *ctx = cairo_create(x11Surface);
 
+    // NSBitmapImageRep is RGBA; Cairo ARGB32 expects premultiplied BGRA
+    BOOL straightAlpha = ([bitmap bitmapFormat] & NSAlphaNonpremultipliedBitmapFormat) != 0;
+    URSPixelConvertRGBAToCairo([bitmap bitmapData], [bitmap pixelsWide], [bitmap pixelsHigh],
+                               [bitmap bytesPerRow], straightAlpha);
+
     // Create Cairo image surface from bitmap data
     cairo_surface_t *imageSurface = cairo_image_surface_create_for_data(
         [bitmap bitmapData],
@@ -422,18 +422,11 @@
 
 - (XCBFrame*)findAssociatedFrame {
     // Search through connection's windows to find the frame associated with this titlebar
-    NSDictionary *windowsMap = [self.connection windowsMap];
+    for (XCBFrame *frame in [self.connection framesMap]) {
+        XCBWindow *titlebarWindow = [frame childWindowForKey:TitleBar];
 
-    for (NSString *windowIdString in windowsMap) {
-        XCBWindow *window = [windowsMap objectForKey:windowIdString];
-
-        if ([window isKindOfClass:[XCBFrame class]]) {
-            XCBFrame *frame = (XCBFrame*)window;
-            XCBWindow *titlebarWindow = [frame childWindowForKey:TitleBar];
-
-            if (titlebarWindow && [titlebarWindow window] == self.windowId) {
-                return frame;
-            }
+        if (titlebarWindow && [titlebarWindow window] == self.windowId) {
+            return frame;
         }
     }
     return nil;
@@ -11,6 +11,9 @@
 #import <XCBKit/XCBConnection.h>
 #import <XCBKit/utils/XCBShape.h>
 
+// Set in xcb_damage_notify_event_t.level when more DeltaRectangles events follow
+#define URS_DAMAGE_NOTIFY_MORE 0x80
+
 @interface URSCompositingManager : NSObject
 
 // Singleton access
@@ -39,10 +42,11 @@
 - (void)moveWindow:(xcb_window_t)windowId x:(int16_t)x y:(int16_t)y;
 - (void)resizeWindow:(xcb_window_t)windowId x:(int16_t)x y:(int16_t)y 
                width:(uint16_t)width height:(uint16_t)height;
-// Invalidate cached pixmap/picture for a window (force re-acquire after move)
+// Repaint a window, re-acquiring its pixmap only if its size changed since it was named
 - (void)invalidateWindowPixmap:(xcb_window_t)windowId;
 
-// OPTIMIZATION: Notify compositor that stacking order changed (window raised/lowered)
+// Resynchronize the stacking order with query_tree and repaint everything. Not
+// needed for ordinary raises and lowers, which arrive as ConfigureNotify.
 - (void)markStackingOrderDirty;
 
 // Window animations (compositing-only)
@@ -77,11 +81,34 @@
 // Perform repair immediately without deferring (for critical updates like cursor blinking)
 - (void)performRepairNow;
 
-// Handle damage events
-- (void)handleDamageNotify:(xcb_window_t)window;
-
-// Handle expose events - forces pixmap recreation for exposed windows
-- (void)handleExposeEvent:(xcb_window_t)window;
+// Handle damage events (area is one damaged rectangle, relative to window;
+// more is set while further rectangles of the same batch follow)
+- (void)handleDamageNotify:(xcb_window_t)window area:(xcb_rectangle_t)area more:(BOOL)more;
+
+// Windows are adopted asynchronously: attribute/geometry replies (and shape and
+// stacking resync replies) are collected here without blocking. Call before
+// handling each event batch; while hasPendingReplies, call again soon.
+- (void)collectPendingReplies;
+- (BOOL)hasPendingReplies;
+
+// Handle Present CompleteNotify (GenericEvent); returns YES if it was consumed
+- (BOOL)handlePresentEvent:(xcb_generic_event_t *)event;
+
+// Frame clock statistics (framesPainted, framesSkipped, paint latency and its
+// p50/p90/p99 over recent frames, interval; requestsPerFrame when benchmarking)
+- (NSDictionary *)frameStatistics;
+
+// Handle expose events - repaints the exposed area (area is relative to window);
+// the pixmap is only re-acquired if the server replaced it
+- (void)handleExposeEvent:(xcb_window_t)window area:(xcb_rectangle_t)area;
+
+// Window tree cache (child -> frame lookup and root origins without round-trips)
+// and the root's stacking order (ConfigureNotify above_sibling, CirculateNotify)
+- (void)trackCreateNotify:(xcb_create_notify_event_t *)event;
+- (void)trackReparentNotify:(xcb_reparent_notify_event_t *)event;
+- (void)trackConfigureNotify:(xcb_configure_notify_event_t *)event;
+- (void)trackCirculateNotify:(xcb_circulate_notify_event_t *)event;
+- (void)trackDestroyNotify:(xcb_destroy_notify_event_t *)event;
 
 // Extension event base access (for event routing)
 - (uint8_t)damageEventBase;
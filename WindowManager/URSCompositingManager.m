@@ -11,13 +11,16 @@
 
 #define _DEFAULT_SOURCE  // For usleep
 #import "URSCompositingManager.h"
+#import "URSPixelOps.h"
 #import <XCBKit/XCBScreen.h>
+#import <XCBKit/XCBRegion.h>
 #import <xcb/xcb.h>
 #import <xcb/composite.h>
 #import <xcb/xfixes.h>
 #import <xcb/render.h>
 #import <xcb/damage.h>
 #import <xcb/shm.h>
+#import <xcb/present.h>
 #import <sys/shm.h>
 #import <unistd.h>  // for usleep
 #import <sys/ipc.h>
@@ -29,6 +32,17 @@
 #define SHADOW_OFFSET_Y -10
 #define SHADOW_OPACITY 0.40
 
+// Damage tracking: rectangles kept per frame before nearby ones are merged
+#define DAMAGE_MAX_RECTS 32
+
+// Paint latencies kept for the frame statistics percentiles
+#define URS_LATENCY_SAMPLES 4096
+
+// Every blocking reply wait in the compositor goes through here, e.g.
+// URS_WAIT_REPLY(xcb_query_tree_reply(conn, cookie, NULL)); one while
+// painting is counted and asserts in debug builds
+#define URS_WAIT_REPLY(call) ([self waitForReplyIn:__PRETTY_FUNCTION__], (call))
+
 // Per-window compositing data
 @interface URSCompositeWindow : NSObject
 @property (assign, nonatomic) xcb_window_t windowId;
@@ -37,7 +51,6 @@
 @property (assign, nonatomic) xcb_pixmap_t nameWindowPixmap;
 @property (assign, nonatomic) xcb_render_picture_t picture;
 @property (assign, nonatomic) xcb_xfixes_region_t borderSize;
-@property (assign, nonatomic) xcb_xfixes_region_t extents;
 @property (assign, nonatomic) BOOL damaged;
 @property (assign, nonatomic) BOOL viewable;
 @property (assign, nonatomic) BOOL redirected;
@@ -45,6 +58,9 @@
 // OPTIMIZATION: Lazy picture creation - defer until first paint
 @property (assign, nonatomic) BOOL pictureValid;
 @property (assign, nonatomic) BOOL needsPictureCreation;
+// Size the named pixmap was taken at; the server swaps the backing pixmap on resize and remap
+@property (assign, nonatomic) uint16_t pixmapWidth;
+@property (assign, nonatomic) uint16_t pixmapHeight;
 // Cached geometry
 @property (assign, nonatomic) int16_t x;
 @property (assign, nonatomic) int16_t y;
@@ -53,13 +69,21 @@
 @property (assign, nonatomic) uint16_t borderWidth;
 @property (assign, nonatomic) uint8_t depth;
 @property (assign, nonatomic) xcb_visualid_t visual;
-// Shadow properties
-@property (assign, nonatomic) xcb_render_picture_t shadowPicture;
-@property (assign, nonatomic) xcb_pixmap_t shadowPixmap;
+@property (assign, nonatomic) xcb_render_pictformat_t pictFormat;  // Resolved when adopted
+// Shadow properties (drawn from the shared shadow tiles, no per-window pixmap)
+@property (assign, nonatomic) BOOL hasShadow;
 @property (assign, nonatomic) int16_t shadowOffsetX;
 @property (assign, nonatomic) int16_t shadowOffsetY;
 @property (assign, nonatomic) uint16_t shadowWidth;
 @property (assign, nonatomic) uint16_t shadowHeight;
+// OPTIMIZATION: Occlusion culling - opaque windows hide what is below their shape
+@property (assign, nonatomic) BOOL opaque;
+@property (assign, nonatomic) xcb_rectangle_t opaqueBounds;    // Largest opaque rect (window-local)
+@property (assign, nonatomic) unsigned int shapeRequest;        // FetchRegion for opaqueBounds in flight, 0 if none
+@property (assign, nonatomic) xcb_xfixes_region_t clipRegion;  // Visible area for the current paint
+// XCB_VISIBILITY_* from the last paint; damage on fully obscured windows is deferred
+@property (assign, nonatomic) uint8_t visibility;
+@property (assign, nonatomic) BOOL damagedWhileObscured;
 // Animation state
 @property (assign, nonatomic) BOOL animating;
 @property (assign, nonatomic) BOOL animatingMinimize;
@@ -80,7 +104,6 @@
         _nameWindowPixmap = XCB_NONE;
         _picture = XCB_NONE;
         _borderSize = XCB_NONE;
-        _extents = XCB_NONE;
         _damaged = NO;
         _viewable = NO;
         _redirected = YES;
@@ -88,12 +111,18 @@
         // OPTIMIZATION: Lazy picture creation
         _pictureValid = NO;
         _needsPictureCreation = YES;
-        _shadowPicture = XCB_NONE;
-        _shadowPixmap = XCB_NONE;
+        _hasShadow = NO;
         _shadowOffsetX = 0;
         _shadowOffsetY = 0;
         _shadowWidth = 0;
         _shadowHeight = 0;
+        _opaque = NO;
+        _opaqueBounds = (xcb_rectangle_t){0, 0, 0, 0};
+        _shapeRequest = 0;
+        _pictFormat = XCB_NONE;
+        _clipRegion = XCB_NONE;
+        _visibility = XCB_VISIBILITY_UNOBSCURED;
+        _damagedWhileObscured = NO;
         _animating = NO;
         _animatingMinimize = NO;
         _animatingFade = NO;
@@ -106,6 +135,78 @@
 }
 @end
 
+// Shared nine-slice shadow tiles, one set per radius/opacity. Corners come from a
+// 2g x 2g A8 picture; edges and center are tiny repeating A8 pictures, so a shadow
+// of any size is a few composites and resizing a window never uploads pixels.
+@interface URSShadowTiles : NSObject
+@property (assign, nonatomic) int tileSize;  // g: Gaussian kernel size
+@property (assign, nonatomic) xcb_pixmap_t cornerPixmap;
+@property (assign, nonatomic) xcb_render_picture_t cornerPicture;   // 2g x 2g, four corners
+@property (assign, nonatomic) xcb_pixmap_t hEdgePixmap;
+@property (assign, nonatomic) xcb_render_picture_t hEdgePicture;    // 1 x 2g, top/bottom, repeat
+@property (assign, nonatomic) xcb_pixmap_t vEdgePixmap;
+@property (assign, nonatomic) xcb_render_picture_t vEdgePicture;    // 2g x 1, left/right, repeat
+@property (assign, nonatomic) xcb_pixmap_t centerPixmap;
+@property (assign, nonatomic) xcb_render_picture_t centerPicture;   // 1 x 1, repeat
+@end
+
+@implementation URSShadowTiles
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _tileSize = 0;
+        _cornerPixmap = XCB_NONE;
+        _cornerPicture = XCB_NONE;
+        _hEdgePixmap = XCB_NONE;
+        _hEdgePicture = XCB_NONE;
+        _vEdgePixmap = XCB_NONE;
+        _vEdgePicture = XCB_NONE;
+        _centerPixmap = XCB_NONE;
+        _centerPicture = XCB_NONE;
+    }
+    return self;
+}
+@end
+
+// Cached window tree entry, kept current from structure notify events so the
+// damage path can find frames and root origins without round-trips.
+@interface URSWindowNode : NSObject
+@property (assign, nonatomic) xcb_window_t parent;
+@property (assign, nonatomic) int16_t x;             // Parent-relative outer corner
+@property (assign, nonatomic) int16_t y;
+@property (assign, nonatomic) uint16_t borderWidth;
+@end
+
+@implementation URSWindowNode
+@end
+
+// Window whose attributes and geometry are still in flight. Nothing waits for
+// the replies; they are collected once they have arrived. Structure events
+// seen in the meantime are newer than (or equal to) the replies and win.
+@interface URSPendingAdoption : NSObject
+@property (assign, nonatomic) xcb_window_t windowId;
+@property (assign, nonatomic) xcb_get_window_attributes_cookie_t attributesCookie;
+@property (assign, nonatomic) xcb_get_geometry_cookie_t geometryCookie;
+@property (assign, nonatomic) xcb_query_tree_cookie_t treeCookie;  // sequence 0 when the tree has a node
+@property (assign, nonatomic) int8_t mapState;                       // -1: take the reply's, else viewable
+@property (assign, nonatomic) BOOL hasPosition;                      // Parent-relative, from events
+@property (assign, nonatomic) int16_t x;
+@property (assign, nonatomic) int16_t y;
+@property (assign, nonatomic) BOOL hasSize;
+@property (assign, nonatomic) uint16_t width;
+@property (assign, nonatomic) uint16_t height;
+@end
+
+@implementation URSPendingAdoption
+@end
+
+// One root child in the stacking list; records are stored bottom to top in a
+// single array so the paint walk reads them without lookups
+typedef struct {
+    xcb_window_t window;
+    __unsafe_unretained URSCompositeWindow *cw;  // Owned by cwindows; nil when not tracked
+} URSStackingRecord;
+
 @interface URSCompositingManager ()
 
 @property (strong, nonatomic) XCBConnection *connection;
@@ -116,20 +217,23 @@
 @property (assign, nonatomic) xcb_render_picture_t blackPicture; // Solid black for shadows
 @property (assign, nonatomic) xcb_pixmap_t rootPixmap;           // Backing pixmap for buffer
 @property (strong, nonatomic) NSMutableDictionary<NSNumber *, URSCompositeWindow *> *cwindows;
+@property (strong, nonatomic) NSMutableDictionary<NSNumber *, URSWindowNode *> *windowTree;  // child -> parent/origin
+@property (strong, nonatomic) NSMutableDictionary<NSNumber *, NSMutableSet<NSNumber *> *> *windowChildren;  // parent -> children in windowTree
 
 @property (assign, nonatomic) BOOL compositingEnabled;
 @property (assign, nonatomic) BOOL compositingActive;
 @property (assign, nonatomic) BOOL extensionsAvailable;
 
-// Accumulated damage region
-@property (assign, nonatomic) xcb_xfixes_region_t allDamage;
-@property (assign, nonatomic) xcb_xfixes_region_t screenRegion;
+// Accumulated damage, kept client-side and sent to the server once per frame
+@property (strong, nonatomic) XCBRegion *damageRegion;
+@property (strong, nonatomic) XCBRegion *frameRegion;  // Server-side clip of the frame being painted
 
 // Gaussian shadow data (pre-computed once)
 @property (assign, nonatomic) int gaussianSize;
 @property (assign, nonatomic) double *gaussianMap;  // Gaussian convolution kernel
 @property (assign, nonatomic) uint8_t *shadowCorner; // Pre-computed shadow corners
 @property (assign, nonatomic) uint8_t *shadowTop;    // Pre-computed shadow top/bottom
+@property (strong, nonatomic) NSMutableDictionary<NSString *, URSShadowTiles *> *shadowTileCache;
 
 // Extension version tracking
 @property (assign, nonatomic) uint8_t compositeOpcode;
@@ -137,10 +241,29 @@
 @property (assign, nonatomic) uint8_t damageEventBase;
 @property (assign, nonatomic) uint8_t fixesOpcode;
 
-// Throttling to prevent excessive recomposites
-@property (assign, nonatomic) BOOL repairScheduled;
-@property (assign, nonatomic) NSTimeInterval lastRepairTime;
-@property (assign, nonatomic) NSUInteger repairFrameCounter; // Frame counter for throttling during drag
+// Frame clock: all damage is coalesced into at most one paintAll per refresh
+@property (assign, nonatomic) BOOL framePending;               // A frame has been requested
+@property (assign, nonatomic) BOOL waitingForVblank;           // Present NotifyMSC in flight
+@property (assign, nonatomic) NSTimeInterval frameInterval;    // Refresh interval (configured or measured)
+@property (assign, nonatomic) NSTimeInterval lastFrameTime;    // Start of the last painted frame
+@property (assign, nonatomic) NSTimeInterval frameRequestTime; // When the pending frame was requested
+@property (assign, nonatomic) NSTimeInterval damageTime;       // First damage since the last frame
+@property (assign, nonatomic) BOOL presentAvailable;
+@property (assign, nonatomic) uint8_t presentOpcode;
+@property (assign, nonatomic) uint32_t presentEventId;
+@property (assign, nonatomic) uint32_t presentSerial;
+@property (assign, nonatomic) uint64_t lastMsc;
+@property (assign, nonatomic) uint64_t lastUst;
+// Frame statistics
+@property (assign, nonatomic) NSUInteger framesPainted;
+@property (assign, nonatomic) NSUInteger framesSkipped;        // Refreshes missed while damage was pending
+@property (assign, nonatomic) NSTimeInterval lastPaintLatency; // Damage to paint completion
+@property (assign, nonatomic) NSTimeInterval totalPaintLatency;
+@property (assign, nonatomic) NSTimeInterval lastPaintDuration;
+@property (assign, nonatomic) double *paintLatencySamples;     // Ring of the last URS_LATENCY_SAMPLES latencies
+@property (assign, nonatomic) NSUInteger paintLatencySampleCount;
+@property (assign, nonatomic) BOOL countFrameRequests;         // Bracket each paint with NoOps (benchmarks)
+@property (assign, nonatomic) uint64_t frameRequests;          // X requests issued by counted paints
 
 // Cached screen info
 @property (assign, nonatomic) uint16_t screenWidth;
@@ -148,26 +271,53 @@
 @property (assign, nonatomic) xcb_window_t rootWindow;
 @property (assign, nonatomic) xcb_render_pictformat_t rootFormat;
 @property (assign, nonatomic) xcb_render_pictformat_t argbFormat;
+@property (assign, nonatomic) xcb_render_pictformat_t a8Format;
 
 // OPTIMIZATION: Cached visual-to-format mappings (avoids repeated xcb_render_query_pict_formats)
 @property (strong, nonatomic) NSMutableDictionary<NSNumber *, NSNumber *> *visualFormatCache;
 @property (strong, nonatomic) NSMutableDictionary<NSNumber *, NSNumber *> *depthFormatCache;
-
-// OPTIMIZATION: Cached window stacking order (avoids xcb_query_tree on every paint)
-@property (strong, nonatomic) NSMutableArray<NSNumber *> *windowStackingOrder;
-@property (assign, nonatomic) BOOL stackingOrderDirty;
+// Formats carrying an alpha channel (windows using them are never treated as opaque)
+@property (strong, nonatomic) NSMutableSet<NSNumber *> *translucentFormats;
+
+// OPTIMIZATION: Stacking order of the root's children, kept current from
+// ConfigureNotify above_sibling, CirculateNotify, Create/Destroy/ReparentNotify;
+// xcb_query_tree only runs to resynchronize
+@property (assign, nonatomic) URSStackingRecord *stackingRecords;  // Bottom to top
+@property (assign, nonatomic) NSUInteger stackingCount;
+@property (assign, nonatomic) NSUInteger stackingCapacity;
+@property (assign, nonatomic) BOOL stackingOrderDirty;             // Resynchronize before the next use
+@property (assign, nonatomic) NSUInteger stackingResyncs;
+@property (assign, nonatomic) unsigned int stackingResyncRequest;   // QueryTree in flight, 0 if none
+@property (assign, nonatomic) BOOL stackingChangedWhileResyncing;
+
+// OPTIMIZATION: Windows are adopted from cookies collected between event batches,
+// so painting never waits on the server (a window is skipped until it is ready)
+@property (strong, nonatomic) NSMutableDictionary<NSNumber *, URSPendingAdoption *> *pendingAdoptions;
+@property (strong, nonatomic) NSMutableSet<NSNumber *> *ignoredWindows;     // InputOnly or gone
+@property (strong, nonatomic) NSMutableSet<NSNumber *> *pendingShapeWindows; // opaqueBounds in flight
+@property (assign, nonatomic) BOOL painting;
+@property (assign, nonatomic) NSUInteger paintRoundTrips;                   // Must stay 0
+@property (assign, nonatomic) NSUInteger culledWindowCount; // Windows skipped by occlusion culling
+@property (strong, nonatomic) NSMutableDictionary<NSNumber *, NSNumber *> *pendingVisibility; // Reported after paintAll
 
 // OPTIMIZATION: MIT-SHM shared memory support for zero-copy transfers
 @property (assign, nonatomic) BOOL shmAvailable;
-@property (assign, nonatomic) xcb_shm_seg_t shmSeg;
 @property (assign, nonatomic) int shmId;
 @property (assign, nonatomic) void *shmAddr;
 @property (assign, nonatomic) size_t shmSize;
 
-// Animation timer
-@property (strong, nonatomic) NSTimer *animationTimer;
+// Running animations (driven by the frame clock)
 @property (assign, nonatomic) NSUInteger activeAnimations;
 
+// OPTIMIZATION: Fullscreen bypass - an opaque window covering the screen is
+// unredirected and scans out directly while the overlay is hidden
+@property (assign, nonatomic) BOOL bypassEnabled;
+@property (assign, nonatomic) NSTimeInterval bypassDelay;        // Candidate must stay on top this long
+@property (assign, nonatomic) xcb_window_t bypassWindow;         // Currently unredirected, or XCB_NONE
+@property (assign, nonatomic) xcb_window_t bypassCandidateId;
+@property (assign, nonatomic) NSTimeInterval bypassCandidateSince;
+@property (assign, nonatomic) NSUInteger bypassCount;
+
 @end
 
 @implementation URSCompositingManager
@@ -177,19 +327,11 @@
         return;
     }
 
-    xcb_connection_t *conn = [self.connection connection];
-    xcb_translate_coordinates_cookie_t cookie = xcb_translate_coordinates(conn,
-                                                                          cw.windowId,
-                                                                          self.rootWindow,
-                                                                          0, 0);
-    xcb_translate_coordinates_reply_t *reply = xcb_translate_coordinates_reply(conn, cookie, NULL);
-    if (!reply) {
-        return;
+    int16_t x, y;
+    if ([self rootOriginForWindow:cw.windowId x:&x y:&y]) {
+        cw.x = x;
+        cw.y = y;
     }
-
-    cw.x = reply->dst_x;
-    cw.y = reply->dst_y;
-    free(reply);
 }
 
 + (instancetype)sharedManager {
@@ -213,31 +355,50 @@
         _rootPicture = XCB_NONE;
         _rootBuffer = XCB_NONE;
         _rootPixmap = XCB_NONE;
-        _allDamage = XCB_NONE;
-        _screenRegion = XCB_NONE;
-        _repairScheduled = NO;
-        _lastRepairTime = 0;
-        _repairFrameCounter = 0;
+        _damageRegion = nil;
+        _frameRegion = nil;
+        _framePending = NO;
+        _waitingForVblank = NO;
+        _frameInterval = 1.0 / 60.0;
+        _lastFrameTime = 0;
+        _presentAvailable = NO;
+        _presentEventId = XCB_NONE;
+        _presentSerial = 0;
         _cwindows = [[NSMutableDictionary alloc] init];
+        _windowTree = [[NSMutableDictionary alloc] init];
+        _windowChildren = [[NSMutableDictionary alloc] init];
+        _pendingAdoptions = [[NSMutableDictionary alloc] init];
+        _ignoredWindows = [[NSMutableSet alloc] init];
+        _pendingShapeWindows = [[NSMutableSet alloc] init];
+        _pendingVisibility = [[NSMutableDictionary alloc] init];
         
         // OPTIMIZATION: Initialize format caches
         _visualFormatCache = [[NSMutableDictionary alloc] init];
         _depthFormatCache = [[NSMutableDictionary alloc] init];
+        _translucentFormats = [[NSMutableSet alloc] init];
+        _shadowTileCache = [[NSMutableDictionary alloc] init];
         
-        // OPTIMIZATION: Initialize stacking order cache
-        _windowStackingOrder = [[NSMutableArray alloc] init];
+        // OPTIMIZATION: Stacking list is seeded from the first query_tree
+        _stackingRecords = NULL;
+        _stackingCount = 0;
+        _stackingCapacity = 0;
         _stackingOrderDirty = YES;
         
         // OPTIMIZATION: Initialize MIT-SHM (will be checked during extension query)
         _shmAvailable = NO;
-        _shmSeg = XCB_NONE;
         _shmId = -1;
         _shmAddr = NULL;
         _shmSize = 0;
 
-        _animationTimer = nil;
         _activeAnimations = 0;
         
+        _bypassEnabled = NO;
+        _bypassDelay = 0.0;
+        _bypassWindow = XCB_NONE;
+        _bypassCandidateId = XCB_NONE;
+        _bypassCandidateSince = 0;
+        _bypassCount = 0;
+        
         // Initialize Gaussian shadow data
         _gaussianMap = make_gaussian_map((double)SHADOW_RADIUS, &_gaussianSize);
         if (_gaussianMap) {
@@ -310,7 +471,7 @@
                                            XCB_COMPOSITE_MAJOR_VERSION, 
                                            XCB_COMPOSITE_MINOR_VERSION);
             xcb_composite_query_version_reply_t *version_reply = 
-                xcb_composite_query_version_reply(conn, version_cookie, NULL);
+                URS_WAIT_REPLY(xcb_composite_query_version_reply(conn, version_cookie, NULL));
             
             if (version_reply) {
                 NSLog(@"[CompositingManager] COMPOSITE v%d.%d available", 
@@ -352,7 +513,7 @@
                                         XCB_DAMAGE_MAJOR_VERSION,
                                         XCB_DAMAGE_MINOR_VERSION);
             xcb_damage_query_version_reply_t *damage_version_reply =
-                xcb_damage_query_version_reply(conn, damage_version_cookie, NULL);
+                URS_WAIT_REPLY(xcb_damage_query_version_reply(conn, damage_version_cookie, NULL));
             if (damage_version_reply) {
                 NSLog(@"[CompositingManager] DAMAGE v%d.%d available (event base: %u)", 
                       damage_version_reply->major_version,
@@ -377,7 +538,7 @@
                                         XCB_XFIXES_MAJOR_VERSION,
                                         XCB_XFIXES_MINOR_VERSION);
             xcb_xfixes_query_version_reply_t *xfixes_reply =
-                xcb_xfixes_query_version_reply(conn, xfixes_cookie, NULL);
+                URS_WAIT_REPLY(xcb_xfixes_query_version_reply(conn, xfixes_cookie, NULL));
             if (xfixes_reply) {
                 NSLog(@"[CompositingManager] XFIXES v%d.%d available", 
                       xfixes_reply->major_version, xfixes_reply->minor_version);
@@ -392,7 +553,7 @@
         if (shm_ext && shm_ext->present) {
             xcb_shm_query_version_cookie_t shm_cookie = xcb_shm_query_version(conn);
             xcb_shm_query_version_reply_t *shm_reply = 
-                xcb_shm_query_version_reply(conn, shm_cookie, NULL);
+                URS_WAIT_REPLY(xcb_shm_query_version_reply(conn, shm_cookie, NULL));
             if (shm_reply) {
                 self.shmAvailable = YES;
                 NSLog(@"[CompositingManager] MIT-SHM v%d.%d available (shared pixmaps: %s)", 
@@ -404,6 +565,26 @@
             NSLog(@"[CompositingManager] MIT-SHM not available (using standard transfers)");
         }
         
+        // Present extension (optional, paces the frame clock to vblank)
+        const xcb_query_extension_reply_t *present_ext =
+            xcb_get_extension_data(conn, &xcb_present_id);
+        
+        if (present_ext && present_ext->present) {
+            xcb_present_query_version_cookie_t present_cookie =
+                xcb_present_query_version(conn, XCB_PRESENT_MAJOR_VERSION, XCB_PRESENT_MINOR_VERSION);
+            xcb_present_query_version_reply_t *present_reply =
+                URS_WAIT_REPLY(xcb_present_query_version_reply(conn, present_cookie, NULL));
+            if (present_reply) {
+                self.presentAvailable = YES;
+                self.presentOpcode = present_ext->major_opcode;
+                NSLog(@"[CompositingManager] Present v%d.%d available",
+                      present_reply->major_version, present_reply->minor_version);
+                free(present_reply);
+            }
+        } else {
+            NSLog(@"[CompositingManager] Present not available (timer-paced frames)");
+        }
+        
         return allExtensionsOK;
         
     } @catch (NSException *exception) {
@@ -418,7 +599,7 @@
     xcb_render_query_pict_formats_cookie_t formats_cookie = 
         xcb_render_query_pict_formats(conn);
     xcb_render_query_pict_formats_reply_t *formats_reply = 
-        xcb_render_query_pict_formats_reply(conn, formats_cookie, NULL);
+        URS_WAIT_REPLY(xcb_render_query_pict_formats_reply(conn, formats_cookie, NULL));
     
     if (!formats_reply) {
         NSLog(@"[CompositingManager] Failed to query render formats");
@@ -428,6 +609,7 @@
     // Find format for root window (typically 24-bit RGB)
     self.rootFormat = XCB_NONE;
     self.argbFormat = XCB_NONE;
+    self.a8Format = XCB_NONE;
     
     // OPTIMIZATION: Build depth-to-format cache while iterating
     xcb_render_pictforminfo_iterator_t iter = 
@@ -442,6 +624,11 @@
             self.depthFormatCache[depthKey] = @(fmt->id);
         }
         
+        // Remember formats with alpha so occlusion culling can skip them
+        if (fmt->type == XCB_RENDER_PICT_TYPE_DIRECT && fmt->direct.alpha_mask != 0) {
+            [self.translucentFormats addObject:@(fmt->id)];
+        }
+        
         // Look for 24-bit format (RGB without alpha)
         if (fmt->depth == 24 && fmt->type == XCB_RENDER_PICT_TYPE_DIRECT) {
             if (self.rootFormat == XCB_NONE) {
@@ -449,6 +636,15 @@
             }
         }
         
+        // Look for A8 (alpha-only) format used by the shadow tiles
+        if (fmt->depth == 8 && fmt->type == XCB_RENDER_PICT_TYPE_DIRECT &&
+            fmt->direct.alpha_mask == 0xFF && fmt->direct.red_mask == 0 &&
+            fmt->direct.green_mask == 0 && fmt->direct.blue_mask == 0) {
+            if (self.a8Format == XCB_NONE) {
+                self.a8Format = fmt->id;
+            }
+        }
+        
         // Look for 32-bit ARGB format with 8-bit channels
         if (fmt->depth == 32 && fmt->type == XCB_RENDER_PICT_TYPE_DIRECT) {
             // Check if it has alpha AND 8-bit channels (mask = 0xFF)
@@ -538,56 +734,6 @@
     return picture;
 }
 
-// Helper to find picture format by depth
-// Helper to find picture format by depth and type
-- (xcb_render_pictformat_t)findPictFormat:(uint8_t)depth {
-    xcb_connection_t *conn = [self.connection connection];
-    
-    xcb_render_query_pict_formats_cookie_t formats_cookie = 
-        xcb_render_query_pict_formats(conn);
-    xcb_render_query_pict_formats_reply_t *formats_reply = 
-        xcb_render_query_pict_formats_reply(conn, formats_cookie, NULL);
-    
-    if (!formats_reply) {
-        NSLog(@"[Shadow] Failed to query formats");
-        return XCB_NONE;
-    }
-    
-    xcb_render_pictformat_t result = XCB_NONE;
-    xcb_render_pictforminfo_iterator_t iter = 
-        xcb_render_query_pict_formats_formats_iterator(formats_reply);
-    
-    // For depth 8, we need A8 format (Direct with only alpha channel)
-    for (; iter.rem; xcb_render_pictforminfo_next(&iter)) {
-        xcb_render_pictforminfo_t *fmt = iter.data;
-        if (fmt->depth == depth && fmt->type == XCB_RENDER_PICT_TYPE_DIRECT) {
-            // For A8, check that it has alpha channel
-            if (depth == 8) {
-                xcb_render_directformat_t *direct = &fmt->direct;
-                // A8 should have alpha_shift=0, alpha_mask=0xFF, and no RGB
-                if (direct->alpha_mask == 0xFF && direct->red_mask == 0 && 
-                    direct->green_mask == 0 && direct->blue_mask == 0) {
-                    result = fmt->id;
-                    NSLog(@"[Shadow] Found A8 format: id=%u alpha_shift=%d alpha_mask=0x%x", 
-                          fmt->id, direct->alpha_shift, direct->alpha_mask);
-                    break;
-                }
-            } else {
-                result = fmt->id;
-                NSLog(@"[Shadow] Found format for depth %d: id=%u type=%d", depth, fmt->id, fmt->type);
-                break;
-            }
-        }
-    }
-    
-    if (result == XCB_NONE) {
-        NSLog(@"[Shadow] WARNING: No suitable format found for depth %d", depth);
-    }
-    
-    free(formats_reply);
-    return result;
-}
-
 #pragma mark - Activation
 
 - (BOOL)activateCompositing {
@@ -624,10 +770,20 @@
             return NO;
         }
         
+        // Damage regions (client-side; frameRegion is uploaded once per frame)
+        self.damageRegion = [[XCBRegion alloc] initWithConnection:self.connection];
+        self.frameRegion = [[XCBRegion alloc] initWithConnection:self.connection];
+        
+        // Configure frame pacing (needs the output window for Present)
+        [self setupFrameClock];
+        [self setupFullscreenBypass];
+        
         // Add all existing windows
         [self addAllWindows];
         
         self.compositingActive = YES;
+        // Redirected windows are always reported unobscured; paintAll supplies visibility
+        self.connection.visibilityFromCompositor = YES;
         NSLog(@"[CompositingManager] Compositing activated successfully");
         
         // Damage entire screen to trigger initial paint
@@ -649,7 +805,7 @@
         xcb_generic_error_t *error = NULL;
         xcb_void_cookie_t cookie = xcb_composite_redirect_subwindows_checked(
             conn, self.rootWindow, XCB_COMPOSITE_REDIRECT_MANUAL);
-        error = xcb_request_check(conn, cookie);
+        error = URS_WAIT_REPLY(xcb_request_check(conn, cookie));
         
         if (error) {
             NSLog(@"[CompositingManager] Error redirecting windows: %d", error->error_code);
@@ -675,7 +831,7 @@
         xcb_composite_get_overlay_window_cookie_t overlay_cookie = 
             xcb_composite_get_overlay_window(conn, self.rootWindow);
         xcb_composite_get_overlay_window_reply_t *overlay_reply = 
-            xcb_composite_get_overlay_window_reply(conn, overlay_cookie, NULL);
+            URS_WAIT_REPLY(xcb_composite_get_overlay_window_reply(conn, overlay_cookie, NULL));
         
         if (!overlay_reply) {
             NSLog(@"[CompositingManager] Failed to get overlay window");
@@ -777,7 +933,7 @@
     xcb_connection_t *conn = [self.connection connection];
     
     xcb_query_tree_cookie_t tree_cookie = xcb_query_tree(conn, self.rootWindow);
-    xcb_query_tree_reply_t *tree_reply = xcb_query_tree_reply(conn, tree_cookie, NULL);
+    xcb_query_tree_reply_t *tree_reply = URS_WAIT_REPLY(xcb_query_tree_reply(conn, tree_cookie, NULL));
     
     if (!tree_reply) {
         NSLog(@"[CompositingManager] Failed to query window tree");
@@ -787,11 +943,22 @@
     xcb_window_t *children = xcb_query_tree_children(tree_reply);
     int num_children = xcb_query_tree_children_length(tree_reply);
     
+    // The same reply seeds the stacking list; addWindow attaches each record
+    [self resetStackingOrderWithChildren:children count:num_children];
+    
     for (int i = 0; i < num_children; i++) {
+        // Seed the window tree cache; addWindow fills in the geometry
+        if (!self.windowTree[@(children[i])]) {
+            URSWindowNode *node = [[URSWindowNode alloc] init];
+            [self setTreeNode:node parent:self.rootWindow forWindow:children[i]];
+        }
         [self addWindow:children[i]];
     }
     
     free(tree_reply);
+    
+    // All requests went out back to back, so this is a single round-trip
+    [self completePendingAdoptionsWaiting:YES];
     // NSLog(@"[CompositingManager] Added %d existing windows", num_children);
 }
 
@@ -801,6 +968,8 @@
     return self.cwindows[@(windowId)];
 }
 
+// Start adopting a window: the requests go out now and the window is built by
+// completeAdoption: once the replies are in. Never waits.
 - (void)addWindow:(xcb_window_t)windowId {
     if (!self.compositingActive) {
         return;
@@ -812,74 +981,205 @@
         return;
     }
     
-    if ([self findCWindow:windowId]) {
-        return; // Already added
+    NSNumber *key = @(windowId);
+    if (self.cwindows[key] || self.pendingAdoptions[key] || [self.ignoredWindows containsObject:key]) {
+        return; // Already added, on its way, or never painted
     }
     
     xcb_connection_t *conn = [self.connection connection];
+    URSPendingAdoption *pending = [[URSPendingAdoption alloc] init];
+    pending.windowId = windowId;
+    pending.mapState = -1;
+    pending.attributesCookie = xcb_get_window_attributes(conn, windowId);
+    pending.geometryCookie = xcb_get_geometry(conn, windowId);
+    if (!self.windowTree[key]) {
+        pending.treeCookie = xcb_query_tree(conn, windowId);
+    }
+    self.pendingAdoptions[key] = pending;
+}
+
+// Build the composite window from the adoption replies. Without wait, returns
+// NO while they have not all arrived yet.
+- (BOOL)completeAdoption:(URSPendingAdoption *)pending wait:(BOOL)wait {
+    xcb_connection_t *conn = [self.connection connection];
+    xcb_window_t windowId = pending.windowId;
+    
+    // Replies arrive in request order: once the last one is here, so are the others
+    unsigned int lastRequest = pending.treeCookie.sequence ?
+        pending.treeCookie.sequence : pending.geometryCookie.sequence;
+    void *lastReply = NULL;
+    xcb_generic_error_t *lastError = NULL;
+    if (!wait && !xcb_poll_for_reply(conn, lastRequest, &lastReply, &lastError)) {
+        return NO;
+    }
+    free(lastError);
     
-    // Get window attributes
-    xcb_get_window_attributes_cookie_t attr_cookie = xcb_get_window_attributes(conn, windowId);
-    xcb_get_window_attributes_reply_t *attr = xcb_get_window_attributes_reply(conn, attr_cookie, NULL);
+    [self.pendingAdoptions removeObjectForKey:@(windowId)];
     
-    if (!attr) {
-        return;
+    xcb_get_window_attributes_reply_t *attr = URS_WAIT_REPLY(xcb_get_window_attributes_reply(conn, pending.attributesCookie, NULL));
+    xcb_get_geometry_reply_t *geom = NULL;
+    xcb_query_tree_reply_t *tree_reply = NULL;
+    if (pending.treeCookie.sequence) {
+        geom = URS_WAIT_REPLY(xcb_get_geometry_reply(conn, pending.geometryCookie, NULL));
+        tree_reply = wait ? URS_WAIT_REPLY(xcb_query_tree_reply(conn, pending.treeCookie, NULL)) : lastReply;
+    } else {
+        geom = wait ? URS_WAIT_REPLY(xcb_get_geometry_reply(conn, pending.geometryCookie, NULL)) : lastReply;
     }
     
-    // Skip InputOnly windows
-    if (attr->_class == XCB_WINDOW_CLASS_INPUT_ONLY) {
+    // Gone already, or InputOnly (nothing to paint)
+    if (!attr || !geom || attr->_class == XCB_WINDOW_CLASS_INPUT_ONLY ||
+        (pending.treeCookie.sequence && !tree_reply)) {
+        [self.ignoredWindows addObject:@(windowId)];
         free(attr);
-        return;
+        free(geom);
+        free(tree_reply);
+        return YES;
     }
     
-    // Get geometry
-    xcb_get_geometry_cookie_t geom_cookie = xcb_get_geometry(conn, windowId);
-    xcb_get_geometry_reply_t *geom = xcb_get_geometry_reply(conn, geom_cookie, NULL);
-    
-    if (!geom) {
-        free(attr);
-        return;
+    URSWindowNode *node = self.windowTree[@(windowId)];
+    if (!node && tree_reply) {
+        node = [[URSWindowNode alloc] init];
+        [self setTreeNode:node parent:tree_reply->parent forWindow:windowId];
     }
     
     URSCompositeWindow *cw = [[URSCompositeWindow alloc] init];
     cw.windowId = windowId;
-    cw.x = geom->x;
-    cw.y = geom->y;
-    cw.width = geom->width;
-    cw.height = geom->height;
+    cw.x = pending.hasPosition ? pending.x : geom->x;
+    cw.y = pending.hasPosition ? pending.y : geom->y;
+    cw.width = pending.hasSize ? pending.width : geom->width;
+    cw.height = pending.hasSize ? pending.height : geom->height;
     cw.borderWidth = geom->border_width;
     cw.depth = geom->depth;
     cw.visual = attr->visual;
-    cw.viewable = (attr->map_state == XCB_MAP_STATE_VIEWABLE);
+    cw.viewable = (pending.mapState >= 0) ? (pending.mapState != 0) :
+                  (attr->map_state == XCB_MAP_STATE_VIEWABLE);
     cw.redirected = YES;
     cw.overrideRedirect = attr->override_redirect;
+    cw.opaque = [self isOpaqueVisual:cw.visual depth:cw.depth];
+    cw.pictFormat = [self findVisualFormat:cw.visual];
+    if (cw.pictFormat == XCB_NONE) {
+        // Fall back to depth-based format
+        cw.pictFormat = [self findFormatForDepth:cw.depth];
+    }
 
     // Track parent and compute absolute position in root coordinates
-    xcb_query_tree_cookie_t tree_cookie = xcb_query_tree(conn, windowId);
-    xcb_query_tree_reply_t *tree_reply = xcb_query_tree_reply(conn, tree_cookie, NULL);
-    if (tree_reply) {
-        cw.parentWindowId = tree_reply->parent;
-        free(tree_reply);
+    if (node) {
+        node.x = cw.x;
+        node.y = cw.y;
+        node.borderWidth = geom->border_width;
+        cw.parentWindowId = node.parent;
     } else {
         cw.parentWindowId = XCB_NONE;
     }
     [self updateAbsolutePositionForWindow:cw];
     
-    // Create damage object for the window
+    // Create damage object for the window; each damaged rectangle arrives as its own event
     cw.damage = xcb_generate_id(conn);
-    xcb_damage_create(conn, cw.damage, windowId, XCB_DAMAGE_REPORT_LEVEL_NON_EMPTY);
+    xcb_damage_create(conn, cw.damage, windowId, XCB_DAMAGE_REPORT_LEVEL_DELTA_RECTANGLES);
     
     self.cwindows[@(windowId)] = cw;
-    
-    // OPTIMIZATION: Mark stacking order dirty (will be rebuilt on next paint)
-    self.stackingOrderDirty = YES;
+    [self attachStackingRecordForWindow:windowId compositeWindow:cw];
 
     NSLog(@"[CompositingManager] Added window %u (parent: %u) pos={%d,%d} size={%hu,%hu} viewable=%d", windowId, cw.parentWindowId, cw.x, cw.y, cw.width, cw.height, (int)cw.viewable);
     
     free(attr);
     free(geom);
+    free(tree_reply);
     
-    [self.connection flush];
+    // Damage raised before the damage object existed is covered by painting it whole
+    if (cw.viewable) {
+        [self damageWindowArea:cw];
+        [self scheduleRepair];
+    }
+    return YES;
+}
+
+- (void)completePendingAdoptionsWaiting:(BOOL)wait {
+    for (URSPendingAdoption *pending in [self.pendingAdoptions allValues]) {
+        [self completeAdoption:pending wait:wait];
+    }
+}
+
+// Adopt a window right away (one round-trip); for callers outside the paint
+// path that cannot wait for the next event batch
+- (URSCompositeWindow *)adoptWindowNow:(xcb_window_t)windowId {
+    [self addWindow:windowId];
+    URSPendingAdoption *pending = self.pendingAdoptions[@(windowId)];
+    if (pending) {
+        [self completeAdoption:pending wait:YES];
+    }
+    return [self findCWindow:windowId];
+}
+
+- (void)discardAdoptionForWindow:(xcb_window_t)windowId {
+    URSPendingAdoption *pending = self.pendingAdoptions[@(windowId)];
+    if (!pending) {
+        return;
+    }
+    
+    xcb_connection_t *conn = [self.connection connection];
+    xcb_discard_reply(conn, pending.attributesCookie.sequence);
+    xcb_discard_reply(conn, pending.geometryCookie.sequence);
+    if (pending.treeCookie.sequence) {
+        xcb_discard_reply(conn, pending.treeCookie.sequence);
+    }
+    [self.pendingAdoptions removeObjectForKey:@(windowId)];
+}
+
+// Collect whatever adoption, shape and resync replies have arrived; never blocks.
+// Runs before each event batch so events read along with the replies are handled.
+- (void)collectPendingReplies {
+    if (!self.compositingActive) {
+        return;
+    }
+    
+    xcb_connection_t *conn = [self.connection connection];
+    
+    [self completePendingAdoptionsWaiting:NO];
+    
+    for (NSNumber *key in [self.pendingShapeWindows allObjects]) {
+        URSCompositeWindow *cw = self.cwindows[key];
+        void *reply = NULL;
+        xcb_generic_error_t *error = NULL;
+        if (!cw || cw.shapeRequest == 0) {
+            [self.pendingShapeWindows removeObject:key];
+        } else if (xcb_poll_for_reply(conn, cw.shapeRequest, &reply, &error)) {
+            [self.pendingShapeWindows removeObject:key];
+            cw.shapeRequest = 0;
+            [self updateOpaqueBoundsForWindow:cw reply:reply];
+            free(reply);
+            free(error);
+        }
+    }
+    
+    if (self.stackingResyncRequest) {
+        void *reply = NULL;
+        xcb_generic_error_t *error = NULL;
+        if (xcb_poll_for_reply(conn, self.stackingResyncRequest, &reply, &error)) {
+            self.stackingResyncRequest = 0;
+            [self completeStackingResync:reply];
+            free(reply);
+            free(error);
+        }
+    }
+}
+
+- (BOOL)hasPendingReplies {
+    return [self.pendingAdoptions count] > 0 || [self.pendingShapeWindows count] > 0 ||
+           self.stackingResyncRequest != 0;
+}
+
+// Called by URS_WAIT_REPLY before every blocking reply: one while painting
+// stalls the frame, so it is counted (frameStatistics paintRoundTrips) and
+// debug builds stop on it
+- (void)waitForReplyIn:(const char *)function {
+    if (!self.painting) {
+        return;
+    }
+    self.paintRoundTrips += 1;
+#ifdef DEBUG
+    NSAssert(!self.painting, @"[CompositingManager] round-trip in %s while painting", function);
+#endif
 }
 
 - (void)registerWindow:(xcb_window_t)window {
@@ -897,6 +1197,7 @@
     
     URSCompositeWindow *cw = [self findCWindow:windowId];
     if (!cw) {
+        [self discardAdoptionForWindow:windowId];
         return;
     }
     
@@ -905,11 +1206,15 @@
         [self damageWindowArea:cw];
     }
     
+    // The window is gone, so there is nothing to redirect again
+    if (windowId == self.bypassWindow) {
+        [self endFullscreenBypassRedirecting:NO];
+    }
+    
+    // The window keeps its place in the stack until it is destroyed or reparented
+    [self attachStackingRecordForWindow:windowId compositeWindow:nil];
     [self freeWindowData:cw delete:YES];
     [self.cwindows removeObjectForKey:@(windowId)];
-    
-    // OPTIMIZATION: Mark stacking order dirty
-    self.stackingOrderDirty = YES;
 }
 
 - (void)freeWindowData:(URSCompositeWindow *)cw delete:(BOOL)shouldDelete {
@@ -925,25 +1230,9 @@
         cw.picture = XCB_NONE;
     }
     
-    if (cw.borderSize != XCB_NONE) {
-        xcb_xfixes_destroy_region(conn, cw.borderSize);
-        cw.borderSize = XCB_NONE;
-    }
-    
-    if (cw.extents != XCB_NONE) {
-        xcb_xfixes_destroy_region(conn, cw.extents);
-        cw.extents = XCB_NONE;
-    }
-    
-    if (cw.shadowPicture != XCB_NONE) {
-        xcb_render_free_picture(conn, cw.shadowPicture);
-        cw.shadowPicture = XCB_NONE;
-    }
+    [self releaseBorderSize:cw];
     
-    if (cw.shadowPixmap != XCB_NONE) {
-        xcb_free_pixmap(conn, cw.shadowPixmap);
-        cw.shadowPixmap = XCB_NONE;
-    }
+    cw.hasShadow = NO;
     
     if (shouldDelete && cw.damage != XCB_NONE) {
         xcb_damage_destroy(conn, cw.damage);
@@ -987,107 +1276,34 @@
     
     URSCompositeWindow *cw = [self findCWindow:windowId];
     if (!cw) {
+        URSPendingAdoption *pending = self.pendingAdoptions[@(windowId)];
+        pending.hasPosition = YES;
+        pending.x = x;
+        pending.y = y;
         return;
     }
     
-    xcb_connection_t *conn = [self.connection connection];
-
-    // Translate to root coordinates for child windows
+    // Translate to root coordinates for child windows (from the window tree cache)
     int16_t newX = x;
     int16_t newY = y;
+    [self updateTreeGeometryForWindow:windowId x:x y:y];
     if (cw.parentWindowId != XCB_NONE && cw.parentWindowId != self.rootWindow) {
-        xcb_translate_coordinates_cookie_t cookie = xcb_translate_coordinates(conn,
-                                                                              cw.windowId,
-                                                                              self.rootWindow,
-                                                                              0, 0);
-        xcb_translate_coordinates_reply_t *reply = xcb_translate_coordinates_reply(conn, cookie, NULL);
-        if (reply) {
-            newX = reply->dst_x;
-            newY = reply->dst_y;
-            free(reply);
-        }
+        [self rootOriginForWindow:cw.windowId x:&newX y:&newY];
     }
     
-    // PERFORMANCE FIX: During drag, only damage once with combined old+new area
-    // Instead of damaging old area, updating position, then damaging new area
-    if (cw.viewable) {
-        // Create a region that covers both old and new positions
-        xcb_rectangle_t rects[2];
-        
-        // Old position (including shadow if present)
-        rects[0].x = cw.x;
-        rects[0].y = cw.y;
-        rects[0].width = cw.width + 2 * cw.borderWidth;
-        rects[0].height = cw.height + 2 * cw.borderWidth;
-        
-        // Expand to include shadow if present
-        if (cw.shadowPicture != XCB_NONE) {
-            // Shadow offsets are typically negative, so we need to expand the rectangle
-            // to encompass both the window and its shadow
-            int16_t shadow_x = cw.x + cw.shadowOffsetX;
-            int16_t shadow_y = cw.y + cw.shadowOffsetY;
-            int16_t window_right = cw.x + cw.width + 2 * cw.borderWidth;
-            int16_t window_bottom = cw.y + cw.height + 2 * cw.borderWidth;
-            int16_t shadow_right = shadow_x + cw.shadowWidth;
-            int16_t shadow_bottom = shadow_y + cw.shadowHeight;
-            
-            // Calculate bounding box that includes both window and shadow
-            rects[0].x = (shadow_x < cw.x) ? shadow_x : cw.x;
-            rects[0].y = (shadow_y < cw.y) ? shadow_y : cw.y;
-            int16_t right = (shadow_right > window_right) ? shadow_right : window_right;
-            int16_t bottom = (shadow_bottom > window_bottom) ? shadow_bottom : window_bottom;
-            rects[0].width = right - rects[0].x;
-            rects[0].height = bottom - rects[0].y;
-        }
-        
-        // New position (including shadow if present)
-        rects[1].x = newX;
-        rects[1].y = newY;
-        rects[1].width = cw.width + 2 * cw.borderWidth;
-        rects[1].height = cw.height + 2 * cw.borderWidth;
-        
-        // Expand to include shadow if present
-        if (cw.shadowPicture != XCB_NONE) {
-            // Shadow offsets are typically negative, so we need to expand the rectangle
-            // to encompass both the window and its shadow
-            int16_t shadow_x = newX + cw.shadowOffsetX;
-            int16_t shadow_y = newY + cw.shadowOffsetY;
-            int16_t window_right = newX + cw.width + 2 * cw.borderWidth;
-            int16_t window_bottom = newY + cw.height + 2 * cw.borderWidth;
-            int16_t shadow_right = shadow_x + cw.shadowWidth;
-            int16_t shadow_bottom = shadow_y + cw.shadowHeight;
-            
-            // Calculate bounding box that includes both window and shadow
-            rects[1].x = (shadow_x < newX) ? shadow_x : newX;
-            rects[1].y = (shadow_y < newY) ? shadow_y : newY;
-            int16_t right = (shadow_right > window_right) ? shadow_right : window_right;
-            int16_t bottom = (shadow_bottom > window_bottom) ? shadow_bottom : window_bottom;
-            rects[1].width = right - rects[1].x;
-            rects[1].height = bottom - rects[1].y;
-        }
-        
-        // Create a single region covering both areas
-        xcb_xfixes_region_t combined = xcb_generate_id(conn);
-        xcb_xfixes_create_region(conn, combined, 2, rects);
-        [self addDamage:combined];
-    }
+    // PERFORMANCE FIX: During drag, damage old and new extents in the
+    // client-side damage region; nothing is sent until the frame is painted
+    BOOL damageMove = cw.viewable;
+    xcb_rectangle_t oldExtents = [self extentsRectForWindow:cw];
     
     // Update position
     cw.x = newX;
     cw.y = newY;
     
-    // Invalidate regions since position changed
-    if (cw.borderSize != XCB_NONE) {
-        xcb_xfixes_destroy_region(conn, cw.borderSize);
-        cw.borderSize = XCB_NONE;
-    }
-    if (cw.extents != XCB_NONE) {
-        xcb_xfixes_destroy_region(conn, cw.extents);
-        cw.extents = XCB_NONE;
+    if (damageMove) {
+        [self addDamageRect:oldExtents];
+        [self addDamageRect:[self extentsRectForWindow:cw]];
     }
-
-    // Mark stacking order dirty (window moved)
-    self.stackingOrderDirty = YES;
 }
 
 - (void)invalidateWindowPixmap:(xcb_window_t)windowId {
@@ -1109,6 +1325,24 @@
         return;
     }
 
+    // A move keeps the backing pixmap; only a size change replaces it
+    if ([self windowPixmapIsStale:cw]) {
+        [self releaseWindowPixmap:cw];
+    }
+
+    // Ensure updated content is repainted
+    [self damageWindowArea:cw];
+    [self scheduleRepair];
+}
+
+// YES when the server has replaced the backing pixmap since it was named
+- (BOOL)windowPixmapIsStale:(URSCompositeWindow *)cw {
+    return cw.nameWindowPixmap != XCB_NONE &&
+           (cw.pixmapWidth != cw.width || cw.pixmapHeight != cw.height);
+}
+
+// Drop the named pixmap and its Picture; both are recreated on the next paint
+- (void)releaseWindowPixmap:(URSCompositeWindow *)cw {
     xcb_connection_t *conn = [self.connection connection];
 
     if (cw.nameWindowPixmap != XCB_NONE) {
@@ -1121,10 +1355,6 @@
     }
     cw.pictureValid = NO;
     cw.needsPictureCreation = YES;
-
-    // Ensure updated content is repainted
-    [self damageWindowArea:cw];
-    [self scheduleRepair];
 }
 
 - (void)resizeWindow:(xcb_window_t)windowId x:(int16_t)x y:(int16_t)y 
@@ -1135,25 +1365,22 @@
     
     URSCompositeWindow *cw = [self findCWindow:windowId];
     if (!cw) {
+        URSPendingAdoption *pending = self.pendingAdoptions[@(windowId)];
+        pending.hasPosition = YES;
+        pending.x = x;
+        pending.y = y;
+        pending.hasSize = YES;
+        pending.width = width;
+        pending.height = height;
         return;
     }
-    
-    xcb_connection_t *conn = [self.connection connection];
 
-    // Translate to root coordinates for child windows
+    // Translate to root coordinates for child windows (from the window tree cache)
     int16_t newX = x;
     int16_t newY = y;
+    [self updateTreeGeometryForWindow:windowId x:x y:y];
     if (cw.parentWindowId != XCB_NONE && cw.parentWindowId != self.rootWindow) {
-        xcb_translate_coordinates_cookie_t cookie = xcb_translate_coordinates(conn,
-                                                                              cw.windowId,
-                                                                              self.rootWindow,
-                                                                              0, 0);
-        xcb_translate_coordinates_reply_t *reply = xcb_translate_coordinates_reply(conn, cookie, NULL);
-        if (reply) {
-            newX = reply->dst_x;
-            newY = reply->dst_y;
-            free(reply);
-        }
+        [self rootOriginForWindow:cw.windowId x:&newX y:&newY];
     }
     
     // If visible, damage the old area
@@ -1163,38 +1390,11 @@
     
     // If size changed, we need to recreate the pixmap and picture
     if (cw.width != width || cw.height != height) {
-        if (cw.nameWindowPixmap != XCB_NONE) {
-            xcb_free_pixmap(conn, cw.nameWindowPixmap);
-            cw.nameWindowPixmap = XCB_NONE;
-        }
-        if (cw.picture != XCB_NONE) {
-            xcb_render_free_picture(conn, cw.picture);
-            cw.picture = XCB_NONE;
-        }
-        // Recreate shadow with new size
-        if (cw.shadowPicture != XCB_NONE) {
-            xcb_render_free_picture(conn, cw.shadowPicture);
-            cw.shadowPicture = XCB_NONE;
-        }
-        if (cw.shadowPixmap != XCB_NONE) {
-            xcb_free_pixmap(conn, cw.shadowPixmap);
-            cw.shadowPixmap = XCB_NONE;
-        }
-        // OPTIMIZATION: Reset lazy picture flags so picture is recreated
-        cw.pictureValid = NO;
-        cw.needsPictureCreation = YES;
-    }
-    
-    // If position or size changed, invalidate regions
-    if (cw.width != width || cw.height != height || cw.x != newX || cw.y != newY) {
-        if (cw.borderSize != XCB_NONE) {
-            xcb_xfixes_destroy_region(conn, cw.borderSize);
-            cw.borderSize = XCB_NONE;
-        }
-        if (cw.extents != XCB_NONE) {
-            xcb_xfixes_destroy_region(conn, cw.extents);
-            cw.extents = XCB_NONE;
-        }
+        [self releaseWindowPixmap:cw];
+        // Shadow extents follow the new size (tiles are shared, nothing to free)
+        cw.hasShadow = NO;
+        // Bounding shape follows the size (e.g. rounded frame corners)
+        [self releaseBorderSize:cw];
     }
     
     // Update cached geometry
@@ -1212,29 +1412,38 @@
 - (void)mapWindow:(xcb_window_t)windowId {
     URSCompositeWindow *cw = [self findCWindow:windowId];
     if (!cw) {
+        // Adopted once the replies are in; it is painted from then on
         [self addWindow:windowId];
-        cw = [self findCWindow:windowId];
+        self.pendingAdoptions[@(windowId)].mapState = 1;
+        return;
     }
     
     if (cw) {
         cw.viewable = YES;
         cw.damaged = NO;
-        // OPTIMIZATION: Force picture recreation on remap (window may have new content)
-        cw.pictureValid = NO;
-        cw.needsPictureCreation = YES;
+        // BUGFIX: Mapping allocates a new backing pixmap, so a pixmap named before an
+        // unmap shows the old contents (fixed-size dialogs never redraw to hide it)
+        [self releaseWindowPixmap:cw];
+        // Shape may have been set while unmapped; refetch on next paint
+        [self releaseBorderSize:cw];
         // Create shadow for newly mapped window
-        if (cw.shadowPicture == XCB_NONE && self.argbFormat != XCB_NONE) {
+        if (!cw.hasShadow) {
             [self createShadowForWindow:cw];
         }
         [self damageWindowArea:cw];
-        // OPTIMIZATION: Window mapping can change stacking order
-        self.stackingOrderDirty = YES;
+        
+        // Mapping never restacks; a root child missing from the list means we lost track
+        URSWindowNode *node = self.windowTree[@(windowId)];
+        if (node.parent == self.rootWindow && [self stackingIndexOfWindow:windowId] == NSNotFound) {
+            self.stackingOrderDirty = YES;
+        }
     }
 }
 
 - (void)unmapWindow:(xcb_window_t)windowId {
     URSCompositeWindow *cw = [self findCWindow:windowId];
     if (!cw) {
+        self.pendingAdoptions[@(windowId)].mapState = 0;
         return;
     }
     
@@ -1242,6 +1451,11 @@
         [self damageWindowArea:cw];
     }
     
+    // Redirect before the window can be mapped again
+    if (windowId == self.bypassWindow) {
+        [self endFullscreenBypassRedirecting:YES];
+    }
+    
     cw.viewable = NO;
     cw.damaged = NO;
 
@@ -1252,49 +1466,202 @@
     
     // Free window data but keep the damage object
     [self freeWindowData:cw delete:NO];
-    // OPTIMIZATION: Window unmapping can change stacking order
-    self.stackingOrderDirty = YES;
 }
 
-#pragma mark - Damage Handling
+#pragma mark - Window Tree Cache
 
-- (void)handleDamageNotify:(xcb_window_t)windowId {
-    if (!self.compositingActive) {
-        return;
+// OPTIMIZATION: Parent links and parent-relative origins for every window we
+// hear about, so frame lookup and root origins need no query_tree or
+// translate_coordinates round-trips. Windows that predate the cache are
+// fetched once on first use.
+- (URSWindowNode *)nodeForWindow:(xcb_window_t)window {
+    if (window == XCB_NONE || window == self.rootWindow) {
+        return nil;
     }
+    
+    URSWindowNode *node = self.windowTree[@(window)];
+    if (node) {
+        return node;
+    }
+    
+    xcb_connection_t *conn = [self.connection connection];
+    xcb_query_tree_cookie_t tree_cookie = xcb_query_tree(conn, window);
+    xcb_get_geometry_cookie_t geom_cookie = xcb_get_geometry(conn, window);
+    xcb_query_tree_reply_t *tree_reply = URS_WAIT_REPLY(xcb_query_tree_reply(conn, tree_cookie, NULL));
+    xcb_get_geometry_reply_t *geom = URS_WAIT_REPLY(xcb_get_geometry_reply(conn, geom_cookie, NULL));
+    
+    if (tree_reply && geom) {
+        node = [[URSWindowNode alloc] init];
+        node.x = geom->x;
+        node.y = geom->y;
+        node.borderWidth = geom->border_width;
+        [self setTreeNode:node parent:tree_reply->parent forWindow:window];
+    }
+    
+    free(tree_reply);
+    free(geom);
+    return node;
+}
 
-    URSCompositeWindow *cw = [self findCWindow:windowId];
-
-    // If the damaged window is not directly tracked, it might be a child window
-    // (like a titlebar). Find its parent frame window.
-    if (!cw) {
-        xcb_window_t parentFrame = [self findParentFrameWindow:windowId];
-        if (parentFrame != XCB_NONE) {
-            cw = [self findCWindow:parentFrame];
+// Root-relative outer corner of a window, summed from the cached tree
+- (BOOL)rootOriginForWindow:(xcb_window_t)window x:(int16_t *)x y:(int16_t *)y {
+    int32_t originX = 0;
+    int32_t originY = 0;
+    xcb_window_t current = window;
+    
+    for (int depth = 0; depth < 10; depth++) {
+        if (current == self.rootWindow) {
+            *x = originX;
+            *y = originY;
+            return YES;
+        }
+        
+        URSWindowNode *node = [self nodeForWindow:current];
+        if (!node) {
+            return NO;
+        }
+        
+        originX += node.x;
+        originY += node.y;
+        if (current != window) {
+            // Children are positioned inside their parent's border
+            originX += node.borderWidth;
+            originY += node.borderWidth;
         }
+        current = node.parent;
     }
+    
+    return NO;
+}
 
-    if (!cw || !cw.damage) {
-        // Unknown window damaged; force full screen repaint to avoid artifacts
-        [self damageScreen];
-        return;
+// Store a node under its parent; the parent's child set lets a destroy drop
+// the whole subtree without scanning the tree
+- (void)setTreeNode:(URSWindowNode *)node parent:(xcb_window_t)parent forWindow:(xcb_window_t)window {
+    NSNumber *key = @(window);
+    URSWindowNode *previous = self.windowTree[key];
+    if (previous) {
+        [self.windowChildren[@(previous.parent)] removeObject:key];
+    }
+    
+    node.parent = parent;
+    self.windowTree[key] = node;
+    
+    NSMutableSet<NSNumber *> *siblings = self.windowChildren[@(parent)];
+    if (!siblings) {
+        siblings = [[NSMutableSet alloc] init];
+        self.windowChildren[@(parent)] = siblings;
     }
+    [siblings addObject:key];
+}
 
-    // Keep root-relative coordinates current for damage calculations
-    [self updateAbsolutePositionForWindow:cw];
+// Children are destroyed with their parent, and the server reports each
+// DestroyNotify only to those selecting it on that window or its parent
+- (void)removeTreeSubtreeOfWindow:(xcb_window_t)window {
+    NSNumber *key = @(window);
+    NSMutableSet<NSNumber *> *children = self.windowChildren[key];
+    [self.windowChildren removeObjectForKey:key];
+    for (NSNumber *child in children) {
+        [self removeTreeSubtreeOfWindow:[child unsignedIntValue]];
+    }
+    [self.windowTree removeObjectForKey:key];
+}
 
-    [self repairWindow:cw];
+- (void)updateTreeGeometryForWindow:(xcb_window_t)window x:(int16_t)x y:(int16_t)y {
+    URSWindowNode *node = self.windowTree[@(window)];
+    if (node) {
+        node.x = x;
+        node.y = y;
+    }
 }
 
-- (void)handleExposeEvent:(xcb_window_t)windowId {
-    if (!self.compositingActive) {
-        return;
+- (void)trackCreateNotify:(xcb_create_notify_event_t *)event {
+    URSWindowNode *node = [[URSWindowNode alloc] init];
+    node.x = event->x;
+    node.y = event->y;
+    node.borderWidth = event->border_width;
+    [self setTreeNode:node parent:event->parent forWindow:event->window];
+    
+    // New windows start on top of their siblings
+    if (event->parent == self.rootWindow && [self stackingIndexOfWindow:event->window] == NSNotFound) {
+        [self insertStackingWindow:event->window atIndex:self.stackingCount];
     }
+}
 
-    URSCompositeWindow *cw = [self findCWindow:windowId];
+- (void)trackReparentNotify:(xcb_reparent_notify_event_t *)event {
+    URSWindowNode *node = self.windowTree[@(event->window)];
+    if (!node) {
+        node = [[URSWindowNode alloc] init];
+    }
+    [self setTreeNode:node parent:event->parent forWindow:event->window];
+    node.x = event->x;
+    node.y = event->y;
+    
+    // Leaving the root drops the window from the stack; arriving puts it on top
+    NSUInteger index = [self stackingIndexOfWindow:event->window];
+    if (index != NSNotFound) {
+        [self removeStackingRecordAtIndex:index];
+    }
+    if (event->parent == self.rootWindow) {
+        [self insertStackingWindow:event->window atIndex:self.stackingCount];
+    }
+}
 
-    // If the exposed window is not directly tracked, it might be a child window
-    // (like a titlebar or client). Find its parent frame window.
+- (void)trackConfigureNotify:(xcb_configure_notify_event_t *)event {
+    URSWindowNode *node = self.windowTree[@(event->window)];
+    if (node) {
+        node.x = event->x;
+        node.y = event->y;
+        node.borderWidth = event->border_width;
+    }
+    
+    // above_sibling is the sibling directly below; a plain move leaves it unchanged
+    if ([self restackWindow:event->window aboveSibling:event->above_sibling]) {
+        [self damageRestackedWindow:event->window];
+    }
+}
+
+- (void)trackCirculateNotify:(xcb_circulate_notify_event_t *)event {
+    NSUInteger index = [self stackingIndexOfWindow:event->window];
+    if (index == NSNotFound) {
+        return;
+    }
+    
+    URSStackingRecord record = self.stackingRecords[index];
+    [self removeStackingRecordAtIndex:index];
+    NSUInteger target = (event->place == XCB_PLACE_ON_TOP) ? self.stackingCount : 0;
+    [self insertStackingRecord:record atIndex:target];
+    if (target != index) {
+        [self damageRestackedWindow:event->window];
+    }
+}
+
+- (void)trackDestroyNotify:(xcb_destroy_notify_event_t *)event {
+    xcb_window_t destroyed = event->window;
+    URSWindowNode *node = self.windowTree[@(destroyed)];
+    if (node) {
+        [self.windowChildren[@(node.parent)] removeObject:@(destroyed)];
+    }
+    [self removeTreeSubtreeOfWindow:destroyed];
+    [self.ignoredWindows removeObject:@(destroyed)];
+    
+    NSUInteger index = [self stackingIndexOfWindow:destroyed];
+    if (index != NSNotFound) {
+        [self removeStackingRecordAtIndex:index];
+    }
+}
+
+#pragma mark - Damage Handling
+
+- (void)handleDamageNotify:(xcb_window_t)windowId area:(xcb_rectangle_t)area more:(BOOL)more {
+    if (!self.compositingActive) {
+        return;
+    }
+
+    URSCompositeWindow *cw = [self findCWindow:windowId];
+    BOOL areaIsWindowLocal = (cw != nil);
+
+    // If the damaged window is not directly tracked, it might be a child window
+    // (like a titlebar). Find its parent frame window.
     if (!cw) {
         xcb_window_t parentFrame = [self findParentFrameWindow:windowId];
         if (parentFrame != XCB_NONE) {
@@ -1302,49 +1669,77 @@
         }
     }
 
-    if (!cw) {
+    if (!cw || !cw.damage) {
+        // Unknown window damaged; force full screen repaint to avoid artifacts
+        [self damageScreen];
         return;
     }
 
-    // BUGFIX: When a window is exposed (becomes visible after being obscured),
-    // the NameWindowPixmap may be stale because fixed-size windows don't redraw
-    // themselves - they expect the X server to preserve their contents.
-    // With compositing, we must force recreation of the pixmap to get fresh content.
-    xcb_connection_t *conn = [self.connection connection];
+    // Keep root-relative coordinates current for damage calculations
+    [self updateAbsolutePositionForWindow:cw];
 
-    if (cw.nameWindowPixmap != XCB_NONE) {
-        xcb_free_pixmap(conn, cw.nameWindowPixmap);
-        cw.nameWindowPixmap = XCB_NONE;
+    // The reported area is relative to the damaged drawable; for a child of
+    // the frame its offset is unknown, so repaint the whole frame instead
+    if (!areaIsWindowLocal) {
+        area.x = 0;
+        area.y = 0;
+        area.width = cw.width;
+        area.height = cw.height;
     }
-    if (cw.picture != XCB_NONE) {
-        xcb_render_free_picture(conn, cw.picture);
-        cw.picture = XCB_NONE;
+
+    [self repairWindow:cw area:area more:more];
+}
+
+- (void)handleExposeEvent:(xcb_window_t)windowId area:(xcb_rectangle_t)area {
+    if (!self.compositingActive) {
+        return;
     }
-    cw.pictureValid = NO;
-    cw.needsPictureCreation = YES;
 
-    // Damage the exposed area to trigger repaint
-    [self damageWindowArea:cw];
+    URSCompositeWindow *cw = [self findCWindow:windowId];
+    BOOL areaIsWindowLocal = (cw != nil);
+
+    // If the exposed window is not directly tracked, it might be a child window
+    // (like a titlebar or client). Find its parent frame window.
+    if (!cw) {
+        xcb_window_t parentFrame = [self findParentFrameWindow:windowId];
+        if (parentFrame != XCB_NONE) {
+            cw = [self findCWindow:parentFrame];
+        }
+    }
+
+    if (!cw) {
+        return;
+    }
+
+    // OPTIMIZATION: The named pixmap follows the window's contents, so an expose
+    // only needs a new one when the server replaced the backing pixmap (resize
+    // or remap, normally handled in resizeWindow:/mapWindow: already).
+    if ([self windowPixmapIsStale:cw]) {
+        [self releaseWindowPixmap:cw];
+        [self damageWindowArea:cw];
+    } else if (areaIsWindowLocal) {
+        area.x += cw.x + cw.borderWidth;
+        area.y += cw.y + cw.borderWidth;
+        [self addDamageRect:area];
+    } else {
+        // Offset of the child inside the frame is not tracked; repaint the frame
+        [self damageWindowArea:cw];
+    }
     [self scheduleRepair];
 }
 
 // Find the parent window that we're tracking (frame window)
 - (xcb_window_t)findParentFrameWindow:(xcb_window_t)childWindow {
-    xcb_connection_t *conn = [self.connection connection];
     xcb_window_t current = childWindow;
     
-    // Walk up the window tree to find a tracked parent
+    // Walk up the cached window tree to find a tracked parent
     for (int depth = 0; depth < 10; depth++) { // Limit depth to prevent infinite loops
-        xcb_query_tree_cookie_t tree_cookie = xcb_query_tree(conn, current);
-        xcb_query_tree_reply_t *tree_reply = xcb_query_tree_reply(conn, tree_cookie, NULL);
-        
-        if (!tree_reply) {
+        URSWindowNode *node = [self nodeForWindow:current];
+        if (!node) {
             return XCB_NONE;
         }
         
-        xcb_window_t parent = tree_reply->parent;
-        free(tree_reply);
-        
+        xcb_window_t parent = node.parent;
         if (parent == self.rootWindow || parent == XCB_NONE) {
             return XCB_NONE; // Reached root without finding tracked window
         }
@@ -1360,83 +1755,83 @@
     return XCB_NONE;
 }
 
-- (void)repairWindow:(URSCompositeWindow *)cw {
+- (void)repairWindow:(URSCompositeWindow *)cw area:(xcb_rectangle_t)area more:(BOOL)more {
     xcb_connection_t *conn = [self.connection connection];
-    xcb_xfixes_region_t parts;
     
     // NOTE: We do NOT free the picture on damage - the underlying NameWindowPixmap
     // is automatically updated by the X server, and Pictures created from it
     // will reflect the updated content.
     // (Picture is only freed when window size changes or window is removed)
     
+    // OPTIMIZATION: Damage objects report DeltaRectangles, one event per damaged
+    // rectangle, so only those sub-rectangles are repainted. Clear the damage
+    // object after the last event of a batch without fetching its region.
+    if (!more) {
+        xcb_damage_subtract(conn, cw.damage, XCB_NONE, XCB_NONE);
+    }
+    
+    // An unredirected fullscreen window draws straight to the screen
+    if (cw.windowId == self.bypassWindow) {
+        return;
+    }
+    
+    // OPTIMIZATION: Nothing of a fully obscured window reaches the screen. Its
+    // pixmap stays current on the server; repaint it when it is revealed.
+    if (cw.visibility == XCB_VISIBILITY_FULLY_OBSCURED && !cw.animating) {
+        cw.damagedWhileObscured = YES;
+        return;
+    }
+    
     if (cw.damaged) {
-        // Window was already damaged before, get the damaged parts
-        parts = xcb_generate_id(conn);
-        xcb_xfixes_create_region(conn, parts, 0, NULL);
-        
-        // Subtract damage from window, copying to parts region
-        xcb_damage_subtract(conn, cw.damage, XCB_NONE, parts);
-        
         // Translate to screen coordinates
-        xcb_xfixes_translate_region(conn, parts, 
-                                    cw.x + cw.borderWidth,
-                                    cw.y + cw.borderWidth);
+        area.x += cw.x + cw.borderWidth;
+        area.y += cw.y + cw.borderWidth;
+        [self addDamageRect:area];
     } else {
         // First damage on this window - use full extents
-        parts = [self windowExtents:cw];
-        
-        // Clear all damage
-        xcb_damage_subtract(conn, cw.damage, XCB_NONE, XCB_NONE);
-    }
-    
-    if (parts != XCB_NONE) {
-        [self addDamage:parts];
+        [self damageWindowArea:cw];
         cw.damaged = YES;
     }
-    
-    // Flush to ensure damage events are processed
-    [self.connection flush];
 }
 
 - (void)damageScreen {
-    xcb_xfixes_region_t region = [self getScreenRegion];
-    [self addDamage:region];
+    xcb_rectangle_t r = {0, 0, self.screenWidth, self.screenHeight};
+    [self addDamageRect:r];
 }
 
 - (void)damageWindowArea:(URSCompositeWindow *)cw {
-    xcb_xfixes_region_t extents = [self windowExtents:cw];
-    if (extents != XCB_NONE) {
-        [self addDamage:extents];
-    }
+    [self addDamageRect:[self extentsRectForWindow:cw]];
 }
 
-- (void)addDamage:(xcb_xfixes_region_t)damage {
-    if (damage == XCB_NONE) {
+- (void)addDamageRect:(xcb_rectangle_t)rect {
+    if (!self.damageRegion) {
         return;
     }
     
-    xcb_connection_t *conn = [self.connection connection];
-    
     // Clip to screen region
-    if (self.screenRegion == XCB_NONE) {
-        self.screenRegion = [self getScreenRegion];
+    xcb_rectangle_t screen = {0, 0, self.screenWidth, self.screenHeight};
+    int32_t x1 = MAX(rect.x, screen.x);
+    int32_t y1 = MAX(rect.y, screen.y);
+    int32_t x2 = MIN((int32_t)rect.x + rect.width, (int32_t)screen.width);
+    int32_t y2 = MIN((int32_t)rect.y + rect.height, (int32_t)screen.height);
+    if (x2 <= x1 || y2 <= y1) {
+        return;
     }
-    xcb_xfixes_intersect_region(conn, damage, damage, self.screenRegion);
+    xcb_rectangle_t clipped = {x1, y1, x2 - x1, y2 - y1};
     
-    if (self.allDamage != XCB_NONE) {
-        // Union with existing damage
-        xcb_xfixes_union_region(conn, self.allDamage, self.allDamage, damage);
-        xcb_xfixes_destroy_region(conn, damage);
-    } else {
-        self.allDamage = damage;
+    if ([self.damageRegion isEmpty]) {
+        self.damageTime = [NSDate timeIntervalSinceReferenceDate];
     }
     
+    // Union with existing damage (client-side, no requests)
+    [self.damageRegion unionWithRectangle:clipped];
+    [self.damageRegion simplifyToMaximumRectangles:DAMAGE_MAX_RECTS];
+    
     [self scheduleRepair];
 }
 
-- (xcb_xfixes_region_t)windowExtents:(URSCompositeWindow *)cw {
-    xcb_connection_t *conn = [self.connection connection];
-    
+// Screen-space bounding box of a window including its shadow
+- (xcb_rectangle_t)extentsRectForWindow:(URSCompositeWindow *)cw {
     xcb_rectangle_t r;
     r.x = cw.x;
     r.y = cw.y;
@@ -1444,122 +1839,302 @@
     r.height = cw.height + 2 * cw.borderWidth;
     
     // Expand to include shadow if present
-    if (cw.shadowPicture != XCB_NONE) {
-        r.x += cw.shadowOffsetX;
-        r.y += cw.shadowOffsetY;
-        r.width = cw.shadowWidth;
-        r.height = cw.shadowHeight;
+    if (cw.hasShadow) {
+        int32_t shadow_x = cw.x + cw.shadowOffsetX;
+        int32_t shadow_y = cw.y + cw.shadowOffsetY;
+        int32_t right = MAX((int32_t)r.x + r.width, shadow_x + cw.shadowWidth);
+        int32_t bottom = MAX((int32_t)r.y + r.height, shadow_y + cw.shadowHeight);
+        r.x = MIN(r.x, shadow_x);
+        r.y = MIN(r.y, shadow_y);
+        r.width = right - r.x;
+        r.height = bottom - r.y;
     }
     
-    xcb_xfixes_region_t region = xcb_generate_id(conn);
-    xcb_xfixes_create_region(conn, region, 1, &r);
-    return region;
+    return r;
 }
 
-- (xcb_xfixes_region_t)getScreenRegion {
-    xcb_connection_t *conn = [self.connection connection];
-    
-    xcb_rectangle_t r;
-    r.x = 0;
-    r.y = 0;
-    r.width = self.screenWidth;
-    r.height = self.screenHeight;
+// Extents the window will have once painted, so culling can run before
+// createShadowForWindow and skip it for windows nobody can see
+- (xcb_rectangle_t)paintExtentsRectForWindow:(URSCompositeWindow *)cw {
+    xcb_rectangle_t r = [self extentsRectForWindow:cw];
+    if (cw.hasShadow || cw.overrideRedirect || self.gaussianSize <= 0) {
+        return r;
+    }
     
-    xcb_xfixes_region_t region = xcb_generate_id(conn);
-    xcb_xfixes_create_region(conn, region, 1, &r);
-    return region;
+    // Same geometry createShadowForWindow will give the shadow
+    int32_t shadow_x = cw.x + SHADOW_OFFSET_X;
+    int32_t shadow_y = cw.y + SHADOW_OFFSET_Y;
+    int32_t right = MAX((int32_t)r.x + r.width, shadow_x + r.width + self.gaussianSize);
+    int32_t bottom = MAX((int32_t)r.y + r.height, shadow_y + r.height + self.gaussianSize);
+    r.x = MIN(r.x, shadow_x);
+    r.y = MIN(r.y, shadow_y);
+    r.width = right - r.x;
+    r.height = bottom - r.y;
+    return r;
 }
 
-#pragma mark - Compositing
+#pragma mark - Frame Clock
+
+- (void)setupFrameClock {
+    NSUserDefaults *defaults = [NSUserDefaults standardUserDefaults];
+    
+    // Fallback interval when Present is unavailable (seconds, default 60 Hz)
+    double interval = [defaults doubleForKey:@"URSCompositorFrameInterval"];
+    self.frameInterval = (interval > 0.0) ? interval : 1.0 / 60.0;
+    
+    // Present pacing can be turned off for servers with a broken vblank source
+    if ([defaults objectForKey:@"URSCompositorVblankPacing"] &&
+        ![defaults boolForKey:@"URSCompositorVblankPacing"]) {
+        self.presentAvailable = NO;
+    }
+    
+    if (self.presentAvailable) {
+        xcb_connection_t *conn = [self.connection connection];
+        self.presentEventId = xcb_generate_id(conn);
+        xcb_present_select_input(conn, self.presentEventId, self.outputWindow,
+                                 XCB_PRESENT_EVENT_MASK_COMPLETE_NOTIFY);
+    }
+    
+    self.framePending = NO;
+    self.waitingForVblank = NO;
+    self.lastFrameTime = 0;
+    
+    if (!self.paintLatencySamples) {
+        self.paintLatencySamples = calloc(URS_LATENCY_SAMPLES, sizeof(double));
+    }
+    self.paintLatencySampleCount = 0;
+    
+    // Requests per frame cost two NoOps per paint, so only count them for benchmark runs
+    self.countFrameRequests = [defaults stringForKey:@"URSBenchmarkStatsFile"] != nil;
+    self.frameRequests = 0;
+    
+    NSLog(@"[CompositingManager] Frame clock: %@ pacing, interval %.2f ms",
+          self.presentAvailable ? @"vblank (Present)" : @"timer", self.frameInterval * 1000.0);
+}
 
 - (void)scheduleRepair {
-    // If repair is already scheduled, don't reschedule (damage accumulates)
-    if (self.repairScheduled) {
+    [self requestFrame];
+}
+
+// Ask for one frame. Damage keeps accumulating in damageRegion until it runs.
+- (void)requestFrame {
+    if (!self.compositingActive || self.framePending) {
         return;
     }
     
-    // Mark repair as scheduled
-    self.repairScheduled = YES;
+    NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+    self.framePending = YES;
+    self.frameRequestTime = now;
+    
+    if (self.presentAvailable) {
+        // Wake up at the next vblank; CompleteNotify runs the frame
+        self.waitingForVblank = YES;
+        self.presentSerial += 1;
+        xcb_present_notify_msc([self.connection connection], self.outputWindow,
+                               self.presentSerial, 0, 1, 0);
+        xcb_flush([self.connection connection]);
+        
+        // Guard against a stalled vblank source
+        [self performSelector:@selector(frameClockTick)
+                   withObject:nil
+                   afterDelay:self.frameInterval * 4.0];
+        return;
+    }
     
-    // Schedule repair on next run loop iteration (immediate)
-    // This ensures damage is painted as soon as possible while still
-    // allowing multiple damage events to accumulate
-    [self performSelector:@selector(performRepair) withObject:nil afterDelay:0.0];
+    NSTimeInterval delay = self.lastFrameTime + self.frameInterval - now;
+    [self performSelector:@selector(frameClockTick)
+               withObject:nil
+               afterDelay:(delay > 0.0) ? delay : 0.0];
+}
+
+- (void)frameClockTick {
+    if (self.waitingForVblank) {
+        NSLog(@"[CompositingManager] Present CompleteNotify timed out; painting anyway");
+    }
+    [self performRepair];
 }
 
+- (BOOL)handlePresentEvent:(xcb_generic_event_t *)event {
+    if (!self.presentAvailable || (event->response_type & ~0x80) != XCB_GE_GENERIC) {
+        return NO;
+    }
+    
+    xcb_ge_generic_event_t *ge = (xcb_ge_generic_event_t *)event;
+    if (ge->extension != self.presentOpcode || ge->event_type != XCB_PRESENT_COMPLETE_NOTIFY) {
+        return NO;
+    }
+    
+    xcb_present_complete_notify_event_t *complete = (xcb_present_complete_notify_event_t *)event;
+    if (complete->kind != XCB_PRESENT_COMPLETE_KIND_NOTIFY_MSC) {
+        return YES;
+    }
+    
+    // Track the real refresh rate from consecutive vblank timestamps
+    if (self.lastMsc != 0 && complete->msc > self.lastMsc && complete->ust > self.lastUst) {
+        double interval = (double)(complete->ust - self.lastUst) /
+                          (double)(complete->msc - self.lastMsc) / 1000000.0;
+        if (interval >= 1.0 / 240.0 && interval <= 1.0 / 20.0) {
+            self.frameInterval = interval;
+        }
+    }
+    self.lastMsc = complete->msc;
+    self.lastUst = complete->ust;
+    
+    if (self.waitingForVblank && complete->serial == self.presentSerial) {
+        [self performRepair];
+    }
+    return YES;
+}
+
+// Run one frame: paint all accumulated damage once
 - (void)performRepair {
+    [NSObject cancelPreviousPerformRequestsWithTarget:self
+                                             selector:@selector(frameClockTick)
+                                               object:nil];
+    self.framePending = NO;
+    self.waitingForVblank = NO;
+    
     if (!self.compositingActive) {
-        self.repairScheduled = NO;
+        return;
+    }
+    
+    // A fullscreen window is scanning out directly; nothing to composite
+    if ([self updateFullscreenBypass]) {
+        [self.damageRegion removeAllRectangles];
         return;
     }
     
     // Check if there's damage to paint
-    if (self.allDamage == XCB_NONE) {
-        self.repairScheduled = NO;
+    if ([self.damageRegion isEmpty]) {
         return;
     }
     
-    xcb_xfixes_region_t damage = self.allDamage;
-    self.allDamage = XCB_NONE;
-    self.repairScheduled = NO;
+    NSTimeInterval start = [NSDate timeIntervalSinceReferenceDate];
+    NSTimeInterval waited = start - self.frameRequestTime;
+    if (waited > self.frameInterval) {
+        self.framesSkipped += (NSUInteger)(waited / self.frameInterval);
+    }
+    
+    // Swap regions so damage raised while painting lands in the next frame,
+    // then upload this frame's damage with a single request
+    XCBRegion *damage = self.damageRegion;
+    NSTimeInterval damagedAt = self.damageTime;
+    self.damageRegion = self.frameRegion;
+    self.frameRegion = damage;
+    [self.damageRegion removeAllRectangles];
+    
+    // Sequence numbers of two NoOps bracket the requests this frame issued
+    xcb_connection_t *conn = [self.connection connection];
+    unsigned int firstSequence = self.countFrameRequests ? xcb_no_operation(conn).sequence : 0;
+    
+    [damage updateServerRegion];
+    [self paintAll:[damage regionId]];
+    
+    if (self.countFrameRequests) {
+        unsigned int lastSequence = xcb_no_operation(conn).sequence;
+        self.frameRequests += (unsigned int)(lastSequence - firstSequence - 1);
+    }
+    
+    NSTimeInterval end = [NSDate timeIntervalSinceReferenceDate];
+    self.lastFrameTime = start;
+    self.framesPainted += 1;
+    self.lastPaintDuration = end - start;
+    self.lastPaintLatency = end - damagedAt;
+    self.totalPaintLatency += self.lastPaintLatency;
+    if (self.paintLatencySamples) {
+        self.paintLatencySamples[self.paintLatencySampleCount % URS_LATENCY_SAMPLES] = self.lastPaintLatency;
+        self.paintLatencySampleCount += 1;
+    }
     
-    [self paintAll:damage];
+    [self reportPendingVisibility];
     
-    xcb_xfixes_destroy_region([self.connection connection], damage);
+    // Animations advance once per frame
+    if (self.activeAnimations > 0) {
+        [self damageScreen];
+    }
 }
 
 - (void)performRepairNow {
-    if (!self.compositingActive) {
+    if (!self.compositingActive || [self.damageRegion isEmpty]) {
         return;
     }
-
-    // PERFORMANCE FIX: Time-based throttling during drag (target ~60fps = 16.67ms)
-    // Unlike frame-skipping, this ensures we always paint when enough time has passed,
-    // preventing ghost artifacts while still maintaining good performance.
-    if ([self.connection dragState]) {
-        NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
-        NSTimeInterval elapsed = now - self.lastRepairTime;
-
-        // Throttle to ~60fps during drag (allow paint if >= 16ms since last paint)
-        // This prevents ghost artifacts that occurred with frame-skipping
-        if (elapsed < 0.016 && self.lastRepairTime > 0) {
-            // Too soon - schedule a deferred repair to ensure we don't miss this damage
-            if (!self.repairScheduled) {
-                self.repairScheduled = YES;
-                [self performSelector:@selector(performRepair)
-                           withObject:nil
-                           afterDelay:0.016 - elapsed];
-            }
-            return;
+    
+    // Without vblank pacing, paint right away if a frame is due; otherwise the
+    // frame clock picks the damage up, so there is never more than one paint
+    // per refresh (this also covers the old drag throttle).
+    NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+    if (!self.presentAvailable && now - self.lastFrameTime >= self.frameInterval) {
+        if (!self.framePending) {
+            self.frameRequestTime = now;
         }
-        self.lastRepairTime = now;
-    }
-
-    // Cancel any scheduled repair
-    if (self.repairScheduled) {
-        [NSObject cancelPreviousPerformRequestsWithTarget:self
-                                                 selector:@selector(performRepair)
-                                                   object:nil];
-        self.repairScheduled = NO;
-    }
-
-    // Check if there's damage to paint
-    if (self.allDamage == XCB_NONE) {
+        [self performRepair];
         return;
     }
+    
+    [self requestFrame];
+}
 
-    xcb_xfixes_region_t damage = self.allDamage;
-    self.allDamage = XCB_NONE;
+static int URSCompareDoubles(const void *a, const void *b) {
+    double lhs = *(const double *)a;
+    double rhs = *(const double *)b;
+    return (lhs > rhs) - (lhs < rhs);
+}
 
-    [self paintAll:damage];
+// Nearest-rank percentile over a sorted sample array
+static inline double URSPercentile(const double *sorted, NSUInteger count, double percentile) {
+    if (count == 0) {
+        return 0.0;
+    }
+    NSUInteger rank = (NSUInteger)ceil(percentile / 100.0 * (double)count);
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
 
-    xcb_xfixes_destroy_region([self.connection connection], damage);
+- (NSDictionary *)frameStatistics {
+    NSTimeInterval average = (self.framesPainted > 0) ?
+        self.totalPaintLatency / (double)self.framesPainted : 0.0;
+    
+    // Percentiles over the most recent frames only
+    NSUInteger samples = MIN(self.paintLatencySampleCount, (NSUInteger)URS_LATENCY_SAMPLES);
+    double p50 = 0.0, p90 = 0.0, p99 = 0.0;
+    if (samples > 0) {
+        double *sorted = malloc(samples * sizeof(double));
+        if (sorted) {
+            memcpy(sorted, self.paintLatencySamples, samples * sizeof(double));
+            qsort(sorted, samples, sizeof(double), URSCompareDoubles);
+            p50 = URSPercentile(sorted, samples, 50.0);
+            p90 = URSPercentile(sorted, samples, 90.0);
+            p99 = URSPercentile(sorted, samples, 99.0);
+            free(sorted);
+        }
+    }
+    
+    NSMutableDictionary *statistics = [NSMutableDictionary dictionaryWithDictionary:@{
+        @"framesPainted": @(self.framesPainted),
+        @"framesSkipped": @(self.framesSkipped),
+        @"lastPaintLatency": @(self.lastPaintLatency),
+        @"averagePaintLatency": @(average),
+        @"lastPaintDuration": @(self.lastPaintDuration),
+        @"frameInterval": @(self.frameInterval),
+        @"vblankPacing": @(self.presentAvailable),
+        @"windowsCulled": @(self.culledWindowCount),
+        @"stackingResyncs": @(self.stackingResyncs),
+        @"paintRoundTrips": @(self.paintRoundTrips),
+        @"fullscreenBypasses": @(self.bypassCount),
+        @"paintLatencyP50": @(p50),
+        @"paintLatencyP90": @(p90),
+        @"paintLatencyP99": @(p99),
+        @"paintLatencySamples": @(samples)
+    }];
+    if (self.countFrameRequests && self.framesPainted > 0) {
+        statistics[@"requestsPerFrame"] = @((double)self.frameRequests / (double)self.framesPainted);
+    }
+    return statistics;
 }
 
 - (void)scheduleComposite {
     // If no damage is pending, damage the entire screen to ensure redraw
     // This handles cases where external drawing (like GSTheme) needs compositing
-    if (self.allDamage == XCB_NONE) {
+    if ([self.damageRegion isEmpty]) {
         [self damageScreen];
     } else {
         [self scheduleRepair];
@@ -1590,33 +2165,18 @@ static inline xcb_render_transform_t URSIdentityTransform(void) {
     return transform;
 }
 
-- (void)startAnimationTimerIfNeeded {
-    if (self.animationTimer || self.activeAnimations == 0) {
-        return;
-    }
-    self.animationTimer = [NSTimer scheduledTimerWithTimeInterval:0.016
-                                                           target:self
-                                                         selector:@selector(animationTimerFired:)
-                                                         userInfo:nil
-                                                          repeats:YES];
+static inline BOOL URSRectIntersectsRect(xcb_rectangle_t a, xcb_rectangle_t b) {
+    return (int32_t)a.x < (int32_t)b.x + b.width && (int32_t)b.x < (int32_t)a.x + a.width &&
+           (int32_t)a.y < (int32_t)b.y + b.height && (int32_t)b.y < (int32_t)a.y + a.height;
 }
 
-- (void)stopAnimationTimerIfIdle {
-    if (self.activeAnimations != 0) {
-        return;
-    }
-    if (self.animationTimer) {
-        [self.animationTimer invalidate];
-        self.animationTimer = nil;
-    }
-}
-
-- (void)animationTimerFired:(NSTimer *)timer {
-    if (!self.compositingActive || self.activeAnimations == 0) {
-        [self stopAnimationTimerIfIdle];
-        return;
+static inline BOOL URSRectContainsRect(xcb_rectangle_t outer, xcb_rectangle_t inner) {
+    if (outer.width == 0 || outer.height == 0) {
+        return NO;
     }
-    [self damageScreen];
+    return inner.x >= outer.x && inner.y >= outer.y &&
+           (int32_t)inner.x + inner.width <= (int32_t)outer.x + outer.width &&
+           (int32_t)inner.y + inner.height <= (int32_t)outer.y + outer.height;
 }
 
 - (void)animateWindowMinimize:(xcb_window_t)windowId
@@ -1683,8 +2243,7 @@ static inline xcb_render_transform_t URSIdentityTransform(void) {
 
     URSCompositeWindow *cw = [self findCWindow:windowId];
     if (!cw) {
-        [self addWindow:windowId];
-        cw = [self findCWindow:windowId];
+        cw = [self adoptWindowNow:windowId];
     }
 
     if (!cw) {
@@ -1710,7 +2269,7 @@ static inline xcb_render_transform_t URSIdentityTransform(void) {
     cw.pictureValid = NO;
     cw.needsPictureCreation = YES;
 
-    [self startAnimationTimerIfNeeded];
+    // The frame clock keeps repainting while activeAnimations > 0
     [self scheduleComposite];
 }
 
@@ -1745,38 +2304,154 @@ static inline xcb_render_transform_t URSIdentityTransform(void) {
 
     [self damageScreen];
     [self scheduleRepair];
-    [self stopAnimationTimerIfIdle];
 }
 
 - (void)compositeScreen {
     [self damageScreen];
 }
 
-// OPTIMIZATION: Rebuild stacking order cache from X server
-- (void)rebuildStackingOrderCache {
-    xcb_connection_t *conn = [self.connection connection];
-    
-    xcb_query_tree_cookie_t tree_cookie = xcb_query_tree(conn, self.rootWindow);
-    xcb_query_tree_reply_t *tree_reply = xcb_query_tree_reply(conn, tree_cookie, NULL);
+#pragma mark - Stacking Order
+
+- (NSUInteger)stackingIndexOfWindow:(xcb_window_t)window {
+    // Top down: raised and newly created windows are found first
+    for (NSUInteger i = self.stackingCount; i > 0; i--) {
+        if (self.stackingRecords[i - 1].window == window) {
+            return i - 1;
+        }
+    }
+    return NSNotFound;
+}
+
+- (BOOL)reserveStackingCapacity:(NSUInteger)count {
+    if (count <= self.stackingCapacity) {
+        return YES;
+    }
     
-    if (!tree_reply) {
+    NSUInteger capacity = MAX(count, self.stackingCapacity ? self.stackingCapacity * 2 : 64);
+    URSStackingRecord *records = realloc(self.stackingRecords, capacity * sizeof(URSStackingRecord));
+    if (!records) {
+        return NO;
+    }
+    self.stackingRecords = records;
+    self.stackingCapacity = capacity;
+    return YES;
+}
+
+- (void)insertStackingRecord:(URSStackingRecord)record atIndex:(NSUInteger)index {
+    if (![self reserveStackingCapacity:self.stackingCount + 1]) {
+        self.stackingOrderDirty = YES;
         return;
     }
     
-    [self.windowStackingOrder removeAllObjects];
+    URSStackingRecord *records = self.stackingRecords;
+    memmove(&records[index + 1], &records[index], (self.stackingCount - index) * sizeof(URSStackingRecord));
+    records[index] = record;
+    self.stackingCount += 1;
+    self.stackingChangedWhileResyncing = (self.stackingResyncRequest != 0);
+}
+
+- (void)insertStackingWindow:(xcb_window_t)window atIndex:(NSUInteger)index {
+    URSStackingRecord record = { window, [self findCWindow:window] };
+    [self insertStackingRecord:record atIndex:index];
+}
+
+- (void)removeStackingRecordAtIndex:(NSUInteger)index {
+    URSStackingRecord *records = self.stackingRecords;
+    memmove(&records[index], &records[index + 1], (self.stackingCount - index - 1) * sizeof(URSStackingRecord));
+    self.stackingCount -= 1;
+    self.stackingChangedWhileResyncing = (self.stackingResyncRequest != 0);
+}
+
+- (void)attachStackingRecordForWindow:(xcb_window_t)window compositeWindow:(URSCompositeWindow *)cw {
+    NSUInteger index = [self stackingIndexOfWindow:window];
+    if (index != NSNotFound) {
+        self.stackingRecords[index].cw = cw;
+    }
+}
+
+// Move window directly above sibling (XCB_NONE: to the bottom). Returns YES if
+// the order changed. An unknown sibling means the list is out of sync.
+- (BOOL)restackWindow:(xcb_window_t)window aboveSibling:(xcb_window_t)sibling {
+    NSUInteger index = [self stackingIndexOfWindow:window];
+    if (index == NSNotFound) {
+        return NO;
+    }
     
-    xcb_window_t *children = xcb_query_tree_children(tree_reply);
-    int num_children = xcb_query_tree_children_length(tree_reply);
+    NSUInteger target = 0;
+    if (sibling != XCB_NONE) {
+        NSUInteger siblingIndex = [self stackingIndexOfWindow:sibling];
+        if (siblingIndex == NSNotFound) {
+            self.stackingOrderDirty = YES;
+            return YES;
+        }
+        target = siblingIndex + 1;
+    }
     
-    for (int i = 0; i < num_children; i++) {
-        [self.windowStackingOrder addObject:@(children[i])];
+    // Already directly above its sibling
+    if (index == target) {
+        return NO;
     }
     
-    free(tree_reply);
+    URSStackingRecord record = self.stackingRecords[index];
+    [self removeStackingRecordAtIndex:index];
+    if (target > index) {
+        target -= 1;
+    }
+    [self insertStackingRecord:record atIndex:target];
+    return YES;
+}
+
+// Restacking only changes what is visible inside the window's own extents
+- (void)damageRestackedWindow:(xcb_window_t)window {
+    URSCompositeWindow *cw = [self findCWindow:window];
+    if (cw && (cw.viewable || cw.animating)) {
+        [self addDamageRect:[self paintExtentsRectForWindow:cw]];
+        [self scheduleRepair];
+    }
+}
+
+- (void)resetStackingOrderWithChildren:(const xcb_window_t *)children count:(int)count {
+    self.stackingCount = 0;
     self.stackingOrderDirty = NO;
+    if (count <= 0 || ![self reserveStackingCapacity:(NSUInteger)count]) {
+        return;
+    }
+    
+    for (int i = 0; i < count; i++) {
+        self.stackingRecords[i].window = children[i];
+        self.stackingRecords[i].cw = [self findCWindow:children[i]];
+    }
+    self.stackingCount = (NSUInteger)count;
+}
+
+// Resynchronize the stacking list with the server. The query_tree reply is
+// picked up by collectPendingReplies; painting goes on with the current list.
+- (void)requestStackingResync {
+    if (self.stackingResyncRequest) {
+        return;
+    }
+    self.stackingResyncRequest = xcb_query_tree([self.connection connection], self.rootWindow).sequence;
+    self.stackingChangedWhileResyncing = NO;
+}
+
+- (void)completeStackingResync:(xcb_query_tree_reply_t *)tree_reply {
+    if (!tree_reply) {
+        return;
+    }
+    
+    [self resetStackingOrderWithChildren:xcb_query_tree_children(tree_reply)
+                                   count:xcb_query_tree_children_length(tree_reply)];
+    self.stackingResyncs += 1;
+    
+    // Restacks handled meanwhile may be newer than the reply; go around again
+    if (self.stackingChangedWhileResyncing) {
+        self.stackingOrderDirty = YES;
+    }
+    [self damageScreen];
 }
 
-// OPTIMIZATION: Notify that stacking order changed (e.g., window raised/lowered)
+// Force a resynchronization and full repaint (the incremental list normally
+// follows restacking from ConfigureNotify on its own)
 - (void)markStackingOrderDirty {
     self.stackingOrderDirty = YES;
     if (self.compositingActive) {
@@ -1788,6 +2463,280 @@ static inline xcb_render_transform_t URSIdentityTransform(void) {
     }
 }
 
+#pragma mark - Fullscreen Bypass
+
+- (void)setupFullscreenBypass {
+    NSUserDefaults *defaults = [NSUserDefaults standardUserDefaults];
+    
+    // On unless URSCompositorUnredirectFullscreen is NO
+    self.bypassEnabled = ![defaults objectForKey:@"URSCompositorUnredirectFullscreen"] ||
+                         [defaults boolForKey:@"URSCompositorUnredirectFullscreen"];
+    
+    // Hysteresis: the window must stay on top and fullscreen this long (seconds)
+    double delay = [defaults doubleForKey:@"URSCompositorUnredirectDelay"];
+    self.bypassDelay = (delay > 0.0) ? delay : 0.5;
+    
+    self.bypassWindow = XCB_NONE;
+    self.bypassCandidateId = XCB_NONE;
+    
+    NSLog(@"[CompositingManager] Fullscreen bypass %@ (delay %.2f s)",
+          self.bypassEnabled ? @"enabled" : @"disabled", self.bypassDelay);
+}
+
+// The topmost painted window, if it is opaque and its opaque shape covers the screen
+- (URSCompositeWindow *)fullscreenBypassCandidate {
+    if (self.stackingOrderDirty || self.stackingResyncRequest) {
+        [self requestStackingResync];
+        return nil;
+    }
+    
+    xcb_rectangle_t screen = {0, 0, self.screenWidth, self.screenHeight};
+    
+    for (NSInteger i = (NSInteger)self.stackingCount - 1; i >= 0; i--) {
+        xcb_window_t win = self.stackingRecords[i].window;
+        if (win == self.overlayWindow || win == self.outputWindow) {
+            continue;
+        }
+        
+        URSCompositeWindow *cw = self.stackingRecords[i].cw;
+        if (!cw || (!cw.viewable && !cw.animating) ||
+            (cw.parentWindowId != XCB_NONE && cw.parentWindowId != self.rootWindow)) {
+            continue;
+        }
+        
+        // Only the top visible window can qualify; ARGB visuals are never opaque
+        if (cw.animating || !cw.opaque) {
+            return nil;
+        }
+        
+        [self borderSizeForWindow:cw];
+        xcb_rectangle_t cover = cw.opaqueBounds;
+        cover.x += cw.x;
+        cover.y += cw.y;
+        return URSRectContainsRect(cover, screen) ? cw : nil;
+    }
+    return nil;
+}
+
+// Called once per frame. Returns YES while a window is unredirected.
+- (BOOL)updateFullscreenBypass {
+    if (!self.bypassEnabled) {
+        return NO;
+    }
+    
+    URSCompositeWindow *candidate = (self.activeAnimations == 0) ? [self fullscreenBypassCandidate] : nil;
+    xcb_window_t candidateId = candidate ? candidate.windowId : XCB_NONE;
+    
+    if (self.bypassWindow != XCB_NONE) {
+        if (candidateId == self.bypassWindow) {
+            return YES;
+        }
+        // Something mapped on top or the window left fullscreen: composite again now
+        [self endFullscreenBypassRedirecting:YES];
+    }
+    
+    NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+    if (candidateId != self.bypassCandidateId) {
+        self.bypassCandidateId = candidateId;
+        self.bypassCandidateSince = now;
+    }
+    
+    if (candidateId == XCB_NONE) {
+        return NO;
+    }
+    
+    NSTimeInterval remaining = self.bypassCandidateSince + self.bypassDelay - now;
+    if (remaining <= 0.0) {
+        [self beginFullscreenBypassForWindow:candidate];
+        return YES;
+    }
+    
+    // Check again once the delay is over, even if nothing else is damaged by then
+    [NSObject cancelPreviousPerformRequestsWithTarget:self
+                                             selector:@selector(requestFrame)
+                                               object:nil];
+    [self performSelector:@selector(requestFrame) withObject:nil afterDelay:remaining];
+    return NO;
+}
+
+- (void)setOverlayHidden:(BOOL)hidden {
+    xcb_connection_t *conn = [self.connection connection];
+    
+    if (!hidden) {
+        // Back to the default (full rectangle) bounding shape
+        xcb_xfixes_set_window_shape_region(conn, self.overlayWindow,
+                                           XCB_SHAPE_SK_BOUNDING, 0, 0, XCB_NONE);
+        return;
+    }
+    
+    xcb_xfixes_region_t empty = xcb_generate_id(conn);
+    xcb_xfixes_create_region(conn, empty, 0, NULL);
+    xcb_xfixes_set_window_shape_region(conn, self.overlayWindow,
+                                       XCB_SHAPE_SK_BOUNDING, 0, 0, empty);
+    xcb_xfixes_destroy_region(conn, empty);
+}
+
+- (void)beginFullscreenBypassForWindow:(URSCompositeWindow *)cw {
+    xcb_connection_t *conn = [self.connection connection];
+    
+    xcb_composite_unredirect_window(conn, cw.windowId, XCB_COMPOSITE_REDIRECT_MANUAL);
+    
+    // The named pixmap stops following the window once it is unredirected
+    [self releaseWindowPixmap:cw];
+    
+    [self setOverlayHidden:YES];
+    [self.connection flush];
+    
+    self.bypassWindow = cw.windowId;
+    self.bypassCount += 1;
+    NSLog(@"[CompositingManager] Fullscreen bypass: window %u unredirected", cw.windowId);
+}
+
+- (void)endFullscreenBypassRedirecting:(BOOL)redirect {
+    if (self.bypassWindow == XCB_NONE) {
+        return;
+    }
+    
+    xcb_window_t window = self.bypassWindow;
+    self.bypassWindow = XCB_NONE;
+    self.bypassCandidateId = XCB_NONE;
+    
+    if (redirect) {
+        xcb_composite_redirect_window([self.connection connection], window, XCB_COMPOSITE_REDIRECT_MANUAL);
+        URSCompositeWindow *cw = [self findCWindow:window];
+        if (cw) {
+            [self releaseWindowPixmap:cw];
+        }
+    }
+    
+    // Show the overlay again; the next paint covers the whole screen
+    [self setOverlayHidden:NO];
+    [self damageScreen];
+    NSLog(@"[CompositingManager] Fullscreen bypass ended for window %u", window);
+}
+
+#pragma mark - Occlusion Culling
+
+// Visibility of a top-level window changed in paintAll; repaint damage that was
+// deferred while it was hidden and let the WM throttle its frame
+- (void)updateVisibility:(uint8_t)visibility forWindow:(URSCompositeWindow *)cw {
+    if (cw.visibility == visibility) {
+        return;
+    }
+    
+    BOOL wasObscured = (cw.visibility == XCB_VISIBILITY_FULLY_OBSCURED);
+    cw.visibility = visibility;
+    
+    if (wasObscured && cw.damagedWhileObscured) {
+        cw.damagedWhileObscured = NO;
+        [self damageWindowArea:cw];
+    }
+    
+    // The WM renders titlebars it deferred while the frame was hidden; that
+    // must not land in the frame that reveals it
+    self.pendingVisibility[@(cw.windowId)] = @(visibility);
+}
+
+// Hand this frame's visibility changes to the WM once painting is done
+- (void)reportPendingVisibility {
+    if ([self.pendingVisibility count] == 0) {
+        return;
+    }
+    
+    NSDictionary<NSNumber *, NSNumber *> *changes = self.pendingVisibility;
+    self.pendingVisibility = [[NSMutableDictionary alloc] init];
+    for (NSNumber *key in changes) {
+        [self.connection setVisibility:[changes[key] unsignedCharValue] forFrameWindow:[key unsignedIntValue]];
+    }
+}
+
+// A window can hide what is below it only if its visual has no alpha channel
+- (BOOL)isOpaqueVisual:(xcb_visualid_t)visual depth:(uint8_t)depth {
+    if (depth != 24) {
+        return NO;
+    }
+    xcb_render_pictformat_t format = [self findVisualFormat:visual];
+    if (format == XCB_NONE) {
+        return NO;
+    }
+    return ![self.translucentFormats containsObject:@(format)];
+}
+
+// Bounding shape of the window in window-local coordinates (origin at the outer
+// top-left corner). Created once per map/resize; moves just translate it.
+- (xcb_xfixes_region_t)borderSizeForWindow:(URSCompositeWindow *)cw {
+    if (cw.borderSize != XCB_NONE) {
+        return cw.borderSize;
+    }
+
+    xcb_connection_t *conn = [self.connection connection];
+    xcb_xfixes_region_t region = xcb_generate_id(conn);
+    xcb_xfixes_create_region_from_window(conn, region, cw.windowId, XCB_SHAPE_SK_BOUNDING);
+    xcb_xfixes_translate_region(conn, region, cw.borderWidth, cw.borderWidth);
+
+    // Keep the largest opaque rectangle client-side so paintAll can decide
+    // that a window is fully covered without a round trip per frame. The
+    // reply is collected between event batches; until then the window
+    // covers nothing.
+    cw.opaqueBounds = (xcb_rectangle_t){0, 0, 0, 0};
+    cw.shapeRequest = xcb_xfixes_fetch_region(conn, region).sequence;
+    [self.pendingShapeWindows addObject:@(cw.windowId)];
+
+    cw.borderSize = region;
+    return region;
+}
+
+- (void)updateOpaqueBoundsForWindow:(URSCompositeWindow *)cw reply:(xcb_xfixes_fetch_region_reply_t *)reply {
+    xcb_rectangle_t best = {0, 0, 0, 0};
+    if (reply) {
+        xcb_rectangle_t *rects = xcb_xfixes_fetch_region_rectangles(reply);
+        int count = xcb_xfixes_fetch_region_rectangles_length(reply);
+        uint32_t bestArea = 0;
+        for (int i = 0; i < count; i++) {
+            uint32_t area = (uint32_t)rects[i].width * rects[i].height;
+            if (area > bestArea) {
+                bestArea = area;
+                best = rects[i];
+            }
+        }
+    }
+    cw.opaqueBounds = best;
+}
+
+// Drop the cached shape; a fetch still in flight is for the old shape
+- (void)releaseBorderSize:(URSCompositeWindow *)cw {
+    xcb_connection_t *conn = [self.connection connection];
+    
+    if (cw.shapeRequest) {
+        xcb_discard_reply(conn, cw.shapeRequest);
+        cw.shapeRequest = 0;
+        [self.pendingShapeWindows removeObject:@(cw.windowId)];
+    }
+    if (cw.borderSize != XCB_NONE) {
+        xcb_xfixes_destroy_region(conn, cw.borderSize);
+        cw.borderSize = XCB_NONE;
+    }
+    cw.opaqueBounds = (xcb_rectangle_t){0, 0, 0, 0};
+}
+
+// OPTIMIZATION: Lazy picture creation - only create when first painting
+// NOTE: The underlying NameWindowPixmap is automatically updated by X server on damage
+// so we only need to recreate when pictureValid is false (size change, etc.)
+- (BOOL)ensureWindowPicture:(URSCompositeWindow *)cw {
+    if (!cw.pictureValid || cw.needsPictureCreation) {
+        if (cw.picture != XCB_NONE) {
+            xcb_render_free_picture([self.connection connection], cw.picture);
+            cw.picture = XCB_NONE;
+        }
+        cw.picture = [self getWindowPicture:cw];
+        if (cw.picture != XCB_NONE) {
+            cw.pictureValid = YES;
+            cw.needsPictureCreation = NO;
+        }
+    }
+    return cw.picture != XCB_NONE;
+}
+
 - (void)paintAll:(xcb_xfixes_region_t)region {
     xcb_connection_t *conn = [self.connection connection];
     
@@ -1795,39 +2744,41 @@ static inline xcb_render_transform_t URSIdentityTransform(void) {
         return;
     }
     
-    // OPTIMIZATION: Use cached stacking order, only query tree when dirty
-    if (self.stackingOrderDirty || [self.windowStackingOrder count] == 0) {
-        [self rebuildStackingOrderCache];
+    // OPTIMIZATION: The stacking list is maintained from events; query_tree only to resync
+    if (self.stackingOrderDirty) {
+        [self requestStackingResync];
     }
+    self.painting = YES;
     
-    NSUInteger num_windows = [self.windowStackingOrder count];
+    NSUInteger num_windows = self.stackingCount;
     
     // Create a copy of the region for painting
     xcb_xfixes_region_t paint_region = xcb_generate_id(conn);
     xcb_xfixes_create_region(conn, paint_region, 0, NULL);
     xcb_xfixes_copy_region(conn, region, paint_region);
     
-    // Paint background ONLY in damaged areas (performance optimization)
-    xcb_xfixes_set_picture_clip_region(conn, self.rootBuffer, region, 0, 0);
-    xcb_render_color_t bg_color = {0x8000, 0x8000, 0x8000, 0xFFFF}; // Mid grey background
-    xcb_rectangle_t bg_rect = {0, 0, self.screenWidth, self.screenHeight};
-    xcb_render_fill_rectangles(conn, XCB_RENDER_PICT_OP_SRC,
-                               self.rootBuffer, bg_color, 1, &bg_rect);
+    // OPTIMIZATION: Occlusion culling. Walk the stack top-down, giving each
+    // window whatever part of the damage is not yet hidden by opaque windows
+    // above it, then subtract its own opaque shape. Windows whose extents lie
+    // entirely inside an opaque window above them are not painted at all.
+    NSMutableArray<URSCompositeWindow *> *paintList = [NSMutableArray arrayWithCapacity:num_windows];
+    xcb_rectangle_t *covers = num_windows > 0 ? malloc(num_windows * sizeof(xcb_rectangle_t)) : NULL;
+    NSUInteger num_covers = 0;
+    NSUInteger num_culled = 0;
     
-    // Paint windows from bottom to top (so higher z-order windows are on top)
-    for (NSUInteger i = 0; i < num_windows; i++) {
-        xcb_window_t win = [self.windowStackingOrder[i] unsignedIntValue];
+    for (NSInteger i = (NSInteger)num_windows - 1; i >= 0; i--) {
+        xcb_window_t win = self.stackingRecords[i].window;
         
         // Skip overlay and output windows (our own compositor windows)
         if (win == self.overlayWindow || win == self.outputWindow) {
             continue;
         }
         
-        URSCompositeWindow *cw = [self findCWindow:win];
+        URSCompositeWindow *cw = self.stackingRecords[i].cw;
         if (!cw) {
-            // Window not tracked yet, try to add it
+            // Not adopted yet: start it (no waiting) and skip it this frame
             [self addWindow:win];
-            cw = [self findCWindow:win];
+            continue;
         }
         if (!cw || (!cw.viewable && !cw.animating)) {
             continue;
@@ -1839,11 +2790,69 @@ static inline xcb_render_transform_t URSIdentityTransform(void) {
             continue;
         }
         
-        // Paint the window - clip region is set inside paintWindow
-        [self paintWindow:cw atX:cw.x atY:cw.y withClipRegion:paint_region];
+        // Fully obscured: the extents (shadow included) lie inside one opaque
+        // window above. Partially: the window itself overlaps one.
+        uint8_t visibility = XCB_VISIBILITY_UNOBSCURED;
+        if (!cw.animating && covers) {
+            xcb_rectangle_t extents = [self paintExtentsRectForWindow:cw];
+            xcb_rectangle_t bounds = {cw.x, cw.y, cw.width + 2 * cw.borderWidth, cw.height + 2 * cw.borderWidth};
+            for (NSUInteger c = 0; c < num_covers; c++) {
+                if (URSRectContainsRect(covers[c], extents)) {
+                    visibility = XCB_VISIBILITY_FULLY_OBSCURED;
+                    break;
+                }
+                if (URSRectIntersectsRect(covers[c], bounds)) {
+                    visibility = XCB_VISIBILITY_PARTIALLY_OBSCURED;
+                }
+            }
+        }
+        [self updateVisibility:visibility forWindow:cw];
+        
+        if (visibility == XCB_VISIBILITY_FULLY_OBSCURED) {
+            num_culled++;
+            continue;
+        }
+        
+        // OPTIMIZATION: Shadows are only set up for windows that get painted
+        if (!cw.hasShadow) {
+            [self createShadowForWindow:cw];
+        }
+        
+        cw.clipRegion = xcb_generate_id(conn);
+        xcb_xfixes_create_region(conn, cw.clipRegion, 0, NULL);
+        xcb_xfixes_copy_region(conn, paint_region, cw.clipRegion);
+        [paintList addObject:cw];
+        
+        if (cw.opaque && !cw.animating && [self ensureWindowPicture:cw]) {
+            xcb_xfixes_region_t shape = [self borderSizeForWindow:cw];
+            xcb_xfixes_translate_region(conn, shape, cw.x, cw.y);
+            xcb_xfixes_subtract_region(conn, paint_region, shape, paint_region);
+            xcb_xfixes_translate_region(conn, shape, -cw.x, -cw.y);
+            
+            xcb_rectangle_t cover = cw.opaqueBounds;
+            cover.x += cw.x;
+            cover.y += cw.y;
+            covers[num_covers++] = cover;
+        }
     }
     
+    // Paint background ONLY in damaged areas not hidden by opaque windows
+    xcb_xfixes_set_picture_clip_region(conn, self.rootBuffer, paint_region, 0, 0);
+    xcb_render_color_t bg_color = {0x8000, 0x8000, 0x8000, 0xFFFF}; // Mid grey background
+    xcb_rectangle_t bg_rect = {0, 0, self.screenWidth, self.screenHeight};
+    xcb_render_fill_rectangles(conn, XCB_RENDER_PICT_OP_SRC,
+                               self.rootBuffer, bg_color, 1, &bg_rect);
+    
     xcb_xfixes_destroy_region(conn, paint_region);
+    free(covers);
+    self.culledWindowCount += num_culled;
+    
+    // Paint windows from bottom to top (so higher z-order windows are on top)
+    for (URSCompositeWindow *cw in [paintList reverseObjectEnumerator]) {
+        [self paintWindow:cw atX:cw.x atY:cw.y withClipRegion:cw.clipRegion];
+        xcb_xfixes_destroy_region(conn, cw.clipRegion);
+        cw.clipRegion = XCB_NONE;
+    }
 
     // BUGFIX: Flush all window painting commands before copying to screen.
     // This ensures all render operations on rootBuffer are complete before
@@ -1863,8 +2872,9 @@ static inline xcb_render_transform_t URSIdentityTransform(void) {
                         self.screenWidth, self.screenHeight);
 
     [self.connection flush];
+    self.painting = NO;
     
-    // NSLog(@"[CompositingManager] paintAll: painted %lu windows", (unsigned long)num_windows);
+    // NSLog(@"[CompositingManager] paintAll: painted %lu windows, culled %lu", (unsigned long)[paintList count], (unsigned long)num_culled);
 }
 
 // Gaussian function for shadow blur
@@ -2057,85 +3067,196 @@ static uint8_t sum_gaussian(double *map, int map_size, double opacity,
     return data;
 }
 
-- (void)createShadowForWindow:(URSCompositeWindow *)cw {
+// Upload an A8 image as a picture. Rows are padded to 32 bits for ZPixmap.
+// Servers without an A8 format get the mask as black premultiplied ARGB32,
+// which works the same as a composite mask.
+- (xcb_render_picture_t)createA8Picture:(const uint8_t *)data
+                                  width:(int)width
+                                 height:(int)height
+                                 repeat:(BOOL)repeat
+                                 pixmap:(xcb_pixmap_t *)pixmapOut {
     xcb_connection_t *conn = [self.connection connection];
-    
-    if (self.argbFormat == XCB_NONE || !self.gaussianMap || cw.overrideRedirect) {
-        return; // Can't create shadow without alpha support, Gaussian map, or if it's override-redirect
+    BOOL expand = (self.a8Format == XCB_NONE);
+    uint8_t depth = expand ? 32 : 8;
+    int stride = expand ? width * 4 : (width + 3) & ~3;
+    uint8_t *padded = calloc((size_t)stride * height, sizeof(uint8_t));
+    if (!padded) {
+        return XCB_NONE;
     }
-    
-    // Generate shadow image in memory
-    int swidth, sheight;
-    uint8_t *shadow_data = [self makeShadowImage:cw.width + 2 * cw.borderWidth 
-                                          height:cw.height + 2 * cw.borderWidth
-                                     shadowWidth:&swidth 
-                                    shadowHeight:&sheight];
-    if (!shadow_data) {
-        NSLog(@"[Shadow] Failed to create shadow image");
-        return;
+    for (int y = 0; y < height; y++) {
+        if (expand) {
+            URSPixelExpandA8(&data[y * width], (uint32_t *)&padded[y * stride], width);
+        } else {
+            memcpy(&padded[y * stride], &data[y * width], width);
+        }
     }
     
-    // Validate shadow data - sample from different regions
-    int corner_val = shadow_data[0];  // top-left corner
-    int center_val = shadow_data[(sheight/2) * swidth + (swidth/2)];  // center
-    int edge_val = shadow_data[10 * swidth + swidth/2];  // top edge
-    int nonzero = 0, maxval = 0;
-    for (int i = 0; i < swidth * sheight && i < 1000; i++) {
-        if (shadow_data[i] > 0) nonzero++;
-        if (shadow_data[i] > maxval) maxval = shadow_data[i];
-    }
-    NSLog(@"[Shadow] Shadow data: size=%dx%d, samples: corner=%d center=%d edge=%d, first1000: nonzero=%d max=%d", 
-          swidth, sheight, corner_val, center_val, edge_val, nonzero, maxval);
+    xcb_pixmap_t pixmap = xcb_generate_id(conn);
+    xcb_create_pixmap(conn, depth, pixmap, self.rootWindow, width, height);
     
-    cw.shadowWidth = swidth;
-    cw.shadowHeight = sheight;
-    cw.shadowOffsetX = SHADOW_OFFSET_X;
-    cw.shadowOffsetY = SHADOW_OFFSET_Y;
+    xcb_gcontext_t gc = xcb_generate_id(conn);
+    xcb_create_gc(conn, gc, pixmap, 0, NULL);
+    [[self.connection shmImagePool] putImage:padded width:width height:height stride:stride
+                                       depth:depth toDrawable:pixmap gc:gc x:0 y:0];
+    xcb_free_gc(conn, gc);
+    free(padded);
     
-    // Create shadow using ARGB32 format directly
-    // Convert 8-bit alpha data to ARGB32 (pre-multiplied black+alpha)
-    uint32_t *argb_data = (uint32_t *)malloc(swidth * sheight * sizeof(uint32_t));
-    if (!argb_data) {
-        NSLog(@"[Shadow] Failed to allocate ARGB data");
-        free(shadow_data);
-        return;
+    xcb_render_picture_t picture = xcb_generate_id(conn);
+    uint32_t values[] = { XCB_RENDER_REPEAT_NORMAL };
+    xcb_render_create_picture(conn, picture, pixmap, expand ? self.argbFormat : self.a8Format,
+                             repeat ? XCB_RENDER_CP_REPEAT : 0, repeat ? values : NULL);
+    
+    *pixmapOut = pixmap;
+    return picture;
+}
+
+// Build (once) the nine-slice tiles for the configured shadow radius/opacity.
+// The tiles are cut from the shadow of a window just larger than the kernel,
+// which is the smallest size where corners and edges take their final values.
+- (URSShadowTiles *)shadowTilesForRadius:(int)radius opacity:(double)opacity {
+    NSString *key = [NSString stringWithFormat:@"%d:%.2f", radius, opacity];
+    URSShadowTiles *tiles = self.shadowTileCache[key];
+    if (tiles) {
+        return tiles;
     }
     
-    // Convert A8 -> ARGB32 (black with alpha)
-    // ARGB format on little-endian is BGRA in memory: B, G, R, A bytes
-    for (int i = 0; i < swidth * sheight; i++) {
-        uint8_t alpha = shadow_data[i];
-        // ARGB32 little-endian: 0xAARRGGBB stored as BB GG RR AA in memory
-        // For black (0,0,0) with alpha, it's just (alpha << 24)
-        argb_data[i] = ((uint32_t)alpha << 24);  // 0xAA000000 = black with alpha
+    if ((self.a8Format == XCB_NONE && self.argbFormat == XCB_NONE) ||
+        !self.gaussianMap || self.gaussianSize <= 0) {
+        return nil;
     }
-    free(shadow_data);
     
-    // Create 32-bit depth pixmap for ARGB shadow
-    cw.shadowPixmap = xcb_generate_id(conn);
-    xcb_create_pixmap(conn, 32, cw.shadowPixmap, self.rootWindow, swidth, sheight);
+    int g = self.gaussianSize;
+    int swidth, sheight;
+    uint8_t *tmpl = [self makeShadowImage:g + 2 height:g + 2 shadowWidth:&swidth shadowHeight:&sheight];
+    if (!tmpl) {
+        NSLog(@"[Shadow] Failed to create shadow template");
+        return nil;
+    }
+    
+    // Template is (2g+2) x (2g+2): corners in [0,g) and [g+2,2g+2), edges/center in between
+    int size = 2 * g;
+    uint8_t *corner = malloc((size_t)size * size);
+    uint8_t *hEdge = malloc((size_t)size);
+    uint8_t *vEdge = malloc((size_t)size);
+    if (!corner || !hEdge || !vEdge) {
+        free(corner);
+        free(hEdge);
+        free(vEdge);
+        free(tmpl);
+        return nil;
+    }
+    for (int y = 0; y < size; y++) {
+        int srcY = (y < g) ? y : y + 2;
+        for (int x = 0; x < size; x++) {
+            int srcX = (x < g) ? x : x + 2;
+            corner[y * size + x] = tmpl[srcY * swidth + srcX];
+        }
+        hEdge[y] = tmpl[srcY * swidth + g];
+        vEdge[y] = tmpl[g * swidth + srcY];
+    }
+    uint8_t center = tmpl[g * swidth + g];
+    free(tmpl);
     
-    // Upload ARGB32 shadow data
-    xcb_gcontext_t gc = xcb_generate_id(conn);
-    xcb_create_gc(conn, gc, cw.shadowPixmap, 0, NULL);
+    tiles = [[URSShadowTiles alloc] init];
+    tiles.tileSize = g;
     
-    xcb_put_image(conn, XCB_IMAGE_FORMAT_Z_PIXMAP, cw.shadowPixmap, gc,
-                 swidth, sheight, 0, 0, 0, 32,
-                 swidth * sheight * 4, (uint8_t *)argb_data);
-    xcb_flush(conn);  // Ensure image data is uploaded before proceeding
+    xcb_pixmap_t pixmap;
+    tiles.cornerPicture = [self createA8Picture:corner width:size height:size repeat:NO pixmap:&pixmap];
+    tiles.cornerPixmap = pixmap;
+    tiles.hEdgePicture = [self createA8Picture:hEdge width:1 height:size repeat:YES pixmap:&pixmap];
+    tiles.hEdgePixmap = pixmap;
+    tiles.vEdgePicture = [self createA8Picture:vEdge width:size height:1 repeat:YES pixmap:&pixmap];
+    tiles.vEdgePixmap = pixmap;
+    tiles.centerPicture = [self createA8Picture:&center width:1 height:1 repeat:YES pixmap:&pixmap];
+    tiles.centerPixmap = pixmap;
     
-    xcb_free_gc(conn, gc);
-    free(argb_data);
+    free(corner);
+    free(hEdge);
+    free(vEdge);
     
-    // Create Picture with ARGB format
-    cw.shadowPicture = xcb_generate_id(conn);
-    xcb_render_create_picture(conn, cw.shadowPicture, cw.shadowPixmap, self.argbFormat, 0, NULL);
+    self.shadowTileCache[key] = tiles;
+    NSLog(@"[Shadow] Built shared shadow tiles (radius=%d, opacity=%.2f, tile=%d)", radius, opacity, g);
+    return tiles;
+}
+
+- (void)freeShadowTiles {
+    xcb_connection_t *conn = [self.connection connection];
+    for (URSShadowTiles *tiles in [self.shadowTileCache allValues]) {
+        xcb_render_picture_t pictures[] = { tiles.cornerPicture, tiles.hEdgePicture,
+                                            tiles.vEdgePicture, tiles.centerPicture };
+        xcb_pixmap_t pixmaps[] = { tiles.cornerPixmap, tiles.hEdgePixmap,
+                                   tiles.vEdgePixmap, tiles.centerPixmap };
+        for (int i = 0; i < 4; i++) {
+            if (pictures[i] != XCB_NONE) {
+                xcb_render_free_picture(conn, pictures[i]);
+            }
+            if (pixmaps[i] != XCB_NONE) {
+                xcb_free_pixmap(conn, pixmaps[i]);
+            }
+        }
+    }
+    [self.shadowTileCache removeAllObjects];
+}
+
+- (void)createShadowForWindow:(URSCompositeWindow *)cw {
+    if (self.blackPicture == XCB_NONE || cw.overrideRedirect) {
+        return; // Can't draw shadow without a source, or if it's override-redirect
+    }
+    if (![self shadowTilesForRadius:SHADOW_RADIUS opacity:SHADOW_OPACITY]) {
+        return;
+    }
     
-    NSLog(@"[Shadow] ARGB32 shadow picture: 0x%x for window 0x%x (size %dx%d), pixmap: 0x%x", 
-          cw.shadowPicture, cw.windowId, swidth, sheight, cw.shadowPixmap);
+    // Only the extents are per-window; the pixels come from the shared tiles
+    cw.shadowWidth = cw.width + 2 * cw.borderWidth + self.gaussianSize;
+    cw.shadowHeight = cw.height + 2 * cw.borderWidth + self.gaussianSize;
+    cw.shadowOffsetX = SHADOW_OFFSET_X;
+    cw.shadowOffsetY = SHADOW_OFFSET_Y;
+    cw.hasShadow = YES;
+}
+
+// Draw a shadow as nine composites of solid black through the A8 tiles
+- (void)paintShadowForWindow:(URSCompositeWindow *)cw atX:(int16_t)sx atY:(int16_t)sy {
+    URSShadowTiles *tiles = [self shadowTilesForRadius:SHADOW_RADIUS opacity:SHADOW_OPACITY];
+    if (!tiles) {
+        return;
+    }
     
-    // DO NOT free the pixmap - the Picture needs it to stay alive
-    // It will be freed when the window is destroyed
+    xcb_connection_t *conn = [self.connection connection];
+    int g = tiles.tileSize;
+    int sw = cw.shadowWidth;
+    int sh = cw.shadowHeight;
+    // Small windows get their corners clipped to half the shadow
+    int cx = (g < sw / 2) ? g : (sw + 1) / 2;
+    int cy = (g < sh / 2) ? g : (sh + 1) / 2;
+    int midW = sw - 2 * cx;
+    int midH = sh - 2 * cy;
+    
+    struct { xcb_render_picture_t mask; int16_t mx, my, dx, dy; int w, h; } parts[] = {
+        { tiles.cornerPicture, 0,               0,               sx,                sy,                cx,   cy   },
+        { tiles.cornerPicture, (int16_t)(2*g-cx), 0,             (int16_t)(sx+sw-cx), sy,              cx,   cy   },
+        { tiles.cornerPicture, 0,               (int16_t)(2*g-cy), sx,              (int16_t)(sy+sh-cy), cx, cy   },
+        { tiles.cornerPicture, (int16_t)(2*g-cx), (int16_t)(2*g-cy), (int16_t)(sx+sw-cx), (int16_t)(sy+sh-cy), cx, cy },
+        { tiles.hEdgePicture,  0,               0,               (int16_t)(sx+cx),  sy,                midW, cy   },
+        { tiles.hEdgePicture,  0,               (int16_t)(2*g-cy), (int16_t)(sx+cx), (int16_t)(sy+sh-cy), midW, cy },
+        { tiles.vEdgePicture,  0,               0,               sx,                (int16_t)(sy+cy),  cx,   midH },
+        { tiles.vEdgePicture,  (int16_t)(2*g-cx), 0,             (int16_t)(sx+sw-cx), (int16_t)(sy+cy), cx,  midH },
+        { tiles.centerPicture, 0,               0,               (int16_t)(sx+cx),  (int16_t)(sy+cy),  midW, midH },
+    };
+    
+    for (size_t i = 0; i < sizeof(parts) / sizeof(parts[0]); i++) {
+        if (parts[i].w <= 0 || parts[i].h <= 0) {
+            continue;
+        }
+        xcb_render_composite(conn,
+                            XCB_RENDER_PICT_OP_OVER,
+                            self.blackPicture,      // Source: solid black
+                            parts[i].mask,          // Mask: A8 shadow tile
+                            self.rootBuffer,        // Destination
+                            0, 0,
+                            parts[i].mx, parts[i].my,
+                            parts[i].dx, parts[i].dy,
+                            parts[i].w, parts[i].h);
+    }
 }
 
 - (void)paintWindow:(URSCompositeWindow *)cw 
@@ -2206,44 +3327,24 @@ static uint8_t sum_gaussian(double *map, int map_size, double opacity,
         }
     }
     
+    // Restrict drawing to the part of the damage this window is visible in
+    if (clipRegion != XCB_NONE) {
+        xcb_xfixes_set_picture_clip_region(conn, self.rootBuffer, clipRegion, 0, 0);
+    }
+    
     // Create shadow if needed (after resize)
-    if (cw.shadowPicture == XCB_NONE && self.argbFormat != XCB_NONE) {
+    if (!cw.hasShadow) {
         [self createShadowForWindow:cw];
     }
     
-    // Draw shadow using Gaussian ARGB32 picture (smooth gradient)
-    if (cw.shadowPicture != XCB_NONE && !animating) {
-        int16_t shadowX = screenX + cw.shadowOffsetX;
-        int16_t shadowY = screenY + cw.shadowOffsetY;
-        
-        // Composite ARGB32 shadow with proper alpha blending
-        xcb_render_composite(conn,
-                            XCB_RENDER_PICT_OP_OVER,
-                            cw.shadowPicture,       // Source: ARGB32 shadow with alpha
-                            XCB_NONE,               // No mask
-                            self.rootBuffer,        // Destination
-                            0, 0,                   // src x, y
-                            0, 0,                   // mask x, y (unused)
-                            shadowX,                // dst x
-                            shadowY,                // dst y
-                            cw.shadowWidth,
-                            cw.shadowHeight);
+    // Draw shadow from the shared Gaussian tiles (smooth gradient)
+    if (cw.hasShadow && !animating) {
+        [self paintShadowForWindow:cw
+                               atX:screenX + cw.shadowOffsetX
+                               atY:screenY + cw.shadowOffsetY];
     }
     
-    // OPTIMIZATION: Lazy picture creation - only create when first painting
-    // NOTE: The underlying NameWindowPixmap is automatically updated by X server on damage
-    // so we only need to recreate when pictureValid is false (size change, etc.)
-    if (!cw.pictureValid || cw.needsPictureCreation) {
-        if (cw.picture != XCB_NONE) {
-            xcb_render_free_picture(conn, cw.picture);
-            cw.picture = XCB_NONE;
-        }
-        cw.picture = [self getWindowPicture:cw];
-        if (cw.picture != XCB_NONE) {
-            cw.pictureValid = YES;
-            cw.needsPictureCreation = NO;
-        }
-    }
+    [self ensureWindowPicture:cw];
     
     if (cw.picture != XCB_NONE) {
         int16_t destXInt = (int16_t)llround(destX);
@@ -2273,10 +3374,22 @@ static uint8_t sum_gaussian(double *map, int map_size, double opacity,
             }
         }
 
+        // OPTIMIZATION: Opaque windows are copied with SRC, clipped to their
+        // bounding shape so shaped corners still show what is underneath
+        uint8_t op = XCB_RENDER_PICT_OP_OVER;
+        if (cw.opaque && !animating && alphaMask == XCB_NONE && clipRegion != XCB_NONE) {
+            xcb_xfixes_region_t shape = [self borderSizeForWindow:cw];
+            xcb_xfixes_translate_region(conn, shape, destXInt, destYInt);
+            xcb_xfixes_intersect_region(conn, clipRegion, shape, clipRegion);
+            xcb_xfixes_translate_region(conn, shape, -destXInt, -destYInt);
+            xcb_xfixes_set_picture_clip_region(conn, self.rootBuffer, clipRegion, 0, 0);
+            op = XCB_RENDER_PICT_OP_SRC;
+        }
+
         // Paint the window - IncludeInferiors captures all child content
         // (titlebar, buttons, client content, etc.)
         xcb_render_composite(conn,
-                            XCB_RENDER_PICT_OP_OVER,
+                            op,
                             cw.picture,
                             alphaMask,
                             self.rootBuffer,
@@ -2305,22 +3418,15 @@ static uint8_t sum_gaussian(double *map, int map_size, double opacity,
     xcb_connection_t *conn = [self.connection connection];
     xcb_drawable_t draw = cw.windowId;
 
-    // Use NameWindowPixmap (the redirected offscreen storage) for proper content capture
-    // Try to get the name_window_pixmap first
-    if (cw.nameWindowPixmap == XCB_NONE) {
-        // BUGFIX: Flush before creating NameWindowPixmap to ensure X server has
-        // finished any pending drawing operations on the window. This prevents
-        // capturing stale or partially-drawn content that causes ghost artifacts.
-        xcb_flush(conn);
-
+    // Use NameWindowPixmap (the redirected offscreen storage) for proper content capture.
+    // OPTIMIZATION: Naming only fails for unviewable or unredirected windows, so check
+    // that locally and send it unchecked instead of waiting for a reply on every paint.
+    if (cw.nameWindowPixmap == XCB_NONE && cw.viewable && cw.redirected &&
+        cw.windowId != self.bypassWindow) {
         cw.nameWindowPixmap = xcb_generate_id(conn);
-        xcb_void_cookie_t cookie = xcb_composite_name_window_pixmap_checked(conn, cw.windowId, cw.nameWindowPixmap);
-        xcb_generic_error_t *error = xcb_request_check(conn, cookie);
-        if (error) {
-            // Failed to get named pixmap, use window directly
-            cw.nameWindowPixmap = XCB_NONE;
-            free(error);
-        }
+        xcb_composite_name_window_pixmap(conn, cw.windowId, cw.nameWindowPixmap);
+        cw.pixmapWidth = cw.width;
+        cw.pixmapHeight = cw.height;
     }
     
     // Use the named pixmap if available, otherwise fall back to window drawable
@@ -2328,12 +3434,8 @@ static uint8_t sum_gaussian(double *map, int map_size, double opacity,
         draw = cw.nameWindowPixmap;
     }
     
-    // Find appropriate format for this window's visual
-    xcb_render_pictformat_t format = [self findVisualFormat:cw.visual];
-    if (format == XCB_NONE) {
-        // Fall back to depth-based format
-        format = [self findFormatForDepth:cw.depth];
-    }
+    // Format was resolved when the window was adopted
+    xcb_render_pictformat_t format = cw.pictFormat;
     if (format == XCB_NONE) {
         NSLog(@"[CompositingManager] No format for visual %d depth %d", cw.visual, cw.depth);
         return XCB_NONE;
@@ -2367,7 +3469,7 @@ static uint8_t sum_gaussian(double *map, int map_size, double opacity,
     xcb_render_query_pict_formats_cookie_t formats_cookie = 
         xcb_render_query_pict_formats(conn);
     xcb_render_query_pict_formats_reply_t *formats_reply = 
-        xcb_render_query_pict_formats_reply(conn, formats_cookie, NULL);
+        URS_WAIT_REPLY(xcb_render_query_pict_formats_reply(conn, formats_cookie, NULL));
     
     if (!formats_reply) {
         return XCB_NONE;
@@ -2417,7 +3519,7 @@ static uint8_t sum_gaussian(double *map, int map_size, double opacity,
     xcb_render_query_pict_formats_cookie_t formats_cookie = 
         xcb_render_query_pict_formats(conn);
     xcb_render_query_pict_formats_reply_t *formats_reply = 
-        xcb_render_query_pict_formats_reply(conn, formats_cookie, NULL);
+        URS_WAIT_REPLY(xcb_render_query_pict_formats_reply(conn, formats_cookie, NULL));
     
     if (!formats_reply) {
         return XCB_NONE;
@@ -2460,6 +3562,14 @@ static uint8_t sum_gaussian(double *map, int map_size, double opacity,
         xcb_composite_unredirect_subwindows(conn, self.rootWindow,
                                            XCB_COMPOSITE_REDIRECT_MANUAL);
         
+        NSLog(@"[CompositingManager] Frame stats: %@", [self frameStatistics]);
+        
+        // Hand visibility back to VisibilityNotify, which only reports changes from here on
+        for (URSCompositeWindow *cw in [self.cwindows allValues]) {
+            [self.connection setVisibility:XCB_VISIBILITY_UNOBSCURED forFrameWindow:cw.windowId];
+        }
+        self.connection.visibilityFromCompositor = NO;
+        
         [self cleanup];
         self.compositingActive = NO;
         NSLog(@"[CompositingManager] Compositing deactivated");
@@ -2473,25 +3583,55 @@ static uint8_t sum_gaussian(double *map, int map_size, double opacity,
     @try {
         xcb_connection_t *conn = [self.connection connection];
         
+        // Stop the frame clock
+        [NSObject cancelPreviousPerformRequestsWithTarget:self
+                                                 selector:@selector(frameClockTick)
+                                                   object:nil];
+        [NSObject cancelPreviousPerformRequestsWithTarget:self
+                                                 selector:@selector(requestFrame)
+                                                   object:nil];
+        self.framePending = NO;
+        self.waitingForVblank = NO;
+        
+        // Unredirecting the subwindows (or releasing the overlay) already covers a bypassed window
+        self.bypassWindow = XCB_NONE;
+        self.bypassCandidateId = XCB_NONE;
+        
         // Free all window data
         for (NSNumber *key in [self.cwindows allKeys]) {
             URSCompositeWindow *cw = self.cwindows[key];
             [self freeWindowData:cw delete:YES];
         }
         [self.cwindows removeAllObjects];
+        [self.windowTree removeAllObjects];
+        [self.windowChildren removeAllObjects];
+        
+        // Replies still in flight are no longer wanted
+        for (NSNumber *key in [self.pendingAdoptions allKeys]) {
+            [self discardAdoptionForWindow:[key unsignedIntValue]];
+        }
+        [self.ignoredWindows removeAllObjects];
+        [self.pendingShapeWindows removeAllObjects];
+        [self.pendingVisibility removeAllObjects];
+        if (self.stackingResyncRequest) {
+            xcb_discard_reply(conn, self.stackingResyncRequest);
+            self.stackingResyncRequest = 0;
+        }
+        
+        // Records point at the windows just freed
+        free(self.stackingRecords);
+        self.stackingRecords = NULL;
+        self.stackingCount = 0;
+        self.stackingCapacity = 0;
+        self.stackingOrderDirty = YES;
         
         // Free damage regions
-        if (self.allDamage != XCB_NONE) {
-            xcb_xfixes_destroy_region(conn, self.allDamage);
-            self.allDamage = XCB_NONE;
-        }
-        
-        if (self.screenRegion != XCB_NONE) {
-            xcb_xfixes_destroy_region(conn, self.screenRegion);
-            self.screenRegion = XCB_NONE;
-        }
+        self.damageRegion = nil;
+        self.frameRegion = nil;
         
         // Free shadow resources
+        [self freeShadowTiles];
+        
         if (self.blackPicture != XCB_NONE) {
             xcb_render_free_picture(conn, self.blackPicture);
             self.blackPicture = XCB_NONE;
@@ -2512,6 +3652,11 @@ static uint8_t sum_gaussian(double *map, int map_size, double opacity,
             self.gaussianMap = NULL;
         }
         
+        if (self.paintLatencySamples) {
+            free(self.paintLatencySamples);
+            self.paintLatencySamples = NULL;
+        }
+        
         // Free root buffer and picture
         if (self.rootBuffer != XCB_NONE) {
             xcb_render_free_picture(conn, self.rootBuffer);
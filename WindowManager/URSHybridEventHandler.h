@@ -18,6 +18,8 @@
 #import "URSWindowSwitcher.h"
 #import "URSWindowSwitcherOverlay.h"
 #import "URSCompositingManager.h"
+#import "URSKeyboardState.h"
+#import "URSKeyBindings.h"
 
 // Use GNUstep's existing RunLoopEventType and RunLoopEvents protocol
 // (already defined in Foundation/NSRunLoop.h)
@@ -52,9 +54,15 @@
 // Auto-focus tracking to prevent double-focusing windows
 @property (strong, nonatomic) NSMutableSet* recentlyAutoFocusedWindowIds;
 
-// Cached Alt keycodes and poll timer to robustly detect Alt release
-@property (strong, nonatomic) NSMutableArray* altKeycodes;
-@property (strong, nonatomic) NSTimer* altReleasePollTimer;
+// Keysym tables and XKB modifier state; Alt release is detected from events
+@property (strong, nonatomic) URSKeyboardState* keyboardState;
+
+// Global key bindings and the modifiers that keep the switcher open
+@property (strong, nonatomic) URSKeyBindings* keyBindings;
+@property (assign, nonatomic) uint16_t switchHoldModifiers;
+
+// Focus state of titlebars whose re-render was deferred while fully obscured (frame ID -> BOOL)
+@property (strong, nonatomic) NSMutableDictionary* deferredTitleBarStates;
 
 // Original URSEventHandler methods (preserved for compatibility)
 - (BOOL)registerAsWindowManager;
@@ -81,6 +89,7 @@
 - (void)handleKeyReleaseEvent:(xcb_key_release_event_t*)event;
 
 // ICCCM/EWMH Strut and Workarea Management
+- (void)registerPropertyHandlers;
 - (void)handleStrutPropertyChange:(xcb_property_notify_event_t*)event;
 - (void)readAndRegisterStrutForWindow:(xcb_window_t)windowId;
 - (void)removeStrutForWindow:(xcb_window_t)windowId;
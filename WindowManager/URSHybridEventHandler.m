@@ -26,6 +26,7 @@
 #import "URSThemeIntegration.h"
 #import "GSThemeTitleBar.h"
 #import "URSWindowSwitcher.h"
+#import "URSIconCache.h"
 
 @implementation URSHybridEventHandler
 
@@ -76,9 +77,13 @@
     // Initialize set to track recently auto-focused windows (to prevent double-focus)
     self.recentlyAutoFocusedWindowIds = [[NSMutableSet alloc] init];
     
-    // Cache Alt keycodes (populated during setupKeyboardGrabbing)
-    self.altKeycodes = [[NSMutableArray alloc] init];
-    self.altReleasePollTimer = nil;
+    // Titlebars of obscured frames are rendered when the frame is revealed
+    self.deferredTitleBarStates = [[NSMutableDictionary alloc] init];
+    
+    // Keyboard tables, modifier state and bindings (created in setupKeyboardGrabbing)
+    self.keyboardState = nil;
+    self.keyBindings = nil;
+    self.switchHoldModifiers = 0;
     
     // Check if compositing was requested via command-line
     self.compositingRequested = [[NSUserDefaults standardUserDefaults] 
@@ -117,6 +122,12 @@
         [self initializeCompositing];
     }
 
+    // Route strut, title and icon PropertyNotify through the connection's atom table
+    [self registerPropertyHandlers];
+
+    // Build the switcher's desktop-file index in the background
+    [[URSIconCache sharedCache] refreshDesktopIndexIfNeeded];
+
     // Decorate any existing windows already on screen
     [self decorateExistingWindowsOnStartup];
 
@@ -254,7 +265,6 @@
     @try {
         XCBScreen *screen = [[connection screens] objectAtIndex:0];
         XCBWindow *rootWindow = [screen rootWindow];
-        EWMHService *ewmhService = [EWMHService sharedInstanceWithConnection:connection];
 
         XCBQueryTreeReply *tree = [rootWindow queryTree];
         xcb_window_t *children = [tree queryTreeAsArray];
@@ -262,57 +272,28 @@
 
         NSLog(@"[WindowManager] Decorating %u pre-existing windows", childCount);
 
-        for (uint32_t i = 0; i < childCount; i++) {
-            xcb_window_t winId = children[i];
+        // Skip our own helper/selection window and root
+        xcb_window_t *candidates = childCount > 0 ? malloc(childCount * sizeof(xcb_window_t)) : NULL;
+        NSUInteger candidateCount = 0;
 
-            // Skip our own helper/selection window and root
+        for (uint32_t i = 0; i < childCount && candidates; i++) {
+            xcb_window_t winId = children[i];
             if (winId == [rootWindow window] || winId == [self.selectionManagerWindow window]) {
                 continue;
             }
+            candidates[candidateCount++] = winId;
+        }
 
-            XCBWindow *win = [[XCBWindow alloc] initWithXCBWindow:winId andConnection:connection];
-            [win updateAttributes];
-            XCBAttributesReply *attrs = [win attributes];
-
-            if (!attrs) {
-                NSLog(@"[WindowManager] Skipping window %u (no attributes)", winId);
-                continue;
-            }
-
-            // Ignore override-redirect windows for decoration
-            if (attrs.overrideRedirect) {
-                NSLog(@"[WindowManager] Skipping window %u (override-redirect)", winId);
-                continue;
-            }
-
-            if (attrs.mapState != XCB_MAP_STATE_VIEWABLE) {
-                NSLog(@"[WindowManager] Skipping window %u (mapState %u)", winId, attrs.mapState);
-                continue;
-            }
-            
-            // Check if this is a dock window with struts - scan for struts even if already managed
-            if ([ewmhService isWindowTypeDock:win]) {
-                NSLog(@"[WindowManager] Found dock window %u at startup - checking for struts", winId);
-                [self readAndRegisterStrutForWindow:winId];
-            }
-
-            // Skip already-managed windows
-            if ([connection windowForXCBId:winId]) {
-                NSLog(@"[WindowManager] Window %u already managed; skipping", winId);
-                continue;
-            }
-
-            NSLog(@"[WindowManager] Adopting existing window %u", winId);
-
-            // Synthesize a map request so normal decoration flow runs
-            xcb_map_request_event_t mapEvent = {0};
-            mapEvent.response_type = XCB_MAP_REQUEST;
-            mapEvent.parent = [rootWindow window];
-            mapEvent.window = winId;
+        // OPTIMIZATION: attributes, geometry and the properties adoption reads are fetched for
+        // every child in one batch; the services answer from these snapshots while adopting.
+        [connection prefetchSnapshotsForWindows:candidates count:candidateCount];
 
-            [connection handleMapRequest:&mapEvent];
+        for (NSUInteger i = 0; i < candidateCount; i++) {
+            [self adoptExistingWindow:candidates[i] rootWindow:rootWindow];
+            [connection discardSnapshotForWindow:candidates[i]];
         }
 
+        free(candidates);
         [connection flush];
         
         // Recalculate workarea after scanning all existing windows for struts
@@ -323,6 +304,52 @@
     }
 }
 
+- (void)adoptExistingWindow:(xcb_window_t)winId rootWindow:(XCBWindow *)rootWindow {
+    EWMHService *ewmhService = [EWMHService sharedInstanceWithConnection:connection];
+
+    XCBWindow *win = [[XCBWindow alloc] initWithXCBWindow:winId andConnection:connection];
+    [win updateAttributes];
+    XCBAttributesReply *attrs = [win attributes];
+
+    if (!attrs || [attrs isError]) {
+        NSLog(@"[WindowManager] Skipping window %u (no attributes)", winId);
+        return;
+    }
+
+    // Ignore override-redirect windows for decoration
+    if (attrs.overrideRedirect) {
+        NSLog(@"[WindowManager] Skipping window %u (override-redirect)", winId);
+        return;
+    }
+
+    if (attrs.mapState != XCB_MAP_STATE_VIEWABLE) {
+        NSLog(@"[WindowManager] Skipping window %u (mapState %u)", winId, attrs.mapState);
+        return;
+    }
+    
+    // Check if this is a dock window with struts - scan for struts even if already managed
+    if ([ewmhService isWindowTypeDock:win]) {
+        NSLog(@"[WindowManager] Found dock window %u at startup - checking for struts", winId);
+        [self readAndRegisterStrutForWindow:winId];
+    }
+
+    // Skip already-managed windows
+    if ([connection windowForXCBId:winId]) {
+        NSLog(@"[WindowManager] Window %u already managed; skipping", winId);
+        return;
+    }
+
+    NSLog(@"[WindowManager] Adopting existing window %u", winId);
+
+    // Synthesize a map request so normal decoration flow runs
+    xcb_map_request_event_t mapEvent = {0};
+    mapEvent.response_type = XCB_MAP_REQUEST;
+    mapEvent.parent = [rootWindow window];
+    mapEvent.window = winId;
+
+    [connection handleMapRequest:&mapEvent];
+}
+
 #pragma mark - NSRunLoop Integration (New for Phase 1)
 
 - (void)setupXCBEventIntegration
@@ -379,6 +406,12 @@
     NSUInteger eventsProcessed = 0;
     const NSUInteger maxEventsPerCall = 50; // Limit to prevent CPU hogging
     BOOL moreEventsAvailable = NO;
+    BOOL compositing = self.compositingManager && [self.compositingManager compositingActive];
+
+    // Compositor replies first: events read along with them are handled in this batch
+    if (compositing) {
+        [self.compositingManager collectPendingReplies];
+    }
 
     // Use xcb_poll_for_event (non-blocking) instead of xcb_wait_for_event (blocking)
     while ((e = xcb_poll_for_event([connection connection])) &&
@@ -401,16 +434,17 @@
                 free(e);
                 e = nextEvent;
                 continue; // Process the next event instead
+            } else if ([connection holdResizeMotion:lastMotionEvent]) {
+                // The client has not drawn the last size yet (_NET_WM_SYNC_REQUEST);
+                // the alarm or the timeout applies the latest held motion
+                [self scheduleResizeSyncTimeout];
+                free(lastMotionEvent);
+                lastMotionEvent = NULL;
+                free(e);
+                continue;
             } else {
                 // No more events, process the motion
-                // STEP 1: Clear background pixmap BEFORE resize to prevent X11 tiling
-                [self clearTitlebarBackgroundBeforeResize:lastMotionEvent];
-                // STEP 2: Let xcbkit resize the windows
-                [connection handleMotionNotify:lastMotionEvent];
-                // STEP 3: Render new content and set as background
-                [self handleResizeDuringMotion:lastMotionEvent];
-                // STEP 4: Update compositor for drag or resize (immediate update for responsiveness)
-                [self handleCompositingDuringMotion:lastMotionEvent];
+                [self processMotionEvent:lastMotionEvent];
                 needFlush = YES;
                 free(lastMotionEvent);
                 lastMotionEvent = NULL;
@@ -434,6 +468,11 @@
         free(lastMotionEvent);
     }
 
+    // Client list changes from this batch go out as one property update
+    if ([connection updateClientListIfNeeded]) {
+        needFlush = YES;
+    }
+
     // Batched flush: only flush when needed
     if (needFlush) {
         [connection flush];
@@ -462,6 +501,11 @@
         [self performSelector:@selector(processAvailableXCBEvents)
                    withObject:nil
                    afterDelay:0.001]; // Very short delay to yield CPU
+    } else if (compositing && [self.compositingManager hasPendingReplies]) {
+        // A reply already buffered by xcb does not wake the run loop again
+        [self performSelector:@selector(processAvailableXCBEvents)
+                   withObject:nil
+                   afterDelay:0.002];
     }
 
 }
@@ -482,15 +526,13 @@
             // Re-apply GSTheme if this is a titlebar expose event
             [self handleTitlebarExpose:exposeEvent];
 
-            // Trigger compositor update for the exposed window
+            // Trigger compositor update for the exposed area only; the pixmap
+            // is re-acquired there if a resize or remap replaced it
             if (self.compositingManager && [self.compositingManager compositingActive]) {
-                // BUGFIX: Handle expose event to force NameWindowPixmap recreation.
-                // This fixes corruption with fixed-size windows (like About dialogs)
-                // that don't redraw themselves when exposed after being obscured.
-                [self.compositingManager handleExposeEvent:exposeEvent->window];
+                xcb_rectangle_t exposed = {exposeEvent->x, exposeEvent->y,
+                                           exposeEvent->width, exposeEvent->height};
+                [self.compositingManager handleExposeEvent:exposeEvent->window area:exposed];
 
-                // Update the specific window that was exposed for efficient redraw
-                [self.compositingManager updateWindow:exposeEvent->window];
                 // Force immediate repair for expose events (e.g., cursor blinking)
                 // Only on the final expose event in a sequence (count == 0)
                 if (exposeEvent->count == 0) {
@@ -515,11 +557,6 @@
             [connection handleFocusIn:focusInEvent];
             // Re-render titlebar with GSTheme as active
             [self handleFocusChange:focusInEvent->event isActive:YES];
-            
-            // Focus change typically means stacking order changed (window raised)
-            if (self.compositingManager && [self.compositingManager compositingActive]) {
-                [self.compositingManager markStackingOrderDirty];
-            }
             break;
         }
         case XCB_FOCUS_OUT: {
@@ -543,15 +580,12 @@
                 // 3. Update titlebar states (active/inactive for all windows)
                 [connection handleButtonPress:pressEvent];
             }
-            
-            // Button press typically raises the window (changes stacking order)
-            if (self.compositingManager && [self.compositingManager compositingActive]) {
-                [self.compositingManager markStackingOrderDirty];
-            }
             break;
         }
         case XCB_BUTTON_RELEASE: {
             xcb_button_release_event_t *releaseEvent = (xcb_button_release_event_t *)event;
+            // A resize motion held for a slow client still sets the final size
+            [self processHeldResizeMotion];
             // Let xcbkit handle the release first
             [connection handleButtonRelease:releaseEvent];
             // After resize completes, update the titlebar with GSTheme
@@ -591,6 +625,9 @@
         case XCB_MAP_REQUEST: {
             xcb_map_request_event_t *mapRequestEvent = (xcb_map_request_event_t *)event;
 
+            // OPTIMIZATION: one burst for everything the checks below and handleMapRequest read
+            [connection prefetchSnapshotForClient:mapRequestEvent->window];
+
             // Check if this is a dock window with struts
             EWMHService *ewmhService = [EWMHService sharedInstanceWithConnection:connection];
             XCBWindow *tempWindow = [[XCBWindow alloc] initWithXCBWindow:mapRequestEvent->window andConnection:connection];
@@ -608,6 +645,14 @@
             // Let XCBConnection handle the map request normally (this creates titlebar structure)
             [connection handleMapRequest:mapRequestEvent];
 
+            // Properties stay in the snapshot (PropertyNotify keeps them current); geometry and
+            // attributes change from here on, and unmanaged windows get no further events.
+            if ([connection windowForXCBId:mapRequestEvent->window]) {
+                [[connection snapshotForWindow:mapRequestEvent->window] discardGeometryAndAttributes];
+            } else {
+                [connection discardSnapshotForWindow:mapRequestEvent->window];
+            }
+
             // Register window with compositor if active
             if (self.compositingManager && [self.compositingManager compositingActive]) {
                 NSLog(@"[HybridEventHandler] Registering window %u with compositor (compositingActive=%d)", mapRequestEvent->window, (int)[self.compositingManager compositingActive]);
@@ -662,8 +707,11 @@
             // Unregister window from compositor before connection handles destroy
             if (self.compositingManager && [self.compositingManager compositingActive]) {
                 [self.compositingManager unregisterWindow:destroyNotify->window];
+                [self.compositingManager trackDestroyNotify:destroyNotify];
             }
             
+            [self.deferredTitleBarStates removeObjectForKey:@(destroyNotify->window)];
+            
             // Remove any struts for this window
             [self removeStrutForWindow:destroyNotify->window];
             // Check if strut removal requires workarea recalculation
@@ -690,6 +738,7 @@
             [connection handleCreateNotify:createNotify];
             // Track newly created child windows for damage (e.g., GL subwindows)
             if (self.compositingManager && [self.compositingManager compositingActive]) {
+                [self.compositingManager trackCreateNotify:createNotify];
                 [self.compositingManager registerWindow:createNotify->window];
                 [self registerChildWindowsForCompositor:createNotify->window depth:2];
             }
@@ -701,13 +750,20 @@
             
             // Notify compositor of window resize/move
             if (self.compositingManager && [self.compositingManager compositingActive]) {
+                [self.compositingManager trackConfigureNotify:configureNotify];
                 [self.compositingManager resizeWindow:configureNotify->window 
                                                     x:configureNotify->x
                                                     y:configureNotify->y
                                                 width:configureNotify->width
                                                height:configureNotify->height];
-                // Stacking can also change via ConfigureNotify (stack mode), ensure repaint
-                [self.compositingManager markStackingOrderDirty];
+            }
+            break;
+        }
+        case XCB_CIRCULATE_NOTIFY: {
+            xcb_circulate_notify_event_t *circulateNotify = (xcb_circulate_notify_event_t *)event;
+            [connection handleCirculateNotify:circulateNotify];
+            if (self.compositingManager && [self.compositingManager compositingActive]) {
+                [self.compositingManager trackCirculateNotify:circulateNotify];
             }
             break;
         }
@@ -717,6 +773,7 @@
 
             if (self.compositingManager && [self.compositingManager compositingActive]) {
                 // Re-register to refresh parent/geometry and avoid stale artifacts
+                [self.compositingManager trackReparentNotify:reparentNotify];
                 [self.compositingManager unregisterWindow:reparentNotify->window];
                 [self.compositingManager registerWindow:reparentNotify->window];
                 [self.compositingManager scheduleComposite];
@@ -725,9 +782,7 @@
         }
         case XCB_PROPERTY_NOTIFY: {
             xcb_property_notify_event_t *propEvent = (xcb_property_notify_event_t *)event;
-            // Check if this is a strut property change
-            [self handleStrutPropertyChange:propEvent];
-            [self handleWindowTitlePropertyChange:propEvent];
+            // Strut and title handlers are registered per atom in registerPropertyHandlers
             [connection handlePropertyNotify:propEvent];
             break;
         }
@@ -747,6 +802,29 @@
             break;
         }
         default: {
+            // MIT-SHM upload completions return their space to the image pool
+            if ([[connection shmImagePool] handleCompletionEvent:event]) {
+                break;
+            }
+
+            // XSync AlarmNotify: a client pacing the resize has drawn the last size
+            if ([[connection resizeSync] handleEvent:event]) {
+                if (![[connection resizeSync] isWaiting]) {
+                    [self processHeldResizeMotion];
+                }
+                break;
+            }
+
+            // XkbStateNotify and MappingNotify keep the keyboard tables and modifiers current
+            URSKeyboardEvent keyboardEvent = [self.keyboardState handleEvent:event];
+            if (keyboardEvent == URSKeyboardEventState) {
+                [self handleModifierStateChange];
+                break;
+            } else if (keyboardEvent == URSKeyboardEventMapping) {
+                [self handleKeyboardMappingChange];
+                break;
+            }
+
             // Check for extension events (damage, etc.)
             // Only log truly unhandled events (not damage events)
             uint8_t responseType = event->response_type & ~0x80;
@@ -822,8 +900,14 @@
         // This is a DAMAGE notify event
         xcb_damage_notify_event_t *damageEvent = (xcb_damage_notify_event_t *)event;
         
-        // The drawable field contains the window that was damaged
-        [self.compositingManager handleDamageNotify:damageEvent->drawable];
+        // The drawable field contains the window that was damaged; area is
+        // one damaged rectangle, more of the same batch may follow
+        [self.compositingManager handleDamageNotify:damageEvent->drawable
+                                               area:damageEvent->area
+                                               more:(damageEvent->level & URS_DAMAGE_NOTIFY_MORE) != 0];
+    } else if (responseType == XCB_GE_GENERIC) {
+        // Present CompleteNotify drives the compositor frame clock
+        [self.compositingManager handlePresentEvent:event];
     }
 }
 
@@ -865,17 +949,12 @@
         if (!window) {
             NSLog(@"handleFocusChange: window %u not found in windowsMap, searching for frame containing it", windowId);
             // The focus event might be for a client window - search all frames
-            NSDictionary *windowsMap = [connection windowsMap];
-            for (NSString *mapWindowId in windowsMap) {
-                XCBWindow *mapWindow = [windowsMap objectForKey:mapWindowId];
-                if (mapWindow && [mapWindow isKindOfClass:[XCBFrame class]]) {
-                    XCBFrame *testFrame = (XCBFrame*)mapWindow;
-                    XCBWindow *clientWindow = [testFrame childWindowForKey:ClientWindow];
-                    if (clientWindow && [clientWindow window] == windowId) {
-                        NSLog(@"handleFocusChange: Found frame containing client window %u", windowId);
-                        window = testFrame;
-                        break;
-                    }
+            for (XCBFrame *testFrame in [connection framesMap]) {
+                XCBWindow *clientWindow = [testFrame childWindowForKey:ClientWindow];
+                if (clientWindow && [clientWindow window] == windowId) {
+                    NSLog(@"handleFocusChange: Found frame containing client window %u", windowId);
+                    window = testFrame;
+                    break;
                 }
             }
             if (!window) {
@@ -924,22 +1003,14 @@
             }
         }
 
-        // Re-render titlebar with GSTheme using the correct active/inactive state
-        [URSThemeIntegration renderGSThemeToWindow:frame
-                                             frame:frame
-                                             title:[titlebar windowTitle]
-                                            active:isActive];
-
-        // Update background pixmap and redraw
-        [titlebar putWindowBackgroundWithPixmap:[titlebar pixmap]];
-        [titlebar drawArea:[titlebar windowRect]];
-        [connection flush];
-        
-        // Notify compositor about the titlebar content change
-        if (self.compositingManager && [self.compositingManager compositingActive]) {
-            [self.compositingManager updateWindow:[frame window]];
-            // Mark stacking order dirty since focused windows are typically raised
-            [self.compositingManager markStackingOrderDirty];
+        // OPTIMIZATION: Nobody can see a fully obscured titlebar; render it
+        // with the latest focus state once the frame is revealed
+        if ([frame isFullyObscured]) {
+            [self.deferredTitleBarStates setObject:@(isActive) forKey:@([frame window])];
+            [frame setTitleBarRedrawPending:YES];
+        } else {
+            [self.deferredTitleBarStates removeObjectForKey:@([frame window])];
+            [self renderTitleBar:titlebar forFrame:frame active:isActive];
         }
 
     } @catch (NSException *exception) {
@@ -947,6 +1018,42 @@
     }
 }
 
+- (void)renderTitleBar:(XCBTitleBar *)titlebar forFrame:(XCBFrame *)frame active:(BOOL)isActive {
+    // Re-render titlebar with GSTheme using the correct active/inactive state
+    [URSThemeIntegration renderGSThemeToWindow:frame
+                                         frame:frame
+                                         title:[titlebar windowTitle]
+                                        active:isActive];
+
+    // Update background pixmap and redraw
+    [titlebar putWindowBackgroundWithPixmap:[titlebar pixmap]];
+    [titlebar drawArea:[titlebar windowRect]];
+    [connection flush];
+
+    // Notify compositor about the titlebar content change
+    if (self.compositingManager && [self.compositingManager compositingActive]) {
+        [self.compositingManager updateWindow:[frame window]];
+    }
+}
+
+// Frame stopped being fully obscured with a titlebar redraw pending
+- (void)renderDeferredTitleBarForFrame:(XCBFrame *)frame {
+    XCBWindow *titlebarWindow = [frame childWindowForKey:TitleBar];
+    if (![titlebarWindow isKindOfClass:[XCBTitleBar class]]) {
+        return;
+    }
+    XCBTitleBar *titlebar = (XCBTitleBar *)titlebarWindow;
+
+    NSNumber *key = @([frame window]);
+    NSNumber *active = [self.deferredTitleBarStates objectForKey:key];
+    if (active) {
+        [self.deferredTitleBarStates removeObjectForKey:key];
+        [self renderTitleBar:titlebar forFrame:frame active:[active boolValue]];
+    } else {
+        [titlebar drawTitleBarComponents];
+    }
+}
+
 - (void)handleWindowFocusChanged:(XCBTitleBar*)titlebar isActive:(BOOL)active {
     if (!titlebar) {
         return;
@@ -1110,12 +1217,16 @@
 
 - (void)adjustBorderForFixedSizeWindow:(xcb_window_t)clientWindowId {
     @try {
-        // Check if window has fixed size (min == max in WM_NORMAL_HINTS)
-        xcb_size_hints_t sizeHints;
-        if (xcb_icccm_get_wm_normal_hints_reply([connection connection],
-                                                 xcb_icccm_get_wm_normal_hints([connection connection], clientWindowId),
-                                                 &sizeHints,
-                                                 NULL)) {
+        // Check if window has fixed size (min == max in WM_NORMAL_HINTS); served from the client's snapshot
+        XCBWindow *hintsWindow = [[XCBWindow alloc] initWithXCBWindow:clientWindowId andConnection:connection];
+        xcb_size_hints_t *hints = [[ICCCMService sharedInstanceWithConnection:connection] wmNormalHintsForWindow:hintsWindow];
+        xcb_size_hints_t sizeHints = {0};
+        if (hints) {
+            sizeHints = *hints;
+            free(hints);
+        }
+        hintsWindow = nil;
+        if (sizeHints.flags) {
             if ((sizeHints.flags & XCB_ICCCM_SIZE_HINT_P_MIN_SIZE) &&
                 (sizeHints.flags & XCB_ICCCM_SIZE_HINT_P_MAX_SIZE) &&
                 sizeHints.min_width == sizeHints.max_width &&
@@ -1134,25 +1245,19 @@
                 }
 
                 // Find the frame for this client window and set its border to 0
-                NSDictionary *windowsMap = [connection windowsMap];
-                for (NSString *mapWindowId in windowsMap) {
-                    XCBWindow *window = [windowsMap objectForKey:mapWindowId];
-
-                    if (window && [window isKindOfClass:[XCBFrame class]]) {
-                        XCBFrame *frame = (XCBFrame*)window;
-                        XCBWindow *clientWindow = [frame childWindowForKey:ClientWindow];
-
-                        if (clientWindow && [clientWindow window] == clientWindowId) {
-                            // Set the frame's border width to 0
-                            uint32_t borderWidth[] = {0};
-                            xcb_configure_window([connection connection],
-                                                 [frame window],
-                                                 XCB_CONFIG_WINDOW_BORDER_WIDTH,
-                                                 borderWidth);
-                            [connection flush];
-                            NSLog(@"Removed border from frame %u for fixed-size window %u", [frame window], clientWindowId);
-                            return;
-                        }
+                for (XCBFrame *frame in [connection framesMap]) {
+                    XCBWindow *clientWindow = [frame childWindowForKey:ClientWindow];
+
+                    if (clientWindow && [clientWindow window] == clientWindowId) {
+                        // Set the frame's border width to 0
+                        uint32_t borderWidth[] = {0};
+                        xcb_configure_window([connection connection],
+                                             [frame window],
+                                             XCB_CONFIG_WINDOW_BORDER_WIDTH,
+                                             borderWidth);
+                        [connection flush];
+                        NSLog(@"Removed border from frame %u for fixed-size window %u", [frame window], clientWindowId);
+                        return;
                     }
                 }
             }
@@ -1191,21 +1296,27 @@
         uint16_t goldenPosX = (uint16_t)(workarea.origin.x + workarea.size.width * 0.382);
         uint16_t goldenPosY = (uint16_t)(workarea.origin.y + workarea.size.height * 0.382);
         
-        // Get current geometry to check if resizing is needed
-        xcb_get_geometry_cookie_t geom_cookie = xcb_get_geometry([connection connection], clientWindowId);
-        xcb_get_geometry_reply_t *geom_reply = xcb_get_geometry_reply([connection connection], geom_cookie, NULL);
+        // Get current geometry to check if resizing is needed (prefetched on MapRequest)
+        XCBWindowSnapshot *snapshot = [connection snapshotForWindow:clientWindowId];
+        xcb_get_geometry_reply_t *geom_reply = [snapshot copyGeometry];
+        if (!geom_reply) {
+            xcb_get_geometry_cookie_t geom_cookie = xcb_get_geometry([connection connection], clientWindowId);
+            geom_reply = xcb_get_geometry_reply([connection connection], geom_cookie, NULL);
+        }
         
         if (geom_reply) {
+            XCBWindow *queryWindow = [[XCBWindow alloc] initWithXCBWindow:clientWindowId andConnection:connection];
+
             // Respect ICCCM WM_NORMAL_HINTS: if the client is fixed-size, do not apply WM defaults
-            xcb_size_hints_t sizeHints;
-            if (xcb_icccm_get_wm_normal_hints_reply([connection connection],
-                                                    xcb_icccm_get_wm_normal_hints([connection connection], clientWindowId),
-                                                    &sizeHints,
-                                                    NULL)) {
-                if ((sizeHints.flags & XCB_ICCCM_SIZE_HINT_P_MIN_SIZE) &&
-                    (sizeHints.flags & XCB_ICCCM_SIZE_HINT_P_MAX_SIZE) &&
-                    sizeHints.min_width == sizeHints.max_width &&
-                    sizeHints.min_height == sizeHints.max_height) {
+            ICCCMService *icccmService = [ICCCMService sharedInstanceWithConnection:connection];
+            xcb_size_hints_t *sizeHints = [icccmService wmNormalHintsForWindow:queryWindow];
+            if (sizeHints) {
+                BOOL fixedSize = (sizeHints->flags & XCB_ICCCM_SIZE_HINT_P_MIN_SIZE) &&
+                                 (sizeHints->flags & XCB_ICCCM_SIZE_HINT_P_MAX_SIZE) &&
+                                 sizeHints->min_width == sizeHints->max_width &&
+                                 sizeHints->min_height == sizeHints->max_height;
+                free(sizeHints);
+                if (fixedSize) {
                     NSLog(@"resizeWindowTo70Percent: client %u is fixed-size; skipping WM defaults", clientWindowId);
                     free(geom_reply);
                     return;
@@ -1215,7 +1326,6 @@
             
             // Check window type
             EWMHService *ewmhService = [EWMHService sharedInstanceWithConnection:connection];
-            XCBWindow *queryWindow = [[XCBWindow alloc] initWithXCBWindow:clientWindowId andConnection:connection];
 
             void *windowTypeReply = [ewmhService getProperty:[ewmhService EWMHWMWindowType]
                                                 propertyType:XCB_ATOM_ATOM
@@ -1276,6 +1386,7 @@
                                      XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y | 
                                      XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT,
                                      configValues);
+                [snapshot discardGeometry];
                 [connection flush];
             } else if (isAtOrigin && (geom_reply->width < screenWidth) && !isDesktopWindow && !isFullscreenState) {
                 // Window starts at (0,0) but is NOT full-width. This is usually a fallback position
@@ -1289,6 +1400,7 @@
                                      clientWindowId,
                                      XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y,
                                      configValues);
+                [snapshot discardGeometry];
                 [connection flush];
             } else if (isDesktopWindow || isFullscreenState) {
                 NSLog(@"Window %u is desktop or fullscreen window. Skipping WM defaults (isDesktop=%d, isFullscreen=%d)",
@@ -1311,61 +1423,54 @@
         NSLog(@"Applying GSTheme to recently mapped window: %u", windowId);
 
         // Find the frame for this client window
-        NSDictionary *windowsMap = [self.connection windowsMap];
+        for (XCBFrame *frame in [[self.connection framesMap] allObjects]) {
+            XCBWindow *clientWindow = [frame childWindowForKey:ClientWindow];
 
-        for (NSString *mapWindowId in windowsMap) {
-            XCBWindow *window = [windowsMap objectForKey:mapWindowId];
+            // Check if this frame contains our client window
+            if (clientWindow && [clientWindow window] == windowId) {
+                XCBWindow *titlebarWindow = [frame childWindowForKey:TitleBar];
 
-            if (window && [window isKindOfClass:[XCBFrame class]]) {
-                XCBFrame *frame = (XCBFrame*)window;
-                XCBWindow *clientWindow = [frame childWindowForKey:ClientWindow];
+                if (titlebarWindow && [titlebarWindow isKindOfClass:[XCBTitleBar class]]) {
+                    XCBTitleBar *titlebar = (XCBTitleBar*)titlebarWindow;
 
-                // Check if this frame contains our client window
-                if (clientWindow && [clientWindow window] == windowId) {
-                    XCBWindow *titlebarWindow = [frame childWindowForKey:TitleBar];
-
-                    if (titlebarWindow && [titlebarWindow isKindOfClass:[XCBTitleBar class]]) {
-                        XCBTitleBar *titlebar = (XCBTitleBar*)titlebarWindow;
-
-                        NSLog(@"Found frame for client window %u, applying GSTheme to titlebar", windowId);
-
-                        // Apply GSTheme rendering (this will override XCBKit's decoration)
-                        BOOL success = [URSThemeIntegration renderGSThemeToWindow:window
-                                                                             frame:frame
-                                                                             title:titlebar.windowTitle
-                                                                            active:YES];
-
-                        if (success) {
-                            // Add to managed list so we can handle expose events
-                            URSThemeIntegration *integration = [URSThemeIntegration sharedInstance];
-                            if (![integration.managedTitlebars containsObject:titlebar]) {
-                                [integration.managedTitlebars addObject:titlebar];
-                            }
-
-                            NSLog(@"Successfully applied GSTheme to titlebar for window %u: %@",
-                                  windowId, titlebar.windowTitle ?: @"(untitled)");
-                            
-                            // Notify compositor about the new window content
-                            if (self.compositingManager && [self.compositingManager compositingActive]) {
-                                [self.compositingManager updateWindow:[frame window]];
-                            }
-
-                            // Auto-focus the client window - the frame and titlebar are now fully set up
-                            // Focus after a small delay to ensure the window is properly rendered and ready
-                            [self performSelector:@selector(focusWindowAfterThemeApplied:)
-                                       withObject:clientWindow
-                                       afterDelay:0.1];
-
-                            // Apply GSTheme again after a short delay to override any subsequent XCBKit drawing
-                            [self performSelector:@selector(reapplyGSThemeToTitlebar:)
-                                       withObject:titlebar
-                                       afterDelay:0.1];
-                        } else {
-                            NSLog(@"Failed to apply GSTheme to titlebar for window %u", windowId);
+                    NSLog(@"Found frame for client window %u, applying GSTheme to titlebar", windowId);
+
+                    // Apply GSTheme rendering (this will override XCBKit's decoration)
+                    BOOL success = [URSThemeIntegration renderGSThemeToWindow:frame
+                                                                         frame:frame
+                                                                         title:titlebar.windowTitle
+                                                                        active:YES];
+
+                    if (success) {
+                        // Add to managed list so we can handle expose events
+                        URSThemeIntegration *integration = [URSThemeIntegration sharedInstance];
+                        if (![integration.managedTitlebars containsObject:titlebar]) {
+                            [integration.managedTitlebars addObject:titlebar];
+                        }
+
+                        NSLog(@"Successfully applied GSTheme to titlebar for window %u: %@",
+                              windowId, titlebar.windowTitle ?: @"(untitled)");
+                        
+                        // Notify compositor about the new window content
+                        if (self.compositingManager && [self.compositingManager compositingActive]) {
+                            [self.compositingManager updateWindow:[frame window]];
                         }
 
-                        return; // Found and processed
+                        // Auto-focus the client window - the frame and titlebar are now fully set up
+                        // Focus after a small delay to ensure the window is properly rendered and ready
+                        [self performSelector:@selector(focusWindowAfterThemeApplied:)
+                                   withObject:clientWindow
+                                   afterDelay:0.1];
+
+                        // Apply GSTheme again after a short delay to override any subsequent XCBKit drawing
+                        [self performSelector:@selector(reapplyGSThemeToTitlebar:)
+                                   withObject:titlebar
+                                   afterDelay:0.1];
+                    } else {
+                        NSLog(@"Failed to apply GSTheme to titlebar for window %u", windowId);
                     }
+
+                    return; // Found and processed
                 }
             }
         }
@@ -1397,29 +1502,22 @@
         NSLog(@"Reapplying GSTheme to titlebar: %@", titlebar.windowTitle);
 
         // Find the frame containing this titlebar
-        NSDictionary *windowsMap = [self.connection windowsMap];
-
-        for (NSString *windowId in windowsMap) {
-            XCBWindow *window = [windowsMap objectForKey:windowId];
-
-            if (window && [window isKindOfClass:[XCBFrame class]]) {
-                XCBFrame *frame = (XCBFrame*)window;
-                XCBWindow *frameTitle = [frame childWindowForKey:TitleBar];
-
-                if (frameTitle && frameTitle == titlebar) {
-                    // Reapply GSTheme rendering
-                    [URSThemeIntegration renderGSThemeToWindow:window
-                                                         frame:frame
-                                                         title:titlebar.windowTitle
-                                                        active:YES];
-                    NSLog(@"GSTheme reapplied to titlebar: %@", titlebar.windowTitle);
-                    
-                    // Notify compositor about the content change
-                    if (self.compositingManager && [self.compositingManager compositingActive]) {
-                        [self.compositingManager updateWindow:[frame window]];
-                    }
-                    return;
+        for (XCBFrame *frame in [[self.connection framesMap] allObjects]) {
+            XCBWindow *frameTitle = [frame childWindowForKey:TitleBar];
+
+            if (frameTitle && frameTitle == titlebar) {
+                // Reapply GSTheme rendering
+                [URSThemeIntegration renderGSThemeToWindow:frame
+                                                     frame:frame
+                                                     title:titlebar.windowTitle
+                                                    active:YES];
+                NSLog(@"GSTheme reapplied to titlebar: %@", titlebar.windowTitle);
+                
+                // Notify compositor about the content change
+                if (self.compositingManager && [self.compositingManager compositingActive]) {
+                    [self.compositingManager updateWindow:[frame window]];
                 }
+                return;
             }
         }
 
@@ -1438,36 +1536,29 @@
             return; // Skip if disabled
         }
 
-        // Check all windows in the connection for new frames/titlebars
-        NSDictionary *windowsMap = [self.connection windowsMap];
+        // Check all frames in the connection for new titlebars
         NSUInteger newTitlebarsFound = 0;
 
-        for (NSString *windowId in windowsMap) {
-            XCBWindow *window = [windowsMap objectForKey:windowId];
-
-            // Look for XCBFrame objects (which contain titlebars)
-            if (window && [window isKindOfClass:[XCBFrame class]]) {
-                XCBFrame *frame = (XCBFrame*)window;
-                XCBWindow *titlebarWindow = [frame childWindowForKey:TitleBar];
-
-                if (titlebarWindow && [titlebarWindow isKindOfClass:[XCBTitleBar class]]) {
-                    XCBTitleBar *titlebar = (XCBTitleBar*)titlebarWindow;
-
-                    // Check if we've already processed this titlebar
-                    if (![integration.managedTitlebars containsObject:titlebar]) {
-                        newTitlebarsFound++;
+        for (XCBFrame *frame in [[self.connection framesMap] allObjects]) {
+            XCBWindow *titlebarWindow = [frame childWindowForKey:TitleBar];
 
-                        // Apply standalone GSTheme rendering
-                        BOOL success = [URSThemeIntegration renderGSThemeToWindow:window
-                                                                             frame:frame
-                                                                             title:titlebar.windowTitle
-                                                                            active:YES];
+            if (titlebarWindow && [titlebarWindow isKindOfClass:[XCBTitleBar class]]) {
+                XCBTitleBar *titlebar = (XCBTitleBar*)titlebarWindow;
 
-                        if (success) {
-                            // Add to managed list only if successful
-                            [integration.managedTitlebars addObject:titlebar];
-                            NSLog(@"Applied GSTheme to new titlebar: %@", titlebar.windowTitle ?: @"(untitled)");
-                        }
+                // Check if we've already processed this titlebar
+                if (![integration.managedTitlebars containsObject:titlebar]) {
+                    newTitlebarsFound++;
+
+                    // Apply standalone GSTheme rendering
+                    BOOL success = [URSThemeIntegration renderGSThemeToWindow:frame
+                                                                         frame:frame
+                                                                         title:titlebar.windowTitle
+                                                                        active:YES];
+
+                    if (success) {
+                        // Add to managed list only if successful
+                        [integration.managedTitlebars addObject:titlebar];
+                        NSLog(@"Applied GSTheme to new titlebar: %@", titlebar.windowTitle ?: @"(untitled)");
                     }
                 }
             }
@@ -1485,6 +1576,45 @@
 
 #pragma mark - Resize Handling
 
+- (void)processMotionEvent:(xcb_motion_notify_event_t*)motionEvent {
+    // STEP 1: Clear background pixmap BEFORE resize to prevent X11 tiling
+    [self clearTitlebarBackgroundBeforeResize:motionEvent];
+    // STEP 2: Let xcbkit resize the windows
+    [connection handleMotionNotify:motionEvent];
+    // STEP 3: Render new content and set as background
+    [self handleResizeDuringMotion:motionEvent];
+    // STEP 4: Update compositor for drag or resize (immediate update for responsiveness)
+    [self handleCompositingDuringMotion:motionEvent];
+}
+
+- (void)processHeldResizeMotion {
+    xcb_motion_notify_event_t heldMotion;
+    if (![connection takeHeldResizeMotion:&heldMotion]) {
+        return;
+    }
+
+    [self processMotionEvent:&heldMotion];
+    [connection flush];
+}
+
+- (void)scheduleResizeSyncTimeout {
+    [NSObject cancelPreviousPerformRequestsWithTarget:self
+                                             selector:@selector(resizeSyncTimeoutFired)
+                                               object:nil];
+    [self performSelector:@selector(resizeSyncTimeoutFired)
+               withObject:nil
+               afterDelay:[[connection resizeSync] timeRemaining] + 0.001];
+}
+
+- (void)resizeSyncTimeoutFired {
+    // isWaiting gives up on the client once the timeout has passed
+    if ([[connection resizeSync] isWaiting]) {
+        [self scheduleResizeSyncTimeout];
+        return;
+    }
+    [self processHeldResizeMotion];
+}
+
 - (void)clearTitlebarBackgroundBeforeResize:(xcb_motion_notify_event_t*)motionEvent {
     @try {
         // Find the frame
@@ -1979,62 +2109,12 @@
     @try {
         XCBScreen *screen = [[connection screens] objectAtIndex:0];
         xcb_window_t root = [[screen rootWindow] window];
-        xcb_connection_t *conn = [connection connection];
-        
-        // Ungrab all key combinations we previously grabbed
-        // We need to ungrab both Alt+Tab and Shift+Alt+Tab
-        
-        // Get the keyboard mapping to find Tab key (same as in setup)
-        xcb_get_keyboard_mapping_cookie_t cookie = xcb_get_keyboard_mapping(
-            conn,
-            8,   // min_keycode
-            248  // count (255 - 8 + 1)
-        );
-        
-        xcb_get_keyboard_mapping_reply_t *reply = xcb_get_keyboard_mapping_reply(conn, cookie, NULL);
-        if (!reply) {
-            NSLog(@"[Alt-Tab] Warning: Failed to get keyboard mapping during cleanup");
-            // Fallback ungrab with common Tab keycode
-            xcb_ungrab_key(conn, 23, root, XCB_MOD_MASK_1);
-            xcb_ungrab_key(conn, 23, root, XCB_MOD_MASK_1 | XCB_MOD_MASK_SHIFT);
-            [connection flush];
-            return;
-        }
-        
-        xcb_keysym_t *keysyms = xcb_get_keyboard_mapping_keysyms(reply);
-        int keysyms_len = xcb_get_keyboard_mapping_keysyms_length(reply);
-        
-        // Find Tab key and ungrab it
-        BOOL tabFound = NO;
-        for (int i = 0; i < keysyms_len; i++) {
-            if (keysyms[i] == XK_Tab) {
-                xcb_keycode_t keycode = 8 + (i / reply->keysyms_per_keycode);
-                
-                NSLog(@"[Alt-Tab] Ungrabbing Tab key at keycode %d", keycode);
-                
-                // Ungrab Alt+Tab
-                xcb_ungrab_key(conn, keycode, root, XCB_MOD_MASK_1);
-                
-                // Ungrab Shift+Alt+Tab
-                xcb_ungrab_key(conn, keycode, root, XCB_MOD_MASK_1 | XCB_MOD_MASK_SHIFT);
-                
-                tabFound = YES;
-                break;
-            }
-        }
         
-        if (!tabFound) {
-            NSLog(@"[Alt-Tab] Using fallback keycode 23 for ungrab");
-            xcb_ungrab_key(conn, 23, root, XCB_MOD_MASK_1);
-            xcb_ungrab_key(conn, 23, root, XCB_MOD_MASK_1 | XCB_MOD_MASK_SHIFT);
-        }
+        // Ungrab exactly the key combinations setupKeyboardGrabbing grabbed
+        [self.keyBindings ungrabKeysOnWindow:root];
         
-        free(reply);
         [connection flush];
         NSLog(@"[Alt-Tab] Successfully ungrabbed keyboard");
-
-        // Ensure poll timer is stopped
-        [self stopAltReleasePoll];
         
     } @catch (NSException *exception) {
         NSLog(@"[Alt-Tab] Exception in cleanupKeyboardGrabbing: %@", exception.reason);
@@ -2077,109 +2157,21 @@
     @try {
         XCBScreen *screen = [[connection screens] objectAtIndex:0];
         xcb_window_t root = [[screen rootWindow] window];
-        xcb_connection_t *conn = [connection connection];
-        
-        // Standard keycodes for Tab on most keyboards
-        // Tab is usually keycode 23 on X11 systems
-        // But we need to grab all variations
-        
-        // Get the keyboard mapping to find Tab key
-        const xcb_setup_t *setup = xcb_get_setup(conn);
-        xcb_get_keyboard_mapping_cookie_t cookie = xcb_get_keyboard_mapping(
-            conn,
-            setup->min_keycode,
-            setup->max_keycode - setup->min_keycode + 1
-        );
-        
-        xcb_get_keyboard_mapping_reply_t *reply = xcb_get_keyboard_mapping_reply(conn, cookie, NULL);
-        if (!reply) {
-            NSLog(@"[Alt-Tab] ERROR: Failed to get keyboard mapping");
-            return;
-        }
-        
-        xcb_keysym_t *keysyms = xcb_get_keyboard_mapping_keysyms(reply);
-        int keysyms_len = xcb_get_keyboard_mapping_keysyms_length(reply);
         
-        NSLog(@"[Alt-Tab] Found %d keysyms in keyboard mapping", keysyms_len);
-        
-        // Find Tab key and grab it, and cache Alt keycodes
-        BOOL tabFound = NO;
-        for (int i = 0; i < keysyms_len; i++) {
-            // Cache Alt/Meta keycodes for query_keymap polling
-            // We look for Alt, Meta, or Super keys as candidates for Mod1
-            if (keysyms[i] == XK_Alt_L || keysyms[i] == XK_Alt_R ||
-                keysyms[i] == XK_Meta_L || keysyms[i] == XK_Meta_R ||
-                keysyms[i] == XK_Super_L || keysyms[i] == XK_Super_R) {
-                xcb_keycode_t altcode = setup->min_keycode + (i / reply->keysyms_per_keycode);
-                
-                // Avoid duplicates
-                if (![self.altKeycodes containsObject:@(altcode)]) {
-                    NSLog(@"[Alt-Tab] Caching potential modifier key: %d (sym=0x%x)", altcode, (unsigned int)keysyms[i]);
-                    [self.altKeycodes addObject:@(altcode)];
-                }
-            }
-
-            if (keysyms[i] == XK_Tab) {
-                // Calculate keycode from index
-                // keycode = min_keycode + (index / keysyms_per_keycode)
-                xcb_keycode_t keycode = setup->min_keycode + (i / reply->keysyms_per_keycode);
-                
-                NSLog(@"[Alt-Tab] Found Tab key at keycode %d", keycode);
-                
-                // Grab Alt+Tab (Mod1)
-                xcb_grab_key(conn,
-                           0,  // owner_events
-                           root,
-                           XCB_MOD_MASK_1,  // modifiers (Alt/Mod1)
-                           keycode,
-                           XCB_GRAB_MODE_ASYNC,
-                           XCB_GRAB_MODE_ASYNC);
-                
-                // Grab Shift+Alt+Tab
-                xcb_grab_key(conn,
-                           0,  // owner_events
-                           root,
-                           XCB_MOD_MASK_1 | XCB_MOD_MASK_SHIFT,  // Alt + Shift
-                           keycode,
-                           XCB_GRAB_MODE_ASYNC,
-                           XCB_GRAB_MODE_ASYNC);
-                
-                tabFound = YES;
-                // Don't break, keep scanning for Alt keycodes
-            }
+        // Keysym tables and XKB modifier tracking; the tables are reloaded on MappingNotify
+        if (!self.keyboardState) {
+            self.keyboardState = [[URSKeyboardState alloc] initWithConnection:connection];
         }
-        
-        // Also explicitly query the modifier mapping to find all keycodes assigned to Mod1
-        xcb_get_modifier_mapping_cookie_t modCookie = xcb_get_modifier_mapping(conn);
-        xcb_get_modifier_mapping_reply_t *modReply = xcb_get_modifier_mapping_reply(conn, modCookie, NULL);
-        if (modReply) {
-            int keycodesPerMod = modReply->keycodes_per_modifier;
-            xcb_keycode_t *modKeycodes = xcb_get_modifier_mapping_keycodes(modReply);
-            
-            // Mod1 is index 3
-            NSLog(@"[Alt-Tab] Querying Mod1 (Alt) modifier mapping (%d keycodes per modifier)", keycodesPerMod);
-            for (int i = 0; i < keycodesPerMod; i++) {
-                xcb_keycode_t kc = modKeycodes[3 * keycodesPerMod + i];
-                if (kc != 0) {
-                    if (![self.altKeycodes containsObject:@(kc)]) {
-                        NSLog(@"[Alt-Tab] Adding Mod1 keycode from mapping: %d", kc);
-                        [self.altKeycodes addObject:@(kc)];
-                    }
-                }
-            }
-            free(modReply);
+        if (!self.keyBindings) {
+            self.keyBindings = [[URSKeyBindings alloc] initWithConnection:connection];
         }
         
-        if (!tabFound) {
-            NSLog(@"[Alt-Tab] Warning: Tab key not found in keyboard mapping, using keycode 23 as fallback");
-            // Fallback to common Tab keycode
-            xcb_grab_key(conn, 0, root, XCB_MOD_MASK_1, 23, XCB_GRAB_MODE_ASYNC, XCB_GRAB_MODE_ASYNC);
-            xcb_grab_key(conn, 0, root, XCB_MOD_MASK_1 | XCB_MOD_MASK_SHIFT, 23, XCB_GRAB_MODE_ASYNC, XCB_GRAB_MODE_ASYNC);
-        }
+        // Alt-Tab, tiling and centering bindings from defaults, compiled for this mapping
+        [self.keyBindings compileWithKeyboardState:self.keyboardState];
+        [self.keyBindings grabKeysOnWindow:root];
         
-        free(reply);
         [connection flush];
-        NSLog(@"[Alt-Tab] Successfully grabbed Alt+Tab and Shift+Alt+Tab");
+        NSLog(@"[Alt-Tab] Grabbed %lu key bindings", (unsigned long)self.keyBindings.bindingsCount);
         
     } @catch (NSException *exception) {
         NSLog(@"[Alt-Tab] Exception in setupKeyboardGrabbing: %@", exception.reason);
@@ -2188,72 +2180,58 @@
 
 - (void)handleKeyPressEvent:(xcb_key_press_event_t*)event {
     @try {
-        // Check for modifier states directly from the event
-        BOOL altPressed = (event->state & XCB_MOD_MASK_1) != 0;
-        BOOL shiftPressed = (event->state & XCB_MOD_MASK_SHIFT) != 0;
+        xcb_keysym_t keysym = [self.keyboardState keysymForKeycode:event->detail column:0];
         
-        // Standard keycodes for reference
-        // Tab is typically keycode 23
-        // Alt keys are typically 64 (Alt_L) and 108 (Alt_R)
-        // Shift keys are typically 50 (Shift_L) and 62 (Shift_R)
-        
-        NSLog(@"[Alt-Tab] Key press: keycode=%d, state=0x%x, alt=%d, shift=%d", 
-              event->detail, event->state, altPressed, shiftPressed);
-        
-        // Track Alt key state using cached keycodes
-        if ([self.altKeycodes containsObject:@(event->detail)]) {
+        // Track Alt key state using the keyboard mapping
+        if ([self.keyboardState isAltKeycode:event->detail]) {
             self.altKeyPressed = YES;
-            NSLog(@"[Alt-Tab] Alt-class key pressed: keycode=%d", event->detail);
         }
         
         // Track Shift key state
-        if (event->detail == 50 || event->detail == 62) {  // Shift keys
+        if (keysym == XK_Shift_L || keysym == XK_Shift_R) {
             self.shiftKeyPressed = YES;
         }
         
-        // Handle Tab key (keycode 23) with Alt modifier
-        if (event->detail == 23 && altPressed) {  // Tab with Alt
-            NSLog(@"[Alt-Tab] Tab pressed with Alt (shift=%d)", shiftPressed);
-            
-            // If not already switching, grab the keyboard to receive all future key events
-            // including the Alt key release
-            if (!self.windowSwitcher.isSwitching) {
-                XCBScreen *screen = [[connection screens] objectAtIndex:0];
-                xcb_window_t root = [[screen rootWindow] window];
-                xcb_connection_t *conn = [connection connection];
-                
-                // Actively grab the keyboard to receive all key events
-                xcb_grab_keyboard_cookie_t cookie = xcb_grab_keyboard(conn,
-                                                                      0,  // owner_events
-                                                                      root,
-                                                                      XCB_CURRENT_TIME,
-                                                                      XCB_GRAB_MODE_ASYNC,
-                                                                      XCB_GRAB_MODE_ASYNC);
-                xcb_grab_keyboard_reply_t *reply = xcb_grab_keyboard_reply(conn, cookie, NULL);
-                
-                if (reply) {
-                    if (reply->status == XCB_GRAB_STATUS_SUCCESS) {
-                        NSLog(@"[Alt-Tab] Successfully grabbed keyboard");
-                    } else {
-                        NSLog(@"[Alt-Tab] Warning: Keyboard grab failed with status %d", reply->status);
-                    }
-                    free(reply);
-                }
-                [connection flush];
-            }
-            
-            if (shiftPressed) {
-                // Shift+Alt+Tab: cycle backward
-                NSLog(@"[Alt-Tab] Cycling backward");
-                [self.windowSwitcher cycleBackward];
-            } else {
-                // Alt+Tab: cycle forward
-                NSLog(@"[Alt-Tab] Cycling forward");
-                [self.windowSwitcher cycleForward];
-            }
-
-            // Start polling for Alt release as a robust fallback in case release events are missed
-            [self startAltReleasePoll];
+        // OPTIMIZATION: One table read resolves the binding for (keycode, modifiers)
+        URSKeyAction action = [self.keyBindings actionForKeycode:event->detail state:event->state];
+        if (action == URSKeyActionNone) {
+            return;
+        }
+        
+        NSLog(@"[KeyBindings] keycode=%d state=0x%x -> %@", event->detail, event->state,
+              [URSKeyBindings nameForAction:action]);
+        
+        switch (action) {
+            case URSKeyActionSwitchForward:
+            case URSKeyActionSwitchBackward:
+                [self handleSwitchKeyAction:action state:event->state];
+                break;
+            case URSKeyActionCenter:
+                [connection centerActiveWindow];
+                break;
+            case URSKeyActionMaximize:
+                [connection tileActiveWindowToZone:SnapZoneTop];
+                break;
+            case URSKeyActionTileLeft:
+                [connection tileActiveWindowLeft];
+                break;
+            case URSKeyActionTileRight:
+                [connection tileActiveWindowRight];
+                break;
+            case URSKeyActionTileTopLeft:
+                [connection tileActiveWindowToZone:SnapZoneTopLeft];
+                break;
+            case URSKeyActionTileTopRight:
+                [connection tileActiveWindowToZone:SnapZoneTopRight];
+                break;
+            case URSKeyActionTileBottomLeft:
+                [connection tileActiveWindowToZone:SnapZoneBottomLeft];
+                break;
+            case URSKeyActionTileBottomRight:
+                [connection tileActiveWindowToZone:SnapZoneBottomRight];
+                break;
+            default:
+                break;
         }
         
     } @catch (NSException *exception) {
@@ -2261,45 +2239,74 @@
     }
 }
 
+- (void)handleSwitchKeyAction:(URSKeyAction)action state:(uint16_t)state {
+    // If not already switching, grab the keyboard to receive all future key events
+    // including the modifier release
+    if (!self.windowSwitcher.isSwitching) {
+        XCBScreen *screen = [[connection screens] objectAtIndex:0];
+        xcb_window_t root = [[screen rootWindow] window];
+        xcb_connection_t *conn = [connection connection];
+        
+        // Actively grab the keyboard to receive all key events
+        xcb_grab_keyboard_cookie_t cookie = xcb_grab_keyboard(conn,
+                                                              0,  // owner_events
+                                                              root,
+                                                              XCB_CURRENT_TIME,
+                                                              XCB_GRAB_MODE_ASYNC,
+                                                              XCB_GRAB_MODE_ASYNC);
+        xcb_grab_keyboard_reply_t *reply = xcb_grab_keyboard_reply(conn, cookie, NULL);
+        
+        if (reply) {
+            if (reply->status == XCB_GRAB_STATUS_SUCCESS) {
+                NSLog(@"[Alt-Tab] Successfully grabbed keyboard");
+            } else {
+                NSLog(@"[Alt-Tab] Warning: Keyboard grab failed with status %d", reply->status);
+            }
+            free(reply);
+        }
+        [connection flush];
+        
+        // The switcher stays open while the binding's modifiers (other than Shift) are held
+        self.switchHoldModifiers = [self.keyBindings bindingModifiersFromState:state] & ~XCB_MOD_MASK_SHIFT;
+    }
+    
+    if (action == URSKeyActionSwitchBackward) {
+        NSLog(@"[Alt-Tab] Cycling backward");
+        [self.windowSwitcher cycleBackward];
+    } else {
+        NSLog(@"[Alt-Tab] Cycling forward");
+        [self.windowSwitcher cycleForward];
+    }
+    
+    // PERFORMANCE FIX: No release polling. With XKB the release arrives as an
+    // XkbStateNotify (handleModifierStateChange); without it the modifier key's
+    // own KeyRelease is delivered through the keyboard grab.
+}
+
 - (void)handleKeyReleaseEvent:(xcb_key_release_event_t*)event {
     @try {
-        // Track Alt key state using cached keycodes
-        if ([self.altKeycodes containsObject:@(event->detail)]) {
+        xcb_keysym_t keysym = [self.keyboardState keysymForKeycode:event->detail column:0];
+        
+        // Track Alt key state using the keyboard mapping
+        if ([self.keyboardState isAltKeycode:event->detail]) {
             self.altKeyPressed = NO;
-            NSLog(@"[Alt-Tab] Alt-class key release: keycode=%d", event->detail);
         }
-
-        // If we're currently switching, check if the switch should be completed.
-        // We ONLY close when Alt is fully released. We use the server-side keymap 
-        // query for maximum robustness, as event->state can sometimes be unreliable 
-        // during grabs or focus changes.
-        if (self.windowSwitcher.isSwitching) {
-            // Check if ANY modifier key that acts as Alt (Mod1) is still pressed
-            if (![self altModifierCurrentlyDown]) {
-                NSLog(@"[Alt-Tab] Alt release confirmed via keymap query - completing switch");
-
-                // Ungrab the keyboard so normal input is restored
-                xcb_connection_t *conn = [connection connection];
-                xcb_ungrab_keyboard(conn, XCB_CURRENT_TIME);
-                [connection flush];
-
-                // Perform the actual window activation and hide the overlay
-                [self.windowSwitcher completeSwitching];
-
-                // Stop the poll timer
-                [self stopAltReleasePoll];
+        
+        // With XKB the switch completes on the XkbStateNotify that clears the held
+        // modifiers. Without it, releasing one of their keys is checked once against
+        // the server keymap, as another key of the same modifier may still be held.
+        if (self.windowSwitcher.isSwitching && !self.keyboardState.xkbAvailable &&
+            [[self.keyboardState keycodesForModifierMask:self.switchHoldModifiers] containsObject:@(event->detail)]) {
+            if (![self modifierKeysCurrentlyDown:self.switchHoldModifiers]) {
+                NSLog(@"[Alt-Tab] Modifier release confirmed via keymap query - completing switch");
+                [self completeSwitchingAfterAltRelease];
             } else {
-                // If Alt is still down, just log for debugging
-                if ([self.altKeycodes containsObject:@(event->detail)]) {
-                    NSLog(@"[Alt-Tab] One Alt key released, but another Alt/Meta key is still held.");
-                } else if (event->detail == 23) {
-                    NSLog(@"[Alt-Tab] Tab released, keeping switcher open as Alt is still held.");
-                }
+                NSLog(@"[Alt-Tab] One modifier key released, but another is still held.");
             }
         }
         
         // Track Shift key release
-        if (event->detail == 50 || event->detail == 62) {  // Shift keys
+        if (keysym == XK_Shift_L || keysym == XK_Shift_R) {
             self.shiftKeyPressed = NO;
         }
         
@@ -2308,8 +2315,31 @@
     }
 }
 
-// Polling helpers for robust Alt release detection
-- (BOOL)altModifierCurrentlyDown {
+- (void)handleModifierStateChange {
+    if (self.windowSwitcher.isSwitching && ![self.keyboardState modifiersHeld:self.switchHoldModifiers]) {
+        NSLog(@"[Alt-Tab] Modifier release reported by XkbStateNotify - completing switch");
+        [self completeSwitchingAfterAltRelease];
+    }
+}
+
+- (void)handleKeyboardMappingChange {
+    // Bound keys may have moved to other keycodes; ungrab the old ones and recompile
+    [self cleanupKeyboardGrabbing];
+    [self setupKeyboardGrabbing];
+}
+
+- (void)completeSwitchingAfterAltRelease {
+    // Ungrab the keyboard so normal input is restored
+    xcb_connection_t *conn = [connection connection];
+    xcb_ungrab_keyboard(conn, XCB_CURRENT_TIME);
+    [connection flush];
+    
+    // Perform the actual window activation and hide the overlay
+    [self.windowSwitcher completeSwitching];
+}
+
+// One-shot server query used only when XKB is unavailable
+- (BOOL)modifierKeysCurrentlyDown:(uint16_t)modifiers {
     xcb_connection_t *conn = [connection connection];
     xcb_query_keymap_cookie_t cookie = xcb_query_keymap(conn);
     xcb_query_keymap_reply_t *reply = xcb_query_keymap_reply(conn, cookie, NULL);
@@ -2318,7 +2348,7 @@
     const uint8_t *keys = reply->keys;  // Use reply->keys array from xcb_query_keymap_reply
     BOOL down = NO;
 
-    for (NSNumber *num in self.altKeycodes) {
+    for (NSNumber *num in [self.keyboardState keycodesForModifierMask:modifiers]) {
         xcb_keycode_t keycode = (xcb_keycode_t)[num unsignedCharValue];
         if (keycode < 8) continue; // safety
         uint8_t byte = keys[keycode >> 3];
@@ -2333,42 +2363,34 @@
     return down;
 }
 
-- (void)startAltReleasePoll {
-    if (self.altReleasePollTimer) return;
-    NSLog(@"[Alt-Tab] Starting Alt release poll timer");
-    self.altReleasePollTimer = [NSTimer scheduledTimerWithTimeInterval:0.05
-                                                                 target:self
-                                                               selector:@selector(checkAltReleaseTimerFired:)
-                                                               userInfo:nil
-                                                                repeats:YES];
-}
-
-- (void)stopAltReleasePoll {
-    if (!self.altReleasePollTimer) return;
-    NSLog(@"[Alt-Tab] Stopping Alt release poll timer");
-    [self.altReleasePollTimer invalidate];
-    self.altReleasePollTimer = nil;
-}
+#pragma mark - Cleanup
 
-- (void)checkAltReleaseTimerFired:(NSTimer*)timer {
-    if (!self.windowSwitcher.isSwitching) {
-        [self stopAltReleasePoll];
+// Dump the frame statistics as JSON for test-xvfb-benchmark.sh when the
+// URSBenchmarkStatsFile default names a file
+- (void)writeBenchmarkStatistics
+{
+    NSString *path = [[NSUserDefaults standardUserDefaults] stringForKey:@"URSBenchmarkStatsFile"];
+    if (!path) {
         return;
     }
 
-    if (![self altModifierCurrentlyDown]) {
-        NSLog(@"[Alt-Tab] Alt release detected via poll - completing switch");
-        xcb_connection_t *conn = [connection connection];
-        xcb_ungrab_keyboard(conn, XCB_CURRENT_TIME);
-        [connection flush];
+    NSMutableDictionary *statistics = [NSMutableDictionary dictionary];
+    statistics[@"eventsProcessed"] = @(self.eventCount);
+    // Lets the benchmark pick this connection out of the per-connection request counts
+    statistics[@"xcbFileDescriptor"] = @(xcb_get_file_descriptor([connection connection]));
+    statistics[@"compositor"] = [self.compositingManager frameStatistics];
 
-        [self.windowSwitcher completeSwitching];
-        [self stopAltReleasePoll];
+    NSError *error = nil;
+    NSData *json = [NSJSONSerialization dataWithJSONObject:statistics
+                                                   options:NSJSONWritingPrettyPrinted
+                                                     error:&error];
+    if (!json || ![json writeToFile:path atomically:YES]) {
+        NSLog(@"[WindowManager] Could not write benchmark statistics to %@: %@", path, error);
+        return;
     }
+    NSLog(@"[WindowManager] Benchmark statistics written to %@", path);
 }
 
-#pragma mark - Cleanup
-
 - (void)cleanupBeforeExit
 {
     NSLog(@"[WindowManager] ========== Starting comprehensive cleanup ==========");
@@ -2376,6 +2398,7 @@
     @try {
         // Step 0: Clean up compositing if active
         if (self.compositingManager && [self.compositingManager compositingActive]) {
+            [self writeBenchmarkStatistics];
             NSLog(@"[WindowManager] Step 0: Deactivating compositing");
             [self.compositingManager deactivateCompositing];
             [self.compositingManager cleanup];
@@ -2422,7 +2445,7 @@
             return;
         }
         
-        NSDictionary *windowsMap = [connection windowsMap];
+        XCBWindowTable *windowsMap = [connection windowsMap];
         if (!windowsMap || [windowsMap count] == 0) {
             NSLog(@"[WindowManager] No windows to clean up");
             return;
@@ -2433,15 +2456,8 @@
         XCBScreen *screen = [[connection screens] objectAtIndex:0];
         XCBWindow *rootWindow = [screen rootWindow];
         
-        // Collect all frames first to avoid modifying dictionary while iterating
-        NSMutableArray *framesToCleanup = [NSMutableArray array];
-        
-        for (NSString *windowId in windowsMap) {
-            XCBWindow *window = [windowsMap objectForKey:windowId];
-            if (window && [window isKindOfClass:[XCBFrame class]]) {
-                [framesToCleanup addObject:window];
-            }
-        }
+        // Snapshot the frames first to avoid modifying the table while iterating
+        NSArray *framesToCleanup = [[connection framesMap] allObjects];
         
         NSLog(@"[WindowManager] Found %lu frames to clean up", (unsigned long)[framesToCleanup count]);
         
@@ -2591,6 +2607,31 @@
 
 #pragma mark - ICCCM/EWMH Strut and Workarea Management
 
+- (void)registerPropertyHandlers
+{
+    EWMHService *ewmhService = [EWMHService sharedInstanceWithConnection:connection];
+    ICCCMService *icccmService = [ICCCMService sharedInstanceWithConnection:connection];
+    __weak URSHybridEventHandler *weakSelf = self;
+
+    [connection addPropertyNotifyHandler:^(xcb_property_notify_event_t *event) {
+        [weakSelf handleStrutPropertyChange:event];
+    } forAtoms:@[[ewmhService EWMHWMStrut], [ewmhService EWMHWMStrutPartial]]];
+
+    [connection addPropertyNotifyHandler:^(xcb_property_notify_event_t *event) {
+        [weakSelf handleWindowTitlePropertyChange:event];
+    } forAtoms:@[[icccmService WMName], [ewmhService EWMHWMName], [ewmhService EWMHWMVisibleName]]];
+
+    __weak XCBConnection *weakConnection = connection;
+    [connection addPropertyNotifyHandler:^(xcb_property_notify_event_t *event) {
+        [[URSIconCache sharedCache] invalidateIconForClientWindow:[weakConnection windowForXCBId:event->window]];
+    } forAtoms:@[[ewmhService EWMHWMIcon]]];
+
+    // Titlebar renders skipped while a frame was fully obscured
+    [connection setFrameRevealHandler:^(XCBFrame *frame) {
+        [weakSelf renderDeferredTitleBarForFrame:frame];
+    }];
+}
+
 - (void)handleStrutPropertyChange:(xcb_property_notify_event_t*)event
 {
     if (!event) return;
@@ -2598,13 +2639,12 @@
     XCBAtomService *atomService = [XCBAtomService sharedInstanceWithConnection:connection];
     EWMHService *ewmhService = [EWMHService sharedInstanceWithConnection:connection];
     
-    NSString *atomName = [atomService atomNameFromAtom:event->atom];
-    
-    // Check if this is a strut property change
-    if ([atomName isEqualToString:[ewmhService EWMHWMStrut]] ||
-        [atomName isEqualToString:[ewmhService EWMHWMStrutPartial]]) {
+    // Check if this is a strut property change (integer compares; atoms are cached at startup)
+    if (event->atom == [atomService atomFromCachedAtomsWithKey:[ewmhService EWMHWMStrut]] ||
+        event->atom == [atomService atomFromCachedAtomsWithKey:[ewmhService EWMHWMStrutPartial]]) {
         
-        NSLog(@"[ICCCM] Strut property changed for window %u: %@", event->window, atomName);
+        NSLog(@"[ICCCM] Strut property changed for window %u: %@", event->window,
+              [atomService cachedNameFromAtom:event->atom]);
         
         if (event->state == XCB_PROPERTY_DELETE) {
             // Strut was removed
@@ -2640,6 +2680,18 @@
         utf8Atom = [atomService cacheAtom:[ewmhService UTF8_STRING]];
     }
 
+    // Titles are read on every PropertyNotify and redraw; the snapshot holds them until they change
+    XCBWindowSnapshot *snapshot = [connection snapshotForWindow:[window window]];
+    if ([snapshot containsAtom:propertyAtom]) {
+        xcb_get_property_reply_t *cached = [snapshot propertyForAtom:propertyAtom];
+        if (!cached || cached->type != utf8Atom || xcb_get_property_value_length(cached) <= 0) {
+            return nil;
+        }
+        return [[NSString alloc] initWithBytes:xcb_get_property_value(cached)
+                                        length:(NSUInteger)xcb_get_property_value_length(cached)
+                                      encoding:NSUTF8StringEncoding];
+    }
+
     xcb_get_property_cookie_t cookie = xcb_get_property([connection connection],
                                                          0,
                                                          [window window],
@@ -2695,23 +2747,7 @@
         return;
     }
 
-    XCBAtomService *atomService = [XCBAtomService sharedInstanceWithConnection:connection];
-    EWMHService *ewmhService = [EWMHService sharedInstanceWithConnection:connection];
-    ICCCMService *icccmService = [ICCCMService sharedInstanceWithConnection:connection];
-
-    NSString *atomName = [atomService atomNameFromAtom:event->atom];
-    if (!atomName) {
-        return;
-    }
-
-    BOOL isWmName = [atomName isEqualToString:[icccmService WMName]];
-    BOOL isNetWmName = [atomName isEqualToString:[ewmhService EWMHWMName]];
-    BOOL isNetWmVisibleName = [atomName isEqualToString:[ewmhService EWMHWMVisibleName]];
-
-    if (!isWmName && !isNetWmName && !isNetWmVisibleName) {
-        return;
-    }
-
+    // Only registered for WM_NAME, _NET_WM_NAME and _NET_WM_VISIBLE_NAME; see registerPropertyHandlers
     XCBWindow *eventWindow = [connection windowForXCBId:event->window];
     if (!eventWindow) {
         return;
@@ -2734,17 +2770,12 @@
         frame = (XCBFrame *)[eventWindow parentWindow];
         clientWindow = [frame childWindowForKey:ClientWindow];
     } else {
-        NSDictionary *windowsMap = [connection windowsMap];
-        for (NSString *mapWindowId in windowsMap) {
-            XCBWindow *mapWindow = [windowsMap objectForKey:mapWindowId];
-            if (mapWindow && [mapWindow isKindOfClass:[XCBFrame class]]) {
-                XCBFrame *testFrame = (XCBFrame *)mapWindow;
-                XCBWindow *testClient = [testFrame childWindowForKey:ClientWindow];
-                if (testClient && [testClient window] == event->window) {
-                    frame = testFrame;
-                    clientWindow = testClient;
-                    break;
-                }
+        for (XCBFrame *testFrame in [connection framesMap]) {
+            XCBWindow *testClient = [testFrame childWindowForKey:ClientWindow];
+            if (testClient && [testClient window] == event->window) {
+                frame = testFrame;
+                clientWindow = testClient;
+                break;
             }
         }
     }
@@ -2833,15 +2864,10 @@
     }
 
     // If the window is already gone, try to match against frames
-    NSDictionary *windowsMap = [connection windowsMap];
-    for (NSString *mapWindowId in windowsMap) {
-        XCBWindow *mapWindow = [windowsMap objectForKey:mapWindowId];
-        if (mapWindow && [mapWindow isKindOfClass:[XCBFrame class]]) {
-            XCBFrame *frame = (XCBFrame *)mapWindow;
-            XCBWindow *client = [frame childWindowForKey:ClientWindow];
-            if (client && [client window] == windowId) {
-                return windowId;
-            }
+    for (XCBFrame *frame in [connection framesMap]) {
+        XCBWindow *client = [frame childWindowForKey:ClientWindow];
+        if (client && [client window] == windowId) {
+            return windowId;
         }
     }
 
@@ -2859,15 +2885,10 @@
         return window;
     }
 
-    NSDictionary *windowsMap = [connection windowsMap];
-    for (NSString *mapWindowId in windowsMap) {
-        XCBWindow *mapWindow = [windowsMap objectForKey:mapWindowId];
-        if (mapWindow && [mapWindow isKindOfClass:[XCBFrame class]]) {
-            XCBFrame *frame = (XCBFrame *)mapWindow;
-            XCBWindow *client = [frame childWindowForKey:ClientWindow];
-            if (client && [client window] == clientId) {
-                return client;
-            }
+    for (XCBFrame *frame in [connection framesMap]) {
+        XCBWindow *client = [frame childWindowForKey:ClientWindow];
+        if (client && [client window] == clientId) {
+            return client;
         }
     }
 
@@ -2928,13 +2949,7 @@
 
 - (xcb_window_t)desktopWindowCandidateExcluding:(xcb_window_t)excludedId
 {
-    NSDictionary *windowsMap = [connection windowsMap];
-    for (NSString *mapWindowId in windowsMap) {
-        XCBWindow *mapWindow = [windowsMap objectForKey:mapWindowId];
-        if (!mapWindow) {
-            continue;
-        }
-
+    for (XCBWindow *mapWindow in [connection windowsMap]) {
         XCBWindow *clientWindow = [self clientWindowForWindow:mapWindow fallbackFrame:nil];
         if (!clientWindow) {
             continue;
@@ -2959,13 +2974,7 @@
 
 - (xcb_window_t)anyFocusableWindowExcluding:(xcb_window_t)excludedId
 {
-    NSDictionary *windowsMap = [connection windowsMap];
-    for (NSString *mapWindowId in windowsMap) {
-        XCBWindow *mapWindow = [windowsMap objectForKey:mapWindowId];
-        if (!mapWindow) {
-            continue;
-        }
-
+    for (XCBWindow *mapWindow in [connection windowsMap]) {
         XCBWindow *clientWindow = [self clientWindowForWindow:mapWindow fallbackFrame:nil];
         if (!clientWindow) {
             continue;
@@ -0,0 +1,47 @@
+//
+//  URSIconCache.h
+//  uroswm - Application Icon Cache
+//
+//  Application icons for the Alt-Tab switcher, pre-scaled to
+//  URSIconCacheIconSize. Icons are kept in memory keyed by WM_CLASS, so each
+//  application is resolved once per session. The window's own _NET_WM_ICON
+//  is the first choice; otherwise the icon named by the application's
+//  .desktop file (or GNUstep bundle) is used and its ARGB rendering is also
+//  written to ~/.cache/uroswm/icons for the next session.
+//
+//  The desktop-file index is built on a background queue and rebuilt when
+//  the modification time of one of the application directories changes.
+//  Lookups on the event thread never scan or parse .desktop files.
+//
+
+#import <Foundation/Foundation.h>
+#import <AppKit/AppKit.h>
+#import <XCBKit/XCBWindow.h>
+
+// Edge of the square icons handed to the switcher overlay (its kIconSize)
+#define URSIconCacheIconSize 48
+
+@interface URSIconCache : NSObject
+
+// Statistics
+@property (readonly, nonatomic) NSUInteger hits;
+@property (readonly, nonatomic) NSUInteger misses;
+@property (readonly, nonatomic) NSUInteger diskHits;
+
++ (instancetype)sharedCache;
+
+// Icon for a client window, URSIconCacheIconSize square. Never nil when a
+// generic application icon is available.
+- (NSImage *)iconForClientWindow:(XCBWindow *)clientWindow;
+
+// Drop the entry for the window's application (its _NET_WM_ICON changed)
+- (void)invalidateIconForClientWindow:(XCBWindow *)clientWindow;
+
+// Check the application directories' mtimes on the background queue and
+// rebuild the desktop-file index if one of them changed. Returns immediately.
+- (void)refreshDesktopIndexIfNeeded;
+
+// Drop all in-memory entries; the on-disk cache is kept
+- (void)removeAllEntries;
+
+@end
@@ -0,0 +1,643 @@
+//
+//  URSIconCache.m
+//  uroswm - Application Icon Cache
+//
+//  Implementation of the WM_CLASS keyed icon cache and desktop-file index.
+//
+
+#import "URSIconCache.h"
+#import "URSPixelOps.h"
+#import <XCBKit/XCBConnection.h>
+#import <XCBKit/services/EWMHService.h>
+#import <XCBKit/services/ICCCMService.h>
+#import <cairo/cairo.h>
+#import <dispatch/dispatch.h>
+#include <sys/stat.h>
+
+#define URS_ICON_CACHE_MAGIC 0x49535255   // "URSI"
+
+// On-disk entry: this header followed by size * size native-endian Cairo ARGB32 pixels
+typedef struct {
+    uint32_t magic;
+    uint32_t size;
+    int64_t sourceMTime;   // mtime of the icon file the pixels were rendered from
+} URSIconCacheFileHeader;
+
+// One application icon
+@interface URSIconCacheEntry : NSObject
+
+@property (strong, nonatomic) NSImage *icon;
+// From the window's _NET_WM_ICON; kept when the desktop-file index is rebuilt
+@property (assign, nonatomic) BOOL fromWindow;
+
+@end
+
+@implementation URSIconCacheEntry
+@end
+
+@interface URSIconCache () {
+    dispatch_queue_t scanQueue;
+    // Only touched on scanQueue
+    NSMutableDictionary *directoryMTimes;
+    // Published by scanQueue under @synchronized(self)
+    NSDictionary *desktopIndex;
+    NSUInteger indexGeneration;
+    // Generation the in-memory entries were resolved against (event thread)
+    NSUInteger entriesGeneration;
+}
+
+@property (strong, nonatomic) NSMutableDictionary *entries;
+@property (strong, nonatomic) NSImage *genericIcon;
+@property (strong, nonatomic) NSString *cacheDirectory;
+@property (assign, nonatomic) NSUInteger hits;
+@property (assign, nonatomic) NSUInteger misses;
+@property (assign, nonatomic) NSUInteger diskHits;
+
+@end
+
+#pragma mark - Pixel Helpers
+
+static int64_t URSIconCacheMTime(NSString *path) {
+    struct stat st;
+    if (!path || stat([path fileSystemRepresentation], &st) != 0) {
+        return -1;
+    }
+    return (int64_t)st.st_mtime;
+}
+
+// Render a premultiplied ARGB32 surface centred into a new size x size buffer,
+// keeping the aspect ratio. Returns a malloc'd buffer of size * size pixels.
+static uint32_t *URSIconCacheRenderSurface(cairo_surface_t *source, int size) {
+    int width = cairo_image_surface_get_width(source);
+    int height = cairo_image_surface_get_height(source);
+    if (width <= 0 || height <= 0) {
+        return NULL;
+    }
+
+    uint32_t *pixels = calloc((size_t)size * size, sizeof(uint32_t));
+    if (!pixels) {
+        return NULL;
+    }
+
+    cairo_surface_t *target = cairo_image_surface_create_for_data((unsigned char *)pixels,
+                                                                  CAIRO_FORMAT_ARGB32,
+                                                                  size, size, size * 4);
+    cairo_t *cr = cairo_create(target);
+
+    double scale = MIN((double)size / width, (double)size / height);
+    cairo_translate(cr, (size - width * scale) / 2.0, (size - height * scale) / 2.0);
+    cairo_scale(cr, scale, scale);
+    cairo_set_source_surface(cr, source, 0, 0);
+    cairo_pattern_set_filter(cairo_get_source(cr), CAIRO_FILTER_GOOD);
+    cairo_paint(cr);
+
+    cairo_destroy(cr);
+    cairo_surface_flush(target);
+    cairo_surface_destroy(target);
+
+    return pixels;
+}
+
+// Pick one image out of a _NET_WM_ICON reply: the smallest that is at least
+// size on both edges, otherwise the largest. Only that image is converted.
+static uint32_t *URSIconCacheRenderNetWMIcon(xcb_get_property_reply_t *reply, int size) {
+    if (!reply || reply->type != XCB_ATOM_CARDINAL || reply->format != 32) {
+        return NULL;
+    }
+
+    const uint32_t *data = (const uint32_t *)xcb_get_property_value(reply);
+    const uint32_t *end = data + xcb_get_property_value_length(reply) / 4;
+    const uint32_t *best = NULL;
+    uint32_t bestWidth = 0, bestHeight = 0;
+
+    while (end - data > 2) {
+        uint32_t width = data[0];
+        uint32_t height = data[1];
+        uint64_t length = (uint64_t)width * height;
+
+        if (width < 1 || height < 1 || length > (uint64_t)(end - data) - 2) {
+            break;
+        }
+
+        BOOL fits = width >= (uint32_t)size && height >= (uint32_t)size;
+        BOOL bestFits = best && bestWidth >= (uint32_t)size && bestHeight >= (uint32_t)size;
+        uint64_t bestLength = (uint64_t)bestWidth * bestHeight;
+
+        if (!best ||
+            (fits && (!bestFits || length < bestLength)) ||
+            (!fits && !bestFits && length > bestLength)) {
+            best = data + 2;
+            bestWidth = width;
+            bestHeight = height;
+        }
+
+        data += 2 + length;
+    }
+
+    if (!best || bestWidth > 4096 || bestHeight > 4096) {
+        return NULL;
+    }
+
+    // _NET_WM_ICON carries straight alpha; Cairo needs it premultiplied
+    size_t count = (size_t)bestWidth * bestHeight;
+    uint32_t *premultiplied = malloc(count * sizeof(uint32_t));
+    if (!premultiplied) {
+        return NULL;
+    }
+    memcpy(premultiplied, best, count * sizeof(uint32_t));
+    URSPixelPremultiply(premultiplied, count);
+
+    cairo_surface_t *source = cairo_image_surface_create_for_data((unsigned char *)premultiplied,
+                                                                  CAIRO_FORMAT_ARGB32,
+                                                                  (int)bestWidth, (int)bestHeight,
+                                                                  (int)bestWidth * 4);
+    uint32_t *pixels = URSIconCacheRenderSurface(source, size);
+    cairo_surface_destroy(source);
+    free(premultiplied);
+
+    return pixels;
+}
+
+@implementation URSIconCache
+
+static URSIconCache *sharedCache = nil;
+
+#pragma mark - Initialization
+
++ (instancetype)sharedCache {
+    if (sharedCache == nil) {
+        sharedCache = [[self alloc] init];
+    }
+    return sharedCache;
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _entries = [[NSMutableDictionary alloc] init];
+        scanQueue = dispatch_queue_create("org.uroswm.iconcache", DISPATCH_QUEUE_SERIAL);
+        directoryMTimes = [[NSMutableDictionary alloc] init];
+        desktopIndex = nil;
+        indexGeneration = 0;
+        entriesGeneration = 0;
+
+        NSString *cacheHome = [[[NSProcessInfo processInfo] environment] objectForKey:@"XDG_CACHE_HOME"];
+        if (!cacheHome || [cacheHome length] == 0) {
+            cacheHome = [NSHomeDirectory() stringByAppendingPathComponent:@".cache"];
+        }
+        _cacheDirectory = [cacheHome stringByAppendingPathComponent:@"uroswm/icons"];
+    }
+    return self;
+}
+
+#pragma mark - Lookup
+
+// Key of a client's icon: @[instance, Class] from WM_CLASS. Both are kept as
+// they are, since either may contain dots (org.gnome.Nautilus).
+- (NSArray *)keyForClientWindow:(XCBWindow *)clientWindow fetch:(BOOL)fetch {
+    NSMutableArray *windowClass = [clientWindow windowClass];
+
+    // wmClassForWindow: appends, so only ask once per window
+    if (fetch && windowClass && [windowClass count] < 2) {
+        ICCCMService *icccmService = [ICCCMService sharedInstanceWithConnection:[clientWindow connection]];
+        [icccmService wmClassForWindow:clientWindow];
+    }
+
+    if (!windowClass || [windowClass count] < 2) {
+        return nil;
+    }
+
+    // windowClass holds the class, then the instance
+    return @[[windowClass objectAtIndex:1], [windowClass objectAtIndex:0]];
+}
+
+- (NSImage *)iconForClientWindow:(XCBWindow *)clientWindow {
+    if (!clientWindow) {
+        return nil;
+    }
+
+    NSDictionary *index = nil;
+    NSUInteger generation = 0;
+    @synchronized(self) {
+        index = desktopIndex;
+        generation = indexGeneration;
+    }
+
+    // A rebuilt index may resolve applications that fell back to the generic icon
+    if (generation != entriesGeneration) {
+        for (NSArray *key in [self.entries allKeys]) {
+            if (![[self.entries objectForKey:key] fromWindow]) {
+                [self.entries removeObjectForKey:key];
+            }
+        }
+        entriesGeneration = generation;
+    }
+
+    NSArray *key = [self keyForClientWindow:clientWindow fetch:YES];
+    URSIconCacheEntry *entry = key ? [self.entries objectForKey:key] : nil;
+    if (entry) {
+        self.hits++;
+        return entry.icon;
+    }
+    self.misses++;
+
+    entry = [[URSIconCacheEntry alloc] init];
+
+    // First choice: the icon the window publishes itself
+    EWMHService *ewmhService = [EWMHService sharedInstanceWithConnection:[clientWindow connection]];
+    xcb_get_property_reply_t *reply = [ewmhService netWmIconFromWindow:clientWindow];
+    if (reply) {
+        uint32_t *pixels = URSIconCacheRenderNetWMIcon(reply, URSIconCacheIconSize);
+        free(reply);
+        if (pixels) {
+            entry.icon = [self imageFromPixels:pixels];
+            entry.fromWindow = YES;
+            free(pixels);
+        }
+    }
+
+    if (!entry.icon && key) {
+        entry.icon = [self applicationIconForKey:key index:index];
+    }
+
+    if (!entry.icon) {
+        entry.icon = [self genericApplicationIcon];
+    }
+
+    if (key && entry.icon) {
+        [self.entries setObject:entry forKey:key];
+    }
+
+    return entry.icon;
+}
+
+- (void)invalidateIconForClientWindow:(XCBWindow *)clientWindow {
+    NSArray *key = clientWindow ? [self keyForClientWindow:clientWindow fetch:NO] : nil;
+    if (key) {
+        [self.entries removeObjectForKey:key];
+    }
+}
+
+- (void)removeAllEntries {
+    if ([self.entries count] > 0) {
+        NSLog(@"[IconCache] Dropping %lu entries (hits: %lu, misses: %lu, disk hits: %lu)",
+              (unsigned long)[self.entries count], (unsigned long)self.hits,
+              (unsigned long)self.misses, (unsigned long)self.diskHits);
+    }
+    [self.entries removeAllObjects];
+}
+
+#pragma mark - Application Icons
+
+// Icon file (or GNUstep bundle) the index holds for @[instance, Class]
+- (NSString *)indexedPathForKey:(NSArray *)key index:(NSDictionary *)index {
+    if (!index) {
+        return nil;
+    }
+
+    NSString *instanceName = [key objectAtIndex:0];
+    NSString *className = [key objectAtIndex:1];
+
+    NSString *path = [index objectForKey:[className lowercaseString]];
+    if (!path) {
+        path = [index objectForKey:[instanceName lowercaseString]];
+    }
+    return path;
+}
+
+- (NSImage *)applicationIconForKey:(NSArray *)key index:(NSDictionary *)index {
+    NSString *path = [self indexedPathForKey:key index:index];
+    if (!path) {
+        return nil;
+    }
+
+    int64_t sourceMTime = URSIconCacheMTime(path);
+    if (sourceMTime < 0) {
+        return nil;
+    }
+
+    NSImage *icon = [self diskIconForKey:key sourceMTime:sourceMTime];
+    if (icon) {
+        self.diskHits++;
+        return icon;
+    }
+
+    uint32_t *pixels = NULL;
+
+    if ([[path pathExtension] isEqualToString:@"png"]) {
+        // PNGs decode through Cairo straight into premultiplied ARGB32
+        cairo_surface_t *source = cairo_image_surface_create_from_png([path fileSystemRepresentation]);
+        if (cairo_surface_status(source) == CAIRO_STATUS_SUCCESS) {
+            pixels = URSIconCacheRenderSurface(source, URSIconCacheIconSize);
+        }
+        cairo_surface_destroy(source);
+    } else {
+        pixels = [self renderImageAtPath:path];
+    }
+
+    if (!pixels) {
+        return nil;
+    }
+
+    icon = [self imageFromPixels:pixels];
+    [self writeDiskIconPixels:pixels forKey:key sourceMTime:sourceMTime];
+    free(pixels);
+
+    return icon;
+}
+
+// SVG, XPM and application bundles go through AppKit; must run on the event thread
+- (uint32_t *)renderImageAtPath:(NSString *)path {
+    NSImage *source = nil;
+    if ([[path pathExtension] isEqualToString:@"app"]) {
+        source = [[NSWorkspace sharedWorkspace] iconForFile:path];
+    } else {
+        source = [[NSImage alloc] initWithContentsOfFile:path];
+    }
+    if (!source) {
+        return NULL;
+    }
+
+    int size = URSIconCacheIconSize;
+    NSImage *canvas = [[NSImage alloc] initWithSize:NSMakeSize(size, size)];
+
+    [canvas lockFocus];
+    [[NSColor clearColor] set];
+    NSRectFill(NSMakeRect(0, 0, size, size));
+    [source drawInRect:NSMakeRect(0, 0, size, size)
+              fromRect:NSZeroRect
+             operation:NSCompositeSourceOver
+              fraction:1.0];
+    [canvas unlockFocus];
+
+    NSBitmapImageRep *bitmap = [NSBitmapImageRep imageRepWithData:[canvas TIFFRepresentation]];
+    if (!bitmap || [bitmap pixelsWide] != size || [bitmap pixelsHigh] != size ||
+        [bitmap bitsPerPixel] != 32) {
+        return NULL;
+    }
+
+    uint32_t *pixels = malloc((size_t)size * size * sizeof(uint32_t));
+    if (!pixels) {
+        return NULL;
+    }
+
+    for (int y = 0; y < size; y++) {
+        memcpy(pixels + (size_t)y * size, [bitmap bitmapData] + (size_t)y * [bitmap bytesPerRow], size * 4);
+    }
+
+    BOOL straightAlpha = ([bitmap bitmapFormat] & NSAlphaNonpremultipliedBitmapFormat) != 0;
+    URSPixelConvertRGBAToCairo((uint8_t *)pixels, size, size, size * 4, straightAlpha);
+
+    return pixels;
+}
+
+- (NSImage *)imageFromPixels:(const uint32_t *)pixels {
+    int size = URSIconCacheIconSize;
+    NSBitmapImageRep *bitmap = [[NSBitmapImageRep alloc]
+        initWithBitmapDataPlanes:NULL
+        pixelsWide:size
+        pixelsHigh:size
+        bitsPerSample:8
+        samplesPerPixel:4
+        hasAlpha:YES
+        isPlanar:NO
+        colorSpaceName:NSDeviceRGBColorSpace
+        bytesPerRow:size * 4
+        bitsPerPixel:32];
+
+    if (!bitmap) {
+        return nil;
+    }
+
+    // Cairo BGRA -> NSBitmapImageRep RGBA, both premultiplied
+    memcpy([bitmap bitmapData], pixels, (size_t)size * size * sizeof(uint32_t));
+    URSPixelSwizzleRB((uint32_t *)[bitmap bitmapData], (size_t)size * size);
+
+    NSImage *image = [[NSImage alloc] initWithSize:NSMakeSize(size, size)];
+    [image addRepresentation:bitmap];
+    return image;
+}
+
+- (NSImage *)genericApplicationIcon {
+    if (!self.genericIcon) {
+        NSWorkspace *workspace = [NSWorkspace sharedWorkspace];
+        NSString *genericAppPath = [workspace fullPathForApplication:@"GNUstep"];
+        if (genericAppPath) {
+            NSImage *icon = [workspace iconForFile:genericAppPath];
+            [icon setSize:NSMakeSize(URSIconCacheIconSize, URSIconCacheIconSize)];
+            self.genericIcon = icon;
+        }
+    }
+    return self.genericIcon;
+}
+
+#pragma mark - Disk Cache
+
+- (NSString *)diskPathForKey:(NSArray *)key {
+    // "instance|Class": a dot in either part cannot make two keys share a file
+    NSString *name = [[key componentsJoinedByString:@"|"] stringByReplacingOccurrencesOfString:@"/" withString:@"_"];
+    return [self.cacheDirectory stringByAppendingPathComponent:[name stringByAppendingPathExtension:@"argb"]];
+}
+
+- (NSImage *)diskIconForKey:(NSArray *)key sourceMTime:(int64_t)sourceMTime {
+    NSData *data = [NSData dataWithContentsOfFile:[self diskPathForKey:key]];
+    size_t pixelBytes = (size_t)URSIconCacheIconSize * URSIconCacheIconSize * sizeof(uint32_t);
+
+    if (!data || [data length] != sizeof(URSIconCacheFileHeader) + pixelBytes) {
+        return nil;
+    }
+
+    URSIconCacheFileHeader header;
+    memcpy(&header, [data bytes], sizeof(header));
+    if (header.magic != URS_ICON_CACHE_MAGIC || header.size != URSIconCacheIconSize ||
+        header.sourceMTime != sourceMTime) {
+        return nil;
+    }
+
+    return [self imageFromPixels:(const uint32_t *)((const uint8_t *)[data bytes] + sizeof(header))];
+}
+
+- (void)writeDiskIconPixels:(const uint32_t *)pixels forKey:(NSArray *)key sourceMTime:(int64_t)sourceMTime {
+    URSIconCacheFileHeader header = { URS_ICON_CACHE_MAGIC, URSIconCacheIconSize, sourceMTime };
+    NSMutableData *data = [NSMutableData dataWithBytes:&header length:sizeof(header)];
+    [data appendBytes:pixels length:(size_t)URSIconCacheIconSize * URSIconCacheIconSize * sizeof(uint32_t)];
+
+    NSString *directory = self.cacheDirectory;
+    NSString *path = [self diskPathForKey:key];
+
+    dispatch_async(scanQueue, ^{
+        NSFileManager *fileManager = [[NSFileManager alloc] init];
+        [fileManager createDirectoryAtPath:directory withIntermediateDirectories:YES attributes:nil error:NULL];
+        if (![data writeToFile:path atomically:YES]) {
+            NSLog(@"[IconCache] Could not write %@", path);
+        }
+    });
+}
+
+#pragma mark - Desktop File Index
+
+- (NSArray *)applicationDirectories {
+    NSMutableArray *directories = [NSMutableArray array];
+
+    NSString *dataHome = [[[NSProcessInfo processInfo] environment] objectForKey:@"XDG_DATA_HOME"];
+    if (!dataHome || [dataHome length] == 0) {
+        dataHome = [NSHomeDirectory() stringByAppendingPathComponent:@".local/share"];
+    }
+    [directories addObject:[dataHome stringByAppendingPathComponent:@"applications"]];
+    [directories addObject:@"/usr/local/share/applications"];
+    [directories addObject:@"/usr/share/applications"];
+
+    // GNUstep application bundles
+    [directories addObjectsFromArray:NSSearchPathForDirectoriesInDomains(NSApplicationDirectory,
+                                                                         NSAllDomainsMask, YES)];
+    return directories;
+}
+
+- (void)refreshDesktopIndexIfNeeded {
+    dispatch_async(scanQueue, ^{
+        BOOL changed = NO;
+        NSArray *directories = [self applicationDirectories];
+
+        for (NSString *directory in directories) {
+            NSNumber *mtime = [NSNumber numberWithLongLong:URSIconCacheMTime(directory)];
+            if (![[directoryMTimes objectForKey:directory] isEqual:mtime]) {
+                [directoryMTimes setObject:mtime forKey:directory];
+                changed = YES;
+            }
+        }
+
+        if (changed) {
+            [self rebuildDesktopIndexFromDirectories:directories];
+        }
+    });
+}
+
+// Runs on scanQueue
+- (void)rebuildDesktopIndexFromDirectories:(NSArray *)directories {
+    NSDate *start = [NSDate date];
+    NSFileManager *fileManager = [[NSFileManager alloc] init];
+    NSMutableDictionary *index = [NSMutableDictionary dictionary];
+
+    // Earlier directories win, so user entries shadow system ones
+    for (NSString *directory in directories) {
+        NSArray *names = [fileManager contentsOfDirectoryAtPath:directory error:NULL];
+        for (NSString *name in names) {
+            NSString *path = [directory stringByAppendingPathComponent:name];
+            NSString *extension = [name pathExtension];
+
+            if ([extension isEqualToString:@"desktop"]) {
+                [self indexDesktopFile:path into:index fileManager:fileManager];
+            } else if ([extension isEqualToString:@"app"]) {
+                NSString *appKey = [[name stringByDeletingPathExtension] lowercaseString];
+                if (![index objectForKey:appKey]) {
+                    [index setObject:path forKey:appKey];
+                }
+            }
+        }
+    }
+
+    @synchronized(self) {
+        desktopIndex = [index copy];
+        indexGeneration++;
+    }
+
+    NSLog(@"[IconCache] Indexed %lu application names in %.1f ms",
+          (unsigned long)[index count], -[start timeIntervalSinceNow] * 1000.0);
+}
+
+- (void)indexDesktopFile:(NSString *)path into:(NSMutableDictionary *)index fileManager:(NSFileManager *)fileManager {
+    NSString *content = [NSString stringWithContentsOfFile:path encoding:NSUTF8StringEncoding error:NULL];
+    if (!content) {
+        return;
+    }
+
+    NSString *iconName = nil;
+    NSString *wmClass = nil;
+    NSString *exec = nil;
+    BOOL inDesktopEntry = NO;
+
+    for (NSString *rawLine in [content componentsSeparatedByString:@"\n"]) {
+        NSString *line = [rawLine stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+
+        if ([line hasPrefix:@"["]) {
+            inDesktopEntry = [line isEqualToString:@"[Desktop Entry]"];
+            continue;
+        }
+        if (!inDesktopEntry) {
+            continue;
+        }
+
+        if ([line hasPrefix:@"Icon="]) {
+            iconName = [line substringFromIndex:5];
+        } else if ([line hasPrefix:@"StartupWMClass="]) {
+            wmClass = [line substringFromIndex:15];
+        } else if ([line hasPrefix:@"Exec="]) {
+            exec = [line substringFromIndex:5];
+        }
+    }
+
+    NSString *iconPath = [self resolveIconName:iconName fileManager:fileManager];
+    if (!iconPath) {
+        return;
+    }
+
+    NSMutableArray *names = [NSMutableArray array];
+    if ([wmClass length] > 0) {
+        [names addObject:wmClass];
+    }
+
+    // "org.gnome.Nautilus.desktop" is found as both the full name and "nautilus"
+    NSString *baseName = [[path lastPathComponent] stringByDeletingPathExtension];
+    [names addObject:baseName];
+    [names addObject:[baseName pathExtension]];
+
+    NSArray *execWords = [exec componentsSeparatedByString:@" "];
+    if ([execWords count] > 0) {
+        [names addObject:[[execWords objectAtIndex:0] lastPathComponent]];
+    }
+
+    for (NSString *name in names) {
+        NSString *nameKey = [name lowercaseString];
+        if ([nameKey length] > 0 && ![index objectForKey:nameKey]) {
+            [index setObject:iconPath forKey:nameKey];
+        }
+    }
+}
+
+- (NSString *)resolveIconName:(NSString *)iconName fileManager:(NSFileManager *)fileManager {
+    if ([iconName length] == 0) {
+        return nil;
+    }
+
+    if ([iconName hasPrefix:@"/"]) {
+        return [fileManager fileExistsAtPath:iconName] ? iconName : nil;
+    }
+
+    // Some entries name the file ("foo.png") rather than the icon
+    NSString *extension = [iconName pathExtension];
+    if ([extension isEqualToString:@"png"] || [extension isEqualToString:@"svg"] ||
+        [extension isEqualToString:@"xpm"]) {
+        iconName = [iconName stringByDeletingPathExtension];
+    }
+
+    // Closest to the switcher size first, then larger renderings
+    NSArray *candidates = @[
+        [NSString stringWithFormat:@"/usr/share/icons/hicolor/48x48/apps/%@.png", iconName],
+        [NSString stringWithFormat:@"/usr/share/pixmaps/%@.png", iconName],
+        [NSString stringWithFormat:@"/usr/share/icons/hicolor/64x64/apps/%@.png", iconName],
+        [NSString stringWithFormat:@"/usr/share/icons/hicolor/128x128/apps/%@.png", iconName],
+        [NSString stringWithFormat:@"/usr/share/icons/hicolor/scalable/apps/%@.svg", iconName],
+        [NSString stringWithFormat:@"/usr/share/icons/hicolor/256x256/apps/%@.png", iconName],
+        [NSString stringWithFormat:@"/usr/share/pixmaps/%@.svg", iconName],
+        [NSString stringWithFormat:@"/usr/share/pixmaps/%@.xpm", iconName]
+    ];
+
+    for (NSString *candidate in candidates) {
+        if ([fileManager fileExistsAtPath:candidate]) {
+            return candidate;
+        }
+    }
+    return nil;
+}
+
+@end
@@ -0,0 +1,63 @@
+//
+//  URSKeyBindings.h
+//  uroswm - Global Key Bindings
+//
+//  Global shortcuts loaded from the URSKeyBindings default, a dictionary of
+//  "Modifier+...+KeysymName" strings to action names merged over the
+//  built-in bindings:
+//
+//    defaults write WindowManager URSKeyBindings \
+//        '{ "Super+Left" = "tile-left"; "Control+Alt+c" = "center"; "Super+Up" = none; }'
+//
+//  Bindings are compiled against the current keyboard mapping into a flat
+//  table indexed by (keycode, modifier mask), so a key press is resolved
+//  with one array read. Every binding is grabbed with the CapsLock and
+//  NumLock variants so it fires whatever the lock state. The table is
+//  rebuilt on MappingNotify.
+//
+
+#import <Foundation/Foundation.h>
+#import <xcb/xcb.h>
+#import <XCBKit/XCBConnection.h>
+#import "URSKeyboardState.h"
+
+typedef enum {
+    URSKeyActionNone = 0,
+    URSKeyActionSwitchForward,
+    URSKeyActionSwitchBackward,
+    URSKeyActionCenter,
+    URSKeyActionMaximize,
+    URSKeyActionTileLeft,
+    URSKeyActionTileRight,
+    URSKeyActionTileTopLeft,
+    URSKeyActionTileTopRight,
+    URSKeyActionTileBottomLeft,
+    URSKeyActionTileBottomRight,
+    URSKeyActionCount
+} URSKeyAction;
+
+@interface URSKeyBindings : NSObject
+
+// Bindings in the compiled table (each may cover several keycodes)
+@property (readonly, nonatomic) NSUInteger bindingsCount;
+
+- (instancetype)initWithConnection:(XCBConnection *)aConnection;
+
+// Parse the bindings and build the lookup table for the current mapping.
+// Ungrab first when bindings are already grabbed.
+- (void)compileWithKeyboardState:(URSKeyboardState *)keyboardState;
+
+// Passive grabs for every compiled binding and lock-modifier variant
+- (void)grabKeysOnWindow:(xcb_window_t)root;
+- (void)ungrabKeysOnWindow:(xcb_window_t)root;
+
+// O(1): lock modifiers and the pointer button bits in state are ignored
+- (URSKeyAction)actionForKeycode:(xcb_keycode_t)keycode state:(uint16_t)state;
+
+// Modifier bits that select bindings (state without lock modifiers and buttons)
+- (uint16_t)bindingModifiersFromState:(uint16_t)state;
+
+// "tile-left" etc.; nil for URSKeyActionNone
++ (NSString *)nameForAction:(URSKeyAction)action;
+
+@end
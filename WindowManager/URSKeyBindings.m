@@ -0,0 +1,266 @@
+//
+//  URSKeyBindings.m
+//  uroswm - Global Key Bindings
+//
+//  Implementation of the binding parser and the compiled action table.
+//
+
+#import "URSKeyBindings.h"
+#import <X11/Xlib.h>
+#import <X11/keysym.h>
+
+// One slot per (keycode, low eight modifier bits)
+#define URS_KEY_TABLE_SIZE (256 * 256)
+#define URS_KEY_TABLE_INDEX(keycode, mods) (((keycode) << 8) | ((mods) & 0xFF))
+
+typedef struct {
+    xcb_keycode_t keycode;
+    uint16_t modifiers;
+} URSKeyGrab;
+
+@interface URSKeyBindings () {
+    xcb_connection_t *conn;
+    uint8_t *actionTable;       // URS_KEY_TABLE_SIZE URSKeyAction values
+    uint16_t ignoredModifiers;  // CapsLock and NumLock
+    URSKeyGrab *grabs;
+    NSUInteger grabsCount;
+    NSUInteger grabsCapacity;
+    BOOL grabbed;
+}
+
+@property (assign, nonatomic) NSUInteger bindingsCount;
+
+@end
+
+@implementation URSKeyBindings
+
+static NSString *const URSKeyActionNames[URSKeyActionCount] = {
+    nil,
+    @"switch-forward",
+    @"switch-backward",
+    @"center",
+    @"maximize",
+    @"tile-left",
+    @"tile-right",
+    @"tile-top-left",
+    @"tile-top-right",
+    @"tile-bottom-left",
+    @"tile-bottom-right"
+};
+
+#pragma mark - Initialization
+
+- (instancetype)initWithConnection:(XCBConnection *)aConnection {
+    self = [super init];
+    if (self) {
+        conn = [aConnection connection];
+        actionTable = calloc(URS_KEY_TABLE_SIZE, sizeof(uint8_t));
+        ignoredModifiers = XCB_MOD_MASK_LOCK;
+        grabs = NULL;
+        grabsCount = 0;
+        grabsCapacity = 0;
+        grabbed = NO;
+        _bindingsCount = 0;
+    }
+    return self;
+}
+
++ (NSString *)nameForAction:(URSKeyAction)action {
+    return (action > URSKeyActionNone && action < URSKeyActionCount) ? URSKeyActionNames[action] : nil;
+}
+
++ (URSKeyAction)actionForName:(NSString *)name {
+    for (int action = URSKeyActionNone + 1; action < URSKeyActionCount; action++) {
+        if ([URSKeyActionNames[action] isEqualToString:name]) {
+            return (URSKeyAction)action;
+        }
+    }
+    return URSKeyActionNone;
+}
+
+// Built-in bindings; the URSKeyBindings default adds to or overrides them
++ (NSDictionary *)defaultBindings {
+    return @{
+        @"Alt+Tab": @"switch-forward",
+        @"Alt+Shift+Tab": @"switch-backward",
+        @"Super+Left": @"tile-left",
+        @"Super+Right": @"tile-right",
+        @"Super+Up": @"maximize",
+        @"Super+Down": @"center"
+    };
+}
+
+#pragma mark - Compilation
+
+- (uint16_t)maskForModifierName:(NSString *)name keyboardState:(URSKeyboardState *)keyboardState {
+    NSString *lower = [name lowercaseString];
+
+    if ([lower isEqualToString:@"shift"]) {
+        return XCB_MOD_MASK_SHIFT;
+    } else if ([lower isEqualToString:@"control"] || [lower isEqualToString:@"ctrl"]) {
+        return XCB_MOD_MASK_CONTROL;
+    } else if ([lower isEqualToString:@"alt"] || [lower isEqualToString:@"meta"]) {
+        return keyboardState.altMask;
+    } else if ([lower isEqualToString:@"super"] || [lower isEqualToString:@"win"]) {
+        uint16_t mask = [keyboardState modifierMaskForKeysym:XK_Super_L];
+        return mask ? mask : XCB_MOD_MASK_4;
+    } else if ([lower hasPrefix:@"mod"] && [lower length] == 4) {
+        int index = [lower characterAtIndex:3] - '1';
+        if (index >= 0 && index < 5) {
+            return (uint16_t)(XCB_MOD_MASK_1 << index);
+        }
+    }
+    return 0;
+}
+
+- (void)addGrabForKeycode:(xcb_keycode_t)keycode modifiers:(uint16_t)modifiers {
+    if (grabsCount == grabsCapacity) {
+        NSUInteger capacity = grabsCapacity ? grabsCapacity * 2 : 32;
+        URSKeyGrab *resized = realloc(grabs, capacity * sizeof(URSKeyGrab));
+        if (!resized) {
+            return;
+        }
+        grabs = resized;
+        grabsCapacity = capacity;
+    }
+    grabs[grabsCount].keycode = keycode;
+    grabs[grabsCount].modifiers = modifiers;
+    grabsCount++;
+}
+
+- (void)compileWithKeyboardState:(URSKeyboardState *)keyboardState {
+    if (!actionTable || !keyboardState) {
+        return;
+    }
+
+    memset(actionTable, URSKeyActionNone, URS_KEY_TABLE_SIZE);
+    grabsCount = 0;
+    self.bindingsCount = 0;
+    ignoredModifiers = XCB_MOD_MASK_LOCK | keyboardState.numLockMask;
+
+    NSMutableDictionary *bindings = [NSMutableDictionary dictionaryWithDictionary:[URSKeyBindings defaultBindings]];
+    id userBindings = [[NSUserDefaults standardUserDefaults] objectForKey:@"URSKeyBindings"];
+    if ([userBindings isKindOfClass:[NSDictionary class]]) {
+        [bindings addEntriesFromDictionary:userBindings];
+    }
+
+    for (NSString *binding in bindings) {
+        NSString *actionName = [bindings objectForKey:binding];
+        if (![actionName isKindOfClass:[NSString class]] || [actionName isEqualToString:@"none"]) {
+            continue;
+        }
+
+        URSKeyAction action = [URSKeyBindings actionForName:actionName];
+        if (action == URSKeyActionNone) {
+            NSLog(@"[KeyBindings] Unknown action \"%@\" for %@", actionName, binding);
+            continue;
+        }
+
+        NSArray *parts = [binding componentsSeparatedByString:@"+"];
+        NSString *keyName = [parts lastObject];
+        uint16_t modifiers = 0;
+        BOOL valid = [keyName length] > 0;
+
+        for (NSUInteger i = 0; valid && i + 1 < [parts count]; i++) {
+            uint16_t mask = [self maskForModifierName:[parts objectAtIndex:i] keyboardState:keyboardState];
+            if (!mask) {
+                NSLog(@"[KeyBindings] Unknown modifier \"%@\" in %@", [parts objectAtIndex:i], binding);
+                valid = NO;
+            }
+            modifiers |= mask;
+        }
+
+        // The switcher stays open while the binding's modifiers are held
+        if (valid && (action == URSKeyActionSwitchForward || action == URSKeyActionSwitchBackward) &&
+            (modifiers & ~XCB_MOD_MASK_SHIFT) == 0) {
+            NSLog(@"[KeyBindings] %@ needs a modifier other than Shift for %@", binding, actionName);
+            valid = NO;
+        }
+
+        if (!valid) {
+            continue;
+        }
+
+        xcb_keysym_t keysym = XStringToKeysym([keyName UTF8String]);
+        if (keysym == NoSymbol) {
+            keysym = XStringToKeysym([[keyName capitalizedString] UTF8String]);
+        }
+
+        NSArray *keycodes = keysym != NoSymbol ? [keyboardState keycodesForKeysym:keysym] : nil;
+        if ([keycodes count] == 0) {
+            NSLog(@"[KeyBindings] No key produces \"%@\" in the current mapping (%@)", keyName, binding);
+            continue;
+        }
+
+        for (NSNumber *number in keycodes) {
+            xcb_keycode_t keycode = [number unsignedCharValue];
+            uint8_t *slot = &actionTable[URS_KEY_TABLE_INDEX(keycode, modifiers)];
+
+            if (*slot != URSKeyActionNone && *slot != action) {
+                NSLog(@"[KeyBindings] %@ replaces %@ on keycode %d", actionName,
+                      [URSKeyBindings nameForAction:(URSKeyAction)*slot], keycode);
+            } else if (*slot == URSKeyActionNone) {
+                [self addGrabForKeycode:keycode modifiers:modifiers];
+            }
+            *slot = (uint8_t)action;
+        }
+
+        self.bindingsCount++;
+    }
+
+    NSLog(@"[KeyBindings] Compiled %lu bindings into %lu key grabs",
+          (unsigned long)self.bindingsCount, (unsigned long)grabsCount);
+}
+
+#pragma mark - Grabs
+
+- (void)grabKeysOnWindow:(xcb_window_t)root {
+    // Every combination of the lock modifiers, so bindings fire with CapsLock or NumLock on
+    uint16_t numLock = ignoredModifiers & ~XCB_MOD_MASK_LOCK;
+    uint16_t variants[4] = { 0, XCB_MOD_MASK_LOCK, numLock, XCB_MOD_MASK_LOCK | numLock };
+    int variantsCount = numLock ? 4 : 2;
+
+    for (NSUInteger i = 0; i < grabsCount; i++) {
+        for (int v = 0; v < variantsCount; v++) {
+            xcb_grab_key(conn, 0, root, grabs[i].modifiers | variants[v], grabs[i].keycode,
+                         XCB_GRAB_MODE_ASYNC, XCB_GRAB_MODE_ASYNC);
+        }
+    }
+    grabbed = YES;
+}
+
+- (void)ungrabKeysOnWindow:(xcb_window_t)root {
+    if (!grabbed) {
+        return;
+    }
+
+    uint16_t numLock = ignoredModifiers & ~XCB_MOD_MASK_LOCK;
+    uint16_t variants[4] = { 0, XCB_MOD_MASK_LOCK, numLock, XCB_MOD_MASK_LOCK | numLock };
+    int variantsCount = numLock ? 4 : 2;
+
+    for (NSUInteger i = 0; i < grabsCount; i++) {
+        for (int v = 0; v < variantsCount; v++) {
+            xcb_ungrab_key(conn, grabs[i].keycode, root, grabs[i].modifiers | variants[v]);
+        }
+    }
+    grabbed = NO;
+}
+
+#pragma mark - Lookup
+
+- (uint16_t)bindingModifiersFromState:(uint16_t)state {
+    return state & 0xFF & ~ignoredModifiers;
+}
+
+- (URSKeyAction)actionForKeycode:(xcb_keycode_t)keycode state:(uint16_t)state {
+    return (URSKeyAction)actionTable[URS_KEY_TABLE_INDEX(keycode, [self bindingModifiersFromState:state])];
+}
+
+- (void)dealloc {
+    free(actionTable);
+    free(grabs);
+    actionTable = NULL;
+    grabs = NULL;
+}
+
+@end
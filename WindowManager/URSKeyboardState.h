@@ -0,0 +1,69 @@
+//
+//  URSKeyboardState.h
+//  uroswm - Keyboard Mapping and Modifier State
+//
+//  Keeps the keycode <-> keysym tables and the modifier mapping in memory,
+//  built from GetKeyboardMapping/GetModifierMapping once and again on each
+//  MappingNotify (XkbMapNotify/XkbNewKeyboardNotify when XKB is in use).
+//  When the XKB extension is present the server's modifier state (base,
+//  latched, locked, effective) is tracked from XkbStateNotify events, so a
+//  modifier release is seen as an event instead of being polled with
+//  QueryKeymap.
+//
+
+#import <Foundation/Foundation.h>
+#import <xcb/xcb.h>
+#import <XCBKit/XCBConnection.h>
+
+typedef enum {
+    URSKeyboardEventNone = 0,    // not a keyboard state/mapping event
+    URSKeyboardEventState,       // modifier state changed
+    URSKeyboardEventMapping      // keyboard or modifier mapping reloaded
+} URSKeyboardEvent;
+
+@interface URSKeyboardState : NSObject
+
+// YES when XkbStateNotify is selected; otherwise the modifier fields stay 0
+@property (readonly, nonatomic) BOOL xkbAvailable;
+
+// Modifier masks from the last XkbStateNotify (or the initial GetState)
+@property (readonly, nonatomic) uint16_t baseModifiers;
+@property (readonly, nonatomic) uint16_t latchedModifiers;
+@property (readonly, nonatomic) uint16_t lockedModifiers;
+@property (readonly, nonatomic) uint16_t effectiveModifiers;
+
+// Modifier bit the Alt keys are mapped to (XCB_MOD_MASK_1 unless remapped)
+@property (readonly, nonatomic) uint16_t altMask;
+// Modifier bit Num_Lock is mapped to, 0 when unmapped
+@property (readonly, nonatomic) uint16_t numLockMask;
+
+- (instancetype)initWithConnection:(XCBConnection *)aConnection;
+
+// Reload the keycode/keysym tables and the modifier mapping (two requests, one wait)
+- (void)refreshKeyboardMapping;
+
+// Keysym in a column of the mapping (0 = unshifted), NoSymbol when unmapped
+- (xcb_keysym_t)keysymForKeycode:(xcb_keycode_t)keycode column:(int)column;
+
+// Keycodes (NSNumbers) that produce keysym in any column; empty when unmapped
+- (NSArray *)keycodesForKeysym:(xcb_keysym_t)keysym;
+
+// Modifier bit the keysym's key is mapped to (e.g. Super_L -> Mod4), 0 when none
+- (uint16_t)modifierMaskForKeysym:(xcb_keysym_t)keysym;
+
+// Keycodes (NSNumbers) in the modifier mapping rows selected by mask
+- (NSArray *)keycodesForModifierMask:(uint16_t)mask;
+
+// YES for keys bound to the Alt modifier (Alt_L/Alt_R/Meta or the altMask row)
+- (BOOL)isAltKeycode:(xcb_keycode_t)keycode;
+- (NSArray *)altKeycodes;
+
+// Any modifier in mask physically held or latched; locks do not count. Only valid with XKB.
+- (BOOL)modifiersHeld:(uint16_t)mask;
+- (BOOL)altHeld;
+
+// Consume XkbStateNotify, XkbMapNotify, XkbNewKeyboardNotify and core
+// MappingNotify; any other event returns None
+- (URSKeyboardEvent)handleEvent:(xcb_generic_event_t *)event;
+
+@end
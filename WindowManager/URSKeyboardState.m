@@ -0,0 +1,319 @@
+//
+//  URSKeyboardState.m
+//  uroswm - Keyboard Mapping and Modifier State
+//
+//  Implementation of the keysym tables and XKB modifier tracking.
+//
+
+#import "URSKeyboardState.h"
+#import <xcb/xkb.h>
+#import <X11/keysym.h>
+
+#define URS_XKB_STATE_DETAILS (XCB_XKB_STATE_PART_MODIFIER_STATE | \
+                               XCB_XKB_STATE_PART_MODIFIER_BASE | \
+                               XCB_XKB_STATE_PART_MODIFIER_LATCH | \
+                               XCB_XKB_STATE_PART_MODIFIER_LOCK)
+
+// Map changes that touch the keycode <-> keysym tables or the modifier mapping
+#define URS_XKB_MAP_DETAILS (XCB_XKB_MAP_PART_KEY_TYPES | \
+                             XCB_XKB_MAP_PART_KEY_SYMS | \
+                             XCB_XKB_MAP_PART_MODIFIER_MAP)
+
+@interface URSKeyboardState () {
+    xcb_connection_t *conn;
+    uint8_t xkbEventBase;
+
+    // GetKeyboardMapping reply: keysymsPerKeycode columns per keycode from minKeycode
+    xcb_get_keyboard_mapping_reply_t *mappingReply;
+    xcb_keycode_t minKeycode;
+    uint8_t keysymsPerKeycode;
+    int keycodesCount;
+
+    // GetModifierMapping reply: eight rows (Shift, Lock, Control, Mod1..Mod5)
+    xcb_get_modifier_mapping_reply_t *modifierReply;
+}
+
+@property (strong, nonatomic) NSMutableDictionary *keycodesByKeysym;   // keysym -> NSArray of keycodes
+@property (strong, nonatomic) NSMutableSet *altKeycodeSet;
+@property (assign, nonatomic) BOOL xkbAvailable;
+@property (assign, nonatomic) uint16_t baseModifiers;
+@property (assign, nonatomic) uint16_t latchedModifiers;
+@property (assign, nonatomic) uint16_t lockedModifiers;
+@property (assign, nonatomic) uint16_t effectiveModifiers;
+@property (assign, nonatomic) uint16_t altMask;
+@property (assign, nonatomic) uint16_t numLockMask;
+
+@end
+
+@implementation URSKeyboardState
+
+#pragma mark - Initialization
+
+- (instancetype)initWithConnection:(XCBConnection *)aConnection {
+    self = [super init];
+    if (self) {
+        conn = [aConnection connection];
+        mappingReply = NULL;
+        modifierReply = NULL;
+        _keycodesByKeysym = [[NSMutableDictionary alloc] init];
+        _altKeycodeSet = [[NSMutableSet alloc] init];
+        _altMask = XCB_MOD_MASK_1;
+        _xkbAvailable = NO;
+
+        [self refreshKeyboardMapping];
+        [self selectXkbStateEvents];
+    }
+    return self;
+}
+
+- (void)selectXkbStateEvents {
+    const xcb_query_extension_reply_t *extension = xcb_get_extension_data(conn, &xcb_xkb_id);
+    if (!extension || !extension->present) {
+        NSLog(@"[Keyboard] XKB not available; Alt release falls back to QueryKeymap");
+        return;
+    }
+
+    xcb_xkb_use_extension_reply_t *useReply =
+        xcb_xkb_use_extension_reply(conn,
+                                    xcb_xkb_use_extension(conn, XCB_XKB_MAJOR_VERSION, XCB_XKB_MINOR_VERSION),
+                                    NULL);
+    if (!useReply || !useReply->supported) {
+        NSLog(@"[Keyboard] XKB %d.%d not supported by the server", XCB_XKB_MAJOR_VERSION, XCB_XKB_MINOR_VERSION);
+        free(useReply);
+        return;
+    }
+    free(useReply);
+
+    // Only modifier changes wake us up, not group or pointer button changes.
+    // Once XKB is in use the server no longer sends the core MappingNotify for
+    // keyboard changes (setxkbmap, layout switch, new keyboard), so those are
+    // selected here and reload the tables like MappingNotify does.
+    xcb_xkb_select_events_details_t details;
+    memset(&details, 0, sizeof(details));
+    details.affectNewKeyboard = XCB_XKB_NKN_DETAIL_KEYCODES;
+    details.newKeyboardDetails = XCB_XKB_NKN_DETAIL_KEYCODES;
+    details.affectState = URS_XKB_STATE_DETAILS;
+    details.stateDetails = URS_XKB_STATE_DETAILS;
+
+    uint16_t events = XCB_XKB_EVENT_TYPE_NEW_KEYBOARD_NOTIFY |
+                      XCB_XKB_EVENT_TYPE_MAP_NOTIFY |
+                      XCB_XKB_EVENT_TYPE_STATE_NOTIFY;
+
+    xcb_xkb_select_events_aux(conn,
+                              XCB_XKB_ID_USE_CORE_KBD,
+                              events,                            // affectWhich
+                              0,                                 // clear
+                              0,                                 // selectAll
+                              URS_XKB_MAP_DETAILS,               // affectMap
+                              URS_XKB_MAP_DETAILS,               // map
+                              &details);
+
+    // Seed the state; later changes arrive as XkbStateNotify
+    xcb_xkb_get_state_reply_t *state = xcb_xkb_get_state_reply(conn,
+                                                               xcb_xkb_get_state(conn, XCB_XKB_ID_USE_CORE_KBD),
+                                                               NULL);
+    if (state) {
+        self.baseModifiers = state->baseMods;
+        self.latchedModifiers = state->latchedMods;
+        self.lockedModifiers = state->lockedMods;
+        self.effectiveModifiers = state->mods;
+        free(state);
+    }
+
+    xkbEventBase = extension->first_event;
+    self.xkbAvailable = YES;
+    NSLog(@"[Keyboard] Tracking modifier state through XkbStateNotify");
+}
+
+#pragma mark - Keyboard Mapping
+
+- (void)refreshKeyboardMapping {
+    const xcb_setup_t *setup = xcb_get_setup(conn);
+    xcb_keycode_t first = setup->min_keycode;
+    int count = setup->max_keycode - setup->min_keycode + 1;
+
+    // Both requests go out before either reply is read
+    xcb_get_keyboard_mapping_cookie_t mappingCookie = xcb_get_keyboard_mapping(conn, first, count);
+    xcb_get_modifier_mapping_cookie_t modifierCookie = xcb_get_modifier_mapping(conn);
+
+    xcb_get_keyboard_mapping_reply_t *reply = xcb_get_keyboard_mapping_reply(conn, mappingCookie, NULL);
+    xcb_get_modifier_mapping_reply_t *modifiers = xcb_get_modifier_mapping_reply(conn, modifierCookie, NULL);
+
+    if (!reply) {
+        NSLog(@"[Keyboard] ERROR: Failed to get keyboard mapping");
+        free(modifiers);
+        return;
+    }
+
+    free(mappingReply);
+    mappingReply = reply;
+    minKeycode = first;
+    keysymsPerKeycode = reply->keysyms_per_keycode;
+    keycodesCount = keysymsPerKeycode > 0 ? xcb_get_keyboard_mapping_keysyms_length(reply) / keysymsPerKeycode : 0;
+
+    [self.keycodesByKeysym removeAllObjects];
+    xcb_keysym_t *keysyms = xcb_get_keyboard_mapping_keysyms(reply);
+
+    for (int i = 0; i < keycodesCount; i++) {
+        for (int column = 0; column < keysymsPerKeycode; column++) {
+            xcb_keysym_t keysym = keysyms[i * keysymsPerKeycode + column];
+            if (keysym == XCB_NO_SYMBOL) {
+                continue;
+            }
+
+            NSNumber *key = @(keysym);
+            NSNumber *keycode = @(minKeycode + i);
+            NSArray *keycodes = [self.keycodesByKeysym objectForKey:key];
+            if (!keycodes) {
+                [self.keycodesByKeysym setObject:@[keycode] forKey:key];
+            } else if (![keycodes containsObject:keycode]) {
+                [self.keycodesByKeysym setObject:[keycodes arrayByAddingObject:keycode] forKey:key];
+            }
+        }
+    }
+
+    free(modifierReply);
+    modifierReply = modifiers;
+    [self rebuildAltKeycodes];
+
+    NSLog(@"[Keyboard] Loaded %d keycodes (%d keysyms each), %lu distinct keysyms, Alt mask 0x%x",
+          keycodesCount, keysymsPerKeycode, (unsigned long)[self.keycodesByKeysym count], self.altMask);
+}
+
+- (void)rebuildAltKeycodes {
+    [self.altKeycodeSet removeAllObjects];
+
+    uint16_t mask = [self modifierMaskForKeysym:XK_Alt_L];
+    if (!mask) {
+        mask = [self modifierMaskForKeysym:XK_Alt_R];
+    }
+    self.altMask = mask ? mask : XCB_MOD_MASK_1;
+    self.numLockMask = [self modifierMaskForKeysym:XK_Num_Lock];
+
+    xcb_keysym_t altKeysyms[] = { XK_Alt_L, XK_Alt_R, XK_Meta_L, XK_Meta_R };
+    for (size_t i = 0; i < sizeof(altKeysyms) / sizeof(altKeysyms[0]); i++) {
+        [self.altKeycodeSet addObjectsFromArray:[self keycodesForKeysym:altKeysyms[i]]];
+    }
+    [self.altKeycodeSet addObjectsFromArray:[self keycodesForModifierMask:self.altMask]];
+}
+
+- (uint16_t)modifierMaskForKeysym:(xcb_keysym_t)keysym {
+    if (!modifierReply) {
+        return 0;
+    }
+
+    int perModifier = modifierReply->keycodes_per_modifier;
+    xcb_keycode_t *modifierKeycodes = xcb_get_modifier_mapping_keycodes(modifierReply);
+
+    for (int row = 0; row < 8; row++) {
+        for (int i = 0; i < perModifier; i++) {
+            xcb_keycode_t keycode = modifierKeycodes[row * perModifier + i];
+            if (keycode != 0 && [self keysymForKeycode:keycode column:0] == keysym) {
+                return (uint16_t)(1 << row);
+            }
+        }
+    }
+    return 0;
+}
+
+- (NSArray *)keycodesForModifierMask:(uint16_t)mask {
+    NSMutableArray *keycodes = [NSMutableArray array];
+    if (!modifierReply) {
+        return keycodes;
+    }
+
+    int perModifier = modifierReply->keycodes_per_modifier;
+    xcb_keycode_t *modifierKeycodes = xcb_get_modifier_mapping_keycodes(modifierReply);
+
+    for (int row = 0; row < 8; row++) {
+        if (!(mask & (1 << row))) {
+            continue;
+        }
+        for (int i = 0; i < perModifier; i++) {
+            xcb_keycode_t keycode = modifierKeycodes[row * perModifier + i];
+            if (keycode != 0 && ![keycodes containsObject:@(keycode)]) {
+                [keycodes addObject:@(keycode)];
+            }
+        }
+    }
+    return keycodes;
+}
+
+- (xcb_keysym_t)keysymForKeycode:(xcb_keycode_t)keycode column:(int)column {
+    if (!mappingReply || keycode < minKeycode || keycode - minKeycode >= keycodesCount ||
+        column < 0 || column >= keysymsPerKeycode) {
+        return XCB_NO_SYMBOL;
+    }
+    return xcb_get_keyboard_mapping_keysyms(mappingReply)[(keycode - minKeycode) * keysymsPerKeycode + column];
+}
+
+- (NSArray *)keycodesForKeysym:(xcb_keysym_t)keysym {
+    NSArray *keycodes = [self.keycodesByKeysym objectForKey:@(keysym)];
+    return keycodes ? keycodes : @[];
+}
+
+- (BOOL)isAltKeycode:(xcb_keycode_t)keycode {
+    return [self.altKeycodeSet containsObject:@(keycode)];
+}
+
+- (NSArray *)altKeycodes {
+    return [self.altKeycodeSet allObjects];
+}
+
+#pragma mark - Modifier State
+
+- (BOOL)modifiersHeld:(uint16_t)mask {
+    return ((self.baseModifiers | self.latchedModifiers) & mask) != 0;
+}
+
+- (BOOL)altHeld {
+    return [self modifiersHeld:self.altMask];
+}
+
+- (URSKeyboardEvent)handleEvent:(xcb_generic_event_t *)event {
+    uint8_t responseType = event->response_type & ~0x80;
+
+    if (responseType == XCB_MAPPING_NOTIFY) {
+        xcb_mapping_notify_event_t *mappingNotify = (xcb_mapping_notify_event_t *)event;
+        if (mappingNotify->request == XCB_MAPPING_POINTER) {
+            return URSKeyboardEventNone;
+        }
+        NSLog(@"[Keyboard] MappingNotify (request %d) - reloading keyboard mapping", mappingNotify->request);
+        [self refreshKeyboardMapping];
+        return URSKeyboardEventMapping;
+    }
+
+    if (!self.xkbAvailable || responseType != xkbEventBase) {
+        return URSKeyboardEventNone;
+    }
+
+    // All XKB events share the header up to xkbType
+    uint8_t xkbType = ((xcb_xkb_state_notify_event_t *)event)->xkbType;
+    if (xkbType == XCB_XKB_NEW_KEYBOARD_NOTIFY || xkbType == XCB_XKB_MAP_NOTIFY) {
+        NSLog(@"[Keyboard] %@ - reloading keyboard mapping",
+              xkbType == XCB_XKB_MAP_NOTIFY ? @"XkbMapNotify" : @"XkbNewKeyboardNotify");
+        [self refreshKeyboardMapping];
+        return URSKeyboardEventMapping;
+    }
+
+    xcb_xkb_state_notify_event_t *stateNotify = (xcb_xkb_state_notify_event_t *)event;
+    if (xkbType != XCB_XKB_STATE_NOTIFY) {
+        return URSKeyboardEventNone;
+    }
+
+    self.baseModifiers = stateNotify->baseMods;
+    self.latchedModifiers = stateNotify->latchedMods;
+    self.lockedModifiers = stateNotify->lockedMods;
+    self.effectiveModifiers = stateNotify->mods;
+
+    return URSKeyboardEventState;
+}
+
+- (void)dealloc {
+    free(mappingReply);
+    free(modifierReply);
+    mappingReply = NULL;
+    modifierReply = NULL;
+}
+
+@end
@@ -0,0 +1,55 @@
+//
+//  URSPixelOps.h
+//  uroswm - Pixel Conversion Kernels
+//
+//  Small 32-bit pixel kernels used when moving theme images and shadow
+//  masks into X11 pixmaps. Each kernel has a scalar version and SSE2, AVX2
+//  or NEON versions; the fastest one the CPU supports is picked at first use.
+//  All implementations are bit-exact with the scalar path.
+//
+//  Pixels are 32-bit words with alpha in the high byte (Cairo ARGB32 in
+//  native little-endian order). Channel order of the other three bytes only
+//  matters for the swizzle.
+//
+
+#import <Foundation/Foundation.h>
+#include <stdint.h>
+#include <stddef.h>
+
+typedef enum {
+    URSPixelOpsScalar = 0,
+    URSPixelOpsSSE2,
+    URSPixelOpsAVX2,
+    URSPixelOpsNEON
+} URSPixelOpsImplementation;
+
+// Implementation selected for this CPU, and an override (used by the self test).
+// Requesting an implementation the CPU cannot run falls back to scalar.
+URSPixelOpsImplementation URSPixelOpsActiveImplementation(void);
+void URSPixelOpsSetImplementation(URSPixelOpsImplementation implementation);
+const char *URSPixelOpsImplementationName(URSPixelOpsImplementation implementation);
+
+// Swap bytes 0 and 2 of every pixel in place (NSBitmapImageRep RGBA -> Cairo BGRA)
+void URSPixelSwizzleRB(uint32_t *pixels, size_t count);
+
+// Premultiply the three colour channels by alpha in place, rounding to nearest
+void URSPixelPremultiply(uint32_t *pixels, size_t count);
+
+// Inactive titlebar pass: composite a premultiplied grey overlay SourceAtop onto
+// premultiplied src, writing dst (may equal src). Alpha is kept; each colour
+// channel becomes c * (255 - overlayAlpha) / 255 + overlayGray * a / 255.
+void URSPixelDimOverlay(const uint32_t *src, uint32_t *dst, size_t count,
+                        uint8_t overlayGray, uint8_t overlayAlpha);
+
+// Convert NSBitmapImageRep RGBA rows in place to Cairo ARGB32 (swizzle, plus
+// premultiply for non-premultiplied bitmaps). Rows must hold 32-bit pixels.
+void URSPixelConvertRGBAToCairo(uint8_t *data, size_t width, size_t height,
+                                size_t bytesPerRow, BOOL premultiply);
+
+// Expand an A8 mask to premultiplied black ARGB32 (a << 24)
+void URSPixelExpandA8(const uint8_t *src, uint32_t *dst, size_t count);
+
+// Check every available implementation against the scalar path on random
+// buffers (all tail lengths included) and time each one. Returns a report;
+// *exact is set to NO on any mismatch.
+NSString *URSPixelOpsSelfTest(size_t pixelCount, NSUInteger iterations, BOOL *exact);
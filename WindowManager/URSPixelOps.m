@@ -0,0 +1,583 @@
+//
+//  URSPixelOps.m
+//  uroswm - Pixel Conversion Kernels
+//
+//  Scalar reference kernels plus SSE2/AVX2 (x86) and NEON (ARM) versions.
+//  Division by 255 is always done as ((x + 128) + ((x + 128) >> 8)) >> 8,
+//  which is exact rounding for every 8-bit product, so vector lanes and the
+//  scalar path produce identical bytes.
+//
+
+#import "URSPixelOps.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define URS_PIXELOPS_X86 1
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define URS_PIXELOPS_NEON 1
+#endif
+
+typedef struct {
+    void (*swizzleRB)(uint32_t *pixels, size_t count);
+    void (*premultiply)(uint32_t *pixels, size_t count);
+    void (*dimOverlay)(const uint32_t *src, uint32_t *dst, size_t count, uint8_t gray, uint8_t alpha);
+    void (*expandA8)(const uint8_t *src, uint32_t *dst, size_t count);
+} URSPixelOpsTable;
+
+#pragma mark - Scalar
+
+static inline uint32_t URSDiv255(uint32_t x)
+{
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+static void URSSwizzleRBScalar(uint32_t *pixels, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        uint32_t p = pixels[i];
+        pixels[i] = (p & 0xFF00FF00u) | ((p & 0xFFu) << 16) | ((p >> 16) & 0xFFu);
+    }
+}
+
+static void URSPremultiplyScalar(uint32_t *pixels, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        uint32_t p = pixels[i];
+        uint32_t a = p >> 24;
+        uint32_t c0 = URSDiv255((p & 0xFFu) * a);
+        uint32_t c1 = URSDiv255(((p >> 8) & 0xFFu) * a);
+        uint32_t c2 = URSDiv255(((p >> 16) & 0xFFu) * a);
+        pixels[i] = (a << 24) | (c2 << 16) | (c1 << 8) | c0;
+    }
+}
+
+static void URSDimOverlayScalar(const uint32_t *src, uint32_t *dst, size_t count, uint8_t gray, uint8_t alpha)
+{
+    uint32_t keep = 255u - alpha;
+
+    for (size_t i = 0; i < count; i++) {
+        uint32_t p = src[i];
+        uint32_t a = p >> 24;
+        uint32_t add = URSDiv255((uint32_t)gray * a);
+        uint32_t out = a << 24;
+
+        for (int shift = 0; shift < 24; shift += 8) {
+            uint32_t c = URSDiv255(((p >> shift) & 0xFFu) * keep) + add;
+            out |= (c > 255u ? 255u : c) << shift;
+        }
+        dst[i] = out;
+    }
+}
+
+static void URSExpandA8Scalar(const uint8_t *src, uint32_t *dst, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        dst[i] = (uint32_t)src[i] << 24;
+    }
+}
+
+static const URSPixelOpsTable URSPixelOpsScalarTable = {
+    URSSwizzleRBScalar, URSPremultiplyScalar, URSDimOverlayScalar, URSExpandA8Scalar
+};
+
+#pragma mark - SSE2
+
+#if defined(URS_PIXELOPS_X86) && defined(__SSE2__)
+#define URS_PIXELOPS_SSE2 1
+
+static inline __m128i URSDiv255SSE2(__m128i x)
+{
+    x = _mm_add_epi16(x, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+// Per 16-bit lane: [a a a a] for each pixel of an unpacked half
+static inline __m128i URSBroadcastAlphaSSE2(__m128i x)
+{
+    x = _mm_shufflelo_epi16(x, _MM_SHUFFLE(3, 3, 3, 3));
+    return _mm_shufflehi_epi16(x, _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+static void URSSwizzleRBSSE2(uint32_t *pixels, size_t count)
+{
+    const __m128i agMask = _mm_set1_epi32((int)0xFF00FF00u);
+    const __m128i rbMask = _mm_set1_epi32(0x00FF00FF);
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(pixels + i));
+        __m128i rb = _mm_and_si128(v, rbMask);
+        v = _mm_or_si128(_mm_and_si128(v, agMask),
+                         _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16)));
+        _mm_storeu_si128((__m128i *)(pixels + i), v);
+    }
+    URSSwizzleRBScalar(pixels + i, count - i);
+}
+
+static void URSPremultiplySSE2(uint32_t *pixels, size_t count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i colorLanes = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+    const __m128i alphaLane = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(pixels + i));
+        __m128i lo = _mm_unpacklo_epi8(v, zero);
+        __m128i hi = _mm_unpackhi_epi8(v, zero);
+        // alpha multiplies by 255, which divides back to alpha exactly
+        __m128i aLo = _mm_or_si128(_mm_and_si128(URSBroadcastAlphaSSE2(lo), colorLanes), alphaLane);
+        __m128i aHi = _mm_or_si128(_mm_and_si128(URSBroadcastAlphaSSE2(hi), colorLanes), alphaLane);
+        lo = URSDiv255SSE2(_mm_mullo_epi16(lo, aLo));
+        hi = URSDiv255SSE2(_mm_mullo_epi16(hi, aHi));
+        _mm_storeu_si128((__m128i *)(pixels + i), _mm_packus_epi16(lo, hi));
+    }
+    URSPremultiplyScalar(pixels + i, count - i);
+}
+
+static void URSDimOverlaySSE2(const uint32_t *src, uint32_t *dst, size_t count, uint8_t gray, uint8_t alpha)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const short keep = 255 - alpha;
+    const __m128i keepMul = _mm_set_epi16(255, keep, keep, keep, 255, keep, keep, keep);
+    const __m128i grayMul = _mm_set_epi16(0, gray, gray, gray, 0, gray, gray, gray);
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i lo = _mm_unpacklo_epi8(v, zero);
+        __m128i hi = _mm_unpackhi_epi8(v, zero);
+        __m128i addLo = URSDiv255SSE2(_mm_mullo_epi16(URSBroadcastAlphaSSE2(lo), grayMul));
+        __m128i addHi = URSDiv255SSE2(_mm_mullo_epi16(URSBroadcastAlphaSSE2(hi), grayMul));
+        lo = _mm_adds_epu16(URSDiv255SSE2(_mm_mullo_epi16(lo, keepMul)), addLo);
+        hi = _mm_adds_epu16(URSDiv255SSE2(_mm_mullo_epi16(hi, keepMul)), addHi);
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(lo, hi));
+    }
+    URSDimOverlayScalar(src + i, dst + i, count - i, gray, alpha);
+}
+
+static void URSExpandA8SSE2(const uint8_t *src, uint32_t *dst, size_t count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+
+    for (; i + 16 <= count; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i lo = _mm_unpacklo_epi8(zero, v);
+        __m128i hi = _mm_unpackhi_epi8(zero, v);
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_unpacklo_epi16(zero, lo));
+        _mm_storeu_si128((__m128i *)(dst + i + 4), _mm_unpackhi_epi16(zero, lo));
+        _mm_storeu_si128((__m128i *)(dst + i + 8), _mm_unpacklo_epi16(zero, hi));
+        _mm_storeu_si128((__m128i *)(dst + i + 12), _mm_unpackhi_epi16(zero, hi));
+    }
+    URSExpandA8Scalar(src + i, dst + i, count - i);
+}
+
+static const URSPixelOpsTable URSPixelOpsSSE2Table = {
+    URSSwizzleRBSSE2, URSPremultiplySSE2, URSDimOverlaySSE2, URSExpandA8SSE2
+};
+#endif
+
+#pragma mark - AVX2
+
+#if defined(URS_PIXELOPS_X86) && (defined(__GNUC__) || defined(__clang__))
+#define URS_PIXELOPS_AVX2 1
+#define URS_AVX2 __attribute__((target("avx2")))
+
+static inline URS_AVX2 __m256i URSDiv255AVX2(__m256i x)
+{
+    x = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+}
+
+static inline URS_AVX2 __m256i URSBroadcastAlphaAVX2(__m256i x)
+{
+    x = _mm256_shufflelo_epi16(x, _MM_SHUFFLE(3, 3, 3, 3));
+    return _mm256_shufflehi_epi16(x, _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+static URS_AVX2 void URSSwizzleRBAVX2(uint32_t *pixels, size_t count)
+{
+    const __m256i order = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+                                           2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(pixels + i));
+        _mm256_storeu_si256((__m256i *)(pixels + i), _mm256_shuffle_epi8(v, order));
+    }
+    URSSwizzleRBScalar(pixels + i, count - i);
+}
+
+static URS_AVX2 void URSPremultiplyAVX2(uint32_t *pixels, size_t count)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i colorLanes = _mm256_set_epi16(0, -1, -1, -1, 0, -1, -1, -1, 0, -1, -1, -1, 0, -1, -1, -1);
+    const __m256i alphaLane = _mm256_set_epi16(255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0);
+    size_t i = 0;
+
+    // unpack and pack both work within 128-bit lanes, so pixel order is preserved
+    for (; i + 8 <= count; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(pixels + i));
+        __m256i lo = _mm256_unpacklo_epi8(v, zero);
+        __m256i hi = _mm256_unpackhi_epi8(v, zero);
+        __m256i aLo = _mm256_or_si256(_mm256_and_si256(URSBroadcastAlphaAVX2(lo), colorLanes), alphaLane);
+        __m256i aHi = _mm256_or_si256(_mm256_and_si256(URSBroadcastAlphaAVX2(hi), colorLanes), alphaLane);
+        lo = URSDiv255AVX2(_mm256_mullo_epi16(lo, aLo));
+        hi = URSDiv255AVX2(_mm256_mullo_epi16(hi, aHi));
+        _mm256_storeu_si256((__m256i *)(pixels + i), _mm256_packus_epi16(lo, hi));
+    }
+    URSPremultiplyScalar(pixels + i, count - i);
+}
+
+static URS_AVX2 void URSDimOverlayAVX2(const uint32_t *src, uint32_t *dst, size_t count, uint8_t gray, uint8_t alpha)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const short keep = 255 - alpha;
+    const __m256i keepMul = _mm256_set_epi16(255, keep, keep, keep, 255, keep, keep, keep,
+                                             255, keep, keep, keep, 255, keep, keep, keep);
+    const __m256i grayMul = _mm256_set_epi16(0, gray, gray, gray, 0, gray, gray, gray,
+                                             0, gray, gray, gray, 0, gray, gray, gray);
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i lo = _mm256_unpacklo_epi8(v, zero);
+        __m256i hi = _mm256_unpackhi_epi8(v, zero);
+        __m256i addLo = URSDiv255AVX2(_mm256_mullo_epi16(URSBroadcastAlphaAVX2(lo), grayMul));
+        __m256i addHi = URSDiv255AVX2(_mm256_mullo_epi16(URSBroadcastAlphaAVX2(hi), grayMul));
+        lo = _mm256_adds_epu16(URSDiv255AVX2(_mm256_mullo_epi16(lo, keepMul)), addLo);
+        hi = _mm256_adds_epu16(URSDiv255AVX2(_mm256_mullo_epi16(hi, keepMul)), addHi);
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_packus_epi16(lo, hi));
+    }
+    URSDimOverlayScalar(src + i, dst + i, count - i, gray, alpha);
+}
+
+static URS_AVX2 void URSExpandA8AVX2(const uint8_t *src, uint32_t *dst, size_t count)
+{
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m256i v = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(src + i)));
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_slli_epi32(v, 24));
+    }
+    URSExpandA8Scalar(src + i, dst + i, count - i);
+}
+
+static const URSPixelOpsTable URSPixelOpsAVX2Table = {
+    URSSwizzleRBAVX2, URSPremultiplyAVX2, URSDimOverlayAVX2, URSExpandA8AVX2
+};
+#endif
+
+#pragma mark - NEON
+
+#ifdef URS_PIXELOPS_NEON
+
+static inline uint8x8_t URSMulDiv255NEON(uint8x8_t a, uint8x8_t b)
+{
+    uint16x8_t t = vmlal_u8(vdupq_n_u16(128), a, b);
+    return vshrn_n_u16(vsraq_n_u16(t, t, 8), 8);
+}
+
+static inline uint8x16_t URSMulDiv255QNEON(uint8x16_t a, uint8x16_t b)
+{
+    return vcombine_u8(URSMulDiv255NEON(vget_low_u8(a), vget_low_u8(b)),
+                       URSMulDiv255NEON(vget_high_u8(a), vget_high_u8(b)));
+}
+
+static void URSSwizzleRBNEON(uint32_t *pixels, size_t count)
+{
+    size_t i = 0;
+
+    for (; i + 16 <= count; i += 16) {
+        uint8x16x4_t v = vld4q_u8((const uint8_t *)(pixels + i));
+        uint8x16_t t = v.val[0];
+        v.val[0] = v.val[2];
+        v.val[2] = t;
+        vst4q_u8((uint8_t *)(pixels + i), v);
+    }
+    URSSwizzleRBScalar(pixels + i, count - i);
+}
+
+static void URSPremultiplyNEON(uint32_t *pixels, size_t count)
+{
+    size_t i = 0;
+
+    for (; i + 16 <= count; i += 16) {
+        uint8x16x4_t v = vld4q_u8((const uint8_t *)(pixels + i));
+        v.val[0] = URSMulDiv255QNEON(v.val[0], v.val[3]);
+        v.val[1] = URSMulDiv255QNEON(v.val[1], v.val[3]);
+        v.val[2] = URSMulDiv255QNEON(v.val[2], v.val[3]);
+        vst4q_u8((uint8_t *)(pixels + i), v);
+    }
+    URSPremultiplyScalar(pixels + i, count - i);
+}
+
+static void URSDimOverlayNEON(const uint32_t *src, uint32_t *dst, size_t count, uint8_t gray, uint8_t alpha)
+{
+    const uint8x16_t keep = vdupq_n_u8(255 - alpha);
+    const uint8x16_t grayv = vdupq_n_u8(gray);
+    size_t i = 0;
+
+    for (; i + 16 <= count; i += 16) {
+        uint8x16x4_t v = vld4q_u8((const uint8_t *)(src + i));
+        uint8x16_t add = URSMulDiv255QNEON(grayv, v.val[3]);
+        v.val[0] = vqaddq_u8(URSMulDiv255QNEON(v.val[0], keep), add);
+        v.val[1] = vqaddq_u8(URSMulDiv255QNEON(v.val[1], keep), add);
+        v.val[2] = vqaddq_u8(URSMulDiv255QNEON(v.val[2], keep), add);
+        vst4q_u8((uint8_t *)(dst + i), v);
+    }
+    URSDimOverlayScalar(src + i, dst + i, count - i, gray, alpha);
+}
+
+static void URSExpandA8NEON(const uint8_t *src, uint32_t *dst, size_t count)
+{
+    size_t i = 0;
+    uint8x16x4_t v;
+    v.val[0] = vdupq_n_u8(0);
+    v.val[1] = vdupq_n_u8(0);
+    v.val[2] = vdupq_n_u8(0);
+
+    for (; i + 16 <= count; i += 16) {
+        v.val[3] = vld1q_u8(src + i);
+        vst4q_u8((uint8_t *)(dst + i), v);
+    }
+    URSExpandA8Scalar(src + i, dst + i, count - i);
+}
+
+static const URSPixelOpsTable URSPixelOpsNEONTable = {
+    URSSwizzleRBNEON, URSPremultiplyNEON, URSDimOverlayNEON, URSExpandA8NEON
+};
+#endif
+
+#pragma mark - Dispatch
+
+static const URSPixelOpsTable *activeTable = NULL;
+static URSPixelOpsImplementation activeImplementation = URSPixelOpsScalar;
+
+static const URSPixelOpsTable *URSPixelOpsTableFor(URSPixelOpsImplementation implementation)
+{
+    switch (implementation) {
+#ifdef URS_PIXELOPS_SSE2
+        case URSPixelOpsSSE2:
+            return &URSPixelOpsSSE2Table;
+#endif
+#ifdef URS_PIXELOPS_AVX2
+        case URSPixelOpsAVX2:
+            return __builtin_cpu_supports("avx2") ? &URSPixelOpsAVX2Table : NULL;
+#endif
+#ifdef URS_PIXELOPS_NEON
+        case URSPixelOpsNEON:
+            return &URSPixelOpsNEONTable;
+#endif
+        case URSPixelOpsScalar:
+            return &URSPixelOpsScalarTable;
+        default:
+            return NULL;
+    }
+}
+
+static const URSPixelOpsTable *URSPixelOps(void)
+{
+    if (activeTable == NULL) {
+        URSPixelOpsImplementation preferred[] = {
+            URSPixelOpsAVX2, URSPixelOpsSSE2, URSPixelOpsNEON, URSPixelOpsScalar
+        };
+        for (size_t i = 0; i < sizeof(preferred) / sizeof(preferred[0]); i++) {
+            const URSPixelOpsTable *table = URSPixelOpsTableFor(preferred[i]);
+            if (table) {
+                activeTable = table;
+                activeImplementation = preferred[i];
+                break;
+            }
+        }
+        NSLog(@"[PixelOps] Using %s kernels", URSPixelOpsImplementationName(activeImplementation));
+    }
+    return activeTable;
+}
+
+URSPixelOpsImplementation URSPixelOpsActiveImplementation(void)
+{
+    URSPixelOps();
+    return activeImplementation;
+}
+
+void URSPixelOpsSetImplementation(URSPixelOpsImplementation implementation)
+{
+    const URSPixelOpsTable *table = URSPixelOpsTableFor(implementation);
+    if (!table) {
+        implementation = URSPixelOpsScalar;
+        table = &URSPixelOpsScalarTable;
+    }
+    activeTable = table;
+    activeImplementation = implementation;
+}
+
+const char *URSPixelOpsImplementationName(URSPixelOpsImplementation implementation)
+{
+    switch (implementation) {
+        case URSPixelOpsSSE2: return "SSE2";
+        case URSPixelOpsAVX2: return "AVX2";
+        case URSPixelOpsNEON: return "NEON";
+        default: return "scalar";
+    }
+}
+
+void URSPixelSwizzleRB(uint32_t *pixels, size_t count)
+{
+    URSPixelOps()->swizzleRB(pixels, count);
+}
+
+void URSPixelPremultiply(uint32_t *pixels, size_t count)
+{
+    URSPixelOps()->premultiply(pixels, count);
+}
+
+void URSPixelDimOverlay(const uint32_t *src, uint32_t *dst, size_t count,
+                        uint8_t overlayGray, uint8_t overlayAlpha)
+{
+    URSPixelOps()->dimOverlay(src, dst, count, overlayGray, overlayAlpha);
+}
+
+void URSPixelExpandA8(const uint8_t *src, uint32_t *dst, size_t count)
+{
+    URSPixelOps()->expandA8(src, dst, count);
+}
+
+void URSPixelConvertRGBAToCairo(uint8_t *data, size_t width, size_t height,
+                                size_t bytesPerRow, BOOL premultiply)
+{
+    const URSPixelOpsTable *table = URSPixelOps();
+
+    // Contiguous rows are converted in one call so the vector loops see no row tails
+    if (bytesPerRow == width * sizeof(uint32_t)) {
+        width *= height;
+        height = 1;
+    }
+
+    for (size_t y = 0; y < height; y++) {
+        uint32_t *row = (uint32_t *)(data + y * bytesPerRow);
+        table->swizzleRB(row, width);
+        if (premultiply) {
+            table->premultiply(row, width);
+        }
+    }
+}
+
+#pragma mark - Self Test
+
+static double URSPixelOpsNow(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Compare one table against scalar on a buffer of count random pixels
+static BOOL URSPixelOpsMatchesScalar(const URSPixelOpsTable *table, size_t count, unsigned int seed)
+{
+    uint32_t *in = malloc((count + 1) * sizeof(uint32_t));
+    uint32_t *expected = malloc((count + 1) * sizeof(uint32_t));
+    uint32_t *actual = malloc((count + 1) * sizeof(uint32_t));
+    uint8_t *mask = malloc(count + 1);
+    BOOL exact = YES;
+
+    srand(seed);
+    for (size_t i = 0; i < count; i++) {
+        in[i] = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+        mask[i] = (uint8_t)rand();
+    }
+    // Include the extremes the rounding has to get right
+    if (count > 0) in[0] = 0xFFFFFFFFu;
+    if (count > 1) in[1] = 0x00FFFFFFu;
+    if (count > 2) in[2] = 0x80FF7F01u;
+
+    memcpy(expected, in, count * sizeof(uint32_t));
+    memcpy(actual, in, count * sizeof(uint32_t));
+    URSSwizzleRBScalar(expected, count);
+    table->swizzleRB(actual, count);
+    exact = exact && memcmp(expected, actual, count * sizeof(uint32_t)) == 0;
+
+    memcpy(expected, in, count * sizeof(uint32_t));
+    memcpy(actual, in, count * sizeof(uint32_t));
+    URSPremultiplyScalar(expected, count);
+    table->premultiply(actual, count);
+    exact = exact && memcmp(expected, actual, count * sizeof(uint32_t)) == 0;
+
+    // The dim pass runs on premultiplied input in practice, but must match on anything
+    URSDimOverlayScalar(in, expected, count, 45, 89);
+    table->dimOverlay(in, actual, count, 45, 89);
+    exact = exact && memcmp(expected, actual, count * sizeof(uint32_t)) == 0;
+
+    URSExpandA8Scalar(mask, expected, count);
+    table->expandA8(mask, actual, count);
+    exact = exact && memcmp(expected, actual, count * sizeof(uint32_t)) == 0;
+
+    free(in);
+    free(expected);
+    free(actual);
+    free(mask);
+    return exact;
+}
+
+NSString *URSPixelOpsSelfTest(size_t pixelCount, NSUInteger iterations, BOOL *exact)
+{
+    URSPixelOpsImplementation all[] = {
+        URSPixelOpsScalar, URSPixelOpsSSE2, URSPixelOpsAVX2, URSPixelOpsNEON
+    };
+    NSMutableString *report = [NSMutableString string];
+    uint32_t *pixels = calloc(pixelCount, sizeof(uint32_t));
+    uint32_t *out = calloc(pixelCount, sizeof(uint32_t));
+    uint8_t *mask = calloc(pixelCount, 1);
+    BOOL allExact = YES;
+
+    [report appendFormat:@"%lu pixels x %lu iterations (selected: %s)\n",
+        (unsigned long)pixelCount, (unsigned long)iterations,
+        URSPixelOpsImplementationName(URSPixelOpsActiveImplementation())];
+
+    for (size_t n = 0; n < sizeof(all) / sizeof(all[0]); n++) {
+        const URSPixelOpsTable *table = URSPixelOpsTableFor(all[n]);
+        if (!table) {
+            continue;
+        }
+
+        // Every tail length up to a few vectors, plus the benchmark size
+        BOOL implExact = YES;
+        for (size_t count = 0; count <= 67 && implExact; count++) {
+            implExact = URSPixelOpsMatchesScalar(table, count, (unsigned int)count + 1);
+        }
+        implExact = implExact && URSPixelOpsMatchesScalar(table, pixelCount, 4242);
+        allExact = allExact && implExact;
+
+        double t0 = URSPixelOpsNow();
+        for (NSUInteger i = 0; i < iterations; i++) table->swizzleRB(pixels, pixelCount);
+        double t1 = URSPixelOpsNow();
+        for (NSUInteger i = 0; i < iterations; i++) table->premultiply(pixels, pixelCount);
+        double t2 = URSPixelOpsNow();
+        for (NSUInteger i = 0; i < iterations; i++) table->dimOverlay(pixels, out, pixelCount, 45, 89);
+        double t3 = URSPixelOpsNow();
+        for (NSUInteger i = 0; i < iterations; i++) table->expandA8(mask, out, pixelCount);
+        double t4 = URSPixelOpsNow();
+
+        double scale = 1e9 / ((double)iterations * (pixelCount ? pixelCount : 1));
+        [report appendFormat:@"%-6s %s  swizzle %.2f  premultiply %.2f  dim %.2f  a8 %.2f ns/pixel\n",
+            URSPixelOpsImplementationName(all[n]), implExact ? "exact   " : "MISMATCH",
+            (t1 - t0) * scale, (t2 - t1) * scale, (t3 - t2) * scale, (t4 - t3) * scale];
+    }
+
+    free(pixels);
+    free(out);
+    free(mask);
+
+    if (exact) {
+        *exact = allExact;
+    }
+    return report;
+}
@@ -7,6 +7,8 @@
 
 #import "URSThemeIntegration.h"
 #import "URSRenderingContext.h"
+#import "URSTitlebarRenderCache.h"
+#import "URSPixelOps.h"
 #import <XCBKit/XCBConnection.h>
 #import <XCBKit/XCBFrame.h>
 #import <cairo/cairo.h>
@@ -29,6 +31,16 @@
 static URSThemeIntegration *sharedInstance = nil;
 static NSMutableSet *fixedSizeWindows = nil;
 
+// Render cache key: everything that changes a rendered titlebar's pixels.
+// The theme pointer is part of the identity so a reloaded theme never hits stale renders.
+static NSString *URSTitlebarCacheKey(NSString *renderer, GSTheme *theme, NSSize size,
+                                     NSString *title, BOOL isActive, NSUInteger styleMask)
+{
+    return [NSString stringWithFormat:@"%@|%@@%p|%dx%d|%d|%lx|%@",
+            renderer, [theme name], theme, (int)size.width, (int)size.height,
+            (int)isActive, (unsigned long)styleMask, title ?: @""];
+}
+
 #pragma mark - Fixed-size window tracking
 
 + (void)initialize {
@@ -268,19 +280,6 @@ static NSMutableSet *fixedSizeWindows = nil;
         }
         NSSize titlebarSize = NSMakeSize(titlebarWidth, xcbRect.size.height);
 
-        // Create NSImage for GSTheme to render into
-        NSImage *titlebarImage = [[NSImage alloc] initWithSize:titlebarSize];
-
-        [titlebarImage lockFocus];
-
-        // Clear background with titlebar background color (not transparent!)
-        // Using transparent would leave garbage pixels from uninitialized pixmap
-        [[NSColor lightGrayColor] set];
-        NSRectFill(NSMakeRect(0, 0, titlebarSize.width, titlebarSize.height));
-
-        // Define the titlebar rect
-        NSRect titlebarRect = NSMakeRect(0, 0, titlebarSize.width, titlebarSize.height);
-
         // Determine style mask based on client capabilities
         // (re-use parentFrame variable declared above)
         XCBWindow *clientWindow = nil;
@@ -317,8 +316,28 @@ static NSMutableSet *fixedSizeWindows = nil;
 
         GSThemeControlState state = isActive ? GSThemeNormalState : GSThemeSelectedState;
 
+        // PERFORMANCE FIX: Focus flips and re-exposes of an unchanged titlebar are served
+        // from the render cache with a CopyArea instead of a full GSTheme render
+        NSString *cacheKey = URSTitlebarCacheKey(@"border", theme, titlebarSize, title, isActive, styleMask);
+        if ([self applyCachedTitlebarForKey:cacheKey toTitlebar:titlebar size:titlebarSize]) {
+            return YES;
+        }
+
         NSLog(@"Drawing GSTheme titlebar with styleMask: 0x%lx, state: %d", (unsigned long)styleMask, (int)state);
 
+        // Create NSImage for GSTheme to render into
+        NSImage *titlebarImage = [[NSImage alloc] initWithSize:titlebarSize];
+
+        [titlebarImage lockFocus];
+
+        // Clear background with titlebar background color (not transparent!)
+        // Using transparent would leave garbage pixels from uninitialized pixmap
+        [[NSColor lightGrayColor] set];
+        NSRectFill(NSMakeRect(0, 0, titlebarSize.width, titlebarSize.height));
+
+        // Define the titlebar rect
+        NSRect titlebarRect = NSMakeRect(0, 0, titlebarSize.width, titlebarSize.height);
+
         // Draw the window titlebar using GSTheme
         [theme drawWindowBorder:titlebarRect
                       withFrame:titlebarRect
@@ -405,6 +424,7 @@ static NSMutableSet *fixedSizeWindows = nil;
         BOOL success = [self transferImage:titlebarImage toTitlebar:titlebar];
 
         if (success) {
+            [[URSTitlebarRenderCache sharedCache] storeTitlebar:titlebar size:titlebarSize forKey:cacheKey];
             NSLog(@"GSTheme titlebar rendered successfully for: %@", title);
         } else {
             NSLog(@"Failed to transfer GSTheme titlebar for: %@", title);
@@ -420,30 +440,10 @@ static NSMutableSet *fixedSizeWindows = nil;
 
 #pragma mark - Image Transfer
 
-// Create a dimmed/desaturated version of an image for inactive window decorations
-+ (NSImage*)createDimmedImage:(NSImage*)image {
-    if (!image) return nil;
-
-    NSSize size = [image size];
-    NSImage *dimmedImage = [[NSImage alloc] initWithSize:size];
-
-    [dimmedImage lockFocus];
-
-    // Draw the original image
-    [image drawInRect:NSMakeRect(0, 0, size.width, size.height)
-             fromRect:NSZeroRect
-            operation:NSCompositeSourceOver
-             fraction:1.0];
-
-    // Apply desaturation overlay using a semi-transparent gray
-    // This reduces vibrancy while maintaining visibility
-    [[NSColor colorWithCalibratedWhite:0.5 alpha:0.35] set];
-    NSRectFillUsingOperation(NSMakeRect(0, 0, size.width, size.height), NSCompositeSourceAtop);
-
-    [dimmedImage unlockFocus];
-
-    return dimmedImage;
-}
+// Inactive decorations: a 50% grey overlay at 35% opacity composited SourceAtop,
+// as 8-bit premultiplied values for URSPixelDimOverlay
+#define URS_INACTIVE_OVERLAY_GRAY  45   // 0.5 * 0.35 * 255
+#define URS_INACTIVE_OVERLAY_ALPHA 89   // 0.35 * 255
 
 + (BOOL)transferImage:(NSImage*)image toTitlebar:(XCBTitleBar*)titlebar {
     // Convert NSImage to bitmap representation
@@ -466,7 +466,7 @@ static NSMutableSet *fixedSizeWindows = nil;
         return NO;
     }
 
-    NSLog(@"Creating Cairo surface for titlebar pixmap: %u, size: %dx%d",
+    NSLog(@"Transferring GSTheme image to titlebar pixmap: %u, size: %dx%d",
           titlebar.pixmap, (int)image.size.width, (int)image.size.height);
 
     // DEBUG: Check bitmap format and sample pixel data
@@ -505,13 +505,88 @@ static NSMutableSet *fixedSizeWindows = nil;
         }
     }
 
-    // Create Cairo surface from XCB titlebar pixmap
+    // NOTE: NSBitmapImageRep uses RGBA but Cairo ARGB32 expects BGRA, so we need to convert
+    unsigned char *bitmapPixels = [bitmap bitmapData];
+    int width = [bitmap pixelsWide];
+    int height = [bitmap pixelsHigh];
+    int bytesPerRow = [bitmap bytesPerRow];
+
+    // OPTIMIZATION: Vectorized RGBA -> BGRA swizzle (and premultiply, which Cairo
+    // requires, when the bitmap carries straight alpha)
+    BOOL straightAlpha = ([bitmap bitmapFormat] & NSAlphaNonpremultipliedBitmapFormat) != 0;
+    URSPixelConvertRGBAToCairo(bitmapPixels, width, height, bytesPerRow, straightAlpha);
+
+    NSLog(@"Painting GSTheme image to titlebar pixmap...");
+
+    if (![self uploadPixels:bitmapPixels width:width height:height stride:bytesPerRow
+                   toPixmap:titlebar.pixmap ofTitlebar:titlebar]) {
+        return NO;
+    }
+
+    // Force immediate X11 update to ensure GSTheme is visible
+    [titlebar.connection flush];
+
+    NSLog(@"GSTheme image painted and flushed");
+
+    // Paint DIMMED version to dPixmap (inactive pixmap) for unfocused windows
+    // XCBWindow.drawArea uses isAbove ? pixmap : dPixmap
+    xcb_pixmap_t dPixmap = [titlebar dPixmap];
+    if (dPixmap != 0) {
+        NSLog(@"Painting dimmed GSTheme to dPixmap (inactive pixmap): %u", dPixmap);
+
+        // OPTIMIZATION: Derive the inactive image from the converted active pixels in a
+        // single pass instead of re-rendering and re-converting a dimmed NSImage
+        uint32_t *dimmedPixels = malloc((size_t)bytesPerRow * height);
+        if (dimmedPixels) {
+            URSPixelDimOverlay((const uint32_t *)bitmapPixels, dimmedPixels,
+                               (size_t)bytesPerRow * height / sizeof(uint32_t),
+                               URS_INACTIVE_OVERLAY_GRAY, URS_INACTIVE_OVERLAY_ALPHA);
+
+            if ([self uploadPixels:(unsigned char *)dimmedPixels width:width height:height
+                            stride:bytesPerRow toPixmap:dPixmap ofTitlebar:titlebar]) {
+                NSLog(@"Dimmed GSTheme painted to dPixmap successfully");
+            }
+            free(dimmedPixels);
+        }
+    }
+
+    [titlebar.connection flush];
+
+    // Notify compositor that titlebar rendering is complete
+    // Use the parent frame's window ID for compositor notification
+    xcb_window_t windowId = [[titlebar parentWindow] window];
+    if (windowId != 0) {
+        [URSRenderingContext notifyRenderingComplete:windowId];
+    }
+
+    return YES;
+}
+
+// Replace a titlebar pixmap's contents with converted ARGB32 pixels. When the visual
+// takes ARGB32 as is, the bytes go straight to the server (MIT-SHM when available);
+// otherwise Cairo converts them for the visual.
++ (BOOL)uploadPixels:(unsigned char*)pixels
+               width:(int)width
+              height:(int)height
+              stride:(int)stride
+            toPixmap:(xcb_pixmap_t)pixmap
+          ofTitlebar:(XCBTitleBar*)titlebar {
+    XCBShmImagePool *pool = [titlebar.connection shmImagePool];
+    XCBScreen *screen = [titlebar onScreen];
+    uint8_t depth = (screen && [screen screen]) ? [screen screen]->root_depth : 0;
+
+    if ([pool acceptsARGB32ForDepth:depth visual:titlebar.visual.visualType]) {
+        [pool putImage:pixels width:width height:height stride:stride depth:depth
+            toDrawable:pixmap gc:[titlebar graphicContextId] x:0 y:0];
+        return YES;
+    }
+
     cairo_surface_t *x11Surface = cairo_xcb_surface_create(
         [titlebar.connection connection],
-        titlebar.pixmap,
+        pixmap,
         titlebar.visual.visualType,
-        (int)image.size.width,
-        (int)image.size.height
+        width,
+        height
     );
 
     cairo_status_t surface_status = cairo_surface_status(x11Surface);
@@ -521,152 +596,43 @@ static NSMutableSet *fixedSizeWindows = nil;
         return NO;
     }
 
-    NSLog(@"Cairo X11 surface created successfully");
-
-    cairo_t *ctx = cairo_create(x11Surface);
-
-    // Create Cairo image surface from bitmap data
-    // NOTE: NSBitmapImageRep uses RGBA but Cairo ARGB32 expects BGRA, so we need to convert
-    unsigned char *bitmapPixels = [bitmap bitmapData];
-    int width = [bitmap pixelsWide];
-    int height = [bitmap pixelsHigh];
-    int bytesPerRow = [bitmap bytesPerRow];
-
-    // OPTIMIZATION: Convert RGBA to BGRA using 32-bit word operations (4x faster)
-    // Process entire rows at once, handling stride properly
-    int rowPixels = width;
-    for (int y = 0; y < height; y++) {
-        uint32_t *rowPtr = (uint32_t *)(bitmapPixels + (y * bytesPerRow));
-        for (int x = 0; x < rowPixels; x++) {
-            uint32_t pixel = rowPtr[x];
-            // RGBA (little-endian memory: A B G R) -> BGRA (little-endian: A R G B)
-            // Extract channels and reassemble
-            uint32_t r = (pixel >> 0) & 0xFF;
-            uint32_t g = (pixel >> 8) & 0xFF;
-            uint32_t b = (pixel >> 16) & 0xFF;
-            uint32_t a = (pixel >> 24) & 0xFF;
-            // BGRA format: B in lowest byte, then G, R, A
-            rowPtr[x] = (a << 24) | (r << 16) | (g << 8) | b;
-        }
-    }
-
     cairo_surface_t *imageSurface = cairo_image_surface_create_for_data(
-        bitmapPixels,
+        pixels,
         CAIRO_FORMAT_ARGB32,
         width,
         height,
-        bytesPerRow
+        stride
     );
 
     if (cairo_surface_status(imageSurface) != CAIRO_STATUS_SUCCESS) {
         NSLog(@"Failed to create Cairo image surface for titlebar transfer");
         cairo_surface_destroy(imageSurface);
-        cairo_destroy(ctx);
         cairo_surface_destroy(x11Surface);
         return NO;
     }
 
-    NSLog(@"Painting GSTheme image to X11 surface...");
-
-    // Paint GSTheme image to X11 surface using SOURCE operator
     // SOURCE completely replaces destination pixels (no compositing)
     // This prevents old pixmap garbage from showing through
+    cairo_t *ctx = cairo_create(x11Surface);
     cairo_set_operator(ctx, CAIRO_OPERATOR_SOURCE);
     cairo_set_source_surface(ctx, imageSurface, 0, 0);
     cairo_paint(ctx);
     cairo_surface_flush(x11Surface);
 
-    // Force immediate X11 update to ensure GSTheme is visible
-    [titlebar.connection flush];
-    xcb_flush([titlebar.connection connection]);
-
-    NSLog(@"GSTheme image painted and surface flushed");
-
-    // Cleanup first surface
-    cairo_surface_destroy(imageSurface);
     cairo_destroy(ctx);
+    cairo_surface_destroy(imageSurface);
     cairo_surface_destroy(x11Surface);
+    return YES;
+}
 
-    // Paint DIMMED version to dPixmap (inactive pixmap) for unfocused windows
-    // XCBWindow.drawArea uses isAbove ? pixmap : dPixmap
-    xcb_pixmap_t dPixmap = [titlebar dPixmap];
-    if (dPixmap != 0) {
-        NSLog(@"Painting dimmed GSTheme to dPixmap (inactive pixmap): %u", dPixmap);
-
-        // Create a dimmed version of the titlebar image for inactive state
-        NSImage *dimmedImage = [self createDimmedImage:image];
-        if (dimmedImage) {
-            // Get bitmap from dimmed image
-            NSBitmapImageRep *dimmedBitmap = nil;
-            for (NSImageRep *rep in [dimmedImage representations]) {
-                if ([rep isKindOfClass:[NSBitmapImageRep class]]) {
-                    dimmedBitmap = (NSBitmapImageRep*)rep;
-                    break;
-                }
-            }
-            if (!dimmedBitmap) {
-                NSData *dimmedData = [dimmedImage TIFFRepresentation];
-                dimmedBitmap = [NSBitmapImageRep imageRepWithData:dimmedData];
-            }
-
-            if (dimmedBitmap) {
-                unsigned char *dimmedPixels = [dimmedBitmap bitmapData];
-                int dimmedWidth = [dimmedBitmap pixelsWide];
-                int dimmedHeight = [dimmedBitmap pixelsHigh];
-                int dimmedBytesPerRow = [dimmedBitmap bytesPerRow];
-
-                // OPTIMIZATION: Convert RGBA to BGRA using 32-bit word operations
-                for (int y = 0; y < dimmedHeight; y++) {
-                    uint32_t *rowPtr = (uint32_t *)(dimmedPixels + (y * dimmedBytesPerRow));
-                    for (int x = 0; x < dimmedWidth; x++) {
-                        uint32_t pixel = rowPtr[x];
-                        uint32_t r = (pixel >> 0) & 0xFF;
-                        uint32_t g = (pixel >> 8) & 0xFF;
-                        uint32_t b = (pixel >> 16) & 0xFF;
-                        uint32_t a = (pixel >> 24) & 0xFF;
-                        rowPtr[x] = (a << 24) | (r << 16) | (g << 8) | b;
-                    }
-                }
-
-                cairo_surface_t *dSurface = cairo_xcb_surface_create(
-                    [titlebar.connection connection],
-                    dPixmap,
-                    titlebar.visual.visualType,
-                    dimmedWidth,
-                    dimmedHeight
-                );
-
-                if (cairo_surface_status(dSurface) == CAIRO_STATUS_SUCCESS) {
-                    cairo_t *dCtx = cairo_create(dSurface);
-
-                    cairo_surface_t *dImageSurface = cairo_image_surface_create_for_data(
-                        dimmedPixels,
-                        CAIRO_FORMAT_ARGB32,
-                        dimmedWidth,
-                        dimmedHeight,
-                        dimmedBytesPerRow
-                    );
-
-                    if (cairo_surface_status(dImageSurface) == CAIRO_STATUS_SUCCESS) {
-                        cairo_set_operator(dCtx, CAIRO_OPERATOR_SOURCE);
-                        cairo_set_source_surface(dCtx, dImageSurface, 0, 0);
-                        cairo_paint(dCtx);
-                        cairo_surface_flush(dSurface);
-                        NSLog(@"Dimmed GSTheme painted to dPixmap successfully");
-                    }
-
-                    cairo_surface_destroy(dImageSurface);
-                    cairo_destroy(dCtx);
-                }
-                cairo_surface_destroy(dSurface);
-            }
-        }
+// Copy a cached render into the titlebar and announce it like transferImage:toTitlebar: does
++ (BOOL)applyCachedTitlebarForKey:(NSString*)key toTitlebar:(XCBTitleBar*)titlebar size:(NSSize)size {
+    if (![[URSTitlebarRenderCache sharedCache] copyEntryForKey:key toTitlebar:titlebar size:size]) {
+        return NO;
     }
 
     [titlebar.connection flush];
 
-    // Notify compositor that titlebar rendering is complete
-    // Use the parent frame's window ID for compositor notification
     xcb_window_t windowId = [[titlebar parentWindow] window];
     if (windowId != 0) {
         [URSRenderingContext notifyRenderingComplete:windowId];
@@ -775,15 +741,6 @@ static NSMutableSet *fixedSizeWindows = nil;
               (int)titlebarSize.width, (int)titlebarSize.height,
               (int)frameRect.size.width, (int)frameRect.size.height, [window window]);
 
-        // Create NSImage for GSTheme to render into
-        NSImage *titlebarImage = [[NSImage alloc] initWithSize:titlebarSize];
-
-        [titlebarImage lockFocus];
-        
-        // Set up the graphics state for theme drawing
-        NSGraphicsContext *gctx = [NSGraphicsContext currentContext];
-        [gctx saveGraphicsState];
-
         // Use GSTheme to draw titlebar decoration
         NSRect drawRect = NSMakeRect(0, 0, titlebarSize.width, titlebarSize.height);
 
@@ -821,8 +778,23 @@ static NSMutableSet *fixedSizeWindows = nil;
 
         GSThemeControlState state = isActive ? GSThemeNormalState : GSThemeSelectedState;
 
+        // PERFORMANCE FIX: Serve unchanged titlebars from the render cache (see renderGSThemeTitlebar:)
+        NSString *cacheKey = URSTitlebarCacheKey(@"standalone", theme, titlebarSize, title, isActive, styleMask);
+        if ([self applyCachedTitlebarForKey:cacheKey toTitlebar:titlebar size:titlebarSize]) {
+            return YES;
+        }
+
         NSLog(@"Drawing standalone GSTheme titlebar with styleMask: 0x%lx, state: %d (fixedSize=%d, mini=%d)", (unsigned long)styleMask, (int)state, (int)isFixedSize, clientWindow ? (int)[clientWindow canMinimize] : 0);
 
+        // Create NSImage for GSTheme to render into
+        NSImage *titlebarImage = [[NSImage alloc] initWithSize:titlebarSize];
+
+        [titlebarImage lockFocus];
+        
+        // Set up the graphics state for theme drawing
+        NSGraphicsContext *gctx = [NSGraphicsContext currentContext];
+        [gctx saveGraphicsState];
+
         // Log GSTheme padding and size values to verify Eau theme values
         if ([theme respondsToSelector:@selector(titlebarPaddingLeft)]) {
             NSLog(@"GSTheme titlebarPaddingLeft: %.1f", [theme titlebarPaddingLeft]);
@@ -1045,6 +1017,7 @@ static NSMutableSet *fixedSizeWindows = nil;
         BOOL success = [self transferImage:titlebarImage toTitlebar:titlebar];
 
         if (success) {
+            [[URSTitlebarRenderCache sharedCache] storeTitlebar:titlebar size:titlebarSize forKey:cacheKey];
             NSLog(@"Standalone GSTheme titlebar rendered successfully for: %@", title);
         } else {
             NSLog(@"Failed to transfer standalone GSTheme titlebar for: %@", title);
@@ -1067,6 +1040,9 @@ static NSMutableSet *fixedSizeWindows = nil;
         return;
     }
 
+    // A refresh means the theme may have changed: render everything again
+    [[URSTitlebarRenderCache sharedCache] removeAllEntries];
+
     for (XCBTitleBar *titlebar in integration.managedTitlebars) {
         // Determine if window is active (simplified for now)
         BOOL isActive = YES; // TODO: Implement proper active window detection
@@ -0,0 +1,35 @@
+//
+//  URSTitlebarRenderCache.h
+//  uroswm - Titlebar Render Cache
+//
+//  Bounded LRU cache of rendered titlebars kept as server-side pixmaps.
+//  Each entry holds the active pixmap and its dimmed counterpart exactly as
+//  transferImage:toTitlebar: left them, so a hit is two CopyArea requests
+//  instead of a GSTheme render, a bitmap conversion and a pixel swizzle.
+//
+
+#import <Foundation/Foundation.h>
+#import <xcb/xcb.h>
+#import <XCBKit/XCBTitleBar.h>
+
+@interface URSTitlebarRenderCache : NSObject
+
+// Maximum number of entries (URSTitlebarCacheSize default, 48 if unset, 0 disables)
+@property (assign, nonatomic) NSUInteger capacity;
+
+// Statistics
+@property (readonly, nonatomic) NSUInteger hits;
+@property (readonly, nonatomic) NSUInteger misses;
+
++ (instancetype)sharedCache;
+
+// Copy a cached render into the titlebar's pixmap and dPixmap. Returns NO on a miss.
+- (BOOL)copyEntryForKey:(NSString*)key toTitlebar:(XCBTitleBar*)titlebar size:(NSSize)size;
+
+// Keep a copy of the titlebar's freshly rendered pixmaps under key
+- (void)storeTitlebar:(XCBTitleBar*)titlebar size:(NSSize)size forKey:(NSString*)key;
+
+// Drop all entries and free their pixmaps (e.g. after a theme change)
+- (void)removeAllEntries;
+
+@end
@@ -0,0 +1,166 @@
+//
+//  URSTitlebarRenderCache.m
+//  uroswm - Titlebar Render Cache
+//
+//  Implementation of the LRU titlebar pixmap cache.
+//
+
+#import "URSTitlebarRenderCache.h"
+#import <XCBKit/XCBConnection.h>
+#import <XCBKit/XCBScreen.h>
+
+#define URS_TITLEBAR_CACHE_DEFAULT_CAPACITY 48
+
+// One cached render: owns its server-side pixmaps and frees them when released
+@interface URSTitlebarCacheEntry : NSObject
+
+@property (assign, nonatomic) xcb_connection_t *connection;
+@property (assign, nonatomic) xcb_pixmap_t pixmap;
+@property (assign, nonatomic) xcb_pixmap_t dPixmap;
+@property (assign, nonatomic) uint16_t width;
+@property (assign, nonatomic) uint16_t height;
+
+@end
+
+@implementation URSTitlebarCacheEntry
+
+- (void)dealloc {
+    if (_connection) {
+        if (_pixmap) {
+            xcb_free_pixmap(_connection, _pixmap);
+        }
+        if (_dPixmap) {
+            xcb_free_pixmap(_connection, _dPixmap);
+        }
+    }
+}
+
+@end
+
+@interface URSTitlebarRenderCache ()
+
+@property (strong, nonatomic) NSMutableDictionary *entries;
+// Keys from least to most recently used
+@property (strong, nonatomic) NSMutableArray *lruKeys;
+@property (assign, nonatomic) NSUInteger hits;
+@property (assign, nonatomic) NSUInteger misses;
+
+@end
+
+@implementation URSTitlebarRenderCache
+
+static URSTitlebarRenderCache *sharedCache = nil;
+
+#pragma mark - Initialization
+
++ (instancetype)sharedCache {
+    if (sharedCache == nil) {
+        sharedCache = [[self alloc] init];
+    }
+    return sharedCache;
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _entries = [[NSMutableDictionary alloc] init];
+        _lruKeys = [[NSMutableArray alloc] init];
+
+        NSUserDefaults *defaults = [NSUserDefaults standardUserDefaults];
+        if ([defaults objectForKey:@"URSTitlebarCacheSize"]) {
+            _capacity = (NSUInteger)MAX(0, [defaults integerForKey:@"URSTitlebarCacheSize"]);
+        } else {
+            _capacity = URS_TITLEBAR_CACHE_DEFAULT_CAPACITY;
+        }
+    }
+    return self;
+}
+
+#pragma mark - Lookup
+
+- (BOOL)copyEntryForKey:(NSString*)key toTitlebar:(XCBTitleBar*)titlebar size:(NSSize)size {
+    if (!key || !titlebar || [titlebar pixmap] == 0) {
+        return NO;
+    }
+
+    URSTitlebarCacheEntry *entry = [self.entries objectForKey:key];
+    if (!entry || entry.width != (uint16_t)size.width || entry.height != (uint16_t)size.height) {
+        self.misses++;
+        return NO;
+    }
+
+    xcb_connection_t *conn = [[titlebar connection] connection];
+    xcb_gcontext_t gc = [titlebar graphicContextId];
+
+    xcb_copy_area(conn, entry.pixmap, [titlebar pixmap], gc,
+                  0, 0, 0, 0, entry.width, entry.height);
+
+    if (entry.dPixmap && [titlebar dPixmap]) {
+        xcb_copy_area(conn, entry.dPixmap, [titlebar dPixmap], gc,
+                      0, 0, 0, 0, entry.width, entry.height);
+    }
+
+    // Move to the most recently used end
+    [self.lruKeys removeObject:key];
+    [self.lruKeys addObject:key];
+    self.hits++;
+
+    return YES;
+}
+
+#pragma mark - Insertion
+
+- (void)storeTitlebar:(XCBTitleBar*)titlebar size:(NSSize)size forKey:(NSString*)key {
+    if (self.capacity == 0 || !key || !titlebar || [titlebar pixmap] == 0) {
+        return;
+    }
+
+    XCBScreen *screen = [titlebar onScreen];
+    if (!screen || [screen screen] == NULL) {
+        return;
+    }
+
+    xcb_connection_t *conn = [[titlebar connection] connection];
+    xcb_window_t root = [screen screen]->root;
+    uint8_t depth = [screen screen]->root_depth;   // same depth createPixmap uses
+    uint16_t width = (uint16_t)size.width;
+    uint16_t height = (uint16_t)size.height;
+    xcb_gcontext_t gc = [titlebar graphicContextId];
+
+    URSTitlebarCacheEntry *entry = [[URSTitlebarCacheEntry alloc] init];
+    entry.connection = conn;
+    entry.width = width;
+    entry.height = height;
+
+    entry.pixmap = xcb_generate_id(conn);
+    xcb_create_pixmap(conn, depth, entry.pixmap, root, width, height);
+    xcb_copy_area(conn, [titlebar pixmap], entry.pixmap, gc, 0, 0, 0, 0, width, height);
+
+    if ([titlebar dPixmap]) {
+        entry.dPixmap = xcb_generate_id(conn);
+        xcb_create_pixmap(conn, depth, entry.dPixmap, root, width, height);
+        xcb_copy_area(conn, [titlebar dPixmap], entry.dPixmap, gc, 0, 0, 0, 0, width, height);
+    }
+
+    [self.lruKeys removeObject:key];
+    [self.lruKeys addObject:key];
+    [self.entries setObject:entry forKey:key];
+
+    // Evict least recently used entries; releasing an entry frees its pixmaps
+    while ([self.lruKeys count] > self.capacity) {
+        NSString *oldest = [self.lruKeys objectAtIndex:0];
+        [self.entries removeObjectForKey:oldest];
+        [self.lruKeys removeObjectAtIndex:0];
+    }
+}
+
+- (void)removeAllEntries {
+    if ([self.entries count] > 0) {
+        NSLog(@"[TitlebarCache] Dropping %lu entries (hits: %lu, misses: %lu)",
+              (unsigned long)[self.entries count], (unsigned long)self.hits, (unsigned long)self.misses);
+    }
+    [self.entries removeAllObjects];
+    [self.lruKeys removeAllObjects];
+}
+
+@end
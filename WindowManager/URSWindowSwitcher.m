@@ -25,6 +25,7 @@
 #import <xcb/xcb_icccm.h>
 #import <cairo/cairo.h>
 #import "URSThemeIntegration.h"
+#import "URSIconCache.h"
 
 #pragma mark - URSWindowEntry Implementation
 
@@ -83,48 +84,44 @@
 - (void)updateWindowStack {
     @try {
         [self.windowEntries removeAllObjects];
-        NSDictionary *windowsMap = [self.connection windowsMap];
+        
+        // Pick up installed or removed applications in the background
+        [[URSIconCache sharedCache] refreshDesktopIndexIfNeeded];
         
         // First pass: collect all valid managed windows
         NSMutableArray *validEntries = [NSMutableArray array];
-        for (NSString *windowId in windowsMap) {
-            XCBWindow *window = [windowsMap objectForKey:windowId];
-            
-            if (window && [window isKindOfClass:[XCBFrame class]]) {
-                XCBFrame *frame = (XCBFrame *)window;
-                
-                // Check if the frame has a titlebar (managed window)
-                XCBWindow *titlebarWindow = [frame childWindowForKey:TitleBar];
-                if (titlebarWindow && [titlebarWindow isKindOfClass:[XCBTitleBar class]]) {
-                    if (!frame.needDestroy) {
-                        BOOL isMinimized = [self isWindowMinimized:frame];
-                        NSString *title = [self getTitleForFrame:frame];
-                        
-                        URSWindowEntry *entry = [[URSWindowEntry alloc] initWithFrame:frame
-                                                                         wasMinimized:isMinimized
-                                                                                title:title];
-                        // Fetch the app icon
-                        entry.icon = [self getIconForFrame:frame];
-                        [validEntries addObject:entry];
-                    }
+        for (XCBFrame *frame in [self.connection framesMap]) {
+            // Check if the frame has a titlebar (managed window)
+            XCBWindow *titlebarWindow = [frame childWindowForKey:TitleBar];
+            if (titlebarWindow && [titlebarWindow isKindOfClass:[XCBTitleBar class]]) {
+                if (!frame.needDestroy) {
+                    BOOL isMinimized = [self isWindowMinimized:frame];
+                    NSString *title = [self getTitleForFrame:frame];
+                    
+                    URSWindowEntry *entry = [[URSWindowEntry alloc] initWithFrame:frame
+                                                                     wasMinimized:isMinimized
+                                                                            title:title];
+                    // Fetch the app icon
+                    entry.icon = [self getIconForFrame:frame];
+                    [validEntries addObject:entry];
                 }
             }
         }
         
-        // Second pass: sort by stacking order from clientList (bottom to top)
-        // The clientList is in stacking order where last entry is topmost (most recently used)
-        xcb_window_t *clientList = [self.connection clientList];
-        NSInteger clientListCount = [self.connection clientListIndex];
+        // Second pass: sort by stacking order (bottom to top, last entry is topmost)
+        // The stacking list holds client windows, so entries are matched by their frame's client
+        xcb_window_t *clientList = [self.connection clientListStacking];
+        NSInteger clientListCount = [self.connection clientListStackingIndex];
         
         NSMutableArray *sortedEntries = [NSMutableArray array];
         
-        // Add windows in reverse order of clientList (topmost first)
+        // Add windows in reverse stacking order (topmost first)
         for (NSInteger i = clientListCount - 1; i >= 0; i--) {
             xcb_window_t windowId = clientList[i];
             
             // Find the matching entry
             for (URSWindowEntry *entry in validEntries) {
-                if ([entry.frame window] == windowId) {
+                if ([[entry.frame childWindowForKey:ClientWindow] window] == windowId) {
                     [sortedEntries addObject:entry];
                     break;
                 }
@@ -571,146 +568,9 @@
         XCBWindow *clientWindow = [frame childWindowForKey:ClientWindow];
         if (!clientWindow) return nil;
         
-        // Get WM_CLASS to identify the application
-        // First ensure wmClass is fetched (it may already be cached)
-        ICCCMService *icccmService = [ICCCMService sharedInstanceWithConnection:self.connection];
-        [icccmService wmClassForWindow:clientWindow];
-        
-        NSMutableArray *windowClass = [clientWindow windowClass];
-        NSString *className = nil;
-        NSString *instanceName = nil;
-        
-        if (windowClass && [windowClass count] >= 2) {
-            className = [windowClass objectAtIndex:0];
-            instanceName = [windowClass objectAtIndex:1];
-        }
-        
-        NSWorkspace *workspace = [NSWorkspace sharedWorkspace];
-        NSString *appPath = nil;
-        
-        // Try to find the application path if we have WM_CLASS
-        if (className && [className length] > 0) {
-            // First try the class name
-            appPath = [workspace fullPathForApplication:className];
-            
-            // If that fails, try the instance name
-            if (!appPath || [appPath length] == 0) {
-                if (instanceName && [instanceName length] > 0) {
-                    appPath = [workspace fullPathForApplication:instanceName];
-                }
-            }
-            
-            // For non-GNUstep apps, try common paths
-            if (!appPath || [appPath length] == 0) {
-                NSArray *searchPaths = @[
-                    @"/usr/share/applications",
-                    @"/usr/local/share/applications",
-                    @"/System/Applications"
-                ];
-                
-                for (NSString *searchPath in searchPaths) {
-                    // Try .desktop file approach for non-GNUstep apps
-                    NSString *desktopPath = [NSString stringWithFormat:@"%@/%@.desktop", searchPath, [className lowercaseString]];
-                    if ([[NSFileManager defaultManager] fileExistsAtPath:desktopPath]) {
-                        // Read Icon= line from .desktop file
-                        NSString *desktopContent = [NSString stringWithContentsOfFile:desktopPath encoding:NSUTF8StringEncoding error:nil];
-                        if (desktopContent) {
-                            NSArray *lines = [desktopContent componentsSeparatedByString:@"\n"];
-                            for (NSString *line in lines) {
-                                if ([line hasPrefix:@"Icon="]) {
-                                    NSString *iconName = [[line substringFromIndex:5] stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
-                                    // Try as absolute path first
-                                    if ([iconName hasPrefix:@"/"]) {
-                                        if ([[NSFileManager defaultManager] fileExistsAtPath:iconName]) {
-                                            appPath = iconName;
-                                            break;
-                                        }
-                                    } else {
-                                        // Search in icon theme paths
-                                        NSArray *iconPaths = @[
-                                            [NSString stringWithFormat:@"/usr/share/pixmaps/%@.png", iconName],
-                                            [NSString stringWithFormat:@"/usr/share/icons/hicolor/48x48/apps/%@.png", iconName],
-                                            [NSString stringWithFormat:@"/usr/share/icons/hicolor/scalable/apps/%@.svg", iconName]
-                                        ];
-                                        for (NSString *iconPath in iconPaths) {
-                                            if ([[NSFileManager defaultManager] fileExistsAtPath:iconPath]) {
-                                                appPath = iconPath;
-                                                break;
-                                            }
-                                        }
-                                        if (appPath) break;
-                                    }
-                                }
-                            }
-                        }
-                        if (appPath) break;
-                    }
-                }
-            }
-            
-            if (appPath && [appPath length] > 0) {
-                // Get the application icon - use iconForFile which works for both .app bundles and icon files
-                NSImage *icon = [workspace iconForFile:appPath];
-                if (icon) {
-                    // Resize icon to 48x48 like the Dock uses
-                    [icon setSize:NSMakeSize(48.0, 48.0)];
-                    return icon;
-                }
-            }
-        }
-        
-        // FALLBACK 1: Try to get icon from X11 _NET_WM_ICON property
-        EWMHService *ewmhService = [EWMHService sharedInstanceWithConnection:self.connection];
-        xcb_get_property_reply_t *reply = [ewmhService netWmIconFromWindow:clientWindow];
-        
-        if (reply) {
-            CairoSurfacesSet *cairoSet = [[CairoSurfacesSet alloc] initWithConnection:self.connection];
-            [cairoSet buildSetFromReply:reply];
-            NSArray *surfaces = [cairoSet cairoSurfaces];
-            
-            if (surfaces && [surfaces count] > 0) {
-                // Find the best icon size (closest to 48x48)
-                cairo_surface_t *bestSurface = NULL;
-                int bestDiff = INT_MAX;
-                
-                for (NSValue *surfaceValue in surfaces) {
-                    cairo_surface_t *surface = [surfaceValue pointerValue];
-                    int width = cairo_image_surface_get_width(surface);
-                    int height = cairo_image_surface_get_height(surface);
-                    int diff = abs(width - 48) + abs(height - 48);
-                    
-                    if (diff < bestDiff) {
-                        bestDiff = diff;
-                        bestSurface = surface;
-                    }
-                }
-                
-                if (bestSurface) {
-                    NSImage *icon = [self convertCairoSurfaceToNSImage:bestSurface];
-                    if (icon) {
-                        // Resize to 48x48
-                        [icon setSize:NSMakeSize(48.0, 48.0)];
-                        free(reply);
-                        return icon;
-                    }
-                }
-            }
-            
-            free(reply);
-        }
-        
-        // FALLBACK 2: Use generic application icon
-        // Try to get the generic application icon from the workspace
-        NSString *genericAppPath = [workspace fullPathForApplication:@"GNUstep"];
-        if (genericAppPath) {
-            NSImage *genericAppIcon = [workspace iconForFile:genericAppPath];
-            if (genericAppIcon) {
-                [genericAppIcon setSize:NSMakeSize(48.0, 48.0)];
-                return genericAppIcon;
-            }
-        }
-        
-        return nil;
+        // PERFORMANCE FIX: Icons come from the WM_CLASS keyed icon cache; the
+        // .desktop lookups it needs are indexed on a background queue
+        return [[URSIconCache sharedCache] iconForClientWindow:clientWindow];
         
     } @catch (NSException *exception) {
         NSLog(@"[WindowSwitcher] Exception getting icon for frame: %@", exception.reason);
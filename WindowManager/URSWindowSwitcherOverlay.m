@@ -17,12 +17,13 @@
 
 #import "URSWindowSwitcherOverlay.h"
 #import "URSCompositingManager.h"
+#import "URSIconCache.h"
 #import <X11/Xlib.h>
 #import <X11/Xutil.h>
 #import <X11/extensions/Xcomposite.h>
 
 // Constants for the switcher appearance
-static const CGFloat kIconSize = 48.0;
+static const CGFloat kIconSize = URSIconCacheIconSize;
 static const CGFloat kIconSpacing = 20.0;
 static const CGFloat kPadding = 24.0;
 static const CGFloat kCornerRadius = 22.0;
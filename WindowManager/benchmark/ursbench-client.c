@@ -0,0 +1,233 @@
+/*
+ * ursbench-client.c - Synthetic XCB client for the compositor benchmark
+ *
+ * Maps a window and drives one workload at 60 Hz for the given duration:
+ *
+ *   map      unmap and map the window again every 10 frames
+ *   move     move the window along a circle every frame
+ *   resize   grow and shrink the window every frame
+ *   blink    toggle a text-cursor sized rectangle every frame
+ *   scroll   scroll the contents up one line and draw a new one every frame
+ *   alttab   press Alt+Tab through XTEST every 10 frames, release Alt every 40
+ *
+ * Usage: ursbench-client <workload> <seconds> [index]
+ *
+ *   cc -O2 -o ursbench-client ursbench-client.c $(pkg-config --cflags --libs xcb xcb-xtest)
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <xcb/xcb.h>
+#include <xcb/xtest.h>
+
+#define FRAME_NSEC (1000000000L / 60)
+#define WINDOW_WIDTH 400
+#define WINDOW_HEIGHT 300
+#define LINE_HEIGHT 16
+
+#define XK_Tab 0xff09
+#define XK_Alt_L 0xffe9
+
+typedef enum {
+    WorkloadMap,
+    WorkloadMove,
+    WorkloadResize,
+    WorkloadBlink,
+    WorkloadScroll,
+    WorkloadAltTab
+} Workload;
+
+static const char *workloadNames[] = { "map", "move", "resize", "blink", "scroll", "alttab" };
+
+static xcb_keycode_t keycodeForKeysym(xcb_connection_t *c, xcb_keysym_t keysym)
+{
+    const xcb_setup_t *setup = xcb_get_setup(c);
+    xcb_keycode_t first = setup->min_keycode;
+    uint8_t count = setup->max_keycode - setup->min_keycode + 1;
+    xcb_get_keyboard_mapping_reply_t *reply =
+        xcb_get_keyboard_mapping_reply(c, xcb_get_keyboard_mapping(c, first, count), NULL);
+    xcb_keycode_t keycode = 0;
+
+    if (reply) {
+        xcb_keysym_t *keysyms = xcb_get_keyboard_mapping_keysyms(reply);
+        int perKeycode = reply->keysyms_per_keycode;
+        for (int i = 0; i < count * perKeycode && !keycode; i++) {
+            if (keysyms[i] == keysym) {
+                keycode = first + i / perKeycode;
+            }
+        }
+        free(reply);
+    }
+    return keycode;
+}
+
+static void fakeKey(xcb_connection_t *c, uint8_t type, xcb_keycode_t keycode)
+{
+    xcb_test_fake_input(c, type, keycode, XCB_CURRENT_TIME, XCB_NONE, 0, 0, 0);
+}
+
+static void sleepUntil(struct timespec *deadline)
+{
+    deadline->tv_nsec += FRAME_NSEC;
+    if (deadline->tv_nsec >= 1000000000L) {
+        deadline->tv_nsec -= 1000000000L;
+        deadline->tv_sec += 1;
+    }
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, deadline, NULL);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <map|move|resize|blink|scroll|alttab> <seconds> [index]\n", argv[0]);
+        return 2;
+    }
+
+    int workload = -1;
+    for (int i = 0; i < (int)(sizeof(workloadNames) / sizeof(workloadNames[0])); i++) {
+        if (strcmp(argv[1], workloadNames[i]) == 0) {
+            workload = i;
+        }
+    }
+    if (workload < 0) {
+        fprintf(stderr, "Unknown workload: %s\n", argv[1]);
+        return 2;
+    }
+
+    double seconds = atof(argv[2]);
+    int index = argc > 3 ? atoi(argv[3]) : 0;
+
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    if (xcb_connection_has_error(c)) {
+        fprintf(stderr, "Cannot open display\n");
+        return 1;
+    }
+    xcb_screen_t *screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+
+    int16_t originX = (int16_t)(40 + (index * 37) % (screen->width_in_pixels / 2));
+    int16_t originY = (int16_t)(40 + (index * 53) % (screen->height_in_pixels / 2));
+
+    xcb_window_t window = xcb_generate_id(c);
+    uint32_t values[] = { screen->white_pixel, XCB_EVENT_MASK_EXPOSURE | XCB_EVENT_MASK_STRUCTURE_NOTIFY };
+    xcb_create_window(c, XCB_COPY_FROM_PARENT, window, screen->root, originX, originY,
+                      WINDOW_WIDTH, WINDOW_HEIGHT, 0, XCB_WINDOW_CLASS_INPUT_OUTPUT,
+                      screen->root_visual, XCB_CW_BACK_PIXEL | XCB_CW_EVENT_MASK, values);
+
+    char title[64];
+    snprintf(title, sizeof(title), "ursbench %s %d", workloadNames[workload], index);
+    xcb_change_property(c, XCB_PROP_MODE_REPLACE, window, XCB_ATOM_WM_NAME, XCB_ATOM_STRING, 8,
+                        strlen(title), title);
+
+    xcb_gcontext_t foreground = xcb_generate_id(c);
+    xcb_gcontext_t background = xcb_generate_id(c);
+    uint32_t gcValues[] = { screen->black_pixel, 0 };
+    xcb_create_gc(c, foreground, window, XCB_GC_FOREGROUND | XCB_GC_GRAPHICS_EXPOSURES, gcValues);
+    gcValues[0] = screen->white_pixel;
+    xcb_create_gc(c, background, window, XCB_GC_FOREGROUND | XCB_GC_GRAPHICS_EXPOSURES, gcValues);
+
+    xcb_keycode_t tabKey = 0;
+    xcb_keycode_t altKey = 0;
+    if (workload == WorkloadAltTab) {
+        tabKey = keycodeForKeysym(c, XK_Tab);
+        altKey = keycodeForKeysym(c, XK_Alt_L);
+        if (!tabKey || !altKey) {
+            fprintf(stderr, "No keycode for Tab or Alt_L\n");
+            return 1;
+        }
+    }
+
+    xcb_map_window(c, window);
+    xcb_flush(c);
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    long frames = (long)(seconds * 60.0);
+    int mapped = 1;
+    int altDown = 0;
+
+    for (long frame = 0; frame < frames; frame++) {
+        xcb_generic_event_t *event;
+        while ((event = xcb_poll_for_event(c))) {
+            free(event);
+        }
+
+        switch (workload) {
+            case WorkloadMap:
+                if (frame % 10 == 0) {
+                    if (mapped) {
+                        xcb_unmap_window(c, window);
+                    } else {
+                        xcb_map_window(c, window);
+                    }
+                    mapped = !mapped;
+                }
+                break;
+
+            case WorkloadMove: {
+                double angle = (double)frame * 0.05;
+                uint32_t position[] = { (uint32_t)(originX + 100 + (int)(100.0 * cos(angle))),
+                                        (uint32_t)(originY + 100 + (int)(100.0 * sin(angle))) };
+                xcb_configure_window(c, window, XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y, position);
+                break;
+            }
+
+            case WorkloadResize: {
+                uint32_t step = (uint32_t)(frame % 60);
+                uint32_t grow = step < 30 ? step : 60 - step;
+                uint32_t size[] = { WINDOW_WIDTH + grow * 8, WINDOW_HEIGHT + grow * 6 };
+                xcb_configure_window(c, window, XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT, size);
+                break;
+            }
+
+            case WorkloadBlink: {
+                xcb_rectangle_t cursor = { 20, 20, 8, LINE_HEIGHT };
+                xcb_poly_fill_rectangle(c, window, (frame & 1) ? background : foreground, 1, &cursor);
+                break;
+            }
+
+            case WorkloadScroll: {
+                xcb_copy_area(c, window, window, foreground, 0, LINE_HEIGHT, 0, 0,
+                              WINDOW_WIDTH, WINDOW_HEIGHT - LINE_HEIGHT);
+                xcb_rectangle_t line = { 0, WINDOW_HEIGHT - LINE_HEIGHT, WINDOW_WIDTH, LINE_HEIGHT };
+                xcb_poly_fill_rectangle(c, window, background, 1, &line);
+                /* A line of "text": glyph-sized blocks of varying width */
+                for (int x = 4; x < WINDOW_WIDTH - 16; x += 10) {
+                    xcb_rectangle_t glyph = { (int16_t)x, WINDOW_HEIGHT - LINE_HEIGHT + 3,
+                                              (uint16_t)(4 + (frame + x) % 5), LINE_HEIGHT - 6 };
+                    xcb_poly_fill_rectangle(c, window, foreground, 1, &glyph);
+                }
+                break;
+            }
+
+            case WorkloadAltTab:
+                if (frame % 10 == 0) {
+                    if (!altDown) {
+                        fakeKey(c, XCB_KEY_PRESS, altKey);
+                        altDown = 1;
+                    }
+                    fakeKey(c, XCB_KEY_PRESS, tabKey);
+                    fakeKey(c, XCB_KEY_RELEASE, tabKey);
+                }
+                if (frame % 40 == 35 && altDown) {
+                    fakeKey(c, XCB_KEY_RELEASE, altKey);
+                    altDown = 0;
+                }
+                break;
+        }
+
+        xcb_flush(c);
+        sleepUntil(&deadline);
+    }
+
+    if (altDown) {
+        fakeKey(c, XCB_KEY_RELEASE, altKey);
+    }
+    xcb_destroy_window(c, window);
+    xcb_flush(c);
+    xcb_disconnect(c);
+    return 0;
+}
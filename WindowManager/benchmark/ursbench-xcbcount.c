@@ -0,0 +1,198 @@
+/*
+ * ursbench-xcbcount.c - LD_PRELOAD shim counting XCB requests and reply waits
+ *
+ * Built and preloaded into the window manager by test-xvfb-benchmark.sh.
+ * Every request goes through one of the xcb_send_request* entry points and
+ * every blocking round trip through xcb_wait_for_reply* or
+ * xcb_request_check, so wrapping those gives exact per-connection counts
+ * without touching the window manager. A reply wait for a reply that already
+ * arrived is still counted, so replyWaits is an upper bound on round trips.
+ *
+ * The counts are written as JSON to $URSBENCH_XCB_STATS when the process
+ * exits. Connections are told apart by their file descriptor (the window
+ * manager reports its own in the benchmark statistics).
+ *
+ *   cc -shared -fPIC -O2 -o ursbench-xcbcount.so ursbench-xcbcount.c -ldl
+ */
+
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/uio.h>
+#include <xcb/xcb.h>
+#include <xcb/xcbext.h>
+
+#define MAX_CONNECTIONS 16
+
+typedef struct {
+    xcb_connection_t *connection;
+    int fileDescriptor;
+    uint64_t requests;
+    uint64_t replyWaits;
+} ConnectionCounts;
+
+static ConnectionCounts counts[MAX_CONNECTIONS];
+
+/* libxcb's public entry points call each other (xcb_send_request ->
+ * xcb_send_request64 -> ...); only the outermost call is counted */
+static __thread int depth;
+
+static ConnectionCounts *countsFor(xcb_connection_t *c)
+{
+    for (int i = 0; i < MAX_CONNECTIONS; i++) {
+        xcb_connection_t *current = __atomic_load_n(&counts[i].connection, __ATOMIC_ACQUIRE);
+        if (current == c) {
+            return &counts[i];
+        }
+        if (current == NULL) {
+            xcb_connection_t *expected = NULL;
+            if (__atomic_compare_exchange_n(&counts[i].connection, &expected, c, 0,
+                                            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                /* Read now: the connection may be freed before the report is written */
+                counts[i].fileDescriptor = xcb_get_file_descriptor(c);
+                return &counts[i];
+            }
+            if (expected == c) {
+                return &counts[i];
+            }
+        }
+    }
+    return NULL;
+}
+
+static void countRequest(xcb_connection_t *c)
+{
+    ConnectionCounts *entry = countsFor(c);
+    if (entry) {
+        __atomic_add_fetch(&entry->requests, 1, __ATOMIC_RELAXED);
+    }
+}
+
+static void countReplyWait(xcb_connection_t *c)
+{
+    ConnectionCounts *entry = countsFor(c);
+    if (entry) {
+        __atomic_add_fetch(&entry->replyWaits, 1, __ATOMIC_RELAXED);
+    }
+}
+
+#define REAL(name) \
+    static __typeof__(&name) real; \
+    if (!real) real = (__typeof__(&name))dlsym(RTLD_NEXT, #name)
+
+/* Requests */
+
+unsigned int xcb_send_request(xcb_connection_t *c, int flags, struct iovec *vector,
+                              const xcb_protocol_request_t *request)
+{
+    REAL(xcb_send_request);
+    if (depth++ == 0) {
+        countRequest(c);
+    }
+    unsigned int sequence = real(c, flags, vector, request);
+    depth--;
+    return sequence;
+}
+
+uint64_t xcb_send_request64(xcb_connection_t *c, int flags, struct iovec *vector,
+                            const xcb_protocol_request_t *request)
+{
+    REAL(xcb_send_request64);
+    if (depth++ == 0) {
+        countRequest(c);
+    }
+    uint64_t sequence = real(c, flags, vector, request);
+    depth--;
+    return sequence;
+}
+
+unsigned int xcb_send_request_with_fds(xcb_connection_t *c, int flags, struct iovec *vector,
+                                       const xcb_protocol_request_t *request,
+                                       unsigned int num_fds, int *fds)
+{
+    REAL(xcb_send_request_with_fds);
+    if (depth++ == 0) {
+        countRequest(c);
+    }
+    unsigned int sequence = real(c, flags, vector, request, num_fds, fds);
+    depth--;
+    return sequence;
+}
+
+uint64_t xcb_send_request_with_fds64(xcb_connection_t *c, int flags, struct iovec *vector,
+                                     const xcb_protocol_request_t *request,
+                                     unsigned int num_fds, int *fds)
+{
+    REAL(xcb_send_request_with_fds64);
+    if (depth++ == 0) {
+        countRequest(c);
+    }
+    uint64_t sequence = real(c, flags, vector, request, num_fds, fds);
+    depth--;
+    return sequence;
+}
+
+/* Round trips */
+
+void *xcb_wait_for_reply(xcb_connection_t *c, unsigned int request, xcb_generic_error_t **e)
+{
+    REAL(xcb_wait_for_reply);
+    if (depth++ == 0) {
+        countReplyWait(c);
+    }
+    void *reply = real(c, request, e);
+    depth--;
+    return reply;
+}
+
+void *xcb_wait_for_reply64(xcb_connection_t *c, uint64_t request, xcb_generic_error_t **e)
+{
+    REAL(xcb_wait_for_reply64);
+    if (depth++ == 0) {
+        countReplyWait(c);
+    }
+    void *reply = real(c, request, e);
+    depth--;
+    return reply;
+}
+
+xcb_generic_error_t *xcb_request_check(xcb_connection_t *c, xcb_void_cookie_t cookie)
+{
+    REAL(xcb_request_check);
+    if (depth++ == 0) {
+        countReplyWait(c);
+    }
+    xcb_generic_error_t *error = real(c, cookie);
+    depth--;
+    return error;
+}
+
+/* Report */
+
+__attribute__((destructor))
+static void writeCounts(void)
+{
+    const char *path = getenv("URSBENCH_XCB_STATS");
+    if (!path) {
+        return;
+    }
+
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        return;
+    }
+
+    fprintf(file, "{\"connections\": [");
+    int written = 0;
+    for (int i = 0; i < MAX_CONNECTIONS && counts[i].connection; i++) {
+        fprintf(file, "%s\n  {\"requests\": %llu, \"replyWaits\": %llu, \"fileDescriptor\": %d}",
+                written++ ? "," : "",
+                (unsigned long long)counts[i].requests,
+                (unsigned long long)counts[i].replyWaits,
+                counts[i].fileDescriptor);
+    }
+    fprintf(file, "\n]}\n");
+    fclose(file);
+}
@@ -13,8 +13,10 @@
 #import "URSHybridEventHandler.h"
 #import "UROSWMApplication.h"
 #import "URSThemeIntegration.h"
+#import "URSPixelOps.h"
 #import <XCBKit/utils/XCBShape.h>
 #import <XCBKit/services/TitleBarSettingsService.h>
+#import <XCBKit/utils/XCBWindowTable.h>
 #import <signal.h>
 #import <string.h>
 
@@ -74,11 +76,28 @@ int main(int argc, const char * argv[])
                 enableCompositing = YES;
                 NSLog(@"[WindowManager] Compositing mode enabled via command-line flag");
                 break;
+            } else if (strcmp(argv[i], "--benchmark-window-table") == 0) {
+                // Window lookup microbenchmark; needs no X server
+                int counts[] = {100, 500, 2000};
+                for (int c = 0; c < 3; c++) {
+                    NSString *report = [XCBWindowTable lookupBenchmarkWithWindowCount:counts[c]
+                                                                            iterations:2000000];
+                    printf("%s\n", [report UTF8String]);
+                }
+                return 0;
+            } else if (strcmp(argv[i], "--benchmark-pixel-ops") == 0) {
+                // Pixel kernel check and benchmark: every SIMD path must match scalar
+                BOOL exact = NO;
+                NSString *report = URSPixelOpsSelfTest(1024 * 24, 2000, &exact);
+                printf("%s", [report UTF8String]);
+                return exact ? 0 : 1;
             } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
                 printf("WindowManager - Objective-C Window Manager\n");
                 printf("Usage: %s [options]\n\n", argv[0]);
                 printf("Options:\n");
                 printf("  -c, --compositing    Enable XRender compositing (experimental)\n");
+                printf("  --benchmark-window-table  Time window lookups (100/500/2000 windows) and exit\n");
+                printf("  --benchmark-pixel-ops     Check SIMD pixel kernels against scalar, time them and exit\n");
                 printf("  -h, --help          Show this help message\n\n");
                 printf("Without compositing, windows render directly (traditional mode).\n");
                 printf("With compositing, windows use XRender for transparency effects.\n");
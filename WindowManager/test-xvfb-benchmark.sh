@@ -0,0 +1,219 @@
+#!/bin/bash
+# test-xvfb-benchmark.sh - Headless compositor benchmark with synthetic clients
+#
+# Starts Xvfb and the window manager with --compositing, then runs each
+# workload (map, move, resize, blink, scroll, alttab) with N synthetic XCB
+# clients for a fixed time. The window manager runs under an LD_PRELOAD shim
+# that counts its X requests and reply waits, and dumps its frame statistics
+# on exit (URSBenchmarkStatsFile). Results are printed as JSON, one object
+# per workload:
+#
+#   paints, paint latency p50/p90/p99 (ms), requests per frame,
+#   requests and round trips per event, RSS and peak RSS (kB)
+#
+# Usage: ./test-xvfb-benchmark.sh [-n clients] [-d seconds] [-o results.json]
+#
+# Requires: Xvfb, cc, pkg-config (xcb, xcb-xtest), python3
+# Also available as "make benchmark" from the top-level directory.
+
+set -e
+
+# Configuration
+DISPLAY_NUM=":96"
+SCREEN_SIZE="1920x1080x24"
+CLIENTS=4
+DURATION=10
+OUTPUT=""
+WM_DIR="$(cd "$(dirname "$0")" && pwd)"
+WORK_DIR="$(mktemp -d)"
+WORKLOADS="map move resize blink scroll alttab"
+
+while getopts "n:d:o:h" opt; do
+    case $opt in
+        n) CLIENTS=$OPTARG ;;
+        d) DURATION=$OPTARG ;;
+        o) OUTPUT=$OPTARG ;;
+        *) echo "Usage: $0 [-n clients] [-d seconds] [-o results.json]"; exit 2 ;;
+    esac
+done
+
+# The window manager runs from its own directory
+case "$OUTPUT" in
+    ""|/*) ;;
+    *) OUTPUT="$PWD/$OUTPUT" ;;
+esac
+
+# Colors for output
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+YELLOW='\033[1;33m'
+NC='\033[0m' # No Color
+
+# Progress goes to stderr so stdout carries only the JSON
+echo -e "${GREEN}=== Compositor Benchmark (Xvfb) ===${NC}" >&2
+
+# Source GNUstep environment
+if [ -f /System/Library/Makefiles/GNUstep.sh ]; then
+    . /System/Library/Makefiles/GNUstep.sh
+fi
+
+for tool in Xvfb cc pkg-config python3; do
+    if ! command -v $tool >/dev/null 2>&1; then
+        echo -e "${RED}Missing required tool: $tool${NC}" >&2
+        exit 1
+    fi
+done
+
+if [ ! -x "$WM_DIR/WindowManager.app/WindowManager" ]; then
+    echo -e "${RED}WindowManager.app not built; run make first${NC}" >&2
+    exit 1
+fi
+
+# Cleanup function
+cleanup() {
+    if [ -n "$CLIENT_PIDS" ]; then
+        kill $CLIENT_PIDS 2>/dev/null || true
+    fi
+    if [ -n "$WM_PID" ]; then
+        kill $WM_PID 2>/dev/null || true
+    fi
+    if [ -n "$XVFB_PID" ]; then
+        kill $XVFB_PID 2>/dev/null || true
+    fi
+    rm -rf "$WORK_DIR"
+}
+
+trap cleanup EXIT
+
+# Build the synthetic client and the request counting shim
+cc -O2 -o "$WORK_DIR/ursbench-client" "$WM_DIR/benchmark/ursbench-client.c" \
+    $(pkg-config --cflags --libs xcb xcb-xtest) -lm
+cc -O2 -shared -fPIC -o "$WORK_DIR/ursbench-xcbcount.so" "$WM_DIR/benchmark/ursbench-xcbcount.c" \
+    $(pkg-config --cflags xcb) -ldl
+
+# One fresh server and window manager per workload, so the numbers don't mix
+run_workload() {
+    local workload=$1
+    local stats="$WORK_DIR/$workload-wm.json"
+    local counts="$WORK_DIR/$workload-xcb.json"
+
+    Xvfb $DISPLAY_NUM -screen 0 $SCREEN_SIZE -nolisten tcp 2>/dev/null &
+    XVFB_PID=$!
+    sleep 1
+
+    if ! kill -0 $XVFB_PID 2>/dev/null; then
+        echo -e "${RED}Failed to start Xvfb on $DISPLAY_NUM${NC}" >&2
+        exit 1
+    fi
+
+    export DISPLAY=$DISPLAY_NUM
+
+    cd "$WM_DIR"
+    URSBENCH_XCB_STATS="$counts" LD_PRELOAD="$WORK_DIR/ursbench-xcbcount.so" \
+        ./WindowManager.app/WindowManager --compositing -URSBenchmarkStatsFile "$stats" \
+        > "$WORK_DIR/$workload-wm.log" 2>&1 &
+    WM_PID=$!
+    sleep 3
+
+    if ! kill -0 $WM_PID 2>/dev/null; then
+        echo -e "${RED}Window manager crashed on startup!${NC}" >&2
+        cat "$WORK_DIR/$workload-wm.log" >&2
+        exit 1
+    fi
+
+    # Alt-Tab needs windows to cycle through but only one key driver
+    local drivers=$CLIENTS
+    CLIENT_PIDS=""
+    if [ "$workload" == "alttab" ]; then
+        for i in $(seq 1 "$CLIENTS"); do
+            "$WORK_DIR/ursbench-client" blink "$DURATION" "$i" &
+            CLIENT_PIDS="$CLIENT_PIDS $!"
+        done
+        drivers=1
+    fi
+    for i in $(seq 1 "$drivers"); do
+        "$WORK_DIR/ursbench-client" "$workload" "$DURATION" "$i" &
+        CLIENT_PIDS="$CLIENT_PIDS $!"
+    done
+
+    echo -e "${YELLOW}Running $workload with $CLIENTS clients for ${DURATION}s${NC}" >&2
+    wait $CLIENT_PIDS || true
+    CLIENT_PIDS=""
+
+    # Memory while the clients' windows were still being composited
+    local rss hwm
+    rss=$(awk '/^VmRSS:/ {print $2}' /proc/$WM_PID/status)
+    hwm=$(awk '/^VmHWM:/ {print $2}' /proc/$WM_PID/status)
+
+    # SIGTERM runs the clean shutdown, which writes the statistics
+    kill -TERM $WM_PID
+    wait $WM_PID 2>/dev/null || true
+    WM_PID=""
+    kill $XVFB_PID 2>/dev/null || true
+    wait $XVFB_PID 2>/dev/null || true
+    XVFB_PID=""
+
+    if [ ! -f "$stats" ]; then
+        echo -e "${RED}No statistics from the window manager for $workload${NC}" >&2
+        tail -n 20 "$WORK_DIR/$workload-wm.log" >&2
+        exit 1
+    fi
+
+    python3 - "$workload" "$stats" "$counts" "$rss" "$hwm" "$CLIENTS" "$DURATION" \
+        > "$WORK_DIR/$workload-result.json" <<'EOF'
+import json, sys
+
+workload, stats_path, counts_path, rss, hwm, clients, duration = sys.argv[1:]
+stats = json.load(open(stats_path))
+compositor = stats.get("compositor", {})
+
+# The shim sees every connection in the process (GNUstep's Xlib one too);
+# report the window manager's XCBKit connection
+requests = round_trips = None
+try:
+    for entry in json.load(open(counts_path))["connections"]:
+        if entry["fileDescriptor"] == stats.get("xcbFileDescriptor"):
+            requests, round_trips = entry["requests"], entry["replyWaits"]
+except (OSError, ValueError, KeyError):
+    pass
+
+events = stats.get("eventsProcessed", 0)
+per_event = lambda n: round(n / events, 3) if n is not None and events else None
+ms = lambda key: round(compositor.get(key, 0.0) * 1000.0, 3)
+
+print(json.dumps({
+    "workload": workload,
+    "clients": int(clients),
+    "seconds": float(duration),
+    "paints": compositor.get("framesPainted", 0),
+    "framesSkipped": compositor.get("framesSkipped", 0),
+    "paintLatencyMs": {"p50": ms("paintLatencyP50"), "p90": ms("paintLatencyP90"),
+                       "p99": ms("paintLatencyP99")},
+    "requestsPerFrame": compositor.get("requestsPerFrame"),
+    "paintRoundTrips": compositor.get("paintRoundTrips"),
+    "events": events,
+    "requests": requests,
+    "roundTrips": round_trips,
+    "requestsPerEvent": per_event(requests),
+    "roundTripsPerEvent": per_event(round_trips),
+    "rssKb": int(rss or 0),
+    "peakRssKb": int(hwm or 0),
+}))
+EOF
+}
+
+for workload in $WORKLOADS; do
+    run_workload "$workload"
+done
+
+RESULTS=$(python3 -c '
+import json, sys
+print(json.dumps([json.load(open(path)) for path in sys.argv[1:]], indent=2))
+' $(for workload in $WORKLOADS; do echo "$WORK_DIR/$workload-result.json"; done))
+
+if [ -n "$OUTPUT" ]; then
+    echo "$RESULTS" > "$OUTPUT"
+    echo -e "${GREEN}=== Results written to $OUTPUT ===${NC}" >&2
+else
+    echo "$RESULTS"
+fi
@@ -0,0 +1,147 @@
+#!/bin/bash
+# test-xvfb-expose.sh - Check that composited windows keep their contents
+#
+# Regression test for fixed-size dialogs (About panels, xmessage) that never
+# redraw themselves: their composited image must survive being covered,
+# uncovered, unmapped and mapped again. Runs headless in Xvfb with
+# compositing enabled and compares the dialog's client area before and after.
+#
+# Requires: Xvfb, xdotool, xwininfo, xwd, ImageMagick (convert), xmessage, xterm
+
+set -e
+
+# Configuration
+DISPLAY_NUM=":97"
+SCREEN_SIZE="1024x768x24"
+WM_DIR="$(cd "$(dirname "$0")" && pwd)"
+WORK_DIR="$(mktemp -d)"
+
+# Colors for output
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+YELLOW='\033[1;33m'
+NC='\033[0m' # No Color
+
+echo -e "${GREEN}=== Composited Expose Test (Xvfb) ===${NC}"
+
+# Source GNUstep environment
+if [ -f /System/Library/Makefiles/GNUstep.sh ]; then
+    . /System/Library/Makefiles/GNUstep.sh
+fi
+
+for tool in Xvfb xdotool xwininfo xwd convert xmessage xterm; do
+    if ! command -v $tool >/dev/null 2>&1; then
+        echo -e "${RED}Missing required tool: $tool${NC}"
+        exit 1
+    fi
+done
+
+# Cleanup function
+cleanup() {
+    if [ -n "$COVER_PID" ]; then
+        kill $COVER_PID 2>/dev/null || true
+    fi
+    if [ -n "$DIALOG_PID" ]; then
+        kill $DIALOG_PID 2>/dev/null || true
+    fi
+    if [ -n "$WM_PID" ]; then
+        kill $WM_PID 2>/dev/null || true
+    fi
+    if [ -n "$XVFB_PID" ]; then
+        kill $XVFB_PID 2>/dev/null || true
+    fi
+    rm -rf "$WORK_DIR"
+}
+
+trap cleanup EXIT
+
+# Start Xvfb
+Xvfb $DISPLAY_NUM -screen 0 $SCREEN_SIZE -nolisten tcp &
+XVFB_PID=$!
+sleep 1
+
+if ! kill -0 $XVFB_PID 2>/dev/null; then
+    echo -e "${RED}Failed to start Xvfb on $DISPLAY_NUM${NC}"
+    exit 1
+fi
+
+export DISPLAY=$DISPLAY_NUM
+
+# Start the window manager with compositing
+cd "$WM_DIR"
+./WindowManager.app/WindowManager --compositing > "$WORK_DIR/wm.log" 2>&1 &
+WM_PID=$!
+sleep 2
+
+if ! kill -0 $WM_PID 2>/dev/null; then
+    echo -e "${RED}Window manager crashed on startup!${NC}"
+    cat "$WORK_DIR/wm.log"
+    exit 1
+fi
+
+# Fixed-size dialog that only draws when asked to
+xmessage -geometry +200+200 -title "Expose Test Dialog" \
+    "Fixed-size dialog contents must survive expose" &
+DIALOG_PID=$!
+sleep 2
+
+DIALOG_WIN=$(xdotool search --sync --name "Expose Test Dialog" | head -n 1)
+
+# Grab the dialog's client area from the composited screen
+capture() {
+    local info x y w h
+    info=$(xwininfo -id "$DIALOG_WIN")
+    x=$(echo "$info" | awk '/Absolute upper-left X/ {print $4}')
+    y=$(echo "$info" | awk '/Absolute upper-left Y/ {print $4}')
+    w=$(echo "$info" | awk '/Width:/ {print $2}')
+    h=$(echo "$info" | awk '/Height:/ {print $2}')
+    xwd -root -silent | convert xwd:- -crop "${w}x${h}+${x}+${y}" +repage "$WORK_DIR/$1.png"
+    convert "$WORK_DIR/$1.png" -format '%#' info:
+}
+
+FAILED=0
+
+check() {
+    local name=$1
+    sleep 1
+    local sum
+    sum=$(capture "$name")
+    if [ "$sum" == "$REFERENCE" ]; then
+        echo -e "${GREEN}PASS${NC} $name"
+    else
+        echo -e "${RED}FAIL${NC} $name (contents differ, see $name.png)"
+        FAILED=1
+    fi
+}
+
+REFERENCE=$(capture reference)
+
+# 1. Cover the dialog completely, then move the cover away
+xterm -geometry 120x50+0+0 -title "Expose Test Cover" &
+COVER_PID=$!
+COVER_WIN=$(xdotool search --sync --name "Expose Test Cover" | head -n 1)
+sleep 1
+xdotool windowmove "$COVER_WIN" 600 400
+check uncovered
+
+# 2. Unmap and map the dialog again (minimize/restore)
+xdotool windowunmap --sync "$DIALOG_WIN"
+sleep 1
+xdotool windowmap --sync "$DIALOG_WIN"
+check remapped
+
+# 3. Raise the cover over the dialog and close it
+xdotool windowmove "$COVER_WIN" 0 0
+xdotool windowraise "$COVER_WIN"
+sleep 1
+kill $COVER_PID
+COVER_PID=""
+check cover-closed
+
+if [ $FAILED -ne 0 ]; then
+    cp "$WORK_DIR"/*.png "$WM_DIR"/ 2>/dev/null || true
+    echo -e "${RED}=== Expose test FAILED ===${NC}"
+    exit 1
+fi
+
+echo -e "${GREEN}=== Expose test passed ===${NC}"
@@ -11,6 +11,12 @@
 #import "XCBVisual.h"
 #import "utils/XCBCreateWindowTypeRequest.h"
 #import "utils/XCBWindowTypeResponse.h"
+#import "utils/XCBWindowTable.h"
+#import "utils/XCBShmImagePool.h"
+#import "utils/XCBWindowSnapshot.h"
+#import "utils/XCBMoveController.h"
+#import "utils/XCBResizeSync.h"
+#import "utils/XCBRootStacking.h"
 #import "XCBReply.h"
 #include <xcb/xcb.h>
 
@@ -41,6 +47,13 @@ typedef NS_ENUM(NSInteger, SnapZone) {
     SnapZoneBottomRight  // Snap to bottom-right quarter
 };
 
+/*** Handlers registered per atom; dispatch is a table lookup on the event's atom ***/
+typedef void (^XCBPropertyNotifyHandler)(xcb_property_notify_event_t *anEvent);
+typedef void (^XCBClientMessageHandler)(xcb_client_message_event_t *anEvent);
+/*** Called when a frame whose titlebar redraw was deferred stops being fully obscured ***/
+@class XCBFrame;
+typedef void (^XCBFrameRevealHandler)(XCBFrame *aFrame);
+
 @class XCBWindow;
 @class EWMHService;
 @class XCBAtomService;
@@ -50,18 +63,35 @@ typedef NS_ENUM(NSInteger, SnapZone) {
 {
     xcb_connection_t *connection;
     NSString *displayName;
-    NSMutableDictionary *windowsMap;
+    XCBWindowTable *windowsMap;
+    XCBWindowTable *framesMap;
+    XCBWindowTable *titleBarsMap;
+    XCBWindowTable *clientsMap;
+    XCBShmImagePool *shmImagePool;
+    XCBWindowTable *windowSnapshots;
+    XCBWindowTable *propertyHandlers;      /*** atom -> NSMutableArray of XCBPropertyNotifyHandler ***/
+    XCBWindowTable *clientMessageHandlers; /*** atom -> XCBClientMessageHandler ***/
 	NSMutableArray *screens;
 	BOOL needFlush;
     xcb_timestamp_t currentTime;
     xcb_window_t clientList[CLIENTLISTSIZE];
+    xcb_window_t clientListStacking[CLIENTLISTSIZE]; /* bottom to top */
+    XCBRootStacking *rootStacking;                    /* every root child, for restacks above unmanaged windows */
+    BOOL clientListNeedsUpdate;
+    xcb_motion_notify_event_t heldResizeMotion;
+    BOOL hasHeldResizeMotion;
 }
 
 @property (nonatomic, assign) BOOL dragState;
+/*** Titlebar drag in progress; drives the frame from cached rects while dragState is YES ***/
+@property (strong, nonatomic, readonly) XCBMoveController *moveController;
+/*** _NET_WM_SYNC_REQUEST pacing of the resize in progress while resizeState is YES ***/
+@property (strong, nonatomic, readonly) XCBResizeSync *resizeSync;
 @property (strong, nonatomic) XCBRegion* damagedRegions;
 @property (nonatomic, assign) BOOL xfixesInitialized;
 @property (nonatomic, assign) BOOL resizeState;
 @property (nonatomic, assign) NSInteger clientListIndex;
+@property (nonatomic, assign) NSInteger clientListStackingIndex;
 @property (nonatomic, assign, readonly) BOOL isAWindowManager;
 @property (nonatomic, assign) BOOL isWindowsMapUpdated;
 
@@ -81,6 +111,12 @@ typedef NS_ENUM(NSInteger, SnapZone) {
 @property (nonatomic, assign) xcb_timestamp_t snapZoneEntryTime;
 @property (nonatomic, assign) BOOL snapPreviewShown;
 
+/*** Frame visibility: when YES the compositor supplies it and VisibilityNotify is ignored
+     (redirected windows are always reported unobscured). Without a reveal handler a
+     deferred titlebar is redrawn with drawTitleBarComponents. ***/
+@property (nonatomic, assign) BOOL visibilityFromCompositor;
+@property (nonatomic, copy) XCBFrameRevealHandler frameRevealHandler;
+
 + (XCBConnection *) sharedConnectionAsWindowManager:(BOOL)asWindowManager;
 - (xcb_connection_t *) connection;
 /**
@@ -91,8 +127,20 @@ typedef NS_ENUM(NSInteger, SnapZone) {
 - (id) initWithDisplay:(NSString *) aDisplay asWindowManager:(BOOL)isWindowManager;
 - (void) registerWindow:(XCBWindow*) aWindow;
 - (void) unregisterWindow:(XCBWindow *) aWindow;
-- (NSMutableDictionary *) windowsMap;
-- (void) setWindowsMap:(NSMutableDictionary *)aWindowsMap;
+/*** All registered windows, plus typed indexes that can be iterated without class checks ***/
+- (XCBWindowTable *) windowsMap;
+- (XCBWindowTable *) framesMap;
+- (XCBWindowTable *) titleBarsMap;
+- (XCBWindowTable *) clientsMap;
+/*** Image uploads (MIT-SHM when available), created on first use ***/
+- (XCBShmImagePool *) shmImagePool;
+/*** Prefetched window state; while a snapshot exists, the services answer reads of its atoms from it.
+     Managed clients keep theirs until unregistered; PropertyNotify drops the changed atom. ***/
+- (void) prefetchSnapshotsForWindows:(const xcb_window_t *)windows count:(NSUInteger)count;
+/*** Selects client events on a new window and prefetches it, unless a snapshot already exists ***/
+- (XCBWindowSnapshot *) prefetchSnapshotForClient:(xcb_window_t)aWindow;
+- (XCBWindowSnapshot *) snapshotForWindow:(xcb_window_t)aWindow;
+- (void) discardSnapshotForWindow:(xcb_window_t)aWindow;
 - (void) closeConnection;
 - (XCBWindow*) windowForXCBId:(xcb_window_t)anId;
 - (int) flush;
@@ -128,19 +176,32 @@ typedef NS_ENUM(NSInteger, SnapZone) {
 - (void) handleKeyPress: (xcb_key_press_event_t*)anEvent;
 - (void) handleKeyRelease: (xcb_key_release_event_t*)anEvent;
 - (void) handleMotionNotify: (xcb_motion_notify_event_t*)anEvent;
+/*** Keeps a resize motion while the client has not caught up with the last size (latest wins) ***/
+- (BOOL) holdResizeMotion:(xcb_motion_notify_event_t*)anEvent;
+/*** Copies out and clears the held motion; NO when there is none ***/
+- (BOOL) takeHeldResizeMotion:(xcb_motion_notify_event_t*)outEvent;
 - (void) handleEnterNotify: (xcb_enter_notify_event_t*)anEvent;
 - (void) handleLeaveNotify: (xcb_leave_notify_event_t*)anEvent;
 - (void) handleExpose: (xcb_expose_event_t*)anEvent;
 - (void) handleCirculateRequest: (xcb_circulate_request_event_t*)anEvent;
 - (void) handleConfigureWindowRequest: (xcb_configure_request_event_t*)anEvent;
 - (void) handleConfigureNotify: (xcb_configure_notify_event_t*)anEvent;
+- (void) handleCirculateNotify: (xcb_circulate_notify_event_t*)anEvent;
 - (void) handleReparentNotify: (xcb_reparent_notify_event_t*)anEvent;
 - (void) handlePropertyNotify: (xcb_property_notify_event_t*)anEvent;
+
+/*** Atoms are interned once here (pipelined); handlers run in registration order ***/
+- (void) addPropertyNotifyHandler:(XCBPropertyNotifyHandler)aHandler forAtoms:(NSArray*)atomNames;
+/*** A registered client message is consumed by its handler and not passed on to EWMH/ICCCM handling ***/
+- (void) setClientMessageHandler:(XCBClientMessageHandler)aHandler forAtom:(NSString*)anAtomName;
 - (void) handleClientMessage: (xcb_client_message_event_t*)anEvent;
 - (void) handleDestroyNotify: (xcb_destroy_notify_event_t*)anEvent;
 - (void) handleFocusOut: (xcb_focus_out_event_t*)anEvent;
 - (void) handleFocusIn: (xcb_focus_in_event_t*)anEvent;
 - (void) handleVisibilityEvent: (xcb_visibility_notify_event_t*)anEvent;
+/*** Records the XCB_VISIBILITY_* state of a frame, exports it as _GERSHWIN_WM_VISIBILITY
+     on the client and runs deferred titlebar redraws; unknown windows are ignored ***/
+- (void) setVisibility:(uint8_t)aState forFrameWindow:(xcb_window_t)aFrameWindow;
 
 /*** SENDS EVENTS ***/
 
@@ -162,6 +223,14 @@ typedef NS_ENUM(NSInteger, SnapZone) {
 - (void) setCurrentTime:(xcb_timestamp_t)time;
 - (XCBWindow*) rootWindowForScreenNumber:(int)number;
 - (xcb_window_t*) clientList;
+- (xcb_window_t*) clientListStacking;
+
+/*** _NET_CLIENT_LIST(_STACKING) bookkeeping: lists change locally, properties are written on flush ***/
+- (void) raiseInClientListStacking:(xcb_window_t)aWindow;
+- (void) lowerInClientListStacking:(xcb_window_t)aWindow;
+- (void) restackInClientListStacking:(xcb_window_t)aWindow aboveSibling:(xcb_window_t)aSibling;
+- (void) setClientListNeedsUpdate;
+- (BOOL) updateClientListIfNeeded;
 
 /*** WINDOW TILING ***/
 
@@ -48,10 +48,13 @@
 @implementation XCBConnection
 
 @synthesize dragState;
+@synthesize moveController;
+@synthesize resizeSync;
 @synthesize damagedRegions;
 @synthesize xfixesInitialized;
 @synthesize resizeState;
 @synthesize clientListIndex;
+@synthesize clientListStackingIndex;
 @synthesize isAWindowManager;
 @synthesize isWindowsMapUpdated;
 
@@ -93,7 +96,17 @@ static XCBConnection *sharedInstance;
         localDisplayName = [aDisplay UTF8String];
     }
 
-    windowsMap = [[NSMutableDictionary alloc] initWithCapacity:1000];
+    windowsMap = [[XCBWindowTable alloc] initWithCapacity:1000];
+    framesMap = [[XCBWindowTable alloc] initWithCapacity:256];
+    titleBarsMap = [[XCBWindowTable alloc] initWithCapacity:256];
+    clientsMap = [[XCBWindowTable alloc] initWithCapacity:256];
+    propertyHandlers = [[XCBWindowTable alloc] initWithCapacity:64];
+    clientMessageHandlers = [[XCBWindowTable alloc] initWithCapacity:64];
+    windowSnapshots = [[XCBWindowTable alloc] initWithCapacity:64];
+    moveController = [[XCBMoveController alloc] init];
+    resizeSync = [[XCBResizeSync alloc] initWithConnection:self];
+    rootStacking = [[XCBRootStacking alloc] init];
+    hasHeldResizeMotion = NO;
     isWindowsMapUpdated = NO;
 
     screens = [NSMutableArray new];
@@ -128,8 +141,11 @@ static XCBConnection *sharedInstance;
     [EWMHService sharedInstanceWithConnection:self];
     currentTime = XCB_CURRENT_TIME;
     icccmService = [ICCCMService sharedInstanceWithConnection:self];
+    [self registerAtomHandlers];
 
     clientListIndex = 0;
+    clientListStackingIndex = 0;
+    clientListNeedsUpdate = NO;
 
     resizeState = NO;
 
@@ -165,14 +181,32 @@ static XCBConnection *sharedInstance;
     return connection;
 }
 
-- (NSMutableDictionary *)windowsMap
+- (XCBWindowTable *)windowsMap
 {
     return windowsMap;
 }
 
-- (void) setWindowsMap:(NSMutableDictionary *)aWindowsMap
+- (XCBWindowTable *)framesMap
 {
-    windowsMap = aWindowsMap;
+    return framesMap;
+}
+
+- (XCBWindowTable *)titleBarsMap
+{
+    return titleBarsMap;
+}
+
+- (XCBWindowTable *)clientsMap
+{
+    return clientsMap;
+}
+
+- (XCBShmImagePool *)shmImagePool
+{
+    if (shmImagePool == nil)
+        shmImagePool = [[XCBShmImagePool alloc] initWithConnection:self];
+
+    return shmImagePool;
 }
 
 - (void)registerWindow:(XCBWindow *)aWindow
@@ -189,33 +223,38 @@ static XCBConnection *sharedInstance;
     xcb_window_t win = [aWindow window];
 
     NSLog(@"[XCBConnection] Adding the window %u in the windowsMap", win);
-    NSNumber *key = [[NSNumber alloc] initWithInt:win];
-    XCBWindow *window = [windowsMap objectForKey:key];
-    EWMHService *ewmhService = [EWMHService sharedInstanceWithConnection:self];
+    XCBWindow *window = [windowsMap objectForWindow:win];
 
     if (window != nil)
     {
         // Window already registered - skip duplicate registration
         window = nil;
-        key = nil;
         return;
     }
-    
-    if ([aWindow isKindOfClass:[XCBFrame class]] ||
-        [aWindow isKindOfClass:[XCBTitleBar class]] ||
-        [aWindow isCloseButton] || [aWindow isMaximizeButton] || [aWindow isMinimizeButton])
-        win = 0;
 
-    if (win != 0)
-        clientList[clientListIndex++] = win;
+    [windowsMap setObject:aWindow forWindow:win];
+
+    // Typed indexes, so callers never have to filter the whole map by class
+    if ([aWindow isKindOfClass:[XCBFrame class]])
+        [framesMap setObject:aWindow forWindow:win];
+    else if ([aWindow isKindOfClass:[XCBTitleBar class]])
+        [titleBarsMap setObject:aWindow forWindow:win];
+    else if (![aWindow isCloseButton] && ![aWindow isMaximizeButton] && ![aWindow isMinimizeButton])
+    {
+        [clientsMap setObject:aWindow forWindow:win];
+
+        if (clientListIndex < CLIENTLISTSIZE)
+        {
+            clientList[clientListIndex++] = win;
+            /* new clients are mapped on top */
+            clientListStacking[clientListStackingIndex++] = win;
+            clientListNeedsUpdate = YES;
+        }
+    }
 
-    [ewmhService updateNetClientList];
-    [windowsMap setObject:aWindow forKey:key];
     isWindowsMapUpdated = YES;
 
     window = nil;
-    key = nil;
-    ewmhService = nil;
 }
 
 - (void)unregisterWindow:(XCBWindow *)aWindow
@@ -225,37 +264,114 @@ static XCBConnection *sharedInstance;
 
     xcb_window_t win = [aWindow window];
     NSLog(@"[XCBConnection] Removing the window %u from the windowsMap", win);
-    NSNumber *key = [[NSNumber alloc] initWithInt:win];
-    [windowsMap removeObjectForKey:key];
-    
-    EWMHService *ewmhService = [EWMHService sharedInstanceWithConnection:self];
+    [windowsMap removeObjectForWindow:win];
+    [framesMap removeObjectForWindow:win];
+    [titleBarsMap removeObjectForWindow:win];
+    [clientsMap removeObjectForWindow:win];
+    [windowSnapshots removeObjectForWindow:win];
     
     BOOL removed = FnRemoveWindowFromWindowsArray(clientList, clientListIndex, win);
     
     if (removed)
+    {
         clientListIndex--;
+        clientListNeedsUpdate = YES;
+    }
 
-    [ewmhService updateNetClientList];
+    if (FnRemoveWindowFromWindowsArray(clientListStacking, clientListStackingIndex, win))
+        clientListStackingIndex--;
+}
 
-    ewmhService = nil;
-    key = nil;
+#pragma mark - Window snapshots
+
+/*** Everything handleMapRequest reads from a new client ***/
+- (NSArray *)snapshotAtomNames
+{
+    EWMHService *ewmhService = [EWMHService sharedInstanceWithConnection:self];
+
+    return @[[icccmService WMHints], [icccmService WMNormalHints], [icccmService WMClass],
+             [icccmService WMProtocols], [icccmService WMName],
+             [ewmhService EWMHWMName], [ewmhService EWMHWMVisibleName], [ewmhService EWMHWMWindowType],
+             [ewmhService EWMHWMStrut], [ewmhService EWMHWMStrutPartial], [ewmhService MotifWMHints],
+             [ewmhService EWMHWMIcon], [ewmhService EWMHWMState], [ewmhService EWMHWMIconGeometry]];
+}
+
+- (XCBWindowSnapshot *)prefetchSnapshotForClient:(xcb_window_t)aWindow
+{
+    XCBWindowSnapshot *snapshot = [windowSnapshots objectForWindow:aWindow];
+
+    if (snapshot != nil)
+        return snapshot;
+
+    /*** selected first, so a change racing the fetch still arrives as PropertyNotify ***/
+    uint32_t clientMask[] = {CLIENT_SELECT_INPUT_EVENT_MASK};
+    xcb_change_window_attributes(connection, aWindow, XCB_CW_EVENT_MASK, clientMask);
+
+    [self prefetchSnapshotsForWindows:&aWindow count:1];
+
+    return [windowSnapshots objectForWindow:aWindow];
+}
+
+- (void)prefetchSnapshotsForWindows:(const xcb_window_t *)windows count:(NSUInteger)count
+{
+    if (count == 0)
+        return;
+
+    XCBAtomService *atomService = [XCBAtomService sharedInstanceWithConnection:self];
+    NSArray *atomNames = [self snapshotAtomNames];
+    NSUInteger atomsCount = [atomNames count];
+    xcb_atom_t atoms[atomsCount];
+
+    [atomService cacheAtoms:atomNames];
+
+    for (NSUInteger i = 0; i < atomsCount; i++)
+        atoms[i] = [atomService atomFromCachedAtomsWithKey:[atomNames objectAtIndex:i]];
+
+    NSArray *snapshots = [XCBWindowSnapshot snapshotsForWindows:windows
+                                                          count:count
+                                                          atoms:atoms
+                                                     atomsCount:atomsCount
+                                                   onConnection:self];
+
+    for (XCBWindowSnapshot *snapshot in snapshots)
+        [windowSnapshots setObject:snapshot forWindow:[snapshot window]];
+
+    atomService = nil;
+}
+
+- (XCBWindowSnapshot *)snapshotForWindow:(xcb_window_t)aWindow
+{
+    /*** the table is not locked; background readers (allowed actions) always go to the server ***/
+    if ([windowSnapshots count] == 0 || ![NSThread isMainThread])
+        return nil;
+
+    return [windowSnapshots objectForWindow:aWindow];
+}
+
+- (void)discardSnapshotForWindow:(xcb_window_t)aWindow
+{
+    [windowSnapshots removeObjectForWindow:aWindow];
 }
 
 - (void)closeConnection
 {
+    /*** the pool detaches its segments, so it has to go before the connection ***/
+    shmImagePool = nil;
+    [propertyHandlers removeAllObjects];
+    [clientMessageHandlers removeAllObjects];
+    [windowSnapshots removeAllObjects];
     xcb_disconnect(connection);
 }
 
 - (XCBWindow *)windowForXCBId:(xcb_window_t)anId
 {
-    NSNumber *key = [NSNumber numberWithInt:anId];
-    XCBWindow *window = [windowsMap objectForKey:key];
-    key = nil;
-    return window;
+    return [windowsMap objectForWindow:anId];
 }
 
 - (int)flush
 {
+    [self updateClientListIfNeeded];
+
     int flushResult = xcb_flush(connection);
     needFlush = NO;
     return flushResult;
@@ -561,7 +677,7 @@ static XCBConnection *sharedInstance;
                           [window window], [leader window]);
 
                     // Find and restore all windows with the same leader
-                    NSArray *allWindows = [windowsMap allValues];
+                    NSArray *allWindows = [windowsMap allObjects];
                     for (XCBWindow *groupedWindow in allWindows)
                     {
                         // Skip windows that aren't minimized or don't share the same leader
@@ -876,6 +992,9 @@ static XCBConnection *sharedInstance;
 
     if ([window decorated] == NO && !isManaged)
     {
+        // OPTIMIZATION: every property read below is answered from one prefetched burst
+        [self prefetchSnapshotForClient:anEvent->window];
+
         window = [[XCBWindow alloc] initWithXCBWindow:anEvent->window andConnection:self];
         [window updateAttributes];
 
@@ -898,6 +1017,7 @@ static XCBConnection *sharedInstance;
         {
             [reply description];
             reply = nil;
+            [self discardSnapshotForWindow:anEvent->window];
             return;
         }
 
@@ -910,6 +1030,7 @@ static XCBConnection *sharedInstance;
                 window = nil;
                 reply = nil;
                 ewmhService = nil;
+                [self discardSnapshotForWindow:anEvent->window];
                 return;
             }
             reply = nil;
@@ -1254,6 +1375,8 @@ static XCBConnection *sharedInstance;
 
     NSLog(@"Client window decorated with id %u at %d,%d", [window window], xPos, yPos);
     [frame initCursor];  // Must init cursor BEFORE decorateClientWindow - resize zones need it
+    // Prefetched geometry and attributes describe the client before reparenting
+    [[self snapshotForWindow:[window window]] discardGeometryAndAttributes];
     [frame decorateClientWindow];
     [self mapWindow:frame];
     [self registerWindow:window];
@@ -1390,6 +1513,30 @@ static XCBConnection *sharedInstance;
 {
     // NSLog(@"In configure notify for window %u: %d, %d", anEvent->window, anEvent->x, anEvent->y);
 
+    /* top-level restacks (ours or a client's) keep _NET_CLIENT_LIST_STACKING current */
+    XCBWindow *rootWindow = [self rootWindowForScreenNumber:0];
+
+    if (anEvent->event == [rootWindow window])
+    {
+        [rootStacking restackWindow:anEvent->window aboveSibling:anEvent->above_sibling];
+        [self restackInClientListStacking:anEvent->window aboveSibling:anEvent->above_sibling];
+    }
+}
+
+- (void)handleCirculateNotify:(xcb_circulate_notify_event_t *)anEvent
+{
+    XCBWindow *rootWindow = [self rootWindowForScreenNumber:0];
+
+    if (anEvent->event != [rootWindow window])
+        return;
+
+    BOOL toTop = anEvent->place == XCB_PLACE_ON_TOP;
+    [rootStacking circulateWindow:anEvent->window toTop:toTop];
+
+    if (toTop)
+        [self raiseInClientListStacking:anEvent->window];
+    else
+        [self lowerInClientListStacking:anEvent->window];
 }
 
 - (void)handleMotionNotify:(xcb_motion_notify_event_t *)anEvent
@@ -1402,7 +1549,14 @@ static XCBConnection *sharedInstance;
         ([[window parentWindow] window] != [rootWindow window])*/)
     {
         frame = (XCBFrame *) [window parentWindow];
-        [window grabPointer];
+
+        // PERFORMANCE FIX: GrabPointer waits for its reply; grab once per drag, not per motion event
+        if (![window pointerGrabbed])
+            [window grabPointer];
+
+        // First motion of the drag; a click without motion moves nothing and sends nothing
+        if ([moveController frame] != frame)
+            [moveController beginForFrame:frame];
 
         // Get the destination point from mouse position
         int16_t mouseX = anEvent->root_x;
@@ -1452,8 +1606,10 @@ static XCBConnection *sharedInstance;
         int16_t destX = frameX + offset.x;
         int16_t destY = frameY + offset.y;
         XCBPoint destPoint = XCBMakePoint(destX, destY);
-        [frame moveTo:destPoint];
-        [frame configureClient];
+
+        // PERFORMANCE FIX: configureClient did three GetGeometry round-trips per motion event.
+        // The move controller works from cached rects and rate-limits the synthetic ConfigureNotify.
+        [moveController moveTo:destPoint time:anEvent->time];
 
         // Edge and corner snap detection - check if mouse is near screen edges/corners
         if (self.workareaValid) {
@@ -1592,6 +1748,10 @@ static XCBConnection *sharedInstance;
         if ([window isKindOfClass:[XCBFrame class]])
             frame = (XCBFrame *) window;
 
+        // First motion of the resize: find out whether the client paces it with a sync counter
+        if (frame && [resizeSync frame] != frame)
+            [resizeSync beginForFrame:frame];
+
         [frame resize:anEvent xcbConnection:connection];
         needFlush = YES;
     }
@@ -1600,6 +1760,26 @@ static XCBConnection *sharedInstance;
     frame = nil;
 }
 
+- (BOOL)holdResizeMotion:(xcb_motion_notify_event_t *)anEvent
+{
+    if (!resizeState || ![resizeSync isWaiting])
+        return NO;
+
+    heldResizeMotion = *anEvent;
+    hasHeldResizeMotion = YES;
+    return YES;
+}
+
+- (BOOL)takeHeldResizeMotion:(xcb_motion_notify_event_t *)outEvent
+{
+    if (!hasHeldResizeMotion)
+        return NO;
+
+    *outEvent = heldResizeMotion;
+    hasHeldResizeMotion = NO;
+    return YES;
+}
+
 - (void)handleButtonPress:(xcb_button_press_event_t *)anEvent
 {
     XCBWindow *window = [self windowForXCBId:anEvent->event];
@@ -2027,6 +2207,15 @@ static XCBConnection *sharedInstance;
         }
     }
 
+    // Drop: the client gets its final position even if the last motion was rate-limited
+    if ([moveController isActive])
+        [moveController end];
+
+    // The resize is over; the hybrid handler has already applied any motion held for a slow client
+    if ([resizeSync frame])
+        [resizeSync end];
+    hasHeldResizeMotion = NO;
+
     /*if (resizeState && [window isKindOfClass:[XCBFrame class]])
     {
         frame = (XCBFrame*) window;
@@ -2131,78 +2320,181 @@ static XCBConnection *sharedInstance;
     }
 }
 
-- (void) handlePropertyNotify:(xcb_property_notify_event_t*)anEvent
+#pragma mark - Atom handler registry
+
+- (void) addPropertyNotifyHandler:(XCBPropertyNotifyHandler)aHandler forAtoms:(NSArray*)atomNames
 {
     XCBAtomService *atomService = [XCBAtomService sharedInstanceWithConnection:self];
+    [atomService cacheAtoms:atomNames];
 
-    NSString *name = [atomService atomNameFromAtom:anEvent->atom];
-    NSLog(@"Property changed for window: %u, with name: %@", anEvent->window, name);
+    for (NSString *atomName in atomNames)
+    {
+        xcb_atom_t atom = [atomService atomFromCachedAtomsWithKey:atomName];
+
+        if (atom == XCB_ATOM_NONE)
+            continue;
+
+        NSMutableArray *handlers = [propertyHandlers objectForWindow:atom];
+
+        if (handlers == nil)
+        {
+            handlers = [[NSMutableArray alloc] init];
+            [propertyHandlers setObject:handlers forWindow:atom];
+        }
+
+        [handlers addObject:[aHandler copy]];
+    }
+
+    atomService = nil;
+}
+
+- (void) setClientMessageHandler:(XCBClientMessageHandler)aHandler forAtom:(NSString*)anAtomName
+{
+    XCBAtomService *atomService = [XCBAtomService sharedInstanceWithConnection:self];
+    xcb_atom_t atom = [atomService cacheAtom:anAtomName];
+
+    if (atom != XCB_ATOM_NONE)
+        [clientMessageHandlers setObject:[aHandler copy] forWindow:atom];
+
+    atomService = nil;
+}
+
+/*** Handlers for the properties and messages the connection itself acts on, interned in one batch ***/
+- (void) registerAtomHandlers
+{
+    XCBAtomService *atomService = [XCBAtomService sharedInstanceWithConnection:self];
+    EWMHService *ewmhService = [EWMHService sharedInstanceWithConnection:self];
+    __weak XCBConnection *weakSelf = self;
+
+    NSArray *gershwinMessages = @[@"_GERSHWIN_CENTER_WINDOW", @"_GERSHWIN_TILE_LEFT", @"_GERSHWIN_TILE_RIGHT",
+                                  @"_GERSHWIN_TILE_TOP_LEFT", @"_GERSHWIN_TILE_TOP_RIGHT",
+                                  @"_GERSHWIN_TILE_BOTTOM_LEFT", @"_GERSHWIN_TILE_BOTTOM_RIGHT"];
+
+    /*** _GERSHWIN_WM_VISIBILITY is written from the compositor's paint pass, which must not intern ***/
+    [atomService cacheAtoms:[gershwinMessages arrayByAddingObjectsFromArray:
+                             @[@"WM_HINTS", [ewmhService EWMHWMWindowType], [ewmhService EWMHWorkarea],
+                               @"_GERSHWIN_WM_VISIBILITY"]]];
+
+    [self addPropertyNotifyHandler:^(xcb_property_notify_event_t *anEvent) {
+        [[weakSelf windowForXCBId:anEvent->window] refreshCachedWMHints];
+    } forAtoms:@[@"WM_HINTS"]];
+
+    [self addPropertyNotifyHandler:^(xcb_property_notify_event_t *anEvent) {
+        [weakSelf handleWindowTypePropertyNotify:anEvent];
+    } forAtoms:@[[ewmhService EWMHWMWindowType]]];
+
+    [self addPropertyNotifyHandler:^(xcb_property_notify_event_t *anEvent) {
+        [weakSelf handleWorkareaPropertyNotify:anEvent];
+    } forAtoms:@[[ewmhService EWMHWorkarea]]];
+
+    [self setClientMessageHandler:^(xcb_client_message_event_t *anEvent) {
+        NSLog(@"[ClientMessage] Center Window requested");
+        [weakSelf centerActiveWindow];
+    } forAtom:@"_GERSHWIN_CENTER_WINDOW"];
+
+    [self setClientMessageHandler:^(xcb_client_message_event_t *anEvent) {
+        NSLog(@"[ClientMessage] Tile Left requested");
+        [weakSelf tileActiveWindowLeft];
+    } forAtom:@"_GERSHWIN_TILE_LEFT"];
+
+    [self setClientMessageHandler:^(xcb_client_message_event_t *anEvent) {
+        NSLog(@"[ClientMessage] Tile Right requested");
+        [weakSelf tileActiveWindowRight];
+    } forAtom:@"_GERSHWIN_TILE_RIGHT"];
+
+    [self setClientMessageHandler:^(xcb_client_message_event_t *anEvent) {
+        NSLog(@"[ClientMessage] Tile Top Left requested");
+        [weakSelf tileActiveWindowToZone:SnapZoneTopLeft];
+    } forAtom:@"_GERSHWIN_TILE_TOP_LEFT"];
+
+    [self setClientMessageHandler:^(xcb_client_message_event_t *anEvent) {
+        NSLog(@"[ClientMessage] Tile Top Right requested");
+        [weakSelf tileActiveWindowToZone:SnapZoneTopRight];
+    } forAtom:@"_GERSHWIN_TILE_TOP_RIGHT"];
+
+    [self setClientMessageHandler:^(xcb_client_message_event_t *anEvent) {
+        NSLog(@"[ClientMessage] Tile Bottom Left requested");
+        [weakSelf tileActiveWindowToZone:SnapZoneBottomLeft];
+    } forAtom:@"_GERSHWIN_TILE_BOTTOM_LEFT"];
+
+    [self setClientMessageHandler:^(xcb_client_message_event_t *anEvent) {
+        NSLog(@"[ClientMessage] Tile Bottom Right requested");
+        [weakSelf tileActiveWindowToZone:SnapZoneBottomRight];
+    } forAtom:@"_GERSHWIN_TILE_BOTTOM_RIGHT"];
+
+    atomService = nil;
+    ewmhService = nil;
+}
 
+- (void) handlePropertyNotify:(xcb_property_notify_event_t*)anEvent
+{
+    [[windowSnapshots objectForWindow:anEvent->window] invalidateAtom:anEvent->atom];
+
+    // OPTIMIZATION: integer lookup on the atom; no atom name round-trip or string compares per event
+    NSArray *handlers = [propertyHandlers objectForWindow:anEvent->atom];
+
+    for (XCBPropertyNotifyHandler handler in handlers)
+        handler(anEvent);
+}
+
+- (void) handleWindowTypePropertyNotify:(xcb_property_notify_event_t*)anEvent
+{
     XCBWindow *window = [self windowForXCBId:anEvent->window];
 
     if (!window)
-    {
-        atomService = nil;
-        name = nil;
         return;
-    }
-
-    if ([name isEqualToString:@"WM_HINTS"])
-    {
-        [window refreshCachedWMHints];
-    }
 
     EWMHService *ewmhService = [EWMHService sharedInstanceWithConnection:self];
 
-    if ([name isEqualToString:[ewmhService EWMHWMWindowType]])
+    void *windowTypeReply = [ewmhService getProperty:[ewmhService EWMHWMWindowType]
+                                        propertyType:XCB_ATOM_ATOM
+                                           forWindow:window
+                                              delete:NO
+                                              length:UINT32_MAX];
+    if (windowTypeReply)
     {
-        void *windowTypeReply = [ewmhService getProperty:[ewmhService EWMHWMWindowType]
-                                            propertyType:XCB_ATOM_ATOM
-                                               forWindow:window
-                                                  delete:NO
-                                                  length:UINT32_MAX];
-        if (windowTypeReply)
-        {
-            xcb_atom_t *atom = (xcb_atom_t *) xcb_get_property_value(windowTypeReply);
+        xcb_atom_t *atom = (xcb_atom_t *) xcb_get_property_value(windowTypeReply);
 
-            if (*atom == [[ewmhService atomService] atomFromCachedAtomsWithKey:[ewmhService EWMHWMWindowTypeDesktop]])
-            {
-                NSLog(@"PropertyNotify: Window %u identified as desktop type - stacking below", anEvent->window);
-                [window setWindowType:[ewmhService EWMHWMWindowTypeDesktop]];
-                [window stackBelow];
-            }
-            free(windowTypeReply);
+        if (xcb_get_property_value_length(windowTypeReply) >= (int) sizeof(xcb_atom_t) &&
+            *atom == [[ewmhService atomService] atomFromCachedAtomsWithKey:[ewmhService EWMHWMWindowTypeDesktop]])
+        {
+            NSLog(@"PropertyNotify: Window %u identified as desktop type - stacking below", anEvent->window);
+            [window setWindowType:[ewmhService EWMHWMWindowTypeDesktop]];
+            [window stackBelow];
         }
+        free(windowTypeReply);
     }
-    
-    // Handle _NET_WORKAREA changes on root window to update cached workarea
+
+    ewmhService = nil;
+    window = nil;
+}
+
+// Handle _NET_WORKAREA changes on root window to update cached workarea
+- (void) handleWorkareaPropertyNotify:(xcb_property_notify_event_t*)anEvent
+{
     XCBScreen *screen = [[self screens] objectAtIndex:0];
     XCBWindow *rootWindow = [screen rootWindow];
-    if ([name isEqualToString:[ewmhService EWMHWorkarea]] && anEvent->window == [rootWindow window])
-    {
-        NSLog(@"PropertyNotify: _NET_WORKAREA changed on root window - updating cached workarea");
-        if (screen && rootWindow) {
-            self.workareaValid = [ewmhService readWorkareaForRootWindow:rootWindow 
-                                                                      x:&_cachedWorkareaX 
-                                                                      y:&_cachedWorkareaY 
-                                                                  width:&_cachedWorkareaWidth 
-                                                                 height:&_cachedWorkareaHeight];
-            if (!self.workareaValid) {
-                // Fallback to full screen if workarea read fails
-                _cachedWorkareaX = 0;
-                _cachedWorkareaY = 0;
-                _cachedWorkareaWidth = [screen width];
-                _cachedWorkareaHeight = [screen height];
-            }
-        }
+
+    if (!screen || !rootWindow || anEvent->window != [rootWindow window])
+        return;
+
+    NSLog(@"PropertyNotify: _NET_WORKAREA changed on root window - updating cached workarea");
+
+    EWMHService *ewmhService = [EWMHService sharedInstanceWithConnection:self];
+    self.workareaValid = [ewmhService readWorkareaForRootWindow:rootWindow
+                                                              x:&_cachedWorkareaX
+                                                              y:&_cachedWorkareaY
+                                                          width:&_cachedWorkareaWidth
+                                                         height:&_cachedWorkareaHeight];
+    if (!self.workareaValid) {
+        // Fallback to full screen if workarea read fails
+        _cachedWorkareaX = 0;
+        _cachedWorkareaY = 0;
+        _cachedWorkareaWidth = [screen width];
+        _cachedWorkareaHeight = [screen height];
     }
 
     ewmhService = nil;
-    atomService = nil;
-    name = nil;
-    window = nil;
-
-    return;
 }
 
 - (BOOL)resolveIconGeometryForWindow:(XCBWindow *)window outRect:(XCBRect *)rectOut
@@ -2248,47 +2540,21 @@ static XCBConnection *sharedInstance;
 {
     XCBAtomService *atomService = [XCBAtomService sharedInstanceWithConnection:self];
     EWMHService *ewmhService = [EWMHService sharedInstanceWithConnection:self];
-    NSString *atomMessageName = [atomService atomNameFromAtom:anEvent->type];
-
-    NSLog(@"Atom name: %@, for atom id: %u", atomMessageName, anEvent->type);
+    XCBClientMessageHandler handler = [clientMessageHandlers objectForWindow:anEvent->type];
 
-    // Handle Gershwin-specific window commands
-    if ([atomMessageName isEqualToString:@"_GERSHWIN_CENTER_WINDOW"]) {
-        NSLog(@"[ClientMessage] Center Window requested");
-        [self centerActiveWindow];
-        return;
-    }
-    if ([atomMessageName isEqualToString:@"_GERSHWIN_TILE_LEFT"]) {
-        NSLog(@"[ClientMessage] Tile Left requested");
-        [self tileActiveWindowLeft];
-        return;
-    }
-    if ([atomMessageName isEqualToString:@"_GERSHWIN_TILE_RIGHT"]) {
-        NSLog(@"[ClientMessage] Tile Right requested");
-        [self tileActiveWindowRight];
-        return;
-    }
-    if ([atomMessageName isEqualToString:@"_GERSHWIN_TILE_TOP_LEFT"]) {
-        NSLog(@"[ClientMessage] Tile Top Left requested");
-        [self tileActiveWindowToZone:SnapZoneTopLeft];
-        return;
-    }
-    if ([atomMessageName isEqualToString:@"_GERSHWIN_TILE_TOP_RIGHT"]) {
-        NSLog(@"[ClientMessage] Tile Top Right requested");
-        [self tileActiveWindowToZone:SnapZoneTopRight];
-        return;
-    }
-    if ([atomMessageName isEqualToString:@"_GERSHWIN_TILE_BOTTOM_LEFT"]) {
-        NSLog(@"[ClientMessage] Tile Bottom Left requested");
-        [self tileActiveWindowToZone:SnapZoneBottomLeft];
-        return;
-    }
-    if ([atomMessageName isEqualToString:@"_GERSHWIN_TILE_BOTTOM_RIGHT"]) {
-        NSLog(@"[ClientMessage] Tile Bottom Right requested");
-        [self tileActiveWindowToZone:SnapZoneBottomRight];
+    if (handler != nil)
+    {
+        handler(anEvent);
+        atomService = nil;
+        ewmhService = nil;
         return;
     }
 
+    /*** served from the reverse atom cache after the first message of each type ***/
+    NSString *atomMessageName = [atomService atomNameFromAtom:anEvent->type];
+
+    NSLog(@"Atom name: %@, for atom id: %u", atomMessageName, anEvent->type);
+
     XCBWindow *window;
     XCBTitleBar *titleBar;
     XCBFrame *frame;
@@ -2605,28 +2871,52 @@ static XCBConnection *sharedInstance;
 
 - (void)handleVisibilityEvent:(xcb_visibility_notify_event_t *)anEvent
 {
-    /*XCBWindow *window = [self windowForXCBId:anEvent->window];
-    XCBFrame *frame;
-    XCBWindow *clientWindow;
-    XCBTitleBar* titleBar;*/
+    /*** Under compositing every redirected window is reported unobscured ***/
+    if (self.visibilityFromCompositor)
+        return;
+
+    [self setVisibility:anEvent->state forFrameWindow:anEvent->window];
+}
+
+- (void)setVisibility:(uint8_t)aState forFrameWindow:(xcb_window_t)aFrameWindow
+{
+    XCBFrame *frame = [framesMap objectForWindow:aFrameWindow];
 
-    /*if ([window isKindOfClass:[XCBFrame class]])
+    if (frame == nil || [frame visibility] == aState)
+        return;
+
+    BOOL wasObscured = [frame isFullyObscured];
+    [frame setVisibility:aState];
+
+    /*** _NET_WM_STATE_HIDDEN means minimized to pagers and taskbars, so the occlusion
+         state goes in its own CARDINAL: 0 unobscured, 1 partially, 2 fully obscured ***/
+    XCBWindow *clientWindow = [frame childWindowForKey:ClientWindow];
+
+    if (clientWindow != nil)
     {
-        frame = (XCBFrame *) window;
-        clientWindow = [frame childWindowForKey:ClientWindow];
-    }*/
+        uint32_t value = aState;
+        [[EWMHService sharedInstanceWithConnection:self] changePropertiesForWindow:clientWindow
+                                                                          withMode:XCB_PROP_MODE_REPLACE
+                                                                      withProperty:@"_GERSHWIN_WM_VISIBILITY"
+                                                                          withType:XCB_ATOM_CARDINAL
+                                                                        withFormat:32
+                                                                    withDataLength:1
+                                                                          withData:&value];
+    }
 
-    /*if (anEvent->state == XCB_VISIBILITY_UNOBSCURED &&
-        anEvent->window == [frame window] &&
-        [frame isAbove])
+    if (wasObscured && ![frame isFullyObscured] && [frame titleBarRedrawPending])
     {
-        if ([clientWindow pixmap] == 0)
-            [clientWindow createPixmap];
-    }*/
+        [frame setTitleBarRedrawPending:NO];
+
+        if (self.frameRevealHandler)
+            self.frameRevealHandler(frame);
+        else
+            [(XCBTitleBar *)[frame childWindowForKey:TitleBar] drawTitleBarComponents];
+    }
 
-    /*window = nil;
+    needFlush = YES;
     clientWindow = nil;
-    titleBar = nil;*/
+    frame = nil;
 }
 
 - (void)handleExpose:(xcb_expose_event_t *)anEvent
@@ -2732,6 +3022,11 @@ static XCBConnection *sharedInstance;
 
     [window setParentWindow:parent];
 
+    if (anEvent->parent == [[self rootWindowForScreenNumber:0] window])
+        [rootStacking addWindowOnTop:anEvent->window];
+    else
+        [rootStacking removeWindow:anEvent->window];
+
     window = nil;
     parent = nil;
 }
@@ -2745,6 +3040,9 @@ static XCBConnection *sharedInstance;
      * unregister title bar, title bar children and client window.
      */
 
+    [self discardSnapshotForWindow:anEvent->window];
+    [rootStacking removeWindow:anEvent->window];
+
     XCBWindow *window = [self windowForXCBId:anEvent->window];
     XCBFrame *frameWindow = nil;
     XCBTitleBar *titleBarWindow = nil;
@@ -2889,47 +3187,33 @@ static XCBConnection *sharedInstance;
 
 - (void)drawAllTitleBarsExcept:(XCBTitleBar *)aTitileBar
 {
-    NSArray *windows = [windowsMap allValues];
-    NSUInteger size = [windows count];
-
-    for (int i = 0; i < size; i++)
+    for (XCBTitleBar *titleBar in titleBarsMap)
     {
-        XCBWindow *tmp = [windows objectAtIndex:i];
-
-        if ([tmp isKindOfClass:[XCBTitleBar class]])
-        {
-            XCBTitleBar *titleBar = (XCBTitleBar *) tmp;
+        if (titleBar == aTitileBar)
+            continue;
 
-            if (titleBar != aTitileBar)
-            {
-                XCBFrame *frame = (XCBFrame *) [titleBar parentWindow];
-                XCBWindow *clientWindow = [frame childWindowForKey:ClientWindow];
+        XCBFrame *frame = (XCBFrame *) [titleBar parentWindow];
+        XCBWindow *clientWindow = [frame childWindowForKey:ClientWindow];
 
-                if ([clientWindow alwaysOnTop])
-                {
-                    NSLog(@"Always on top");
-                    windows = nil;
-                    tmp = nil;
-                    frame = nil;
-                    clientWindow = nil;
-                    titleBar = nil;
-                    continue;
-                }
+        if ([clientWindow alwaysOnTop])
+        {
+            NSLog(@"Always on top");
+            continue;
+        }
 
-                [titleBar setIsAbove:NO];
-                [titleBar setButtonsAbove:NO];
-                [titleBar drawTitleBarComponents];
-                [frame setIsAbove:NO];
-                frame = nil;
-            }
+        [titleBar setIsAbove:NO];
+        [titleBar setButtonsAbove:NO];
+        [frame setIsAbove:NO];
 
-            titleBar = nil;
+        /*** Nobody can see it: draw once the frame is revealed ***/
+        if ([frame isFullyObscured])
+        {
+            [frame setTitleBarRedrawPending:YES];
+            continue;
         }
 
-        tmp = nil;
+        [titleBar drawTitleBarComponents];
     }
-
-    windows = nil;
 }
 
 - (void) sendEvent:(const char *)anEvent toClient:(XCBWindow*)aWindow propagate:(BOOL)propagating
@@ -3065,6 +3349,190 @@ static XCBConnection *sharedInstance;
     return clientList;
 }
 
+- (xcb_window_t*)clientListStacking
+{
+    return clientListStacking;
+}
+
+/*** Client id a restacked window stands for: frames stand for their client ***/
+- (xcb_window_t)clientIdForStackingWindow:(xcb_window_t)aWindow
+{
+    XCBFrame *frame = [framesMap objectForWindow:aWindow];
+
+    if (frame != nil)
+        return [[frame childWindowForKey:ClientWindow] window];
+
+    if ([clientsMap objectForWindow:aWindow] != nil)
+        return aWindow;
+
+    return XCB_NONE;
+}
+
+- (NSInteger)clientListStackingPositionOf:(xcb_window_t)aClient
+{
+    for (NSInteger i = 0; i < clientListStackingIndex; i++)
+    {
+        if (clientListStacking[i] == aClient)
+            return i;
+    }
+
+    return -1;
+}
+
+- (void)moveInClientListStacking:(xcb_window_t)aClient toPosition:(NSInteger)position
+{
+    NSInteger current = [self clientListStackingPositionOf:aClient];
+
+    if (current < 0 || current == position)
+        return;
+
+    if (current < position)
+        memmove(&clientListStacking[current], &clientListStacking[current + 1], (position - current) * sizeof(xcb_window_t));
+    else
+        memmove(&clientListStacking[position + 1], &clientListStacking[position], (current - position) * sizeof(xcb_window_t));
+
+    clientListStacking[position] = aClient;
+    clientListNeedsUpdate = YES;
+}
+
+- (void)raiseInClientListStacking:(xcb_window_t)aWindow
+{
+    xcb_window_t client = [self clientIdForStackingWindow:aWindow];
+
+    if (client != XCB_NONE)
+        [self moveInClientListStacking:client toPosition:clientListStackingIndex - 1];
+}
+
+- (void)lowerInClientListStacking:(xcb_window_t)aWindow
+{
+    xcb_window_t client = [self clientIdForStackingWindow:aWindow];
+
+    if (client != XCB_NONE)
+        [self moveInClientListStacking:client toPosition:0];
+}
+
+/*** Places aClient directly above aBelowClient in _NET_CLIENT_LIST_STACKING ***/
+- (void)moveInClientListStacking:(xcb_window_t)aClient aboveClient:(xcb_window_t)aBelowClient
+{
+    NSInteger current = [self clientListStackingPositionOf:aClient];
+    NSInteger below = [self clientListStackingPositionOf:aBelowClient];
+
+    if (current < 0 || below < 0)
+        return;
+
+    [self moveInClientListStacking:aClient toPosition:(current < below) ? below : below + 1];
+}
+
+- (void)restackInClientListStacking:(xcb_window_t)aWindow aboveSibling:(xcb_window_t)aSibling
+{
+    xcb_window_t client = [self clientIdForStackingWindow:aWindow];
+
+    if (client == XCB_NONE)
+        return;
+
+    if (aSibling == XCB_NONE)
+    {
+        [self moveInClientListStacking:client toPosition:0];
+        return;
+    }
+
+    xcb_window_t siblingClient = [self clientIdForStackingWindow:aSibling];
+
+    if (siblingClient != XCB_NONE)
+    {
+        [self moveInClientListStacking:client aboveClient:siblingClient];
+        return;
+    }
+
+    /* unmanaged sibling (panel, dock, override-redirect popup): the client goes
+       above the nearest managed client below it in the server order */
+    NSUInteger index = [rootStacking isValid] ? [rootStacking indexOfWindow:aWindow] : NSNotFound;
+
+    if (index == NSNotFound)
+    {
+        [self resyncClientListStacking];
+        return;
+    }
+
+    while (index > 0)
+    {
+        xcb_window_t belowClient = [self clientIdForStackingWindow:[rootStacking windowAtIndex:--index]];
+
+        if (belowClient != XCB_NONE && belowClient != client)
+        {
+            [self moveInClientListStacking:client aboveClient:belowClient];
+            return;
+        }
+    }
+
+    /* only unmanaged windows below: it is the lowest client */
+    [self moveInClientListStacking:client toPosition:0];
+}
+
+/*** One QueryTree: reseeds the root stacking order and reorders the client list from it ***/
+- (void)resyncClientListStacking
+{
+    xcb_window_t root = [[self rootWindowForScreenNumber:0] window];
+    xcb_query_tree_reply_t *reply = xcb_query_tree_reply(connection, xcb_query_tree(connection, root), NULL);
+
+    if (reply == NULL)
+    {
+        [rootStacking invalidate];
+        return;
+    }
+
+    xcb_window_t *children = xcb_query_tree_children(reply);
+    int length = xcb_query_tree_children_length(reply);
+    [rootStacking resetWithChildren:children count:length];
+    free(reply);
+
+    /* clients the tree did not show stay at the bottom in their old order, the rest follow the server */
+    xcb_window_t ordered[CLIENTLISTSIZE];
+    NSInteger count = 0;
+
+    for (NSInteger i = 0; i < clientListStackingIndex; i++)
+    {
+        BOOL shown = NO;
+
+        for (NSUInteger j = 0; j < [rootStacking count] && !shown; j++)
+            shown = [self clientIdForStackingWindow:[rootStacking windowAtIndex:j]] == clientListStacking[i];
+
+        if (!shown)
+            ordered[count++] = clientListStacking[i];
+    }
+
+    for (NSUInteger i = 0; i < [rootStacking count] && count < clientListStackingIndex; i++)
+    {
+        xcb_window_t client = [self clientIdForStackingWindow:[rootStacking windowAtIndex:i]];
+        BOOL seen = client == XCB_NONE || [self clientListStackingPositionOf:client] < 0;
+
+        for (NSInteger j = 0; j < count && !seen; j++)
+            seen = ordered[j] == client;
+
+        if (!seen)
+            ordered[count++] = client;
+    }
+
+    memcpy(clientListStacking, ordered, count * sizeof(xcb_window_t));
+    clientListNeedsUpdate = YES;
+}
+
+- (void)setClientListNeedsUpdate
+{
+    clientListNeedsUpdate = YES;
+}
+
+- (BOOL)updateClientListIfNeeded
+{
+    if (!clientListNeedsUpdate)
+        return NO;
+
+    clientListNeedsUpdate = NO;
+    [[EWMHService sharedInstanceWithConnection:self] updateNetClientList];
+
+    return YES;
+}
+
 - (void) grabServer
 {
     xcb_grab_server(connection);
@@ -3081,6 +3549,9 @@ static XCBConnection *sharedInstance;
     screens = nil;
     [windowsMap removeAllObjects];
     windowsMap = nil;
+    framesMap = nil;
+    titleBarsMap = nil;
+    clientsMap = nil;
     displayName = nil;
     damagedRegions = nil;
 
@@ -3100,6 +3571,10 @@ static XCBConnection *sharedInstance;
     if (parentWindow) {
         NSLog(@"New window %u created with parent %u", anEvent->window, anEvent->parent);
     }
+
+    /* new children are created on top of their siblings */
+    if (anEvent->parent == [[self rootWindowForScreenNumber:0] window])
+        [rootStacking addWindowOnTop:anEvent->window];
 }
 
 - (void) handleKeyPress: (xcb_key_press_event_t*)anEvent
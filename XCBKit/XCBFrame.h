@@ -46,6 +46,10 @@ typedef NS_ENUM(NSInteger, childrenMask)
 @property (nonatomic, assign) BOOL leftBorderClicked;
 @property (nonatomic, assign) BOOL topBorderClicked;
 @property (nonatomic, assign) XCBPoint offset;
+/*** XCB_VISIBILITY_* state of the frame, from VisibilityNotify or the compositor's stacking ***/
+@property (nonatomic, assign) uint8_t visibility;
+/*** Set when a titlebar re-render was skipped because the frame was fully obscured ***/
+@property (nonatomic, assign) BOOL titleBarRedrawPending;
 
 - (id) initWithClientWindow:(XCBWindow*) aClientWindow withConnection:(XCBConnection*) aConnection;
 - (id) initWithClientWindow:(XCBWindow*) aClientWindow
@@ -57,6 +61,7 @@ typedef NS_ENUM(NSInteger, childrenMask)
 - (XCBWindow*) childWindowForKey:(childrenMask) key;
 - (void) removeChild:(childrenMask) frameChild;
 - (void) resize:(xcb_motion_notify_event_t *)anEvent xcbConnection:(xcb_connection_t*)aXcbConnection;
+- (XCBRect) resizeTargetRectForEvent:(xcb_motion_notify_event_t *)anEvent;
 - (void) moveTo:(XCBPoint)coordinates;
 - (void) configureClient;
 - (void) configureClientWithFramePosition:(XCBPoint)framePos clientSize:(XCBSize)clientSize;
@@ -67,6 +72,7 @@ typedef NS_ENUM(NSInteger, childrenMask)
 - (void) raiseResizeHandle;
 - (void) applyRoundedCornersShapeMask;
 - (void) programmaticResizeToRect:(XCBRect)targetRect;
+- (BOOL) isFullyObscured;
 
 // Theme-driven resize zones
 - (void) createResizeZonesFromTheme;
@@ -58,7 +58,22 @@ static void sendSyntheticConfigureNotify(xcb_connection_t *conn,
                    XCB_EVENT_MASK_STRUCTURE_NOTIFY, (const char *)&event);
 }
 
+void resizeFromRightForEvent(xcb_motion_notify_event_t *anEvent, XCBFrame *frame, XCBRect *aRect, int minW);
+void resizeFromLeftForEvent(xcb_motion_notify_event_t *anEvent, XCBFrame *frame, XCBRect *aRect, int minW);
+void resizeFromBottomForEvent(xcb_motion_notify_event_t *anEvent, XCBFrame *frame, XCBRect *aRect,
+                              int minH, uint16_t titleBarHeight);
+void resizeFromTopForEvent(xcb_motion_notify_event_t *anEvent, XCBFrame *frame, XCBRect *aRect,
+                           int minH, uint16_t titleBarHeight);
+void resizeFromAngleForEvent(xcb_motion_notify_event_t *anEvent, XCBRect *aRect,
+                             int minW, int minH, uint16_t titleBarHeight);
+
 @implementation XCBFrame
+{
+    /*** Size and radii of the bounding shape last set; resizes that keep them skip the shape ***/
+    XCBSize shapedSize;
+    int shapedTopRadius;
+    int shapedBottomRadius;
+}
 
 @synthesize minWidthHint;
 @synthesize minHeightHint;
@@ -69,6 +84,8 @@ static void sendSyntheticConfigureNotify(xcb_connection_t *conn,
 @synthesize leftBorderClicked;
 @synthesize topBorderClicked;
 @synthesize titleHeight;
+@synthesize visibility;
+@synthesize titleBarRedrawPending;
 
 - (id) initWithClientWindow:(XCBWindow *)aClientWindow withConnection:(XCBConnection *)aConnection
 {
@@ -359,17 +376,47 @@ static void sendSyntheticConfigureNotify(xcb_connection_t *conn,
 
 - (void) resize:(xcb_motion_notify_event_t *)anEvent xcbConnection:(xcb_connection_t*)aXcbConnection
 {
+    XCBRect rect = [self resizeTargetRectForEvent:anEvent];
+    XCBRect current = [self windowRect];
+
+    if (rect.position.x == current.position.x && rect.position.y == current.position.y &&
+        rect.size.width == current.size.width && rect.size.height == current.size.height)
+        return;
+
+    [self applyResizeRect:rect time:anEvent->time xcbConnection:aXcbConnection];
+
+    // Update resize zone positions if they exist
+    [self updateAllResizeZonePositions];
+
+    // Update shape mask for rounded corners (must match new window dimensions)
+    [self applyRoundedCornersShapeMask];
+
+}
+
+/*** Frame rect this motion resizes to, min size and work area clamps included; sends nothing ***/
+
+- (XCBRect) resizeTargetRectForEvent:(xcb_motion_notify_event_t *)anEvent
+{
+    XCBRect rect = [self windowRect];
+    XCBWindow *clientWindow = [self childWindowForKey:ClientWindow];
+
+    // Respect ICCCM: if client is non-resizable, ignore interactive resize
+    if (clientWindow && ![clientWindow canResize])
+    {
+        NSDebugLog(@"Ignoring interactive resize for non-resizable client %u", [clientWindow window]);
+        return rect;
+    }
 
     /*** width ***/
 
     if (rightBorderClicked && !bottomBorderClicked && !leftBorderClicked && !topBorderClicked)
     {
-        resizeFromRightForEvent(anEvent, aXcbConnection, self, minWidthHint);
+        resizeFromRightForEvent(anEvent, self, &rect, minWidthHint);
     }
 
     if (leftBorderClicked && !bottomBorderClicked && !rightBorderClicked && !topBorderClicked)
     {
-        resizeFromLeftForEvent(anEvent, aXcbConnection, self, minWidthHint);
+        resizeFromLeftForEvent(anEvent, self, &rect, minWidthHint);
     }
 
 
@@ -377,13 +424,13 @@ static void sendSyntheticConfigureNotify(xcb_connection_t *conn,
 
     if (bottomBorderClicked && !rightBorderClicked && !leftBorderClicked)
     {
-        resizeFromBottomForEvent(anEvent, aXcbConnection, self, minHeightHint, titleHeight);
+        resizeFromBottomForEvent(anEvent, self, &rect, minHeightHint, titleHeight);
     }
 
 
     if (topBorderClicked && !rightBorderClicked && !leftBorderClicked && !bottomBorderClicked)
     {
-        resizeFromTopForEvent(anEvent, aXcbConnection, self, minHeightHint, titleHeight);
+        resizeFromTopForEvent(anEvent, self, &rect, minHeightHint, titleHeight);
     }
 
 
@@ -392,36 +439,134 @@ static void sendSyntheticConfigureNotify(xcb_connection_t *conn,
     // SE corner (bottom-right)
     if (rightBorderClicked && bottomBorderClicked && !leftBorderClicked && !topBorderClicked)
     {
-        resizeFromAngleForEvent(anEvent, aXcbConnection, self, minWidthHint, minHeightHint, titleHeight);
+        resizeFromAngleForEvent(anEvent, &rect, minWidthHint, minHeightHint, titleHeight);
     }
 
     // NW corner (top-left) - combine top and left resizes
     if (topBorderClicked && leftBorderClicked && !rightBorderClicked && !bottomBorderClicked)
     {
-        resizeFromTopForEvent(anEvent, aXcbConnection, self, minHeightHint, titleHeight);
-        resizeFromLeftForEvent(anEvent, aXcbConnection, self, minWidthHint);
+        resizeFromTopForEvent(anEvent, self, &rect, minHeightHint, titleHeight);
+        resizeFromLeftForEvent(anEvent, self, &rect, minWidthHint);
     }
 
     // NE corner (top-right) - combine top and right resizes
     if (topBorderClicked && rightBorderClicked && !leftBorderClicked && !bottomBorderClicked)
     {
-        resizeFromTopForEvent(anEvent, aXcbConnection, self, minHeightHint, titleHeight);
-        resizeFromRightForEvent(anEvent, aXcbConnection, self, minWidthHint);
+        resizeFromTopForEvent(anEvent, self, &rect, minHeightHint, titleHeight);
+        resizeFromRightForEvent(anEvent, self, &rect, minWidthHint);
     }
 
     // SW corner (bottom-left) - combine bottom and left resizes
     if (bottomBorderClicked && leftBorderClicked && !rightBorderClicked && !topBorderClicked)
     {
-        resizeFromBottomForEvent(anEvent, aXcbConnection, self, minHeightHint, titleHeight);
-        resizeFromLeftForEvent(anEvent, aXcbConnection, self, minWidthHint);
+        resizeFromBottomForEvent(anEvent, self, &rect, minHeightHint, titleHeight);
+        resizeFromLeftForEvent(anEvent, self, &rect, minWidthHint);
     }
 
-    // Update resize zone positions if they exist
-    [self updateAllResizeZonePositions];
+    clientWindow = nil;
+    return rect;
+}
 
-    // Update shape mask for rounded corners (must match new window dimensions)
-    [self applyRoundedCornersShapeMask];
+/*** Moves and sizes the frame, titlebar and client to aRect; only changed fields are configured ***/
+
+- (void) applyResizeRect:(XCBRect)aRect time:(xcb_timestamp_t)aTime xcbConnection:(xcb_connection_t *)aXcbConnection
+{
+    XCBWindow *clientWindow = [self childWindowForKey:ClientWindow];
+    XCBTitleBar *titleBar = (XCBTitleBar *)[self childWindowForKey:TitleBar];
+    XCBRect frameRect = [self windowRect];
+    XCBRect titleBarRect = [titleBar windowRect];
+    XCBRect clientRect = [clientWindow windowRect];
+    BOOL widthChanged = aRect.size.width != frameRect.size.width;
+    BOOL heightChanged = aRect.size.height != frameRect.size.height;
+
+    if (widthChanged)
+        clientRect.size.width = aRect.size.width;
+
+    if (heightChanged)
+        clientRect.size.height = aRect.size.height - titleHeight;
+
+    /*** A client pacing the resize gets its sync request before the configures it covers ***/
+    XCBResizeSync *resizeSync = [connection resizeSync];
+
+    if ([resizeSync frame] == self)
+        [resizeSync requestForClientSize:clientRect.size time:aTime];
+
+    uint32_t values[4];
+    uint16_t mask = 0;
+    int count = 0;
+
+    if (aRect.position.x != frameRect.position.x)
+    {
+        mask |= XCB_CONFIG_WINDOW_X;
+        values[count++] = (uint32_t) aRect.position.x;
+    }
+
+    if (aRect.position.y != frameRect.position.y)
+    {
+        mask |= XCB_CONFIG_WINDOW_Y;
+        values[count++] = (uint32_t) aRect.position.y;
+    }
+
+    if (widthChanged)
+    {
+        mask |= XCB_CONFIG_WINDOW_WIDTH;
+        values[count++] = aRect.size.width;
+    }
+
+    if (heightChanged)
+    {
+        mask |= XCB_CONFIG_WINDOW_HEIGHT;
+        values[count++] = aRect.size.height;
+    }
+
+    xcb_configure_window(aXcbConnection, window, mask, values);
+
+    if (widthChanged)
+    {
+        values[0] = aRect.size.width;
+        xcb_configure_window(aXcbConnection, [titleBar window], XCB_CONFIG_WINDOW_WIDTH, values);
+        titleBarRect.size.width = aRect.size.width;
+        [titleBar setWindowRect:titleBarRect];
+        [titleBar setOriginalRect:titleBarRect];
+    }
+
+    mask = 0;
+    count = 0;
+
+    if (widthChanged)
+    {
+        mask |= XCB_CONFIG_WINDOW_WIDTH;
+        values[count++] = clientRect.size.width;
+    }
+
+    if (heightChanged)
+    {
+        mask |= XCB_CONFIG_WINDOW_HEIGHT;
+        values[count++] = clientRect.size.height;
+    }
+
+    if (mask != 0)
+    {
+        xcb_configure_window(aXcbConnection, [clientWindow window], mask, values);
+        [clientWindow setWindowRect:clientRect];
+        [clientWindow setOriginalRect:clientRect];
+    }
 
+    // Flush to ensure smooth resizing updates
+    xcb_flush(aXcbConnection);
+
+    [self setWindowRect:aRect];
+    [self setOriginalRect:aRect];
+
+    // Send synthetic ConfigureNotify to client
+    sendSyntheticConfigureNotify(aXcbConnection, clientWindow,
+                                  aRect.position.x,
+                                  aRect.position.y + titleHeight,
+                                  clientRect.size.width,
+                                  clientRect.size.height);
+
+    clientWindow = nil;
+    titleBar = nil;
 }
 
 - (void)updateResizeHandlePosition
@@ -696,136 +841,67 @@ static void sendSyntheticConfigureNotify(xcb_connection_t *conn,
         bottomRadius = [theme windowBottomCornerRadius];
     }
 
+    // PERFORMANCE FIX: this runs on every resize motion. The shape used to be drawn into
+    // fresh pixmaps after QueryExtents and GetGeometry round-trips; now it is built from the
+    // cached frame size and per-radius corner rows, and skipped when nothing changed.
+    XCBSize size = [super windowRect].size;
+
+    if (size.width == shapedSize.width && size.height == shapedSize.height &&
+        (int)topRadius == shapedTopRadius && (int)bottomRadius == shapedBottomRadius) {
+        return;
+    }
+
     if (topRadius > 0 || bottomRadius > 0) {
-        XCBShape *shape = [[XCBShape alloc] initWithConnection:connection withWinId:window];
-        if ([shape checkSupported]) {
-            XCBGeometryReply *geometry = [self geometries];
-            [shape calculateDimensionsFromGeometries:geometry];
-            [shape createPixmapsAndGCs];
-            [shape createRoundedCornersWithTopRadius:(int)topRadius bottomRadius:(int)bottomRadius];
+        if (![XCBShape setRoundedBoundingForWindow:window
+                                      onConnection:connection
+                                             width:size.width
+                                            height:size.height
+                                         topRadius:(int)topRadius
+                                      bottomRadius:(int)bottomRadius]) {
+            return;
         }
+    } else if (shapedTopRadius > 0 || shapedBottomRadius > 0) {
+        // The theme dropped its rounded corners
+        [XCBShape resetBoundingForWindow:window onConnection:connection];
     }
+
+    shapedSize = size;
+    shapedTopRadius = (int)topRadius;
+    shapedBottomRadius = (int)bottomRadius;
 }
 
+/*** The resizeFrom*ForEvent functions only compute: each moves the edges it owns in aRect ***/
+
 void resizeFromRightForEvent(xcb_motion_notify_event_t *anEvent,
-                             xcb_connection_t *connection,
-                             XCBFrame* frame,
+                             XCBFrame *frame,
+                             XCBRect *aRect,
                              int minW)
 {
-    XCBWindow* clientWindow = [frame childWindowForKey:ClientWindow];
-    // Respect ICCCM: if client is non-resizable, ignore interactive resize
-    if (clientWindow && ![clientWindow canResize]) {
-        NSDebugLog(@"Ignoring interactive right-edge resize for non-resizable client %u", [clientWindow window]);
-        return;
-    }
-    XCBTitleBar* titleBar = (XCBTitleBar*)[frame childWindowForKey:TitleBar];
-    //xcb_connection_t *connection = [[frame connection] connection];
-
-    XCBRect frameRect = [frame windowRect];
-    XCBRect titleBarRect = [titleBar windowRect];
-    XCBRect clientRect = [clientWindow windowRect];
-
     // Apply minimum visibility constraint when shrinking
     const int32_t MIN_VISIBLE_PIXELS = 16;
     XCBConnection *xcbConn = [frame connection];
-    int32_t newWidth = anEvent->event_x;
 
     if ([xcbConn workareaValid]) {
         int32_t workareaX = [xcbConn cachedWorkareaX];
         // Ensure at least MIN_VISIBLE_PIXELS of right edge stays on screen
         // rightEdge = frameX + newWidth, must be >= workareaX + MIN_VISIBLE_PIXELS
-        int32_t minWidth = workareaX + MIN_VISIBLE_PIXELS - frameRect.position.x;
+        int32_t minWidth = workareaX + MIN_VISIBLE_PIXELS - aRect->position.x;
         if (minWidth > minW) {
             minW = minWidth;
         }
     }
 
-    uint32_t values[] = {newWidth};
-
-    if (frameRect.size.width <= minW && anEvent->event_x < minW)
-    {
-        frameRect.size.width = minW;
-        titleBarRect.size.width = minW;
-        clientRect.size.width = minW;
-        values[0] = minW;
-        xcb_configure_window(connection, [frame window], XCB_CONFIG_WINDOW_WIDTH, &values);
-        xcb_configure_window(connection, [titleBar window], XCB_CONFIG_WINDOW_WIDTH, &values);
-        xcb_configure_window(connection, [clientWindow window], XCB_CONFIG_WINDOW_WIDTH, &values);
-
-        [frame setWindowRect:frameRect];
-        [frame setOriginalRect:frameRect];
-
-        [titleBar setWindowRect:titleBarRect];
-        [titleBar setOriginalRect:titleBarRect];
-
-        [clientWindow setWindowRect:clientRect];
-        [clientWindow setOriginalRect:clientRect];
-        //[titleBar drawTitleBarComponentsForColor:TitleBarUpColor];
-
-        // Send synthetic ConfigureNotify to client
-        sendSyntheticConfigureNotify(connection, clientWindow,
-                                      frameRect.position.x,
-                                      frameRect.position.y + [frame titleHeight],
-                                      clientRect.size.width,
-                                      clientRect.size.height);
-
-        clientWindow = nil;
-        titleBar = nil;
-        connection = NULL;
-        return;
-    }
-
-    xcb_configure_window(connection, [frame window], XCB_CONFIG_WINDOW_WIDTH, &values);
-    xcb_configure_window(connection, [titleBar window], XCB_CONFIG_WINDOW_WIDTH, &values);
-    xcb_configure_window(connection, [clientWindow window], XCB_CONFIG_WINDOW_WIDTH, &values);
-
-    // Flush to ensure smooth resizing updates
-    xcb_flush(connection);
-
-    frameRect.size.width = anEvent->event_x;
-
-    [frame setWindowRect:frameRect];
-    [frame setOriginalRect:frameRect];
-
-    titleBarRect.size.width = anEvent->event_x;
-    [titleBar setWindowRect:titleBarRect];
-    [titleBar setOriginalRect:titleBarRect];
-
-    clientRect.size.width = anEvent->event_x;
-    [clientWindow setWindowRect:clientRect];
-    [clientWindow setOriginalRect:clientRect];
-    //[titleBar drawTitleBarComponentsForColor:TitleBarUpColor];
-
-    // Send synthetic ConfigureNotify to client
-    sendSyntheticConfigureNotify(connection, clientWindow,
-                                  frameRect.position.x,
-                                  frameRect.position.y + [frame titleHeight],
-                                  clientRect.size.width,
-                                  clientRect.size.height);
-
-    clientWindow = nil;
-    titleBar = nil;
-    connection = NULL;
+    if (aRect->size.width <= minW && anEvent->event_x < minW)
+        aRect->size.width = minW;
+    else
+        aRect->size.width = anEvent->event_x;
 }
 
 void resizeFromLeftForEvent(xcb_motion_notify_event_t *anEvent,
-                            xcb_connection_t *connection,
-                            XCBFrame* frame,
+                            XCBFrame *frame,
+                            XCBRect *aRect,
                             int minW)
 {
-    XCBWindow* clientWindow = [frame childWindowForKey:ClientWindow];
-    // Respect ICCCM: if client is non-resizable, ignore interactive resize
-    if (clientWindow && ![clientWindow canResize]) {
-        NSDebugLog(@"Ignoring interactive left-edge resize for non-resizable client %u", [clientWindow window]);
-        return;
-    }
-    XCBTitleBar* titleBar = (XCBTitleBar*)[frame childWindowForKey:TitleBar];
-    //xcb_connection_t *connection = [[frame connection] connection];
-
-    XCBRect rect = [frame windowRect];
-    XCBRect titleBarRect = [titleBar windowRect];
-    XCBRect clientRect = [clientWindow windowRect];
-
     // Apply minimum visibility constraint
     const int32_t MIN_VISIBLE_PIXELS = 16;
     XCBConnection *xcbConn = [frame connection];
@@ -834,7 +910,7 @@ void resizeFromLeftForEvent(xcb_motion_notify_event_t *anEvent,
     if ([xcbConn workareaValid]) {
         int32_t workareaX = [xcbConn cachedWorkareaX];
         int32_t workareaWidth = [xcbConn cachedWorkareaWidth];
-        int32_t newWidth = rect.position.x - newX + rect.size.width;
+        int32_t newWidth = aRect->position.x - newX + aRect->size.width;
 
         // Ensure at least MIN_VISIBLE_PIXELS of right edge stays on screen
         int32_t minX = workareaX + MIN_VISIBLE_PIXELS - newWidth;
@@ -848,112 +924,25 @@ void resizeFromLeftForEvent(xcb_motion_notify_event_t *anEvent,
         }
     }
 
-    int xDelta = rect.position.x - newX;
-    uint32_t values[] = {newX, xDelta + rect.size.width};
-
-    if (rect.size.width <= minW && anEvent->root_x > rect.position.x)
+    if (aRect->size.width <= minW && anEvent->root_x > aRect->position.x)
     {
         // When hitting minimum width, maintain the right edge position
-        // Calculate the correct left position to preserve right edge
-        int rightEdge = rect.position.x + rect.size.width;
-        int newX = rightEdge - minW;
-
-        rect.size.width = minW;
-        rect.position.x = newX;
-        titleBarRect.size.width = minW;
-        titleBarRect.position.x = 0; // Relative to frame
-        clientRect.size.width = minW;
-        clientRect.position.x = 0; // Relative to frame
-
-        values[0] = newX;
-        values[1] = minW;
-        xcb_configure_window(connection, [frame window], XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_WIDTH, &values);
-        values[0] = 0;
-        xcb_configure_window(connection, [titleBar window], XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_WIDTH, &values);
-        xcb_configure_window(connection, [clientWindow window], XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_WIDTH, &values);
-
-        [frame setWindowRect:rect];
-        [frame setOriginalRect:rect];
-
-        titleBarRect.position.x = values[0];
-        titleBarRect.size.width = values[1];
-        [titleBar setWindowRect:titleBarRect];
-        [titleBar setOriginalRect:titleBarRect];
-
-        clientRect.position.x = values[0];
-        clientRect.size.width = values[1];
-        [clientWindow setWindowRect:clientRect];
-        [clientWindow setOriginalRect:clientRect];
-        //[titleBar drawTitleBarComponentsForColor:TitleBarUpColor];
-
-        // Send synthetic ConfigureNotify to client
-        sendSyntheticConfigureNotify(connection, clientWindow,
-                                      rect.position.x,
-                                      rect.position.y + [frame titleHeight],
-                                      clientRect.size.width,
-                                      clientRect.size.height);
-
-        clientWindow = nil;
-        titleBar = nil;
-        connection = NULL;
+        int rightEdge = aRect->position.x + aRect->size.width;
+        aRect->position.x = rightEdge - minW;
+        aRect->size.width = minW;
         return;
     }
 
-
-    xcb_configure_window(connection, [frame window], XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_WIDTH, &values);
-    rect.position.x = values[0];
-    rect.size.width = values[1];
-    values[0] = 0;
-    xcb_configure_window(connection, [titleBar window], XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_WIDTH, &values);
-    xcb_configure_window(connection, [clientWindow window], XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_WIDTH, &values);
-
-    // Flush to ensure smooth resizing updates
-    xcb_flush(connection);
-
-    [frame setWindowRect:rect];
-    [frame setOriginalRect:rect];
-
-    titleBarRect.position.x = values[0];
-    titleBarRect.size.width = values[1];
-    [titleBar setWindowRect:titleBarRect];
-    [titleBar setOriginalRect:titleBarRect];
-
-    clientRect.position.x = values[0];
-    clientRect.size.width = values[1];
-    [clientWindow setWindowRect:clientRect];
-    [clientWindow setOriginalRect:clientRect];
-    //[titleBar drawTitleBarComponentsForColor:TitleBarUpColor];
-
-    // Send synthetic ConfigureNotify to client
-    sendSyntheticConfigureNotify(connection, clientWindow,
-                                  rect.position.x,
-                                  rect.position.y + [frame titleHeight],
-                                  clientRect.size.width,
-                                  clientRect.size.height);
-
-    clientWindow = nil;
-    titleBar = nil;
-    connection = NULL;
-
+    aRect->size.width = aRect->position.x - newX + aRect->size.width;
+    aRect->position.x = newX;
 }
 
 void resizeFromBottomForEvent(xcb_motion_notify_event_t *anEvent,
-                              xcb_connection_t *connection,
-                              XCBFrame* frame,
+                              XCBFrame *frame,
+                              XCBRect *aRect,
                               int minH,
                               uint16_t titleBarHeight)
 {
-    XCBWindow* clientWindow = [frame childWindowForKey:ClientWindow];
-    // Respect ICCCM: if client is non-resizable, ignore interactive resize
-    if (clientWindow && ![clientWindow canResize]) {
-        NSDebugLog(@"Ignoring interactive bottom-edge resize for non-resizable client %u", [clientWindow window]);
-        return;
-    }
-    //xcb_connection_t *connection = [[frame connection] connection];
-
-    XCBRect rect = [frame windowRect];
-    XCBRect clientRect = [clientWindow windowRect];
-
     // Apply minimum visibility constraint when shrinking
     const int32_t MIN_VISIBLE_PIXELS = 16;
     XCBConnection *xcbConn = [frame connection];
@@ -962,88 +951,24 @@ void resizeFromBottomForEvent(xcb_motion_notify_event_t *anEvent,
         int32_t workareaY = [xcbConn cachedWorkareaY];
         // Ensure at least MIN_VISIBLE_PIXELS of bottom edge stays on screen
         // bottomEdge = frameY + newHeight, must be >= workareaY + MIN_VISIBLE_PIXELS
-        int32_t minHeight = workareaY + MIN_VISIBLE_PIXELS - rect.position.y;
+        int32_t minHeight = workareaY + MIN_VISIBLE_PIXELS - aRect->position.y;
         if (minHeight > minH + titleBarHeight) {
             minH = minHeight - titleBarHeight;
         }
     }
 
-    uint32_t values[] = {anEvent->event_y};
-
-    if (rect.size.height <= minH + titleBarHeight && anEvent->event_y < minH)
-    {
-        rect.size.height = minH + titleBarHeight;
-        clientRect.size.height = minH;
-        values[0] = clientRect.size.height;
-        xcb_configure_window(connection, [clientWindow window], XCB_CONFIG_WINDOW_HEIGHT, &values);
-        values[0] = rect.size.height;
-        xcb_configure_window(connection, [frame window], XCB_CONFIG_WINDOW_HEIGHT, &values);
-
-        [frame setWindowRect:rect];
-        [frame setOriginalRect:rect];
-
-        [clientWindow setWindowRect:clientRect];
-        [clientWindow setOriginalRect:clientRect];
-
-        // Send synthetic ConfigureNotify to client
-        sendSyntheticConfigureNotify(connection, clientWindow,
-                                      rect.position.x,
-                                      rect.position.y + titleBarHeight,
-                                      clientRect.size.width,
-                                      clientRect.size.height);
-
-        clientWindow = nil;
-        connection = NULL;
-        return;
-    }
-
-    values[0] = anEvent->event_y - titleBarHeight;
-    xcb_configure_window(connection, [clientWindow window], XCB_CONFIG_WINDOW_HEIGHT, &values);
-    clientRect.size.height = values[0];
-    values[0] = anEvent->event_y;
-    xcb_configure_window(connection, [frame window], XCB_CONFIG_WINDOW_HEIGHT, &values);
-
-    // Flush to ensure smooth resizing updates
-    xcb_flush(connection);
-
-    [clientWindow setWindowRect:clientRect];
-    [clientWindow setOriginalRect:clientRect];
-
-
-    rect.size.height = values[0];
-    [frame setWindowRect:rect];
-    [frame setOriginalRect:rect];
-
-    // Send synthetic ConfigureNotify to client
-    sendSyntheticConfigureNotify(connection, clientWindow,
-                                  rect.position.x,
-                                  rect.position.y + titleBarHeight,
-                                  clientRect.size.width,
-                                  clientRect.size.height);
-
-    clientWindow = nil;
-    connection = NULL;
+    if (aRect->size.height <= minH + titleBarHeight && anEvent->event_y < minH)
+        aRect->size.height = minH + titleBarHeight;
+    else
+        aRect->size.height = anEvent->event_y;
 }
 
 void resizeFromTopForEvent(xcb_motion_notify_event_t *anEvent,
-                           xcb_connection_t *connection,
-                           XCBFrame* frame,
+                           XCBFrame *frame,
+                           XCBRect *aRect,
                            int minH,
                            uint16_t titleBarHeight)
 {
-    XCBWindow* clientWindow = [frame childWindowForKey:ClientWindow];
-    // Respect ICCCM: if client is non-resizable, ignore interactive resize
-    if (clientWindow && ![clientWindow canResize]) {
-        NSDebugLog(@"Ignoring interactive top-edge resize for non-resizable client %u", [clientWindow window]);
-        return;
-    }
-    XCBTitleBar* titleBar = (XCBTitleBar*)[frame childWindowForKey:TitleBar];
-    //xcb_connection_t *connection = [[frame connection] connection];
-
-    XCBRect rect = [frame windowRect];
-    XCBRect titleBarRect = [titleBar windowRect];
-    XCBRect clientRect = [clientWindow windowRect];
-
     // Apply minimum visibility constraint
     const int32_t MIN_VISIBLE_PIXELS = 16;
     XCBConnection *xcbConn = [frame connection];
@@ -1064,192 +989,35 @@ void resizeFromTopForEvent(xcb_motion_notify_event_t *anEvent,
         }
     }
 
-    int yDelta = rect.position.y - newY;
-
-    uint32_t values[] = {newY, yDelta + rect.size.height};
-
-    if (rect.size.height <= minH + titleBarHeight && anEvent->root_y > rect.position.y)
+    if (aRect->size.height <= minH + titleBarHeight && anEvent->root_y > aRect->position.y)
     {
         // When hitting minimum height, maintain the bottom edge position
-        // Calculate the correct top position to preserve bottom edge
-        int bottomEdge = rect.position.y + rect.size.height;
-        int newY = bottomEdge - (minH + titleBarHeight);
-
-        rect.size.height = minH + titleBarHeight;
-        rect.position.y = newY;
-        clientRect.size.height = minH;
-        clientRect.position.y = titleBarHeight;
-
-        values[0] = clientRect.position.y;
-        values[1] = clientRect.size.height;
-        xcb_configure_window(connection, [clientWindow window], XCB_CONFIG_WINDOW_Y | XCB_CONFIG_WINDOW_HEIGHT, &values);
-
-        values[0] = newY;
-        values[1] = rect.size.height;
-        xcb_configure_window(connection, [frame window], XCB_CONFIG_WINDOW_Y | XCB_CONFIG_WINDOW_HEIGHT, &values);
-
-
-        [frame setWindowRect:rect];
-        [frame setOriginalRect:rect];
-
-        [clientWindow setWindowRect:clientRect];
-        [clientWindow setOriginalRect:clientRect];
-
-        // Send synthetic ConfigureNotify to client
-        sendSyntheticConfigureNotify(connection, clientWindow,
-                                      rect.position.x,
-                                      rect.position.y + titleBarHeight,
-                                      clientRect.size.width,
-                                      clientRect.size.height);
-
-        titleBar = nil;
-        clientWindow = nil;
-        connection = NULL;
-
+        int bottomEdge = aRect->position.y + aRect->size.height;
+        aRect->position.y = bottomEdge - (minH + titleBarHeight);
+        aRect->size.height = minH + titleBarHeight;
         return;
     }
 
-    xcb_configure_window(connection, [frame window], XCB_CONFIG_WINDOW_Y | XCB_CONFIG_WINDOW_HEIGHT, &values);
-
-    rect.position.y = values[0];
-    rect.size.height = values[1];
-    values[0] = 0;
-
-    xcb_configure_window(connection, [titleBar window], XCB_CONFIG_WINDOW_Y, &values);
-
-    titleBarRect.position.y = values[0];
-
-    values[0] = titleBarHeight;
-    values[1] = rect.size.height - titleBarHeight;
-
-    xcb_configure_window(connection, [clientWindow window], XCB_CONFIG_WINDOW_Y | XCB_CONFIG_WINDOW_HEIGHT, &values);
-    clientRect.size.height = values[1];
-    
-    // Flush to ensure smooth resizing updates
-    xcb_flush(connection);
-
-    [frame setWindowRect:rect];
-    [frame setOriginalRect:rect];
-
-    [titleBar setWindowRect:titleBarRect];
-    [titleBar setOriginalRect:titleBarRect];
-
-
-    [clientWindow setWindowRect:clientRect];
-    [clientWindow setOriginalRect:clientRect];
-
-    // Send synthetic ConfigureNotify to client
-    sendSyntheticConfigureNotify(connection, clientWindow,
-                                  rect.position.x,
-                                  rect.position.y + titleBarHeight,
-                                  clientRect.size.width,
-                                  clientRect.size.height);
-
-    clientWindow = nil;
-    titleBar = nil;
-    connection = NULL;
+    aRect->size.height = aRect->position.y - newY + aRect->size.height;
+    aRect->position.y = newY;
 }
 
 void resizeFromAngleForEvent(xcb_motion_notify_event_t *anEvent,
-                             xcb_connection_t *connection,
-                             XCBFrame *frame,
+                             XCBRect *aRect,
                              int minW,
                              int minH,
                              uint16_t titleBarHeight)
 {
-    XCBWindow* clientWindow = [frame childWindowForKey:ClientWindow];
-    // Respect ICCCM: if client is non-resizable, ignore interactive resize
-    if (clientWindow && ![clientWindow canResize]) {
-        NSDebugLog(@"Ignoring interactive corner resize for non-resizable client %u", [clientWindow window]);
-        return;
-    }
-    XCBTitleBar* titleBar = (XCBTitleBar*)[frame childWindowForKey:TitleBar];
-    //xcb_connection_t *connection = [[frame connection] connection];
-
-    XCBRect rect = [frame windowRect];
-    XCBRect titleBarRect = [titleBar windowRect];
-    XCBRect clientRect = [clientWindow windowRect];
-
-    uint32_t values[] = {anEvent->event_x, anEvent->event_y};
-
-    if (rect.size.width <= minW && anEvent->event_x < minW &&
-        rect.size.height <= minH + titleBarHeight && anEvent->event_y < minH)
+    if (aRect->size.width <= minW && anEvent->event_x < minW &&
+        aRect->size.height <= minH + titleBarHeight && anEvent->event_y < minH)
     {
-        rect.size.width = minW;
-        titleBarRect.size.width = minW;
-        clientRect.size.width = minW;
-
-        rect.size.height = minH + titleBarHeight;
-        clientRect.size.height = minH;
-
-        values[0] = rect.size.width;
-        values[1] = rect.size.height;
-
-        xcb_configure_window(connection, [frame window], XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT, &values);
-        values[0] = titleBarRect.size.width;
-        xcb_configure_window(connection, [titleBar window], XCB_CONFIG_WINDOW_WIDTH, &values);
-        values[0] = clientRect.size.width;
-        values[1] = clientRect.size.height;
-        xcb_configure_window(connection, [clientWindow window], XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT, &values);
-
-        [frame setWindowRect:rect];
-        [frame setOriginalRect:rect];
-
-        [titleBar setWindowRect:titleBarRect];
-        [titleBar setOriginalRect:titleBarRect];
-
-        [clientWindow setWindowRect:clientRect];
-        [clientWindow setOriginalRect:clientRect];
-        //[titleBar drawTitleBarComponentsForColor:TitleBarUpColor];
-
-        // Send synthetic ConfigureNotify to client
-        sendSyntheticConfigureNotify(connection, clientWindow,
-                                      rect.position.x,
-                                      rect.position.y + titleBarHeight,
-                                      clientRect.size.width,
-                                      clientRect.size.height);
-
-        titleBar = nil;
-        clientWindow = nil;
-        connection = NULL;
-
+        aRect->size.width = minW;
+        aRect->size.height = minH + titleBarHeight;
         return;
     }
 
-    xcb_configure_window(connection, [frame window], XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT, &values);
-    xcb_configure_window(connection, [titleBar window], XCB_CONFIG_WINDOW_WIDTH, &values);
-    values[1] = values[1] - titleBarHeight;
-    xcb_configure_window(connection, [clientWindow window], XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT, &values);
-    
-    // Flush to ensure smooth resizing updates
-    xcb_flush(connection);
-
-    rect.size.width = anEvent->event_x;
-    rect.size.height = anEvent->event_y;
-    [frame setWindowRect:rect];
-    [frame setOriginalRect:rect];
-
-
-    titleBarRect.size.width = anEvent->event_x;
-    [titleBar setWindowRect:titleBarRect];
-    [titleBar setOriginalRect:titleBarRect];
-
-    clientRect.size.width = anEvent->event_x;
-    clientRect.size.height = values[1];
-    [clientWindow setWindowRect:clientRect];
-    [clientWindow setOriginalRect:clientRect];
-    //[titleBar drawTitleBarComponentsForColor:TitleBarUpColor];
-
-    // Send synthetic ConfigureNotify to client
-    sendSyntheticConfigureNotify(connection, clientWindow,
-                                  rect.position.x,
-                                  rect.position.y + titleBarHeight,
-                                  clientRect.size.width,
-                                  clientRect.size.height);
-
-    titleBar = nil;
-    clientWindow = nil;
-    connection = NULL;
+    aRect->size.width = anEvent->event_x;
+    aRect->size.height = anEvent->event_y;
 }
 
 - (void) moveTo:(XCBPoint)coordinates
@@ -1458,6 +1226,11 @@ void resizeFromAngleForEvent(xcb_motion_notify_event_t *anEvent,
     return children;
 }
 
+- (BOOL) isFullyObscured
+{
+    return visibility == XCB_VISIBILITY_FULLY_OBSCURED;
+}
+
 - (void) dealloc
 {
     [children removeAllObjects]; //not needed probably
@@ -6,7 +6,10 @@
 //  Copyright (c) 2020 alex. All rights reserved.
 //
 
-/** This class uses the xcb_xfixes that implements the XFixes protocol **/
+/** This class uses the xcb_xfixes that implements the XFixes protocol.
+ *  It also keeps a client-side rectangle list, so regions can be combined
+ *  locally and sent to the server with a single request when needed.
+ *  The rectangles may overlap, as they may in XFixes CreateRegion. **/
 
 
 #import <Foundation/Foundation.h>
@@ -16,6 +19,8 @@
 @interface XCBRegion : NSObject
 {
     NSString* className;
+    int rectanglesCapacity;
+    BOOL serverRegionCreated;
 }
 
 @property (nonatomic) xcb_xfixes_region_t regionId;
@@ -26,8 +31,27 @@
 - (id) initWithConnection:(XCBConnection*)aConnection;
 - (id) initWithConnection:(XCBConnection *)aConnection regionId:(xcb_xfixes_region_t)aRegionId;
 - (id) initWithConnection:(XCBConnection *)aConnection rectagles:(xcb_rectangle_t*)rects count:(int) rectsNumber;
+- (id) initWithRectangles:(const xcb_rectangle_t*)rects count:(int)rectsNumber;
 - (void) unionWithRegion:(XCBRegion*)secondSource destination:(XCBRegion*)destination;
 - (BOOL) initXFixesProtocol;
 
+/*** CLIENT-SIDE REGION MATH (no protocol requests) ***/
+
+- (BOOL) isEmpty;
+- (xcb_rectangle_t) extents;
+- (void) removeAllRectangles;
+- (void) setRectangle:(xcb_rectangle_t)rect;
+- (void) unionWithRectangle:(xcb_rectangle_t)rect;
+- (void) unionWithRegion:(XCBRegion*)aRegion;
+- (void) intersectWithRectangle:(xcb_rectangle_t)rect;
+- (void) intersectWithRegion:(XCBRegion*)aRegion;
+- (void) subtractRectangle:(xcb_rectangle_t)rect;
+- (void) subtractRegion:(XCBRegion*)aRegion;
+- (void) translateByX:(int16_t)dx y:(int16_t)dy;
+- (void) simplifyToMaximumRectangles:(int)maxRects;
+
+/*** Pushes the rectangle list to regionId (one request), creating the server region if needed ***/
+- (void) updateServerRegion;
+
 
 @end
@@ -10,6 +10,53 @@
 #import "XCBRegion.h"
 
 
+static inline BOOL XCBRectangleIsEmpty(xcb_rectangle_t r)
+{
+    return r.width == 0 || r.height == 0;
+}
+
+static inline BOOL XCBRectangleContains(xcb_rectangle_t outer, xcb_rectangle_t inner)
+{
+    return inner.x >= outer.x &&
+           inner.y >= outer.y &&
+           (int32_t)inner.x + inner.width <= (int32_t)outer.x + outer.width &&
+           (int32_t)inner.y + inner.height <= (int32_t)outer.y + outer.height;
+}
+
+static inline xcb_rectangle_t XCBRectangleIntersection(xcb_rectangle_t a, xcb_rectangle_t b)
+{
+    int32_t x1 = MAX(a.x, b.x);
+    int32_t y1 = MAX(a.y, b.y);
+    int32_t x2 = MIN((int32_t)a.x + a.width, (int32_t)b.x + b.width);
+    int32_t y2 = MIN((int32_t)a.y + a.height, (int32_t)b.y + b.height);
+    xcb_rectangle_t r = {0, 0, 0, 0};
+
+    if (x2 > x1 && y2 > y1)
+    {
+        r.x = x1;
+        r.y = y1;
+        r.width = x2 - x1;
+        r.height = y2 - y1;
+    }
+
+    return r;
+}
+
+static inline xcb_rectangle_t XCBRectangleBounds(xcb_rectangle_t a, xcb_rectangle_t b)
+{
+    int32_t x1 = MIN(a.x, b.x);
+    int32_t y1 = MIN(a.y, b.y);
+    int32_t x2 = MAX((int32_t)a.x + a.width, (int32_t)b.x + b.width);
+    int32_t y2 = MAX((int32_t)a.y + a.height, (int32_t)b.y + b.height);
+    xcb_rectangle_t r = {x1, y1, x2 - x1, y2 - y1};
+    return r;
+}
+
+static inline int64_t XCBRectangleArea(xcb_rectangle_t r)
+{
+    return (int64_t)r.width * r.height;
+}
+
 @implementation XCBRegion
 
 @synthesize regionId;
@@ -39,7 +86,10 @@
     if (aRegionId == XCB_NONE)
         regionId = xcb_generate_id([connection connection]);
     else
+    {
         regionId = aRegionId;
+        serverRegionCreated = YES;
+    }
     
     
     return self;
@@ -50,13 +100,33 @@
 {
     self = [self initWithConnection:aConnection];
     
-    rectanglesNumber = rectsNumber;
-    rectangles = rects;
+    for (int i = 0; i < rectsNumber; i++)
+        [self appendRectangle:rects[i]];
     
     xcb_xfixes_create_region([connection connection],
                              regionId,
                              rectanglesNumber,
                              rectangles);
+    serverRegionCreated = YES;
+    
+    return self;
+}
+
+- (id) initWithRectangles:(const xcb_rectangle_t *)rects count:(int)rectsNumber
+{
+    self = [super init];
+    
+    if (self == nil)
+    {
+        NSLog(@"Unable to init");
+        return nil;
+    }
+    
+    className = NSStringFromClass([self class]);
+    regionId = XCB_NONE;
+    
+    for (int i = 0; i < rectsNumber; i++)
+        [self unionWithRectangle:rects[i]];
     
     return self;
 }
@@ -120,9 +190,281 @@
     return;
 }
 
+#pragma mark - Client-side region math
+
+- (void) appendRectangle:(xcb_rectangle_t)rect
+{
+    if (rectanglesNumber == rectanglesCapacity)
+    {
+        int newCapacity = rectanglesCapacity > 0 ? rectanglesCapacity * 2 : 8;
+        xcb_rectangle_t *newRects = realloc(rectangles, newCapacity * sizeof(xcb_rectangle_t));
+        
+        if (newRects == NULL)
+        {
+            NSLog(@" [%@:] Unable to grow the rectangle list", className);
+            return;
+        }
+        
+        rectangles = newRects;
+        rectanglesCapacity = newCapacity;
+    }
+    
+    rectangles[rectanglesNumber++] = rect;
+}
+
+- (void) replaceRectangles:(xcb_rectangle_t *)rects count:(int)rectsNumber capacity:(int)capacity
+{
+    free(rectangles);
+    rectangles = rects;
+    rectanglesNumber = rectsNumber;
+    rectanglesCapacity = capacity;
+}
+
+- (BOOL) isEmpty
+{
+    return rectanglesNumber == 0;
+}
+
+- (xcb_rectangle_t) extents
+{
+    xcb_rectangle_t bounds = {0, 0, 0, 0};
+    
+    if (rectanglesNumber == 0)
+        return bounds;
+    
+    bounds = rectangles[0];
+    
+    for (int i = 1; i < rectanglesNumber; i++)
+        bounds = XCBRectangleBounds(bounds, rectangles[i]);
+    
+    return bounds;
+}
+
+- (void) removeAllRectangles
+{
+    rectanglesNumber = 0;
+}
+
+- (void) setRectangle:(xcb_rectangle_t)rect
+{
+    rectanglesNumber = 0;
+    
+    if (!XCBRectangleIsEmpty(rect))
+        [self appendRectangle:rect];
+}
+
+- (void) unionWithRectangle:(xcb_rectangle_t)rect
+{
+    if (XCBRectangleIsEmpty(rect))
+        return;
+    
+    int kept = 0;
+    
+    for (int i = 0; i < rectanglesNumber; i++)
+    {
+        if (XCBRectangleContains(rectangles[i], rect))
+            return;
+        
+        /*** drop the rectangles the new one covers ***/
+        if (!XCBRectangleContains(rect, rectangles[i]))
+            rectangles[kept++] = rectangles[i];
+    }
+    
+    rectanglesNumber = kept;
+    [self appendRectangle:rect];
+}
+
+- (void) unionWithRegion:(XCBRegion *)aRegion
+{
+    if (aRegion == self)
+        return;
+    
+    int count = [aRegion rectanglesNumber];
+    xcb_rectangle_t *rects = [aRegion rectangles];
+    
+    for (int i = 0; i < count; i++)
+        [self unionWithRectangle:rects[i]];
+}
+
+- (void) intersectWithRectangle:(xcb_rectangle_t)rect
+{
+    int kept = 0;
+    
+    for (int i = 0; i < rectanglesNumber; i++)
+    {
+        xcb_rectangle_t r = XCBRectangleIntersection(rectangles[i], rect);
+        
+        if (!XCBRectangleIsEmpty(r))
+            rectangles[kept++] = r;
+    }
+    
+    rectanglesNumber = kept;
+}
+
+- (void) intersectWithRegion:(XCBRegion *)aRegion
+{
+    if (aRegion == self)
+        return;
+    
+    int count = [aRegion rectanglesNumber];
+    xcb_rectangle_t *rects = [aRegion rectangles];
+    
+    if (count == 1)
+    {
+        [self intersectWithRectangle:rects[0]];
+        return;
+    }
+    
+    int oldCount = rectanglesNumber;
+    xcb_rectangle_t *old = rectangles;
+    
+    rectangles = NULL;
+    rectanglesNumber = 0;
+    rectanglesCapacity = 0;
+    
+    for (int i = 0; i < oldCount; i++)
+    {
+        for (int j = 0; j < count; j++)
+            [self unionWithRectangle:XCBRectangleIntersection(old[i], rects[j])];
+    }
+    
+    free(old);
+}
+
+- (void) subtractRectangle:(xcb_rectangle_t)rect
+{
+    if (XCBRectangleIsEmpty(rect) || rectanglesNumber == 0)
+        return;
+    
+    /*** every rectangle splits into at most four pieces ***/
+    int capacity = rectanglesNumber * 4;
+    xcb_rectangle_t *result = malloc(capacity * sizeof(xcb_rectangle_t));
+    int count = 0;
+    
+    if (result == NULL)
+    {
+        NSLog(@" [%@:] Unable to allocate the rectangle list", className);
+        return;
+    }
+    
+    for (int i = 0; i < rectanglesNumber; i++)
+    {
+        xcb_rectangle_t a = rectangles[i];
+        xcb_rectangle_t hole = XCBRectangleIntersection(a, rect);
+        
+        if (XCBRectangleIsEmpty(hole))
+        {
+            result[count++] = a;
+            continue;
+        }
+        
+        int32_t aBottom = (int32_t)a.y + a.height;
+        int32_t aRight = (int32_t)a.x + a.width;
+        int32_t holeBottom = (int32_t)hole.y + hole.height;
+        int32_t holeRight = (int32_t)hole.x + hole.width;
+        
+        if (hole.y > a.y)
+            result[count++] = (xcb_rectangle_t){a.x, a.y, a.width, hole.y - a.y};
+        
+        if (holeBottom < aBottom)
+            result[count++] = (xcb_rectangle_t){a.x, holeBottom, a.width, aBottom - holeBottom};
+        
+        if (hole.x > a.x)
+            result[count++] = (xcb_rectangle_t){a.x, hole.y, hole.x - a.x, hole.height};
+        
+        if (holeRight < aRight)
+            result[count++] = (xcb_rectangle_t){holeRight, hole.y, aRight - holeRight, hole.height};
+    }
+    
+    [self replaceRectangles:result count:count capacity:capacity];
+}
+
+- (void) subtractRegion:(XCBRegion *)aRegion
+{
+    if (aRegion == self)
+    {
+        rectanglesNumber = 0;
+        return;
+    }
+    
+    int count = [aRegion rectanglesNumber];
+    xcb_rectangle_t *rects = [aRegion rectangles];
+    
+    for (int i = 0; i < count && rectanglesNumber > 0; i++)
+        [self subtractRectangle:rects[i]];
+}
+
+- (void) translateByX:(int16_t)dx y:(int16_t)dy
+{
+    for (int i = 0; i < rectanglesNumber; i++)
+    {
+        rectangles[i].x += dx;
+        rectangles[i].y += dy;
+    }
+}
+
+- (void) simplifyToMaximumRectangles:(int)maxRects
+{
+    if (maxRects < 1)
+        maxRects = 1;
+    
+    /*** merge the pair whose bounding box wastes the least area until the list fits ***/
+    while (rectanglesNumber > maxRects)
+    {
+        int bestA = 0;
+        int bestB = 1;
+        int64_t bestWaste = INT64_MAX;
+        
+        for (int i = 0; i < rectanglesNumber - 1; i++)
+        {
+            for (int j = i + 1; j < rectanglesNumber; j++)
+            {
+                int64_t waste = XCBRectangleArea(XCBRectangleBounds(rectangles[i], rectangles[j])) -
+                                XCBRectangleArea(rectangles[i]) - XCBRectangleArea(rectangles[j]);
+                
+                if (waste < bestWaste)
+                {
+                    bestWaste = waste;
+                    bestA = i;
+                    bestB = j;
+                }
+            }
+        }
+        
+        xcb_rectangle_t merged = XCBRectangleBounds(rectangles[bestA], rectangles[bestB]);
+        rectangles[bestB] = rectangles[--rectanglesNumber];
+        rectangles[bestA] = rectangles[--rectanglesNumber];
+        [self unionWithRectangle:merged];
+    }
+}
+
+- (void) updateServerRegion
+{
+    if (connection == nil)
+    {
+        NSLog(@" [%@:] Client-side region has no connection", className);
+        return;
+    }
+    
+    if (regionId == XCB_NONE)
+        regionId = xcb_generate_id([connection connection]);
+    
+    if (serverRegionCreated)
+        xcb_xfixes_set_region([connection connection], regionId, rectanglesNumber, rectangles);
+    else
+    {
+        xcb_xfixes_create_region([connection connection], regionId, rectanglesNumber, rectangles);
+        serverRegionCreated = YES;
+    }
+}
+
 - (void) dealloc
 {
-    xcb_xfixes_destroy_region([connection connection], regionId);
+    if (serverRegionCreated && connection != nil)
+        xcb_xfixes_destroy_region([connection connection], regionId);
+    
+    free(rectangles);
+    rectangles = NULL;
     connection = nil;
     className = nil;
 }
@@ -40,4 +40,17 @@
 - (void) createRoundedCornersWithTopRadius:(int)topRadius bottomRadius:(int)bottomRadius;
 - (void) calculateDimensionsFromGeometries:(XCBGeometryReply*)aGeometryReply;
 
+/*** Sets the bounding shape of a width x height window with rounded corners as one
+     ShapeRectangles request: no pixmaps, no GCs, no round-trips. The corner rows are
+     computed once per (topRadius, bottomRadius) and reused for every size. ***/
++ (BOOL) setRoundedBoundingForWindow:(xcb_window_t)aWindow
+                        onConnection:(XCBConnection*)aConnection
+                               width:(uint16_t)aWidth
+                              height:(uint16_t)aHeight
+                           topRadius:(int)topRadius
+                        bottomRadius:(int)bottomRadius;
+
+/*** Back to the default (rectangular) bounding shape ***/
++ (void) resetBoundingForWindow:(xcb_window_t)aWindow onConnection:(XCBConnection*)aConnection;
+
 @end
\ No newline at end of file
@@ -7,6 +7,18 @@
 #import "XCBShape.h"
 #import "XCBConnection.h"
 
+#include <math.h>
+
+/*** A run of corner rows that all leave the same number of pixels out at each end ***/
+typedef struct _XCBCornerBand
+{
+    uint16_t inset;
+    uint16_t rows;
+} XCBCornerBand;
+
+/*** (topRadius, bottomRadius) -> NSArray of two NSData of XCBCornerBand, outer edge first ***/
+static NSMutableDictionary *cornerBandsCache;
+
 @implementation XCBShape
 
 @synthesize connection;
@@ -222,6 +234,131 @@
     xcb_shape_mask(conn, XCB_SHAPE_SO_SET, XCB_SHAPE_SK_BOUNDING, winId, -borderWidth, -borderWidth, borderPixmap);
 }
 
+/*** Same circle as the arcs above: bounding box (-1, -1, 2r, 2r), a pixel is in when its center is ***/
++ (NSData*) cornerBandsForRadius:(int)aRadius
+{
+    NSMutableData *bands = [NSMutableData data];
+    XCBCornerBand band = {0, 0};
+
+    for (int y = 0; y < aRadius; y++)
+    {
+        double dy = (y + 0.5) - (aRadius - 1);
+        double dx = sqrt((double)aRadius * aRadius - dy * dy);
+        int inset = (int) ceil(aRadius - 1.5 - dx);
+
+        if (inset <= 0)
+            break;
+
+        if (band.rows > 0 && band.inset != inset)
+        {
+            [bands appendBytes:&band length:sizeof(band)];
+            band.rows = 0;
+        }
+
+        band.inset = (uint16_t) inset;
+        band.rows++;
+    }
+
+    if (band.rows > 0)
+        [bands appendBytes:&band length:sizeof(band)];
+
+    return bands;
+}
+
++ (NSArray*) cornerBandsForTopRadius:(int)topRadius bottomRadius:(int)bottomRadius
+{
+    NSString *key = [NSString stringWithFormat:@"%d/%d", topRadius, bottomRadius];
+    NSArray *bands = [cornerBandsCache objectForKey:key];
+
+    if (bands)
+        return bands;
+
+    if (cornerBandsCache == nil)
+        cornerBandsCache = [[NSMutableDictionary alloc] init];
+
+    bands = @[[self cornerBandsForRadius:topRadius], [self cornerBandsForRadius:bottomRadius]];
+    [cornerBandsCache setObject:bands forKey:key];
+
+    return bands;
+}
+
++ (BOOL) setRoundedBoundingForWindow:(xcb_window_t)aWindow
+                        onConnection:(XCBConnection*)aConnection
+                               width:(uint16_t)aWidth
+                              height:(uint16_t)aHeight
+                           topRadius:(int)topRadius
+                        bottomRadius:(int)bottomRadius
+{
+    xcb_connection_t *conn = [aConnection connection];
+    const xcb_query_extension_reply_t *shapeExtension = xcb_get_extension_data(conn, &xcb_shape_id);
+
+    if (!shapeExtension || !shapeExtension->present || aWidth == 0 || aHeight == 0)
+        return NO;
+
+    NSArray *bands = [self cornerBandsForTopRadius:topRadius bottomRadius:bottomRadius];
+    NSData *topData = [bands objectAtIndex:0];
+    NSData *bottomData = [bands objectAtIndex:1];
+    const XCBCornerBand *topBands = [topData bytes];
+    const XCBCornerBand *bottomBands = [bottomData bytes];
+    NSUInteger topCount = [topData length] / sizeof(XCBCornerBand);
+    NSUInteger bottomCount = [bottomData length] / sizeof(XCBCornerBand);
+
+    /*** One rectangle per band, top to bottom and never overlapping: YX-banded ***/
+    xcb_rectangle_t rects[topCount + bottomCount + 1];
+    uint32_t count = 0;
+    int y = 0;
+
+    for (NSUInteger i = 0; i < topCount && y < aHeight; i++)
+    {
+        int rows = MIN((int) topBands[i].rows, aHeight - y);
+
+        if (aWidth > 2 * topBands[i].inset)
+            rects[count++] = (xcb_rectangle_t) {topBands[i].inset, y, aWidth - 2 * topBands[i].inset, rows};
+
+        y += rows;
+    }
+
+    int bottomRows = 0;
+
+    for (NSUInteger i = 0; i < bottomCount; i++)
+        bottomRows += bottomBands[i].rows;
+
+    int bottomStart = MAX(y, aHeight - bottomRows);
+
+    if (bottomStart > y)
+        rects[count++] = (xcb_rectangle_t) {0, y, aWidth, bottomStart - y};
+
+    /*** Bottom corner bands go from the edge inward, so walk them backwards ***/
+    y = aHeight - bottomRows;
+
+    for (NSInteger i = (NSInteger) bottomCount - 1; i >= 0; i--)
+    {
+        int top = MAX(y, bottomStart);
+        int end = y + bottomBands[i].rows;
+
+        if (end > top && aWidth > 2 * bottomBands[i].inset)
+            rects[count++] = (xcb_rectangle_t) {bottomBands[i].inset, top, aWidth - 2 * bottomBands[i].inset, end - top};
+
+        y = end;
+    }
+
+    xcb_shape_rectangles(conn, XCB_SHAPE_SO_SET, XCB_SHAPE_SK_BOUNDING, XCB_CLIP_ORDERING_YX_BANDED,
+                         aWindow, 0, 0, count, rects);
+
+    return YES;
+}
+
++ (void) resetBoundingForWindow:(xcb_window_t)aWindow onConnection:(XCBConnection*)aConnection
+{
+    xcb_connection_t *conn = [aConnection connection];
+    const xcb_query_extension_reply_t *shapeExtension = xcb_get_extension_data(conn, &xcb_shape_id);
+
+    if (!shapeExtension || !shapeExtension->present)
+        return;
+
+    xcb_shape_mask(conn, XCB_SHAPE_SO_SET, XCB_SHAPE_SK_BOUNDING, aWindow, 0, 0, XCB_NONE);
+}
+
 - (void) dealloc
 {
     if (shapeExtensionReply)
@@ -436,6 +436,23 @@
 - (XCBScreen*) onScreen
 {
     NSUInteger size = [[connection screens] count];
+    xcb_get_geometry_reply_t *cachedGeometry = [[connection snapshotForWindow:window] geometry];
+
+    /*** the prefetched geometry already names the root, no QueryTree needed ***/
+    if (cachedGeometry != NULL)
+    {
+        for (int i = 0; i < size; i++)
+        {
+            XCBScreen *candidate = [[connection screens] objectAtIndex:i];
+
+            if ([[candidate rootWindow] window] == cachedGeometry->root)
+            {
+                screen = candidate;
+                return screen;
+            }
+        }
+    }
+
     XCBQueryTreeReply *queryTreeReply = [self queryTree];
     
     if ([queryTreeReply message] == BadWindow)
@@ -549,6 +566,14 @@
 
 - (void) updateAttributes
 {
+    xcb_get_window_attributes_reply_t *cachedAttributes = [[connection snapshotForWindow:window] copyAttributes];
+
+    if (cachedAttributes != NULL)
+    {
+        attributes = [[XCBAttributesReply alloc] initWithAttributesReply:cachedAttributes];
+        return;
+    }
+
     xcb_generic_error_t *error;
     xcb_get_window_attributes_cookie_t cookie = xcb_get_window_attributes([connection connection], window);
     xcb_get_window_attributes_reply_t *attr = xcb_get_window_attributes_reply([connection connection], cookie, &error);
@@ -888,9 +913,7 @@
     isBelow = NO;
     NSLog(@"[STACK] Window %u raised to top", window);
 
-    EWMHService *ewmhService = [EWMHService sharedInstanceWithConnection:connection];
-    [ewmhService updateNetClientList];
-    ewmhService = nil;
+    [connection raiseInClientListStacking:window];
 }
 
 - (void)stackBelow
@@ -901,9 +924,7 @@
     isAbove = NO;
     isBelow = YES;
 
-    EWMHService *ewmhService = [EWMHService sharedInstanceWithConnection:connection];
-    [ewmhService updateNetClientList];
-    ewmhService = nil;
+    [connection lowerInClientListStacking:window];
 }
 
 - (void)grabButton
@@ -1031,12 +1052,18 @@
 
 - (XCBGeometryReply *)geometries
 {
-    xcb_get_geometry_cookie_t cookie = xcb_get_geometry([connection connection], window);
-    xcb_generic_error_t *error;
+    xcb_get_geometry_cookie_t cookie;
+    xcb_generic_error_t *error = NULL;
     xcb_get_geometry_reply_t *pixmapReply;
-    xcb_get_geometry_reply_t *reply = xcb_get_geometry_reply([connection connection], cookie, &error);
+    xcb_get_geometry_reply_t *reply = [[connection snapshotForWindow:window] copyGeometry];
     XCBGeometryReply *geometry;
 
+    if (reply == NULL)
+    {
+        cookie = xcb_get_geometry([connection connection], window);
+        reply = xcb_get_geometry_reply([connection connection], cookie, &error);
+    }
+
     if (reply == NULL)
     {
         NSLog(@"Reply is NULL");
@@ -1196,12 +1223,14 @@
     xcb_flush([connection connection]);
     [frame setOriginalRect:frameRect];
     [frame updateAllResizeZonePositions];
-    [frame applyRoundedCornersShapeMask];
 
     [titleBar updateRectsFromGeometries];
     //[titleBar drawTitleBarComponents]; FIXME: why this draw here?
     [frame setWindowRect:frameRect];
 
+    /*** the shape is built from the cached frame size ***/
+    [frame applyRoundedCornersShapeMask];
+
     /*** required by ICCCM compliance ***/
 
     [frame configureClient];
@@ -1322,6 +1351,9 @@
     xcb_get_property_reply_t *reply = [ewmhService netWmIconFromWindow:self];
     cairoSet = [[CairoSurfacesSet alloc] initWithConnection:connection];
     [cairoSet buildSetFromReply:reply];
+
+    /*** the icon is now held as surfaces; the raw property is by far the largest thing in a snapshot ***/
+    [[connection snapshotForWindow:window] invalidateAtom:[[ewmhService atomService] atomFromCachedAtomsWithKey:[ewmhService EWMHWMIcon]]];
     icons = [cairoSet cairoSurfaces];
     [self onScreen];
     [self updateAttributes];
@@ -41,7 +41,8 @@
 
 @interface EWMHService : NSObject
 {
-
+    NSData *lastClientList;          /* last values written, to skip redundant updates */
+    NSData *lastClientListStacking;
 }
 
 @property (strong, nonatomic) NSArray *atoms;
@@ -140,6 +141,7 @@
 // Window Manager Protocols
 @property (strong, nonatomic)NSString* EWMHWMPing;
 @property (strong, nonatomic)NSString* EWMHWMSyncRequest;
+@property (strong, nonatomic)NSString* EWMHWMSyncRequestCounter;
 @property (strong, nonatomic)NSString* EWMHWMFullscreenMonitors;
 
 // Other properties
@@ -196,6 +198,9 @@
 - (void) updateNetWmState:(XCBWindow*) aWindow;
 - (uint32_t) netWMPidForWindow:(XCBWindow *)aWindow;
 
+// Window manager protocols
+- (BOOL) readSyncRequestCounterForWindow:(XCBWindow*)aWindow counter:(uint32_t*)outCounter;
+
 // ICCCM/EWMH Strut and Workarea support
 - (BOOL) readStrutForWindow:(XCBWindow*)aWindow strut:(uint32_t[4])outStrut;
 - (BOOL) readStrutPartialForWindow:(XCBWindow*)aWindow strut:(uint32_t[12])outStrut;
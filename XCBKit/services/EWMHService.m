@@ -124,6 +124,7 @@
 // Window Manager Protocols
 @synthesize EWMHWMPing;
 @synthesize EWMHWMSyncRequest;
+@synthesize EWMHWMSyncRequestCounter;
 @synthesize EWMHWMFullscreenMonitors;
 
 // Other properties
@@ -251,6 +252,7 @@
     // Window Manager Protocols
     EWMHWMPing = @"_NET_WM_PING";
     EWMHWMSyncRequest = @"_NET_WM_SYNC_REQUEST";
+    EWMHWMSyncRequestCounter = @"_NET_WM_SYNC_REQUEST_COUNTER";
     EWMHWMFullscreenMonitors = @"_NET_WM_FULLSCREEN_MONITORS";
 
     // Other properties
@@ -354,6 +356,7 @@
         EWMHWMActionBelow,
         EWMHWMPing,
         EWMHWMSyncRequest,
+        EWMHWMSyncRequestCounter,
         EWMHWMFullscreenMonitors,
         EWMHWMFullPlacement,
         GNUStepMiniaturizeWindow,
@@ -522,6 +525,9 @@
 {
     xcb_atom_t property = [atomService atomFromCachedAtomsWithKey:propertyKey];
 
+    // The PropertyNotify for our own write comes later; don't serve the old value until then
+    [[connection snapshotForWindow:[aWindow window]] invalidateAtom:property];
+
     xcb_change_property([connection connection],
                         mode,
                         [aWindow window],
@@ -540,6 +546,24 @@
                length:(uint32_t)len
 {
     xcb_atom_t property = [atomService atomFromCachedAtomsWithKey:aPropertyName];
+    XCBWindowSnapshot *snapshot = [connection snapshotForWindow:[aWindow window]];
+
+    if (deleteProperty)
+    {
+        [snapshot invalidateAtom:property];
+        snapshot = nil;
+    }
+
+    // OPTIMIZATION: answer from the prefetched snapshot, no round-trip
+    if ([snapshot containsAtom:property])
+    {
+        xcb_get_property_reply_t *cached = [snapshot propertyForAtom:property];
+
+        if (cached == NULL || (propertyType != XCB_GET_PROPERTY_TYPE_ANY && cached->type != propertyType))
+            return NULL;
+
+        return [snapshot copyPropertyForAtom:property];
+    }
 
     xcb_get_property_cookie_t cookie = xcb_get_property([connection connection],
                                                         deleteProperty,
@@ -622,20 +646,8 @@
 
 - (BOOL) ewmhClientMessage:(NSString *)anAtomMessageName
 {
-    NSString *net = @"NET";
-    BOOL ewmh = NO;
-
-    NSString *sub = [anAtomMessageName componentsSeparatedByString:@"_"][1];
-
-    if ([net isEqualToString:sub])
-        ewmh = YES;
-    else
-        ewmh = NO;
-
-    net = nil;
-    sub = nil;
-
-    return ewmh;
+    // BUGFIX: splitting on "_" threw for names with no underscore and allocated an array per message
+    return [anAtomMessageName hasPrefix:@"_NET_"];
 }
 
 - (void) handleClientMessage:(NSString*)anAtomMessageName forWindow:(XCBWindow*)aWindow data:(xcb_client_message_data_t)someData
@@ -1185,10 +1197,19 @@
 
 - (xcb_get_property_reply_t*) netWmIconFromWindow:(XCBWindow*)aWindow
 {
+    xcb_atom_t iconAtom = [atomService atomFromCachedAtomsWithKey:EWMHWMIcon];
+    XCBWindowSnapshot *snapshot = [connection snapshotForWindow:[aWindow window]];
+
+    if ([snapshot containsAtom:iconAtom])
+    {
+        xcb_get_property_reply_t *cached = [snapshot propertyForAtom:iconAtom];
+        return (cached != NULL && cached->type == XCB_ATOM_CARDINAL) ? [snapshot copyPropertyForAtom:iconAtom] : NULL;
+    }
+
     xcb_get_property_cookie_t cookie = xcb_get_property_unchecked([connection connection],
                                                                   false,
                                                                   [aWindow window],
-                                                                  [atomService atomFromCachedAtomsWithKey:EWMHWMIcon],
+                                                                  iconAtom,
                                                                   XCB_ATOM_CARDINAL,
                                                                   0,
                                                                   UINT32_MAX);
@@ -1199,81 +1220,39 @@
 
 - (void) updateNetClientList
 {
-    uint32_t size = [connection clientListIndex];
-
     //TODO: with more screens this need to be looped ?
     XCBWindow *rootWindow = [connection rootWindowForScreenNumber:0];
 
-    [self changePropertiesForWindow:rootWindow
-                           withMode:XCB_PROP_MODE_REPLACE
-                       withProperty:EWMHClientList
-                           withType:XCB_ATOM_WINDOW
-                         withFormat:32
-                     withDataLength:size
-                           withData:[connection clientList]];
-
-    // _NET_CLIENT_LIST_STACKING must reflect actual stacking order (bottom-to-top)
-    if (size > 0) {
-        xcb_connection_t *conn = [connection connection];
-        xcb_query_tree_cookie_t tree_cookie = xcb_query_tree(conn, [rootWindow window]);
-        xcb_query_tree_reply_t *tree_reply = xcb_query_tree_reply(conn, tree_cookie, NULL);
-
-        xcb_window_t stackingList[size];
-        uint32_t stackingCount = 0;
-
-        if (tree_reply) {
-            xcb_window_t *children = xcb_query_tree_children(tree_reply);
-            int num_children = xcb_query_tree_children_length(tree_reply);
-
-            NSMutableSet *clientSet = [NSMutableSet setWithCapacity:size];
-            for (uint32_t i = 0; i < size; i++) {
-                [clientSet addObject:@([connection clientList][i])];
-            }
-
-            for (int i = 0; i < num_children; i++) {
-                NSNumber *childNumber = @(children[i]);
-                if ([clientSet containsObject:childNumber]) {
-                    stackingList[stackingCount++] = children[i];
-                }
-            }
-
-            // Append any clients not present in the query tree (e.g., unmapped)
-            if (stackingCount < size) {
-                NSMutableSet *addedSet = [NSMutableSet setWithCapacity:stackingCount];
-                for (uint32_t i = 0; i < stackingCount; i++) {
-                    [addedSet addObject:@(stackingList[i])];
-                }
-                for (uint32_t i = 0; i < size; i++) {
-                    NSNumber *clientNumber = @([connection clientList][i]);
-                    if (![addedSet containsObject:clientNumber]) {
-                        stackingList[stackingCount++] = [clientNumber unsignedIntValue];
-                    }
-                }
-            }
-
-            free(tree_reply);
-        } else {
-            // Fallback to client registration order if stacking can't be queried
-            for (uint32_t i = 0; i < size; i++) {
-                stackingList[stackingCount++] = [connection clientList][i];
-            }
-        }
+    // Both lists are kept by the connection (_NET_CLIENT_LIST_STACKING bottom-to-top),
+    // so nothing has to be queried here; a property is only written when its list changed.
+    NSData *clientList = [NSData dataWithBytes:[connection clientList]
+                                        length:[connection clientListIndex] * sizeof(xcb_window_t)];
 
+    if (![clientList isEqualToData:lastClientList])
+    {
         [self changePropertiesForWindow:rootWindow
                                withMode:XCB_PROP_MODE_REPLACE
-                           withProperty:EWMHClientListStacking
+                           withProperty:EWMHClientList
                                withType:XCB_ATOM_WINDOW
                              withFormat:32
-                         withDataLength:stackingCount
-                               withData:stackingList];
-    } else {
+                         withDataLength:(uint32_t)[connection clientListIndex]
+                               withData:[connection clientList]];
+        lastClientList = clientList;
+    }
+
+    NSData *stackingList = [NSData dataWithBytes:[connection clientListStacking]
+                                          length:[connection clientListStackingIndex] * sizeof(xcb_window_t)];
+
+    if (![stackingList isEqualToData:lastClientListStacking])
+    {
         [self changePropertiesForWindow:rootWindow
                                withMode:XCB_PROP_MODE_REPLACE
                            withProperty:EWMHClientListStacking
                                withType:XCB_ATOM_WINDOW
                              withFormat:32
-                         withDataLength:0
-                               withData:NULL];
+                         withDataLength:(uint32_t)[connection clientListStackingIndex]
+                               withData:[connection clientListStacking]];
+        lastClientListStacking = stackingList;
     }
 
     rootWindow = nil;
@@ -1312,6 +1291,40 @@
                            withData:atomList];
 }
 
+#pragma mark - Window Manager Protocols
+
+- (BOOL) readSyncRequestCounterForWindow:(XCBWindow*)aWindow counter:(uint32_t*)outCounter
+{
+    if (!aWindow) {
+        return NO;
+    }
+
+    // _NET_WM_SYNC_REQUEST_COUNTER is one XID, or two when the client also
+    // supports frame-synchronized drawing; the first is the basic counter
+    void *reply = [self getProperty:EWMHWMSyncRequestCounter
+                       propertyType:XCB_ATOM_CARDINAL
+                          forWindow:aWindow
+                             delete:NO
+                             length:2];
+
+    if (!reply) {
+        return NO;
+    }
+
+    xcb_get_property_reply_t *propReply = (xcb_get_property_reply_t *)reply;
+
+    if (propReply->type == XCB_ATOM_NONE || propReply->length < 1) {
+        free(reply);
+        return NO;
+    }
+
+    uint32_t *values = (uint32_t *)xcb_get_property_value(propReply);
+    *outCounter = values[0];
+
+    free(reply);
+    return *outCounter != XCB_NONE;
+}
+
 #pragma mark - ICCCM/EWMH Strut and Workarea Support
 
 - (BOOL) readStrutForWindow:(XCBWindow*)aWindow strut:(uint32_t[4])outStrut
@@ -1578,6 +1591,7 @@
     // Window Manager Protocols
     EWMHWMPing = nil;
     EWMHWMSyncRequest = nil;
+    EWMHWMSyncRequestCounter = nil;
     EWMHWMFullscreenMonitors = nil;
 
     // Other properties
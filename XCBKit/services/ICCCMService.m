@@ -108,10 +108,26 @@
 
 - (xcb_size_hints_t*) wmNormalHintsForWindow:(XCBWindow *)aWindow
 {
+    XCBWindowSnapshot *snapshot = [[super connection] snapshotForWindow:[aWindow window]];
+    xcb_atom_t normalHintsAtom = [[super atomService] atomFromCachedAtomsWithKey:WMNormalHints];
+
+    if ([snapshot containsAtom:normalHintsAtom])
+    {
+        xcb_get_property_reply_t *reply = [snapshot propertyForAtom:normalHintsAtom];
+        xcb_size_hints_t *cachedHints = calloc(1, sizeof(xcb_size_hints_t));
+
+        /*** like the server path, a missing property leaves the hints empty (flags 0) ***/
+        if (cachedHints != NULL && reply != NULL)
+            xcb_icccm_get_wm_size_hints_from_reply(cachedHints, reply);
+
+        return cachedHints;
+    }
+
     xcb_connection_t *connection = [[aWindow connection] connection];
     xcb_get_property_cookie_t cookie = xcb_icccm_get_wm_normal_hints(connection, [aWindow window]);
     
-    xcb_size_hints_t *sizeHints = malloc(sizeof(xcb_size_hints_t));
+    // BUGFIX: zeroed, so a window without WM_NORMAL_HINTS reads flags 0 instead of garbage
+    xcb_size_hints_t *sizeHints = calloc(1, sizeof(xcb_size_hints_t));
     
     xcb_icccm_get_wm_normal_hints_reply(connection, cookie, sizeHints, NULL);
     
@@ -126,6 +142,22 @@
 
 - (NSString*) getWmNameForWindow:(XCBWindow *)aWindow
 {
+    XCBWindowSnapshot *snapshot = [[super connection] snapshotForWindow:[aWindow window]];
+    xcb_atom_t nameAtom = [[super atomService] atomFromCachedAtomsWithKey:WMName];
+
+    if ([snapshot containsAtom:nameAtom])
+    {
+        xcb_get_property_reply_t *reply = [snapshot propertyForAtom:nameAtom];
+        int length = reply != NULL ? xcb_get_property_value_length(reply) : 0;
+
+        if (length <= 0)
+            return nil;
+
+        return [[NSString alloc] initWithBytes:xcb_get_property_value(reply)
+                                        length:length
+                                      encoding:NSASCIIStringEncoding];
+    }
+
     xcb_get_property_cookie_t cookie = xcb_icccm_get_wm_name([[aWindow connection] connection], [aWindow window]);
     xcb_icccm_get_text_property_reply_t property;
     
@@ -143,6 +175,22 @@
 - (xcb_icccm_wm_hints_t) wmHintsFromWindow:(XCBWindow*)aWindow
 {
     xcb_icccm_wm_hints_t wmHints;
+    XCBWindowSnapshot *snapshot = [[super connection] snapshotForWindow:[aWindow window]];
+    xcb_atom_t hintsAtom = [[super atomService] atomFromCachedAtomsWithKey:WMHints];
+
+    if ([snapshot containsAtom:hintsAtom])
+    {
+        xcb_get_property_reply_t *reply = [snapshot propertyForAtom:hintsAtom];
+
+        if (reply == NULL || !xcb_icccm_get_wm_hints_from_reply(&wmHints, reply))
+        {
+            NSLog(@"Error: Can't fill wmHints structure!");
+            memset(&wmHints, 0, sizeof(wmHints));
+        }
+
+        return wmHints;
+    }
+
     xcb_get_property_cookie_t cookie = xcb_icccm_get_wm_hints([[super connection] connection],
                                                               [aWindow window]);
     uint8_t success = xcb_icccm_get_wm_hints_reply([[super connection] connection],
@@ -199,12 +247,29 @@
 
 - (void) wmClassForWindow:(XCBWindow*)aWindow
 {
-    xcb_get_property_cookie_t cookie = xcb_icccm_get_wm_class_unchecked([[super connection] connection], [aWindow window]);
     xcb_icccm_get_wm_class_reply_t reply;
+    XCBWindowSnapshot *snapshot = [[super connection] snapshotForWindow:[aWindow window]];
+    xcb_atom_t classAtom = [[super atomService] atomFromCachedAtomsWithKey:WMClass];
+    BOOL success;
+
+    if ([snapshot containsAtom:classAtom])
+    {
+        /*** the class reply takes ownership of the property reply, so it gets a copy ***/
+        xcb_get_property_reply_t *copy = [snapshot copyPropertyForAtom:classAtom];
+        success = copy != NULL && xcb_icccm_get_wm_class_from_reply(&reply, copy);
 
-    if (!xcb_icccm_get_wm_class_reply([[super connection] connection],
-                                      cookie,
-                                      &reply, NULL))
+        if (copy != NULL && !success)
+            free(copy);
+    }
+    else
+    {
+        xcb_get_property_cookie_t cookie = xcb_icccm_get_wm_class_unchecked([[super connection] connection], [aWindow window]);
+        success = xcb_icccm_get_wm_class_reply([[super connection] connection],
+                                               cookie,
+                                               &reply, NULL);
+    }
+
+    if (!success)
     {
         NSLog(@"Error while checking WM_CLASS");
         return;
@@ -15,6 +15,7 @@
 
 @interface XCBAtomService : NSObject
 {
+    XCBWindowTable *atomNames; /*** atom -> name, filled by cacheAtom and atomNameFromAtom ***/
 }
 
 @property (strong, nonatomic) XCBConnection *connection;
@@ -24,10 +25,13 @@
 + (id) sharedInstanceWithConnection:(XCBConnection*) aConnection;
 
 - (xcb_atom_t) cacheAtom:(NSString*) atomName;
+/*** Interns every name not yet cached with one pipelined batch of intern_atom requests ***/
 - (void) cacheAtoms:(NSArray*) atoms;
 - (xcb_atom_t) atomFromCachedAtomsWithKey:(NSString*) atomName;
 - (NSNumber*) atomNumberFromCachedAtomsWithKey:(NSString*) atomName;
 - (NSString*) atomNameFromAtom:(xcb_atom_t)anAtom;
+/*** Name from the reverse cache only; nil for atoms never seen, never a round-trip ***/
+- (NSString*) cachedNameFromAtom:(xcb_atom_t)anAtom;
 
 - (void) dealloc;
 
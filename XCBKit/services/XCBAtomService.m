@@ -25,6 +25,7 @@
     
     connection = aConnection;
     cachedAtoms = [[NSMutableDictionary alloc] init];
+    atomNames = [[XCBWindowTable alloc] initWithCapacity:256];
     
     return self;
 }
@@ -57,9 +58,15 @@
     const char *str = [atomName UTF8String];
     xcb_intern_atom_cookie_t cookie = xcb_intern_atom([connection connection], NO, strlen(str), str);
     xcb_intern_atom_reply_t* reply = xcb_intern_atom_reply([connection connection], cookie, NULL);
+
+    if (reply == NULL)
+    {
+        NSLog(@"[XCBAtomService] Failed to intern atom %@", atomName);
+        return XCB_ATOM_NONE;
+    }
+
     xcb_atom_t atom = reply->atom;
-    atomValue = [NSNumber numberWithUnsignedInt:atom];
-    [cachedAtoms setObject:atomValue forKey:atomName];
+    [self storeAtom:atom withName:atomName];
     
     free(reply);
     atomValue = nil;
@@ -67,17 +74,60 @@
     return atom;
 }
 
+- (void) storeAtom:(xcb_atom_t)anAtom withName:(NSString*)atomName
+{
+    [cachedAtoms setObject:[NSNumber numberWithUnsignedInt:anAtom] forKey:atomName];
+
+    if (anAtom != XCB_ATOM_NONE)
+        [atomNames setObject:atomName forWindow:anAtom];
+}
+
 - (void) cacheAtoms:(NSArray *)atoms
 {
     NSUInteger size = [atoms count];
-    
+
+    if (size == 0)
+        return;
+
+    xcb_connection_t *conn = [connection connection];
+    xcb_intern_atom_cookie_t *cookies = malloc(size * sizeof(xcb_intern_atom_cookie_t));
+    NSMutableArray *pending = [[NSMutableArray alloc] initWithCapacity:size];
+
+    if (cookies == NULL)
+        return;
+
+    /*** OPTIMIZATION: send every request before waiting on the first reply: one round-trip for the batch ***/
     for (NSUInteger i = 0; i < size; i++)
     {
         NSString *atomName = [atoms objectAtIndex:i];
-        [self cacheAtom:atomName];
-        atomName = nil;
+
+        if ([cachedAtoms objectForKey:atomName] != nil || [pending containsObject:atomName])
+            continue;
+
+        const char *str = [atomName UTF8String];
+        cookies[[pending count]] = xcb_intern_atom(conn, NO, strlen(str), str);
+        [pending addObject:atomName];
     }
-    
+
+    NSUInteger count = [pending count];
+
+    for (NSUInteger i = 0; i < count; i++)
+    {
+        NSString *atomName = [pending objectAtIndex:i];
+        xcb_intern_atom_reply_t *reply = xcb_intern_atom_reply(conn, cookies[i], NULL);
+
+        if (reply == NULL)
+        {
+            NSLog(@"[XCBAtomService] Failed to intern atom %@", atomName);
+            continue;
+        }
+
+        [self storeAtom:reply->atom withName:atomName];
+        free(reply);
+    }
+
+    free(cookies);
+    pending = nil;
 }
 
 - (xcb_atom_t) atomFromCachedAtomsWithKey:(NSString *)atomName
@@ -96,6 +146,12 @@
         return @"NONE";
     }
 
+    NSString *cachedName = [atomNames objectForWindow:anAtom];
+
+    if (cachedName != nil) {
+        return cachedName;
+    }
+
     xcb_get_atom_name_cookie_t cookie = xcb_get_atom_name([connection connection], anAtom);
     xcb_get_atom_name_reply_t *reply = xcb_get_atom_name_reply([connection connection], cookie, NULL);
 
@@ -120,13 +176,24 @@
     NSString *name = [NSString stringWithUTF8String:nameCopy];
     free(nameCopy);
     free(reply);
+
+    if (name != nil) {
+        [atomNames setObject:name forWindow:anAtom];
+    }
+
     return name;
 }
 
+- (NSString*) cachedNameFromAtom:(xcb_atom_t)anAtom
+{
+    return [atomNames objectForWindow:anAtom];
+}
+
 - (void) dealloc
 {
     connection = nil;
     cachedAtoms = nil;
+    atomNames = nil;
 }
 
 @end
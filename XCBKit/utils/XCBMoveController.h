@@ -0,0 +1,37 @@
+//
+//  XCBMoveController.h
+//  XCBKit
+//
+//  Interactive titlebar drag. Works only from the frame's cached windowRect
+//  and the client's cached size, so a motion event costs one ConfigureWindow
+//  and no GetGeometry. The client is told where it is (ICCCM 4.1.5 synthetic
+//  ConfigureNotify) at most once per notifyInterval while dragging, and always
+//  once on drop.
+//
+
+#import <Foundation/Foundation.h>
+#include <xcb/xcb.h>
+#import "../XCBWindow.h"
+
+@class XCBFrame;
+
+/*** Milliseconds between synthetic ConfigureNotify events during a drag ***/
+#define XCB_MOVE_NOTIFY_INTERVAL 50
+
+@interface XCBMoveController : NSObject
+
+@property (nonatomic, readonly) XCBFrame *frame;
+@property (nonatomic, assign) xcb_timestamp_t notifyInterval;
+
+/*** Caches the client size; nothing is sent ***/
+- (void) beginForFrame:(XCBFrame *)aFrame;
+
+/*** aPoint is in pointer coordinates, as for -[XCBFrame moveTo:] ***/
+- (void) moveTo:(XCBPoint)aPoint time:(xcb_timestamp_t)aTime;
+
+/*** Sends the final ConfigureNotify and forgets the frame ***/
+- (void) end;
+
+- (BOOL) isActive;
+
+@end
@@ -0,0 +1,91 @@
+//
+//  XCBMoveController.m
+//  XCBKit
+//
+
+#import "XCBMoveController.h"
+#import "../XCBFrame.h"
+#import "../services/TitleBarSettingsService.h"
+
+@implementation XCBMoveController
+{
+    XCBSize clientSize;
+    xcb_timestamp_t lastNotifyTime;
+}
+
+@synthesize frame;
+@synthesize notifyInterval;
+
+- (id) init
+{
+    self = [super init];
+
+    if (self == nil)
+    {
+        NSLog(@"Unable to init");
+        return nil;
+    }
+
+    notifyInterval = XCB_MOVE_NOTIFY_INTERVAL;
+
+    return self;
+}
+
+- (void) beginForFrame:(XCBFrame *)aFrame
+{
+    frame = aFrame;
+    lastNotifyTime = 0;
+
+    /*** The client's rect is kept current by every resize path; derive it from
+         the frame only if the client was never configured through us ***/
+    XCBWindow *clientWindow = [aFrame childWindowForKey:ClientWindow];
+    XCBRect frameRect = [aFrame windowRect];
+    clientSize = [clientWindow windowRect].size;
+
+    if (clientSize.width == 0 || clientSize.height == 0)
+    {
+        TitleBarSettingsService *settings = [TitleBarSettingsService sharedInstance];
+        uint16_t titleHeight = [settings heightDefined] ? [settings height] : [settings defaultHeight];
+        clientSize.width = frameRect.size.width;
+        clientSize.height = frameRect.size.height > titleHeight ? frameRect.size.height - titleHeight : 1;
+    }
+
+    clientWindow = nil;
+}
+
+- (void) sendConfigureNotify
+{
+    [frame configureClientWithFramePosition:[frame windowRect].position clientSize:clientSize];
+}
+
+- (void) moveTo:(XCBPoint)aPoint time:(xcb_timestamp_t)aTime
+{
+    if (frame == nil)
+        return;
+
+    [frame moveTo:aPoint];
+
+    /*** Server timestamps wrap; unsigned subtraction still gives the elapsed time ***/
+    if (lastNotifyTime == 0 || (xcb_timestamp_t)(aTime - lastNotifyTime) >= notifyInterval)
+    {
+        [self sendConfigureNotify];
+        lastNotifyTime = aTime;
+    }
+}
+
+- (void) end
+{
+    if (frame == nil)
+        return;
+
+    /*** Always on drop: the client may have missed the last positions ***/
+    [self sendConfigureNotify];
+    frame = nil;
+}
+
+- (BOOL) isActive
+{
+    return frame != nil;
+}
+
+@end
@@ -0,0 +1,50 @@
+//
+//  XCBResizeSync.h
+//  XCBKit
+//
+//  _NET_WM_SYNC_REQUEST pacing for interactive resize. When the client
+//  lists _NET_WM_SYNC_REQUEST in WM_PROTOCOLS and publishes a
+//  _NET_WM_SYNC_REQUEST_COUNTER, every configure that changes the client size
+//  is preceded by a sync request carrying the next counter value, and further
+//  configures are held until an XSync alarm reports that the client has set
+//  its counter to that value (it has redrawn at the new size). A client that
+//  does not answer within timeout is resized unpaced for the rest of the drag.
+//
+
+#import <Foundation/Foundation.h>
+#include <xcb/xcb.h>
+#import "../XCBWindow.h"
+
+@class XCBConnection;
+@class XCBFrame;
+
+/*** Seconds to wait for the client's counter before resizing without it ***/
+#define XCB_RESIZE_SYNC_TIMEOUT 0.1
+
+@interface XCBResizeSync : NSObject
+
+@property (nonatomic, readonly) XCBFrame *frame;
+@property (nonatomic, assign) NSTimeInterval timeout;
+
+- (id) initWithConnection:(XCBConnection *)aConnection;
+
+/*** Reads the client's counter and arms an alarm on it; a few round-trips, once per resize ***/
+- (void) beginForFrame:(XCBFrame *)aFrame;
+
+/*** Sends the sync request for the configures about to give the client aSize; no-op for
+     unsynced clients and for a size the client was already asked to draw ***/
+- (void) requestForClientSize:(XCBSize)aSize time:(xcb_timestamp_t)aTime;
+
+/*** YES while the client has not caught up with the last request and the timeout has not expired ***/
+- (BOOL) isWaiting;
+
+/*** Seconds until the outstanding request times out; 0 when not waiting ***/
+- (NSTimeInterval) timeRemaining;
+
+/*** YES for an AlarmNotify of our alarm; the client may have caught up ***/
+- (BOOL) handleEvent:(xcb_generic_event_t *)anEvent;
+
+/*** Destroys the alarm and forgets the frame ***/
+- (void) end;
+
+@end
@@ -0,0 +1,252 @@
+//
+//  XCBResizeSync.m
+//  XCBKit
+//
+
+#import "XCBResizeSync.h"
+#import "../XCBConnection.h"
+#import "../XCBFrame.h"
+#import "../services/EWMHService.h"
+#import "../services/ICCCMService.h"
+#import "../services/XCBAtomService.h"
+#include <xcb/sync.h>
+#include <time.h>
+
+static NSTimeInterval XCBResizeSyncNow(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int64_t XCBResizeSyncValue(xcb_sync_int64_t aValue)
+{
+    return (int64_t) (((uint64_t) (uint32_t) aValue.hi << 32) | aValue.lo);
+}
+
+static xcb_sync_int64_t XCBResizeSyncMakeValue(int64_t aValue)
+{
+    xcb_sync_int64_t value;
+    value.hi = (int32_t) (aValue >> 32);
+    value.lo = (uint32_t) (aValue & 0xffffffff);
+    return value;
+}
+
+@implementation XCBResizeSync
+{
+    __weak XCBConnection *connection;
+    BOOL extensionChecked;
+    BOOL extensionAvailable;
+    uint8_t alarmNotifyEvent;
+    xcb_sync_counter_t counter;
+    xcb_sync_alarm_t alarm;
+    int64_t requestedValue;
+    XCBSize requestedSize;
+    BOOL synced;
+    BOOL waiting;
+    NSTimeInterval requestTime;
+}
+
+@synthesize frame;
+@synthesize timeout;
+
+- (id) initWithConnection:(XCBConnection *)aConnection
+{
+    self = [super init];
+
+    if (self == nil)
+    {
+        NSLog(@"Unable to init");
+        return nil;
+    }
+
+    connection = aConnection;
+    timeout = XCB_RESIZE_SYNC_TIMEOUT;
+    alarm = XCB_NONE;
+
+    return self;
+}
+
+- (BOOL) checkExtension
+{
+    if (extensionChecked)
+        return extensionAvailable;
+
+    extensionChecked = YES;
+    xcb_connection_t *conn = [connection connection];
+    const xcb_query_extension_reply_t *extension = xcb_get_extension_data(conn, &xcb_sync_id);
+
+    if (!extension || !extension->present)
+    {
+        NSLog(@"[ResizeSync] SYNC extension not available; resizes are not paced");
+        return NO;
+    }
+
+    xcb_sync_initialize_reply_t *reply =
+        xcb_sync_initialize_reply(conn, xcb_sync_initialize(conn, XCB_SYNC_MAJOR_VERSION, XCB_SYNC_MINOR_VERSION), NULL);
+
+    if (!reply)
+    {
+        NSLog(@"[ResizeSync] SYNC initialization failed; resizes are not paced");
+        return NO;
+    }
+
+    free(reply);
+    alarmNotifyEvent = extension->first_event + XCB_SYNC_ALARM_NOTIFY;
+    extensionAvailable = YES;
+    return YES;
+}
+
+- (void) beginForFrame:(XCBFrame *)aFrame
+{
+    [self end];
+
+    frame = aFrame;
+
+    if (![self checkExtension])
+        return;
+
+    XCBWindow *clientWindow = [aFrame childWindowForKey:ClientWindow];
+    EWMHService *ewmhService = [EWMHService sharedInstanceWithConnection:connection];
+    ICCCMService *icccmService = [ICCCMService sharedInstanceWithConnection:connection];
+    xcb_connection_t *conn = [connection connection];
+
+    if (!clientWindow ||
+        ![icccmService hasProtocol:[ewmhService EWMHWMSyncRequest] forWindow:clientWindow] ||
+        ![ewmhService readSyncRequestCounterForWindow:clientWindow counter:&counter])
+    {
+        return;
+    }
+
+    /*** Requests must move the counter forward from wherever the client left it ***/
+    xcb_sync_query_counter_reply_t *reply =
+        xcb_sync_query_counter_reply(conn, xcb_sync_query_counter(conn, counter), NULL);
+
+    if (!reply)
+    {
+        NSLog(@"[ResizeSync] Counter 0x%x of window %u is gone; resize not paced", counter, [clientWindow window]);
+        return;
+    }
+
+    requestedValue = XCBResizeSyncValue(reply->counter_value);
+    requestedSize = [clientWindow windowRect].size;
+    free(reply);
+
+    /*** Armed by the first request; fires once the counter reaches the requested value ***/
+    xcb_sync_create_alarm_value_list_t values;
+    memset(&values, 0, sizeof(values));
+    values.counter = counter;
+    values.valueType = XCB_SYNC_VALUETYPE_ABSOLUTE;
+    values.value = XCBResizeSyncMakeValue(requestedValue + 1);
+    values.testType = XCB_SYNC_TESTTYPE_POSITIVE_COMPARISON;
+    values.delta = XCBResizeSyncMakeValue(0);
+    values.events = 1;
+
+    alarm = xcb_generate_id(conn);
+    xcb_sync_create_alarm_aux(conn, alarm,
+                              XCB_SYNC_CA_COUNTER | XCB_SYNC_CA_VALUE_TYPE | XCB_SYNC_CA_VALUE |
+                              XCB_SYNC_CA_TEST_TYPE | XCB_SYNC_CA_DELTA | XCB_SYNC_CA_EVENTS,
+                              &values);
+
+    synced = YES;
+    waiting = NO;
+}
+
+- (void) requestForClientSize:(XCBSize)aSize time:(xcb_timestamp_t)aTime
+{
+    if (!synced || waiting)
+        return;
+
+    /*** A configure that keeps the size gives the client nothing to redraw ***/
+    if (aSize.width == requestedSize.width && aSize.height == requestedSize.height)
+        return;
+
+    xcb_connection_t *conn = [connection connection];
+    XCBWindow *clientWindow = [frame childWindowForKey:ClientWindow];
+    XCBAtomService *atomService = [XCBAtomService sharedInstanceWithConnection:connection];
+    EWMHService *ewmhService = [EWMHService sharedInstanceWithConnection:connection];
+    ICCCMService *icccmService = [ICCCMService sharedInstanceWithConnection:connection];
+
+    requestedValue++;
+
+    xcb_sync_change_alarm_value_list_t values;
+    memset(&values, 0, sizeof(values));
+    values.value = XCBResizeSyncMakeValue(requestedValue);
+    xcb_sync_change_alarm_aux(conn, alarm, XCB_SYNC_CA_VALUE, &values);
+
+    xcb_client_message_event_t event;
+    memset(&event, 0, sizeof(event));
+    event.response_type = XCB_CLIENT_MESSAGE;
+    event.format = 32;
+    event.window = [clientWindow window];
+    event.type = [atomService atomFromCachedAtomsWithKey:[icccmService WMProtocols]];
+    event.data.data32[0] = [atomService atomFromCachedAtomsWithKey:[ewmhService EWMHWMSyncRequest]];
+    event.data.data32[1] = aTime;
+    event.data.data32[2] = (uint32_t) (requestedValue & 0xffffffff);
+    event.data.data32[3] = (uint32_t) ((uint64_t) requestedValue >> 32);
+
+    xcb_send_event(conn, 0, [clientWindow window], XCB_EVENT_MASK_NO_EVENT, (const char *) &event);
+
+    requestedSize = aSize;
+    waiting = YES;
+    requestTime = XCBResizeSyncNow();
+}
+
+- (BOOL) isWaiting
+{
+    if (!waiting)
+        return NO;
+
+    if (XCBResizeSyncNow() - requestTime >= timeout)
+    {
+        /*** Unresponsive or broken client: fall back to unpaced resizing for this drag ***/
+        NSLog(@"[ResizeSync] Client of frame %u did not update its counter within %.0f ms; resize not paced",
+              [frame window], timeout * 1000.0);
+        waiting = NO;
+        synced = NO;
+    }
+
+    return waiting;
+}
+
+- (NSTimeInterval) timeRemaining
+{
+    if (!waiting)
+        return 0;
+
+    NSTimeInterval remaining = timeout - (XCBResizeSyncNow() - requestTime);
+    return remaining > 0 ? remaining : 0;
+}
+
+- (BOOL) handleEvent:(xcb_generic_event_t *)anEvent
+{
+    if (!extensionAvailable || (anEvent->response_type & ~0x80) != alarmNotifyEvent)
+        return NO;
+
+    xcb_sync_alarm_notify_event_t *notify = (xcb_sync_alarm_notify_event_t *) anEvent;
+
+    /*** Alarms of an earlier resize may still be in flight ***/
+    if (alarm == XCB_NONE || notify->alarm != alarm)
+        return YES;
+
+    if (XCBResizeSyncValue(notify->counter_value) >= requestedValue)
+        waiting = NO;
+
+    return YES;
+}
+
+- (void) end
+{
+    if (alarm != XCB_NONE)
+    {
+        xcb_sync_destroy_alarm([connection connection], alarm);
+        alarm = XCB_NONE;
+    }
+
+    frame = nil;
+    counter = XCB_NONE;
+    synced = NO;
+    waiting = NO;
+}
+
+@end
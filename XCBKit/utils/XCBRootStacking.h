@@ -0,0 +1,33 @@
+//
+//  XCBRootStacking.h
+//  XCBKit
+//
+//  Server stacking order of the root's children, bottom to top, kept from
+//  SubstructureNotify events on the root. It covers every top-level window,
+//  managed or not, so a restack above a panel or an override-redirect popup
+//  can still be placed among the managed clients. Empty and invalid until
+//  reset from a QueryTree reply; events are ignored until then.
+//
+
+#import <Foundation/Foundation.h>
+#include <xcb/xcb.h>
+
+@interface XCBRootStacking : NSObject
+
+@property (nonatomic, readonly) BOOL isValid;
+
+- (void) resetWithChildren:(const xcb_window_t *)children count:(NSUInteger)count;
+- (void) invalidate;
+
+- (NSUInteger) count;
+- (xcb_window_t) windowAtIndex:(NSUInteger)index;
+/*** NSNotFound for a window that is not a known child of the root ***/
+- (NSUInteger) indexOfWindow:(xcb_window_t)aWindow;
+
+/*** Event updates: new and reparented children go on top, aSibling XCB_NONE means bottom ***/
+- (void) addWindowOnTop:(xcb_window_t)aWindow;
+- (void) removeWindow:(xcb_window_t)aWindow;
+- (void) restackWindow:(xcb_window_t)aWindow aboveSibling:(xcb_window_t)aSibling;
+- (void) circulateWindow:(xcb_window_t)aWindow toTop:(BOOL)toTop;
+
+@end
@@ -0,0 +1,158 @@
+//
+//  XCBRootStacking.m
+//  XCBKit
+//
+
+#import "XCBRootStacking.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define XCB_ROOT_STACKING_MIN_CAPACITY 64
+
+@implementation XCBRootStacking
+{
+    xcb_window_t *windows;
+    NSUInteger windowsCount;
+    NSUInteger capacity;
+}
+
+@synthesize isValid;
+
+- (BOOL) reserve:(NSUInteger)aCount
+{
+    if (aCount <= capacity)
+        return YES;
+
+    NSUInteger newCapacity = capacity ? capacity : XCB_ROOT_STACKING_MIN_CAPACITY;
+
+    while (newCapacity < aCount)
+        newCapacity *= 2;
+
+    xcb_window_t *grown = realloc(windows, newCapacity * sizeof(xcb_window_t));
+
+    if (grown == NULL)
+    {
+        NSLog(@"[RootStacking] Unable to grow to %lu windows", (unsigned long) newCapacity);
+        return NO;
+    }
+
+    windows = grown;
+    capacity = newCapacity;
+    return YES;
+}
+
+- (void) resetWithChildren:(const xcb_window_t *)children count:(NSUInteger)count
+{
+    windowsCount = 0;
+    isValid = NO;
+
+    if (![self reserve:count])
+        return;
+
+    memcpy(windows, children, count * sizeof(xcb_window_t));
+    windowsCount = count;
+    isValid = YES;
+}
+
+- (void) invalidate
+{
+    windowsCount = 0;
+    isValid = NO;
+}
+
+- (NSUInteger) count
+{
+    return windowsCount;
+}
+
+- (xcb_window_t) windowAtIndex:(NSUInteger)index
+{
+    return index < windowsCount ? windows[index] : XCB_NONE;
+}
+
+- (NSUInteger) indexOfWindow:(xcb_window_t)aWindow
+{
+    for (NSUInteger i = 0; i < windowsCount; i++)
+    {
+        if (windows[i] == aWindow)
+            return i;
+    }
+
+    return NSNotFound;
+}
+
+- (void) insertWindow:(xcb_window_t)aWindow atIndex:(NSUInteger)index
+{
+    if (![self reserve:windowsCount + 1])
+    {
+        /*** a partial order would misplace clients; wait for the next resync instead ***/
+        [self invalidate];
+        return;
+    }
+
+    memmove(&windows[index + 1], &windows[index], (windowsCount - index) * sizeof(xcb_window_t));
+    windows[index] = aWindow;
+    windowsCount++;
+}
+
+- (void) removeWindow:(xcb_window_t)aWindow
+{
+    NSUInteger index = [self indexOfWindow:aWindow];
+
+    if (index == NSNotFound)
+        return;
+
+    memmove(&windows[index], &windows[index + 1], (windowsCount - index - 1) * sizeof(xcb_window_t));
+    windowsCount--;
+}
+
+- (void) addWindowOnTop:(xcb_window_t)aWindow
+{
+    if (!isValid)
+        return;
+
+    [self removeWindow:aWindow];
+    [self insertWindow:aWindow atIndex:windowsCount];
+}
+
+- (void) restackWindow:(xcb_window_t)aWindow aboveSibling:(xcb_window_t)aSibling
+{
+    if (!isValid)
+        return;
+
+    [self removeWindow:aWindow];
+
+    if (aSibling == XCB_NONE)
+    {
+        [self insertWindow:aWindow atIndex:0];
+        return;
+    }
+
+    NSUInteger sibling = [self indexOfWindow:aSibling];
+
+    /*** a sibling we never heard of means events were missed ***/
+    if (sibling == NSNotFound)
+    {
+        [self invalidate];
+        return;
+    }
+
+    [self insertWindow:aWindow atIndex:sibling + 1];
+}
+
+- (void) circulateWindow:(xcb_window_t)aWindow toTop:(BOOL)toTop
+{
+    if (!isValid)
+        return;
+
+    [self removeWindow:aWindow];
+    [self insertWindow:aWindow atIndex:toTop ? windowsCount : 0];
+}
+
+- (void) dealloc
+{
+    free(windows);
+    windows = NULL;
+}
+
+@end
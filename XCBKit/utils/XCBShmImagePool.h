@@ -0,0 +1,44 @@
+//
+//  XCBShmImagePool.h
+//  XCBKit
+//
+//  ZPixmap image uploads through MIT-SHM. A few shared segments are attached
+//  once and handed out with a bump allocator; a segment is reused from the
+//  start when the server has sent ShmCompletion for every image placed in it.
+//  A ShmPutImage that fails (drawable destroyed meanwhile) sends no
+//  ShmCompletion; its error releases the space instead.
+//  Without SHM (remote display, extension missing, attach refused) uploads
+//  fall back to xcb_put_image, split to the maximum request length.
+//
+
+#import <Foundation/Foundation.h>
+#include <xcb/xcb.h>
+
+@class XCBConnection;
+
+@interface XCBShmImagePool : NSObject
+
+@property (nonatomic, readonly) BOOL shmAvailable;
+@property (nonatomic, readonly) NSUInteger shmUploads;
+@property (nonatomic, readonly) NSUInteger fallbackUploads;
+
+- (id) initWithConnection:(XCBConnection *)aConnection;
+
+/*** data holds height rows of stride bytes; depth 8 is one byte per pixel, depth 24/32 four ***/
+- (void) putImage:(const uint8_t *)data
+            width:(uint16_t)width
+           height:(uint16_t)height
+           stride:(uint32_t)stride
+            depth:(uint8_t)depth
+       toDrawable:(xcb_drawable_t)aDrawable
+               gc:(xcb_gcontext_t)aGc
+                x:(int16_t)x
+                y:(int16_t)y;
+
+/*** YES when native-endian Cairo ARGB32 pixels can be uploaded unchanged to this depth/visual ***/
+- (BOOL) acceptsARGB32ForDepth:(uint8_t)depth visual:(xcb_visualtype_t *)aVisual;
+
+/*** Consumes ShmCompletion events and ShmPutImage errors; returns NO for any other event ***/
+- (BOOL) handleCompletionEvent:(xcb_generic_event_t *)anEvent;
+
+@end
@@ -0,0 +1,314 @@
+//
+//  XCBShmImagePool.m
+//  XCBKit
+//
+
+#import "XCBShmImagePool.h"
+#import "../XCBConnection.h"
+#include <xcb/shm.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define XCB_SHM_POOL_SEGMENT_SIZE (4 * 1024 * 1024)
+#define XCB_SHM_POOL_MAX_SEGMENTS 4
+#define XCB_SHM_POOL_ALIGN 64
+#define XCB_SHM_POOL_MAX_UPLOADS 256
+
+typedef struct _XCBShmSegment
+{
+    xcb_shm_seg_t seg;
+    uint8_t *address;
+    size_t size;
+    size_t used;            /*** bump pointer ***/
+    unsigned int pending;   /*** uploads not yet completed ***/
+} XCBShmSegment;
+
+/*** One in-flight xcb_shm_put_image, in request order ***/
+typedef struct _XCBShmUpload
+{
+    unsigned int sequence;
+    int segmentIndex;
+} XCBShmUpload;
+
+@implementation XCBShmImagePool
+{
+    xcb_connection_t *connection;
+    uint8_t completionEvent;
+    uint8_t majorOpcode;
+    XCBShmSegment segments[XCB_SHM_POOL_MAX_SEGMENTS];
+    int segmentsCount;
+    XCBShmUpload uploads[XCB_SHM_POOL_MAX_UPLOADS];
+    int uploadsHead;
+    int uploadsCount;
+}
+
+@synthesize shmAvailable;
+@synthesize shmUploads;
+@synthesize fallbackUploads;
+
+- (id) initWithConnection:(XCBConnection *)aConnection
+{
+    self = [super init];
+
+    if (self == nil)
+    {
+        NSLog(@"Unable to init");
+        return nil;
+    }
+
+    connection = [aConnection connection];
+    segmentsCount = 0;
+    uploadsHead = 0;
+    uploadsCount = 0;
+    shmAvailable = NO;
+
+    const xcb_query_extension_reply_t *extension = xcb_get_extension_data(connection, &xcb_shm_id);
+
+    if (extension == NULL || !extension->present)
+    {
+        NSLog(@"[ShmImagePool] MIT-SHM not available, using xcb_put_image");
+        return self;
+    }
+
+    xcb_shm_query_version_reply_t *version = xcb_shm_query_version_reply(connection,
+                                                                         xcb_shm_query_version(connection),
+                                                                         NULL);
+
+    if (version == NULL)
+        return self;
+
+    free(version);
+    completionEvent = extension->first_event + XCB_SHM_COMPLETION;
+    majorOpcode = extension->major_opcode;
+    shmAvailable = YES;
+
+    return self;
+}
+
+/*** Create and attach one segment; a refused attach (e.g. remote server) disables SHM ***/
+- (XCBShmSegment *) createSegmentWithSize:(size_t)aSize
+{
+    if (segmentsCount >= XCB_SHM_POOL_MAX_SEGMENTS)
+        return NULL;
+
+    int shmid = shmget(IPC_PRIVATE, aSize, IPC_CREAT | 0600);
+
+    if (shmid < 0)
+        return NULL;
+
+    void *address = shmat(shmid, NULL, 0);
+
+    if (address == (void *) -1)
+    {
+        shmctl(shmid, IPC_RMID, NULL);
+        return NULL;
+    }
+
+    xcb_shm_seg_t seg = xcb_generate_id(connection);
+    xcb_generic_error_t *error = xcb_request_check(connection,
+                                                   xcb_shm_attach_checked(connection, seg, shmid, 1));
+
+    /*** the segment goes away with the last detach, whether or not the attach worked ***/
+    shmctl(shmid, IPC_RMID, NULL);
+
+    if (error != NULL)
+    {
+        NSLog(@"[ShmImagePool] Server refused MIT-SHM attach (error %d), using xcb_put_image", error->error_code);
+        free(error);
+        shmdt(address);
+        shmAvailable = NO;
+        return NULL;
+    }
+
+    XCBShmSegment *segment = &segments[segmentsCount++];
+    segment->seg = seg;
+    segment->address = address;
+    segment->size = aSize;
+    segment->used = 0;
+    segment->pending = 0;
+
+    return segment;
+}
+
+/*** Bump-allocate aSize bytes; never blocks, returns NULL when every segment is busy ***/
+- (XCBShmSegment *) segmentForSize:(size_t)aSize offset:(size_t *)anOffset
+{
+    for (int i = 0; i < segmentsCount; i++)
+    {
+        XCBShmSegment *segment = &segments[i];
+
+        if (segment->pending == 0)
+            segment->used = 0;
+
+        if (segment->size - segment->used >= aSize)
+        {
+            *anOffset = segment->used;
+            segment->used = (segment->used + aSize + XCB_SHM_POOL_ALIGN - 1) & ~(size_t)(XCB_SHM_POOL_ALIGN - 1);
+            return segment;
+        }
+    }
+
+    size_t size = aSize > XCB_SHM_POOL_SEGMENT_SIZE ? aSize : XCB_SHM_POOL_SEGMENT_SIZE;
+    XCBShmSegment *segment = [self createSegmentWithSize:size];
+
+    if (segment == NULL)
+        return NULL;
+
+    *anOffset = 0;
+    segment->used = (aSize + XCB_SHM_POOL_ALIGN - 1) & ~(size_t)(XCB_SHM_POOL_ALIGN - 1);
+
+    return segment;
+}
+
+- (void) putImage:(const uint8_t *)data
+            width:(uint16_t)width
+           height:(uint16_t)height
+           stride:(uint32_t)stride
+            depth:(uint8_t)depth
+       toDrawable:(xcb_drawable_t)aDrawable
+               gc:(xcb_gcontext_t)aGc
+                x:(int16_t)x
+                y:(int16_t)y
+{
+    if (width == 0 || height == 0)
+        return;
+
+    uint32_t bytesPerPixel = depth > 8 ? 4 : 1;
+    size_t size = (size_t) stride * height;
+    size_t offset = 0;
+    BOOL canQueue = uploadsCount < XCB_SHM_POOL_MAX_UPLOADS;
+    XCBShmSegment *segment = shmAvailable && canQueue ? [self segmentForSize:size offset:&offset] : NULL;
+
+    if (segment != NULL)
+    {
+        memcpy(segment->address + offset, data, size);
+        segment->pending++;
+        shmUploads++;
+
+        /*** send_event asks for the ShmCompletion that frees the space again ***/
+        xcb_void_cookie_t cookie = xcb_shm_put_image(connection, aDrawable, aGc,
+                                                     stride / bytesPerPixel, height,
+                                                     0, 0, width, height,
+                                                     x, y, depth, XCB_IMAGE_FORMAT_Z_PIXMAP,
+                                                     1, segment->seg, (uint32_t) offset);
+
+        XCBShmUpload *upload = &uploads[(uploadsHead + uploadsCount) % XCB_SHM_POOL_MAX_UPLOADS];
+        upload->sequence = cookie.sequence;
+        upload->segmentIndex = (int) (segment - segments);
+        uploadsCount++;
+        return;
+    }
+
+    fallbackUploads++;
+
+    /*** PutImage rows must be padded to exactly 32 bits ***/
+    uint32_t padded = (width * bytesPerPixel + 3) & ~3u;
+    uint8_t *packed = NULL;
+
+    if (stride != padded)
+    {
+        packed = malloc((size_t) padded * height);
+
+        if (packed == NULL)
+            return;
+
+        for (uint16_t row = 0; row < height; row++)
+            memcpy(packed + (size_t) row * padded, data + (size_t) row * stride, width * bytesPerPixel);
+
+        data = packed;
+    }
+
+    /*** split into bands that fit the maximum request length (in 4-byte units, minus the header) ***/
+    size_t maxBytes = (size_t) xcb_get_maximum_request_length(connection) * 4 - sizeof(xcb_put_image_request_t);
+    uint16_t rowsPerRequest = maxBytes / padded > 0 ? (uint16_t) MIN(maxBytes / padded, height) : 1;
+
+    for (uint16_t row = 0; row < height; row += rowsPerRequest)
+    {
+        uint16_t rows = MIN(rowsPerRequest, height - row);
+        xcb_put_image(connection, XCB_IMAGE_FORMAT_Z_PIXMAP, aDrawable, aGc,
+                      width, rows, x, y + row, 0, depth,
+                      (uint32_t) padded * rows, data + (size_t) row * padded);
+    }
+
+    free(packed);
+}
+
+- (BOOL) acceptsARGB32ForDepth:(uint8_t)depth visual:(xcb_visualtype_t *)aVisual
+{
+    if ((depth != 24 && depth != 32) || aVisual == NULL)
+        return NO;
+
+    if (aVisual->_class != XCB_VISUAL_CLASS_TRUE_COLOR ||
+        aVisual->red_mask != 0xff0000 || aVisual->green_mask != 0xff00 || aVisual->blue_mask != 0xff)
+        return NO;
+
+    /*** Cairo stores ARGB32 as native 32-bit words; the server must read the same byte order ***/
+    uint32_t probe = 1;
+    BOOL littleEndian = *(uint8_t *) &probe == 1;
+    uint8_t order = xcb_get_setup(connection)->image_byte_order;
+
+    return littleEndian ? order == XCB_IMAGE_ORDER_LSB_FIRST : order == XCB_IMAGE_ORDER_MSB_FIRST;
+}
+
+/*** The server answers uploads in request order, so every upload up to aSequence is
+     finished: completed, or failed with an error (e.g. BadDrawable after the window was
+     destroyed) that never produces a ShmCompletion ***/
+- (void) releaseUploadsThroughSequence:(unsigned int)aSequence
+{
+    while (uploadsCount > 0)
+    {
+        XCBShmUpload *upload = &uploads[uploadsHead];
+
+        /*** sequence numbers wrap; the signed difference keeps the order ***/
+        if ((int) (upload->sequence - aSequence) > 0)
+            break;
+
+        if (segments[upload->segmentIndex].pending > 0)
+            segments[upload->segmentIndex].pending--;
+
+        uploadsHead = (uploadsHead + 1) % XCB_SHM_POOL_MAX_UPLOADS;
+        uploadsCount--;
+    }
+}
+
+- (BOOL) handleCompletionEvent:(xcb_generic_event_t *)anEvent
+{
+    if (!shmAvailable && segmentsCount == 0)
+        return NO;
+
+    if (anEvent->response_type == 0)
+    {
+        xcb_generic_error_t *error = (xcb_generic_error_t *) anEvent;
+
+        if (error->major_code != majorOpcode || error->minor_code != XCB_SHM_PUT_IMAGE)
+            return NO;
+
+        NSLog(@"[ShmImagePool] MIT-SHM upload failed (error %d, resource 0x%x); reclaiming its space",
+              error->error_code, error->resource_id);
+        [self releaseUploadsThroughSequence:error->full_sequence];
+        return YES;
+    }
+
+    if ((anEvent->response_type & ~0x80) != completionEvent)
+        return NO;
+
+    [self releaseUploadsThroughSequence:anEvent->full_sequence];
+
+    return YES;
+}
+
+- (void) dealloc
+{
+    for (int i = 0; i < segmentsCount; i++)
+    {
+        xcb_shm_detach(connection, segments[i].seg);
+        shmdt(segments[i].address);
+    }
+
+    segmentsCount = 0;
+    uploadsCount = 0;
+}
+
+@end
@@ -0,0 +1,55 @@
+//
+//  XCBWindowSnapshot.h
+//  XCBKit
+//
+//  Attributes, geometry and a fixed set of properties of one window, fetched
+//  with every request sent before the first reply is read. Snapshots for many
+//  windows are filled by one batch, so adopting N windows costs one round-trip
+//  instead of several per window. Property replies are requested with
+//  AnyPropertyType and kept whole; a property that was fetched but is not set
+//  on the window is remembered as absent.
+//
+//  A managed client keeps its snapshot until it is unregistered, so the
+//  theme, switcher and compositor read the same replies. A property drops
+//  out of the snapshot as soon as it changes.
+//
+
+#import <Foundation/Foundation.h>
+#include <xcb/xcb.h>
+
+@class XCBConnection;
+
+@interface XCBWindowSnapshot : NSObject
+
+@property (nonatomic, readonly) xcb_window_t window;
+
+/*** Sends GetWindowAttributes, GetGeometry and a GetProperty per atom for every window, then collects ***/
++ (NSArray *) snapshotsForWindows:(const xcb_window_t *)windows
+                            count:(NSUInteger)count
+                            atoms:(const xcb_atom_t *)atoms
+                       atomsCount:(NSUInteger)atomsCount
+                     onConnection:(XCBConnection *)aConnection;
+
+/*** Owned by the snapshot; NULL when the request failed (window already destroyed) ***/
+- (xcb_get_window_attributes_reply_t *) attributes;
+- (xcb_get_geometry_reply_t *) geometry;
+
+/*** Called once the window manager reparents or reconfigures the window; properties stay valid ***/
+- (void) discardGeometryAndAttributes;
+- (void) discardGeometry;
+
+/*** Forget one property (PropertyNotify, or a write by the window manager); later reads go to the server ***/
+- (void) invalidateAtom:(xcb_atom_t)anAtom;
+
+/*** YES when anAtom was part of the batch, whether or not the window has the property ***/
+- (BOOL) containsAtom:(xcb_atom_t)anAtom;
+
+/*** Owned by the snapshot; NULL when the property is not set or was not fetched ***/
+- (xcb_get_property_reply_t *) propertyForAtom:(xcb_atom_t)anAtom;
+
+/*** malloc'd copies for callers that free what they get, like a fresh reply ***/
+- (xcb_get_window_attributes_reply_t *) copyAttributes;
+- (xcb_get_geometry_reply_t *) copyGeometry;
+- (xcb_get_property_reply_t *) copyPropertyForAtom:(xcb_atom_t)anAtom;
+
+@end
@@ -0,0 +1,218 @@
+//
+//  XCBWindowSnapshot.m
+//  XCBKit
+//
+
+#import "XCBWindowSnapshot.h"
+#import "../XCBConnection.h"
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct _XCBSnapshotProperty
+{
+    xcb_atom_t atom;
+    xcb_get_property_reply_t *reply; /*** NULL when the property is not set ***/
+} XCBSnapshotProperty;
+
+@implementation XCBWindowSnapshot
+{
+    xcb_get_window_attributes_reply_t *attributes;
+    xcb_get_geometry_reply_t *geometry;
+    XCBSnapshotProperty *properties;
+    NSUInteger propertiesCount;
+}
+
+@synthesize window;
+
+- (id) initWithWindow:(xcb_window_t)aWindow atomsCount:(NSUInteger)atomsCount
+{
+    self = [super init];
+
+    if (self == nil)
+    {
+        NSLog(@"Unable to init");
+        return nil;
+    }
+
+    window = aWindow;
+    properties = atomsCount > 0 ? calloc(atomsCount, sizeof(XCBSnapshotProperty)) : NULL;
+    propertiesCount = 0;
+
+    return self;
+}
+
++ (NSArray *) snapshotsForWindows:(const xcb_window_t *)windows
+                            count:(NSUInteger)count
+                            atoms:(const xcb_atom_t *)atoms
+                       atomsCount:(NSUInteger)atomsCount
+                     onConnection:(XCBConnection *)aConnection
+{
+    xcb_connection_t *conn = [aConnection connection];
+    NSMutableArray *snapshots = [NSMutableArray arrayWithCapacity:count];
+
+    if (count == 0)
+        return snapshots;
+
+    xcb_get_window_attributes_cookie_t *attributeCookies = malloc(count * sizeof(xcb_get_window_attributes_cookie_t));
+    xcb_get_geometry_cookie_t *geometryCookies = malloc(count * sizeof(xcb_get_geometry_cookie_t));
+    xcb_get_property_cookie_t *propertyCookies = malloc((count * atomsCount + 1) * sizeof(xcb_get_property_cookie_t));
+
+    if (attributeCookies == NULL || geometryCookies == NULL || propertyCookies == NULL)
+    {
+        free(attributeCookies);
+        free(geometryCookies);
+        free(propertyCookies);
+        return snapshots;
+    }
+
+    /*** OPTIMIZATION: queue the whole batch before reading any reply ***/
+    for (NSUInteger i = 0; i < count; i++)
+    {
+        attributeCookies[i] = xcb_get_window_attributes(conn, windows[i]);
+        geometryCookies[i] = xcb_get_geometry(conn, windows[i]);
+
+        for (NSUInteger j = 0; j < atomsCount; j++)
+            propertyCookies[i * atomsCount + j] = xcb_get_property(conn, 0, windows[i], atoms[j],
+                                                                   XCB_GET_PROPERTY_TYPE_ANY, 0, UINT32_MAX);
+    }
+
+    for (NSUInteger i = 0; i < count; i++)
+    {
+        XCBWindowSnapshot *snapshot = [[XCBWindowSnapshot alloc] initWithWindow:windows[i] atomsCount:atomsCount];
+        xcb_generic_error_t *error = NULL;
+
+        snapshot->attributes = xcb_get_window_attributes_reply(conn, attributeCookies[i], &error);
+        free(error);
+        error = NULL;
+
+        snapshot->geometry = xcb_get_geometry_reply(conn, geometryCookies[i], &error);
+        free(error);
+        error = NULL;
+
+        for (NSUInteger j = 0; j < atomsCount; j++)
+        {
+            xcb_get_property_reply_t *reply = xcb_get_property_reply(conn, propertyCookies[i * atomsCount + j], &error);
+            free(error);
+            error = NULL;
+
+            /*** an unset property comes back as type None ***/
+            if (reply != NULL && reply->type == XCB_ATOM_NONE)
+            {
+                free(reply);
+                reply = NULL;
+            }
+
+            snapshot->properties[snapshot->propertiesCount].atom = atoms[j];
+            snapshot->properties[snapshot->propertiesCount].reply = reply;
+            snapshot->propertiesCount++;
+        }
+
+        [snapshots addObject:snapshot];
+    }
+
+    free(attributeCookies);
+    free(geometryCookies);
+    free(propertyCookies);
+
+    return snapshots;
+}
+
+- (xcb_get_window_attributes_reply_t *) attributes
+{
+    return attributes;
+}
+
+- (xcb_get_geometry_reply_t *) geometry
+{
+    return geometry;
+}
+
+- (void) discardGeometryAndAttributes
+{
+    free(attributes);
+    free(geometry);
+    attributes = NULL;
+    geometry = NULL;
+}
+
+- (void) discardGeometry
+{
+    free(geometry);
+    geometry = NULL;
+}
+
+- (void) invalidateAtom:(xcb_atom_t)anAtom
+{
+    XCBSnapshotProperty *entry = [self entryForAtom:anAtom];
+
+    if (entry == NULL)
+        return;
+
+    free(entry->reply);
+    *entry = properties[--propertiesCount];
+}
+
+- (XCBSnapshotProperty *) entryForAtom:(xcb_atom_t)anAtom
+{
+    for (NSUInteger i = 0; i < propertiesCount; i++)
+    {
+        if (properties[i].atom == anAtom)
+            return &properties[i];
+    }
+
+    return NULL;
+}
+
+- (BOOL) containsAtom:(xcb_atom_t)anAtom
+{
+    return [self entryForAtom:anAtom] != NULL;
+}
+
+- (xcb_get_property_reply_t *) propertyForAtom:(xcb_atom_t)anAtom
+{
+    XCBSnapshotProperty *entry = [self entryForAtom:anAtom];
+    return entry != NULL ? entry->reply : NULL;
+}
+
+/*** Replies are 32 bytes plus length 4-byte units, the same size the server sent ***/
+static void *FnCopyReply(const void *aReply, uint32_t length)
+{
+    if (aReply == NULL)
+        return NULL;
+
+    size_t size = 32 + (size_t) length * 4;
+    void *copy = malloc(size);
+
+    if (copy != NULL)
+        memcpy(copy, aReply, size);
+
+    return copy;
+}
+
+- (xcb_get_window_attributes_reply_t *) copyAttributes
+{
+    return attributes != NULL ? FnCopyReply(attributes, attributes->length) : NULL;
+}
+
+- (xcb_get_geometry_reply_t *) copyGeometry
+{
+    return geometry != NULL ? FnCopyReply(geometry, geometry->length) : NULL;
+}
+
+- (xcb_get_property_reply_t *) copyPropertyForAtom:(xcb_atom_t)anAtom
+{
+    xcb_get_property_reply_t *reply = [self propertyForAtom:anAtom];
+    return reply != NULL ? FnCopyReply(reply, reply->length) : NULL;
+}
+
+- (void) dealloc
+{
+    for (NSUInteger i = 0; i < propertiesCount; i++)
+        free(properties[i].reply);
+
+    free(properties);
+    free(attributes);
+    free(geometry);
+}
+
+@end
@@ -0,0 +1,29 @@
+//
+//  XCBWindowTable.h
+//  XCBKit
+//
+//  Open-addressing hash table keyed by xcb_window_t.
+//  Lookups do not allocate (no boxed NSNumber keys), and the table can be
+//  iterated with for...in, yielding the stored objects.
+//
+
+#import <Foundation/Foundation.h>
+#include <xcb/xcb.h>
+
+@interface XCBWindowTable : NSObject <NSFastEnumeration>
+
+- (id) initWithCapacity:(NSUInteger)aCapacity;
+
+- (id) objectForWindow:(xcb_window_t)aWindow;
+- (void) setObject:(id)anObject forWindow:(xcb_window_t)aWindow;
+- (void) removeObjectForWindow:(xcb_window_t)aWindow;
+- (void) removeAllObjects;
+- (NSUInteger) count;
+
+/*** Snapshot of the stored objects, for callers that mutate the table while iterating ***/
+- (NSArray *) allObjects;
+
+/*** Compares lookups against an NSMutableDictionary keyed by NSNumber and returns a report ***/
++ (NSString *) lookupBenchmarkWithWindowCount:(NSUInteger)windowCount iterations:(NSUInteger)iterations;
+
+@end
@@ -0,0 +1,307 @@
+//
+//  XCBWindowTable.m
+//  XCBKit
+//
+//  Linear probing with backward-shift deletion, so there are no tombstones
+//  and a lookup is a multiply, a mask and a short scan.
+//
+
+#import "XCBWindowTable.h"
+#include <time.h>
+
+typedef struct _XCBWindowTableSlot
+{
+    xcb_window_t window;   /*** XCB_NONE marks an empty slot ***/
+    void *object;          /*** retained ***/
+} XCBWindowTableSlot;
+
+static inline NSUInteger XCBWindowTableHash(xcb_window_t aWindow, unsigned int shift)
+{
+    /*** Fibonacci hashing spreads the sequential ids of one client over the table ***/
+    return (uint32_t)(aWindow * 2654435769u) >> shift;
+}
+
+@implementation XCBWindowTable
+{
+    XCBWindowTableSlot *slots;
+    NSUInteger capacity;
+    unsigned int shift;    /*** 32 - log2(capacity) ***/
+    NSUInteger count;
+    unsigned long mutations;
+}
+
+- (id) init
+{
+    return [self initWithCapacity:64];
+}
+
+- (id) initWithCapacity:(NSUInteger)aCapacity
+{
+    self = [super init];
+
+    if (self == nil)
+    {
+        NSLog(@"Unable to init");
+        return nil;
+    }
+
+    /*** keep the load factor at or below one half ***/
+    capacity = 16;
+    shift = 28;
+
+    while (capacity < aCapacity * 2)
+    {
+        capacity *= 2;
+        shift--;
+    }
+
+    slots = calloc(capacity, sizeof(XCBWindowTableSlot));
+    count = 0;
+    mutations = 0;
+
+    return self;
+}
+
+- (NSUInteger) slotIndexForWindow:(xcb_window_t)aWindow
+{
+    NSUInteger mask = capacity - 1;
+    NSUInteger i = XCBWindowTableHash(aWindow, shift);
+
+    while (slots[i].window != XCB_NONE && slots[i].window != aWindow)
+        i = (i + 1) & mask;
+
+    return i;
+}
+
+- (void) grow
+{
+    XCBWindowTableSlot *oldSlots = slots;
+    NSUInteger oldCapacity = capacity;
+
+    capacity *= 2;
+    shift--;
+    slots = calloc(capacity, sizeof(XCBWindowTableSlot));
+
+    for (NSUInteger i = 0; i < oldCapacity; i++)
+    {
+        if (oldSlots[i].window == XCB_NONE)
+            continue;
+
+        NSUInteger j = [self slotIndexForWindow:oldSlots[i].window];
+        slots[j] = oldSlots[i];
+    }
+
+    free(oldSlots);
+}
+
+- (id) objectForWindow:(xcb_window_t)aWindow
+{
+    if (aWindow == XCB_NONE)
+        return nil;
+
+    NSUInteger i = [self slotIndexForWindow:aWindow];
+
+    if (slots[i].window == XCB_NONE)
+        return nil;
+
+    return (__bridge id) slots[i].object;
+}
+
+- (void) setObject:(id)anObject forWindow:(xcb_window_t)aWindow
+{
+    if (aWindow == XCB_NONE)
+        return;
+
+    if (anObject == nil)
+    {
+        [self removeObjectForWindow:aWindow];
+        return;
+    }
+
+    if ((count + 1) * 2 > capacity)
+        [self grow];
+
+    NSUInteger i = [self slotIndexForWindow:aWindow];
+
+    if (slots[i].window == aWindow)
+    {
+        id old = (__bridge_transfer id) slots[i].object;
+        slots[i].object = (__bridge_retained void *) anObject;
+        old = nil;
+        return;
+    }
+
+    slots[i].window = aWindow;
+    slots[i].object = (__bridge_retained void *) anObject;
+    count++;
+    mutations++;
+}
+
+- (void) removeObjectForWindow:(xcb_window_t)aWindow
+{
+    if (aWindow == XCB_NONE)
+        return;
+
+    NSUInteger mask = capacity - 1;
+    NSUInteger i = [self slotIndexForWindow:aWindow];
+
+    if (slots[i].window == XCB_NONE)
+        return;
+
+    id old = (__bridge_transfer id) slots[i].object;
+    old = nil;
+
+    /*** shift the following entries back so every probe chain stays unbroken ***/
+    NSUInteger j = i;
+
+    for (;;)
+    {
+        j = (j + 1) & mask;
+
+        if (slots[j].window == XCB_NONE)
+            break;
+
+        NSUInteger home = XCBWindowTableHash(slots[j].window, shift);
+        BOOL movable = (j > i) ? (home <= i || home > j) : (home <= i && home > j);
+
+        if (movable)
+        {
+            slots[i] = slots[j];
+            i = j;
+        }
+    }
+
+    slots[i].window = XCB_NONE;
+    slots[i].object = NULL;
+    count--;
+    mutations++;
+}
+
+- (void) removeAllObjects
+{
+    for (NSUInteger i = 0; i < capacity; i++)
+    {
+        if (slots[i].window == XCB_NONE)
+            continue;
+
+        id old = (__bridge_transfer id) slots[i].object;
+        old = nil;
+        slots[i].window = XCB_NONE;
+        slots[i].object = NULL;
+    }
+
+    count = 0;
+    mutations++;
+}
+
+- (NSUInteger) count
+{
+    return count;
+}
+
+- (NSArray *) allObjects
+{
+    NSMutableArray *objects = [NSMutableArray arrayWithCapacity:count];
+
+    for (NSUInteger i = 0; i < capacity; i++)
+    {
+        if (slots[i].window != XCB_NONE)
+            [objects addObject:(__bridge id) slots[i].object];
+    }
+
+    return objects;
+}
+
+- (NSUInteger) countByEnumeratingWithState:(NSFastEnumerationState *)state
+                                   objects:(id __unsafe_unretained [])buffer
+                                     count:(NSUInteger)length
+{
+    /*** state->extra[0] holds the next slot to visit ***/
+    if (state->state == 0)
+    {
+        state->state = 1;
+        state->mutationsPtr = &mutations;
+        state->extra[0] = 0;
+    }
+
+    NSUInteger i = state->extra[0];
+    NSUInteger filled = 0;
+
+    while (i < capacity && filled < length)
+    {
+        if (slots[i].window != XCB_NONE)
+            buffer[filled++] = (__bridge id) slots[i].object;
+
+        i++;
+    }
+
+    state->extra[0] = i;
+    state->itemsPtr = buffer;
+
+    return filled;
+}
+
+static double XCBWindowTableNow(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
++ (NSString *) lookupBenchmarkWithWindowCount:(NSUInteger)windowCount iterations:(NSUInteger)iterations
+{
+    XCBWindowTable *table = [[XCBWindowTable alloc] initWithCapacity:windowCount];
+    NSMutableDictionary *dictionary = [[NSMutableDictionary alloc] initWithCapacity:windowCount];
+    xcb_window_t *ids = malloc(windowCount * sizeof(xcb_window_t));
+
+    /*** ids as a server hands them out: a few clients, sequential within each ***/
+    for (NSUInteger i = 0; i < windowCount; i++)
+    {
+        ids[i] = (xcb_window_t) (((i % 8) + 1) << 21 | (i / 8 + 1));
+        NSObject *object = [[NSObject alloc] init];
+        [table setObject:object forWindow:ids[i]];
+        [dictionary setObject:object forKey:[NSNumber numberWithInt:ids[i]]];
+    }
+
+    NSUInteger hits = 0;
+    double start = XCBWindowTableNow();
+
+    for (NSUInteger n = 0; n < iterations; n++)
+    {
+        if ([table objectForWindow:ids[n % windowCount]] != nil)
+            hits++;
+    }
+
+    double tableTime = XCBWindowTableNow() - start;
+    start = XCBWindowTableNow();
+
+    for (NSUInteger n = 0; n < iterations; n++)
+    {
+        @autoreleasepool
+        {
+            NSNumber *key = [NSNumber numberWithInt:ids[n % windowCount]];
+
+            if ([dictionary objectForKey:key] != nil)
+                hits++;
+        }
+    }
+
+    double dictionaryTime = XCBWindowTableNow() - start;
+    free(ids);
+
+    return [NSString stringWithFormat:@"%lu windows, %lu lookups (%lu hits): XCBWindowTable %.1f ns/lookup, NSMutableDictionary %.1f ns/lookup",
+            (unsigned long) windowCount,
+            (unsigned long) iterations,
+            (unsigned long) hits,
+            tableTime * 1e9 / iterations,
+            dictionaryTime * 1e9 / iterations];
+}
+
+- (void) dealloc
+{
+    [self removeAllObjects];
+    free(slots);
+    slots = NULL;
+}
+
+@end